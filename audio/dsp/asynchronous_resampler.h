@@ -0,0 +1,322 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Asynchronous sample rate conversion with a continuously adjustable ratio.
+//
+// AsynchronousResampler bridges two independent clocks, e.g. a capture device
+// and a playback device, or a network jitter buffer and a device, whose rates
+// are nominally related but drift. A controller, typically driven by the fill
+// level of the buffer between the clock domains, calls AdjustRatio() between
+// blocks to speed up or slow down the consumption of input.
+//
+// The filter for each output sample is interpolated from the oversampled kernel
+// table of PolyphaseTableMode::kLinearInterpolation or kCubicInterpolation [see
+// resampler_rational_factor.h], so the ratio can change without rebuilding any
+// tables, and the cost per output sample is the same as for a
+// RationalFactorResampler in the same table mode.
+
+#ifndef AUDIO_DSP_ASYNCHRONOUS_RESAMPLER_H_
+#define AUDIO_DSP_ASYNCHRONOUS_RESAMPLER_H_
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "audio/dsp/resampler.h"
+#include "audio/dsp/resampler_rational_factor.h"
+#include "audio/dsp/types.h"
+#include "glog/logging.h"
+#include "absl/types/span.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+
+// ValueType may be float, double, complex<float>, or complex<double>.
+//
+// The position in the input advances by factor() input samples per output
+// sample. It is tracked in fixed point with kPhaseBits fractional bits, so it
+// does not drift over long streams, and the number of output samples for a
+// block is exact [see ComputeOutputSize()].
+template <typename ValueType>
+class AsynchronousResampler: public Resampler<ValueType> {
+ public:
+  static constexpr int kPhaseBits = 32;
+
+  // Construct with the nominal resampling factor
+  // kernel.input_sample_rate() / kernel.output_sample_rate(). table_mode must
+  // be kLinearInterpolation or kCubicInterpolation.
+  explicit AsynchronousResampler(
+      const ResamplingKernel& kernel,
+      PolyphaseTableMode table_mode = PolyphaseTableMode::kCubicInterpolation) {
+    // Skip initialization on invalid parameters.
+    if (!kernel.Valid() || table_mode == PolyphaseTableMode::kExact) {
+      return;
+    }
+    table_mode_ = table_mode;
+    oversampling_ = (table_mode == PolyphaseTableMode::kLinearInterpolation)
+        ? kLinearInterpolationOversampling : kCubicInterpolationOversampling;
+    filters_ = GetOversampledFilters<CoefficientType>(kernel, oversampling_);
+    nominal_factor_ =
+        kernel.input_sample_rate() / kernel.output_sample_rate();
+    radius_ = std::ceil(kernel.radius());
+    num_taps_ = 2 * radius_ + 1;
+    history_.resize(2 * num_taps_ - 1);
+    AdjustRatio(1.0);
+    valid_ = true;
+    this->Reset();
+  }
+
+  ~AsynchronousResampler() override {}
+
+  // Sets the resampling factor to ratio * nominal_factor(), taking effect from
+  // the next output sample. A ratio above 1 consumes input faster, e.g.
+  // 1 + 1e-4 when the input clock runs 100 ppm fast. The kernel is designed
+  // for the nominal factor, so ratio should stay close to 1, and the factor
+  // must not exceed 2 * radius() + 1. Does not allocate.
+  void AdjustRatio(double ratio) {
+    DCHECK_GT(ratio, 0.0);
+    step_ = std::llround(ratio * nominal_factor_ * kPhaseScale);
+    DCHECK_GT(step_, 0);
+  }
+
+  // The current resampling factor in input samples per output sample, as
+  // represented in fixed point.
+  double factor() const { return static_cast<double>(step_) / kPhaseScale; }
+  double nominal_factor() const { return nominal_factor_; }
+  int radius() const { return radius_; }
+  PolyphaseTableMode table_mode() const { return table_mode_; }
+
+  void ResetImpl() override {
+    phase_ = 0;
+    history_.head(radius_).setZero();
+    num_delayed_ = radius_;
+  }
+
+  bool ValidImpl() const override {
+    return valid_;
+  }
+
+  void ProcessSamplesImpl(const std::vector<ValueType>& input,
+                          std::vector<ValueType>* output) override {
+    output->resize(ComputeOutputSize(static_cast<int>(input.size())));
+    using EigenVectorType = Eigen::Matrix<ValueType, Eigen::Dynamic, 1>;
+    Eigen::Map<const EigenVectorType> input_map(input.data(), input.size());
+    Eigen::Map<EigenVectorType> output_map(output->data(), output->size());
+    ProcessSamplesEigen(input_map, &output_map);
+  }
+
+  // A version of ProcessSamples() for one dimensional Eigen types. This does
+  // not allocate if output already has ComputeOutputSize(input.size())
+  // samples, so it is realtime safe.
+  template <typename EigenType1, typename EigenType2>
+  void ProcessSamplesEigen(const EigenType1& input, EigenType2* output) {
+    DCHECK(output != nullptr);
+    DCHECK_LT(num_delayed_, num_taps_);
+    static_assert(std::is_same<typename EigenType1::Scalar,
+                               typename EigenType2::Scalar>::value,
+                  "input and output must have the same scalar type");
+
+    const int input_size = static_cast<int>(input.size());
+    output->resize(ComputeOutputSize(input_size));
+    int output_samples = 0;
+    // As in RationalFactorResampler, the position in the input is
+    // (window_start + phase_ / 2^kPhaseBits) input samples, and the window
+    // starts in the delayed input while window_start is negative.
+    int window_start = -num_delayed_;
+
+    if (num_delayed_ > 0) {
+      const int num_appended = std::min(num_taps_ - 1, input_size);
+      history_.segment(num_delayed_, num_appended) =
+          input.matrix().head(num_appended);
+      const int history_size = num_delayed_ + num_appended;
+      while (window_start < 0 &&
+             window_start + num_delayed_ + num_taps_ <= history_size) {
+        DCHECK_LT(output_samples, output->size());
+        (*output)[output_samples] = ApplyFilter(
+            phase_, history_.segment(window_start + num_delayed_, num_taps_));
+        ++output_samples;
+        window_start += Advance(&phase_);
+      }
+      if (window_start < 0) {
+        // Ran out of input samples before consuming all the delayed input.
+        const int first_needed = window_start + num_delayed_;
+        std::copy(history_.data() + first_needed,
+                  history_.data() + history_size, history_.data());
+        num_delayed_ = history_size - first_needed;
+        return;
+      }
+    }
+
+    uint64_t phase = phase_;
+    while (window_start + num_taps_ <= input_size) {
+      DCHECK_LT(output_samples, output->size());
+      (*output)[output_samples] =
+          ApplyFilter(phase, input.matrix().segment(window_start, num_taps_));
+      ++output_samples;
+      window_start += Advance(&phase);
+    }
+    phase_ = phase;
+    DCHECK_EQ(output_samples, output->size());
+
+    // Save the rest of the input, which is less than a full window.
+    DCHECK_LE(window_start, input_size);
+    num_delayed_ = input_size - window_start;
+    history_.head(num_delayed_) =
+        input.matrix().segment(window_start, num_delayed_);
+  }
+
+  void FlushImpl(std::vector<ValueType>* output) override {
+    // As for RationalFactorResampler, num_taps_ - 1 zeros process all the
+    // delayed input.
+    const std::vector<ValueType> input(num_taps_ - 1, ValueType(0));
+    this->ProcessSamples(input, output);
+  }
+
+  // A version of Flush() that supports Eigen types.
+  template <typename EigenType>
+  void FlushEigen(EigenType* output) {
+    this->ProcessSamplesEigen(
+        Eigen::Matrix<ValueType, Eigen::Dynamic, 1>::Zero(num_taps_ - 1),
+        output);
+    this->Reset();
+  }
+
+  // Returns the number of output samples that the next call to
+  // ProcessSamplesEigen() produces for input_size input samples at the current
+  // factor. This is the smallest o with
+  //   floor((phase + o step) / 2^kPhaseBits) >= a - num_taps + 1
+  // where a is the number of delayed and new input samples [see
+  // RationalFactorResampler::ComputeOutputSizeFromCurrentState()].
+  int ComputeOutputSize(int input_size) const {
+    const int64 min_consumed_input =
+        static_cast<int64>(num_delayed_) + input_size - num_taps_ + 1;
+    if (min_consumed_input <= 0) {
+      return 0;
+    }
+    const uint64_t target =
+        static_cast<uint64_t>(min_consumed_input) << kPhaseBits;
+    return (target - phase_ + step_ - 1) / step_;
+  }
+
+  // Returns an upper bound of ComputeOutputSize(input_size) over all states at
+  // the current factor. Callers that adjust the ratio should size buffers for
+  // the smallest ratio, which produces the most output.
+  int MaxOutputSize(int input_size) const {
+    if (input_size <= 0) {
+      return 0;
+    }
+    return ((static_cast<uint64_t>(input_size) << kPhaseBits) + step_ - 1) /
+        step_;
+  }
+
+  // Returns the number of output samples that Flush() produces, which is at
+  // most MaxOutputSize(2 * radius()).
+  int ComputeFlushSize() const {
+    return ComputeOutputSize(num_taps_ - 1);
+  }
+
+  // Versions of ProcessSamples() and Flush() that write to caller-owned
+  // output, as for RationalFactorResampler. Do not allocate.
+  using Resampler<ValueType>::ProcessSamples;
+  int ProcessSamples(absl::Span<const ValueType> input,
+                     absl::Span<ValueType> output) {
+    DCHECK(this->Valid());
+    DCHECK(input.data() != output.data()) << "Cannot resample in place!";
+    const int output_size = ComputeOutputSize(input.size());
+    DCHECK_LE(output_size, output.size());
+    using EigenVectorType = Eigen::Matrix<ValueType, Eigen::Dynamic, 1>;
+    Eigen::Map<const EigenVectorType> input_map(input.data(), input.size());
+    Eigen::Map<EigenVectorType> output_map(output.data(), output_size);
+    ProcessSamplesEigen(input_map, &output_map);
+    return output_size;
+  }
+
+  using Resampler<ValueType>::Flush;
+  int Flush(absl::Span<ValueType> output) {
+    DCHECK(this->Valid());
+    const int output_size = ComputeFlushSize();
+    DCHECK_LE(output_size, output.size());
+    Eigen::Map<Eigen::Matrix<ValueType, Eigen::Dynamic, 1>> output_map(
+        output.data(), output_size);
+    FlushEigen(&output_map);
+    return output_size;
+  }
+
+ private:
+  typedef typename RealType<ValueType>::Type CoefficientType;
+  static constexpr uint64_t kPhaseScale = uint64_t{1} << kPhaseBits;
+
+  // Advances the position by one output sample and returns the number of
+  // input samples stepped over.
+  int Advance(uint64_t* phase) const {
+    *phase += step_;
+    const int num_stepped = *phase >> kPhaseBits;
+    *phase &= kPhaseScale - 1;
+    return num_stepped;
+  }
+
+  // Returns the output sample at the fractional position phase, where window is
+  // the num_taps_ input samples under the filter.
+  template <typename WindowType>
+  ValueType ApplyFilter(uint64_t phase, const WindowType& window) const {
+    const PolyphaseFilters<CoefficientType>& filters = *filters_;
+    // The phase is (index + a) / oversampling_ with 0 <= a < 1.
+    const uint64_t scaled_phase = phase * oversampling_;
+    const int index = scaled_phase >> kPhaseBits;
+    const double a = static_cast<double>(scaled_phase & (kPhaseScale - 1)) /
+        kPhaseScale;
+    CoefficientType weights[4];
+    ComputeInterpolationWeights(table_mode_, a, weights);
+    if (table_mode_ == PolyphaseTableMode::kLinearInterpolation) {
+      return (weights[0] * filters.col(index + 1) +
+              weights[1] * filters.col(index + 2)).dot(window);
+    } else {
+      return (weights[0] * filters.col(index) +
+              weights[1] * filters.col(index + 1) +
+              weights[2] * filters.col(index + 2) +
+              weights[3] * filters.col(index + 3)).dot(window);
+    }
+  }
+
+  bool valid_ = false;
+  PolyphaseTableMode table_mode_;
+  int oversampling_;
+  double nominal_factor_;
+  int radius_;
+  int num_taps_;
+  // Input samples per output sample, in units of 2^-kPhaseBits.
+  uint64_t step_;
+  // Shared with other resamplers using the same kernel and table mode.
+  std::shared_ptr<const PolyphaseFilters<CoefficientType>> filters_;
+
+  // Fractional part of the position, in units of 2^-kPhaseBits input samples.
+  uint64_t phase_;
+  // The first num_delayed_ samples are input that has not been fully consumed.
+  // As in RationalFactorResampler, up to num_taps_ - 1 input samples are
+  // appended so that windows straddling the delayed input are contiguous.
+  Eigen::Matrix<ValueType, Eigen::Dynamic, 1> history_;
+  int num_delayed_;
+};
+
+}  // namespace audio_dsp
+
+#endif  // AUDIO_DSP_ASYNCHRONOUS_RESAMPLER_H_
@@ -0,0 +1,221 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/asynchronous_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "audio/dsp/heap_allocation_counter.h"
+#include "audio/dsp/resampler_rational_factor.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_format.h"
+#include "absl/types/span.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+namespace {
+
+using ::Eigen::VectorXf;
+
+std::vector<float> RandomVector(int size, std::mt19937* rng) {
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  std::vector<float> samples(size);
+  for (float& sample : samples) {
+    sample = distribution(*rng);
+  }
+  return samples;
+}
+
+// At the nominal ratio, the output matches a RationalFactorResampler in the
+// same table mode, up to the rounding of the factor to kPhaseBits bits. Where
+// the rounded position falls just below a whole input sample instead of on it,
+// the filter window is shifted by one sample and the result differs by the
+// truncation of the kernel at the edges of its support.
+TEST(AsynchronousResamplerTest, MatchesRationalFactorResampler) {
+  std::mt19937 rng(0 /* seed */);
+  const std::vector<float> input = RandomVector(3000, &rng);
+  for (const auto& rates : std::vector<std::pair<double, double>>{
+           {48000, 16000}, {44100, 48000}, {48000, 44100}, {16000, 48000}}) {
+    for (auto table_mode : {PolyphaseTableMode::kLinearInterpolation,
+                            PolyphaseTableMode::kCubicInterpolation}) {
+      SCOPED_TRACE(absl::StrFormat("Resampling from %gHz to %gHz, mode %d",
+                                   rates.first, rates.second,
+                                   static_cast<int>(table_mode)));
+      DefaultResamplingKernel kernel(rates.first, rates.second);
+      AsynchronousResampler<float> resampler(kernel, table_mode);
+      ASSERT_TRUE(resampler.Valid());
+      EXPECT_EQ(resampler.table_mode(), table_mode);
+      EXPECT_DOUBLE_EQ(resampler.nominal_factor(), rates.first / rates.second);
+      EXPECT_NEAR(resampler.factor(), resampler.nominal_factor(), 1e-9);
+      RationalFactorResampler<float> expected_resampler(kernel, 1000,
+                                                        table_mode);
+      std::vector<float> output;
+      std::vector<float> expected;
+      resampler.ProcessSamples(input, &output);
+      expected_resampler.ProcessSamples(input, &expected);
+      // The rounding may also move the last position across the end of the
+      // input.
+      ASSERT_NEAR(output.size(), expected.size(), 1);
+      for (int i = 0; i < std::min(output.size(), expected.size()); ++i) {
+        ASSERT_NEAR(output[i], expected[i], 1e-3) << "i: " << i;
+      }
+    }
+  }
+}
+
+// Streams blocks of random sizes, adjusting the ratio before each block, and
+// checks that the output is the resampled sine at the adjusted rate.
+TEST(AsynchronousResamplerTest, FollowsAdjustedRatio) {
+  constexpr double kSampleRate = 48000;
+  constexpr double kFrequency = 1000;
+  constexpr int kNumSamples = 48000;
+  std::vector<float> input(kNumSamples);
+  for (int n = 0; n < kNumSamples; ++n) {
+    input[n] = std::sin(2 * M_PI * kFrequency * n / kSampleRate);
+  }
+  AsynchronousResampler<float> resampler(
+      DefaultResamplingKernel(kSampleRate, kSampleRate));
+  const int radius = resampler.radius();
+  std::mt19937 rng(0 /* seed */);
+  std::uniform_int_distribution<int> block_size_distribution(0, 500);
+  std::uniform_real_distribution<double> ratio_distribution(0.99, 1.01);
+  // Position of the next output sample in input samples.
+  double position = 0.0;
+  std::vector<float> output;
+  for (int start = 0; start < kNumSamples;) {
+    const int block_size =
+        std::min(block_size_distribution(rng), kNumSamples - start);
+    resampler.AdjustRatio(ratio_distribution(rng));
+    const int expected_size = resampler.ComputeOutputSize(block_size);
+    resampler.ProcessSamples(std::vector<float>(
+        input.begin() + start, input.begin() + start + block_size), &output);
+    ASSERT_EQ(output.size(), expected_size);
+    for (float sample : output) {
+      // Skip the start, where the kernel overlaps the zeros before the input.
+      if (position > radius) {
+        ASSERT_NEAR(sample,
+                    std::sin(2 * M_PI * kFrequency * position / kSampleRate),
+                    2e-3) << "position: " << position;
+      }
+      position += resampler.factor();
+    }
+    start += block_size;
+    // All input within the radius of the next output is not yet consumed.
+    ASSERT_GT(position + radius, start - 1);
+    ASSERT_LE(position + radius, start + resampler.factor());
+  }
+}
+
+TEST(AsynchronousResamplerTest, DoesNotAllocate) {
+  AsynchronousResampler<float> resampler(DefaultResamplingKernel(44100, 48000));
+  std::mt19937 rng(0 /* seed */);
+  for (int block_size : {441, 1, 0, 1000, 50, 441}) {
+    SCOPED_TRACE("block_size: " + testing::PrintToString(block_size));
+    const std::vector<float> input_vector = RandomVector(block_size, &rng);
+    const Eigen::Map<const VectorXf> input(input_vector.data(), block_size);
+    VectorXf output(2 * block_size + 1);
+    {
+      ScopedHeapAllocationCounter counter;
+      resampler.AdjustRatio(1.0 + 1e-4 * block_size);
+      auto output_segment =
+          output.head(resampler.ComputeOutputSize(block_size));
+      resampler.ProcessSamplesEigen(input, &output_segment);
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+  }
+}
+
+TEST(AsynchronousResamplerTest, SpanApi) {
+  constexpr int kBlockSize = 100;
+  DefaultResamplingKernel kernel(44100, 48000);
+  AsynchronousResampler<float> resampler(kernel);
+  AsynchronousResampler<float> expected_resampler(kernel);
+  std::mt19937 rng(0 /* seed */);
+  const std::vector<float> input = RandomVector(kBlockSize, &rng);
+  // Size the output for the ratio that produces the most samples.
+  resampler.AdjustRatio(0.999);
+  std::vector<float> output(
+      std::max(resampler.MaxOutputSize(kBlockSize),
+               resampler.MaxOutputSize(2 * resampler.radius())));
+  std::vector<float> expected;
+  for (double ratio : {1.0, 1.001, 0.999}) {
+    resampler.AdjustRatio(ratio);
+    expected_resampler.AdjustRatio(ratio);
+    expected_resampler.ProcessSamples(input, &expected);
+    ScopedHeapAllocationCounter counter;
+    const int num_written =
+        resampler.ProcessSamples(input, absl::MakeSpan(output));
+    EXPECT_EQ(counter.num_allocations(), 0);
+    ASSERT_EQ(num_written, expected.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), output.begin()));
+  }
+  expected_resampler.Flush(&expected);
+  ASSERT_EQ(resampler.Flush(absl::MakeSpan(output)), expected.size());
+  EXPECT_TRUE(std::equal(expected.begin(), expected.end(), output.begin()));
+}
+
+TEST(AsynchronousResamplerTest, InvalidParameters) {
+  EXPECT_FALSE(AsynchronousResampler<float>(
+      DefaultResamplingKernel(44100, -1)).Valid());
+  EXPECT_FALSE(AsynchronousResampler<float>(
+      DefaultResamplingKernel(44100, 48000), PolyphaseTableMode::kExact)
+      .Valid());
+}
+
+// Compares adjusting the ratio every 10ms block to fixed-ratio resampling with
+// the same table mode, from 44.1kHz to 48kHz.
+constexpr int kBenchmarkBlockSize = 441;
+
+void BM_AsynchronousResampler(benchmark::State& state) {
+  std::mt19937 rng(0 /* seed */);
+  const std::vector<float> input = RandomVector(kBenchmarkBlockSize, &rng);
+  AsynchronousResampler<float> resampler(DefaultResamplingKernel(44100, 48000));
+  std::vector<float> output;
+  double ratio = 1.0;
+  while (state.KeepRunning()) {
+    ratio = (ratio > 1.0) ? 1.0 - 1e-4 : 1.0 + 1e-4;
+    resampler.AdjustRatio(ratio);
+    resampler.ProcessSamples(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK(BM_AsynchronousResampler);
+
+void BM_RationalFactorResamplerCubic(benchmark::State& state) {
+  std::mt19937 rng(0 /* seed */);
+  const std::vector<float> input = RandomVector(kBenchmarkBlockSize, &rng);
+  RationalFactorResampler<float> resampler(
+      DefaultResamplingKernel(44100, 48000), 1000,
+      PolyphaseTableMode::kCubicInterpolation);
+  std::vector<float> output;
+  while (state.KeepRunning()) {
+    resampler.ProcessSamples(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK(BM_RationalFactorResamplerCubic);
+
+}  // namespace
+}  // namespace audio_dsp
@@ -16,6 +16,7 @@
 
 #include "audio/dsp/attack_release_envelope.h"
 
+#include <algorithm>
 #include <cmath>
 
 #include "audio/linear_filters/discretization.h"
@@ -27,47 +28,166 @@ namespace audio_dsp {
 using ::linear_filters::FirstOrderCoefficientFromTimeConstant;
 using ::linear_filters::LowpassBiquadFilterCoefficients;
 
+namespace {
+
+// The control rate is at least this many times the interpolation rate, so
+// that holding the coefficients over a control period is not audible.
+constexpr float kControlRateFactor = 16.0f;
+
+// The envelope update with coefficient attack when rectified > envelope and
+// release otherwise, without a branch. One of the two terms is zero.
+inline float NextEnvelope(float rectified, float envelope, float attack,
+                          float release) {
+  const float difference = rectified - envelope;
+  return envelope + attack * std::max(difference, 0.0f) +
+         release * std::min(difference, 0.0f);
+}
+
+}  // namespace
+
 AttackReleaseEnvelope::AttackReleaseEnvelope(
-    const AttackReleaseEnvelopeParams& params, float sample_rate_hz)
-    :  envelope_(0.0),
-       attack_(FirstOrderCoefficientFromTimeConstant(params.attack_s,
-                                                     sample_rate_hz)),
-       release_(FirstOrderCoefficientFromTimeConstant(params.release_s,
-                                                      sample_rate_hz)),
+    int num_channels, const AttackReleaseEnvelopeParams& params,
+    float sample_rate_hz)
+    :  num_channels_(num_channels),
+       envelope_(num_channels),
+       attack_(Eigen::ArrayXf::Constant(
+           num_channels, FirstOrderCoefficientFromTimeConstant(
+                             params.attack_s, sample_rate_hz))),
+       release_(Eigen::ArrayXf::Constant(
+           num_channels, FirstOrderCoefficientFromTimeConstant(
+                             params.release_s, sample_rate_hz))),
        sample_rate_hz_(sample_rate_hz) {
+    CHECK_GT(num_channels, 0);
+    CHECK_GT(params.max_control_period_samples, 0);
+    control_period_samples_ = std::max(1, std::min(
+        params.max_control_period_samples,
+        static_cast<int>(sample_rate_hz /
+                         (kControlRateFactor * params.interpolation_rate_hz))));
     constexpr float kOverdamped = 0.49;  // Prevent param oscillations.
     linear_filters::BiquadFilterCoefficients smoothing_coeffs =
-        LowpassBiquadFilterCoefficients(sample_rate_hz,
-                                        params.interpolation_rate_hz,
-                                        kOverdamped);
-    constexpr int kOneChannel = 1;
-    attack_param_smoother_.Init(kOneChannel, smoothing_coeffs);
-    release_param_smoother_.Init(kOneChannel, smoothing_coeffs);
+        LowpassBiquadFilterCoefficients(
+            sample_rate_hz / control_period_samples_,
+            params.interpolation_rate_hz, kOverdamped);
+    // We don't stop smoothing until the coefficients are within -80dB of
+    // their target value.
+    smoothing_updates_max_ =
+        std::ceil(smoothing_coeffs.EstimateDecayTime(80.0));
+    attack_param_smoother_.Init(num_channels, smoothing_coeffs);
+    release_param_smoother_.Init(num_channels, smoothing_coeffs);
     Reset();
 }
 
 void AttackReleaseEnvelope::SetAttackTimeSeconds(float attack_s) {
-  attack_ = FirstOrderCoefficientFromTimeConstant(attack_s, sample_rate_hz_);
+  attack_.setConstant(
+      FirstOrderCoefficientFromTimeConstant(attack_s, sample_rate_hz_));
+  smoothing_updates_ = smoothing_updates_max_;
 }
 
 void AttackReleaseEnvelope::SetReleaseTimeSeconds(float release_s) {
-  release_ = FirstOrderCoefficientFromTimeConstant(release_s, sample_rate_hz_);
+  release_.setConstant(
+      FirstOrderCoefficientFromTimeConstant(release_s, sample_rate_hz_));
+  smoothing_updates_ = smoothing_updates_max_;
 }
 
-float AttackReleaseEnvelope::Output(float input) {
-  float rectified = std::abs(input);
+void AttackReleaseEnvelope::SetAttackTimeSeconds(int channel, float attack_s) {
+  DCHECK_GE(channel, 0);
+  DCHECK_LT(channel, num_channels_);
+  attack_[channel] =
+      FirstOrderCoefficientFromTimeConstant(attack_s, sample_rate_hz_);
+  // The smoothing runs on all channels, but leaves those at their targets
+  // unchanged.
+  smoothing_updates_ = smoothing_updates_max_;
+}
 
-  float current_attack;
-  attack_param_smoother_.ProcessSample(attack_, &current_attack);
-  float current_release;
-  release_param_smoother_.ProcessSample(release_, &current_release);
-  const float coefficient =
-      rectified > envelope_ ? current_attack : current_release;
-  envelope_ += coefficient * (rectified - envelope_);
+void AttackReleaseEnvelope::SetReleaseTimeSeconds(int channel,
+                                                  float release_s) {
+  DCHECK_GE(channel, 0);
+  DCHECK_LT(channel, num_channels_);
+  release_[channel] =
+      FirstOrderCoefficientFromTimeConstant(release_s, sample_rate_hz_);
+  smoothing_updates_ = smoothing_updates_max_;
+}
 
+void AttackReleaseEnvelope::Reset() {
+  envelope_.setZero();
+  attack_param_smoother_.SetSteadyStateCondition(attack_);
+  release_param_smoother_.SetSteadyStateCondition(release_);
+  current_attack_ = attack_;
+  current_release_ = release_;
+  smoothing_updates_ = 0;
+  samples_until_update_ = 0;
+}
+
+void AttackReleaseEnvelope::UpdateCoefficients() {
+  samples_until_update_ = control_period_samples_;
+  // Avoid running the smoothers for clients that don't change the time
+  // constants.
+  if (smoothing_updates_ > 0) {
+    --smoothing_updates_;
+    if (smoothing_updates_ > 0) {
+      attack_param_smoother_.ProcessSample(attack_, &current_attack_);
+      release_param_smoother_.ProcessSample(release_, &current_release_);
+    } else {
+      attack_param_smoother_.SetSteadyStateCondition(attack_);
+      release_param_smoother_.SetSteadyStateCondition(release_);
+      current_attack_ = attack_;
+      current_release_ = release_;
+    }
+  }
+}
+
+float AttackReleaseEnvelope::Output(float input) {
+  DCHECK_EQ(num_channels_, 1);
+  if (samples_until_update_ == 0) {
+    UpdateCoefficients();
+  }
+  --samples_until_update_;
+  envelope_[0] = NextEnvelope(std::abs(input), envelope_[0],
+                              current_attack_[0], current_release_[0]);
   // TODO: Add more smoothing to account for the slope discontinuity
   // when switching time constants.
-  return envelope_;
+  return envelope_[0];
+}
+
+void AttackReleaseEnvelope::ProcessBlock(
+    const Eigen::Ref<const Eigen::ArrayXXf>& input,
+    Eigen::Ref<Eigen::ArrayXXf> output) {
+  DCHECK_EQ(input.rows(), num_channels_);
+  DCHECK_EQ(output.rows(), num_channels_);
+  DCHECK_EQ(input.cols(), output.cols());
+  const int num_samples = input.cols();
+  for (int start = 0; start < num_samples;) {
+    if (samples_until_update_ == 0) {
+      UpdateCoefficients();
+    }
+    // The coefficients are constant over the rest of the control period.
+    const int end = std::min(num_samples, start + samples_until_update_);
+    samples_until_update_ -= end - start;
+    if (num_channels_ == 1) {
+      const float attack = current_attack_[0];
+      const float release = current_release_[0];
+      const float* input_data = input.data();
+      float* output_data = output.data();
+      const int input_stride = input.outerStride();
+      const int output_stride = output.outerStride();
+      float envelope = envelope_[0];
+      for (int i = start; i < end; ++i) {
+        envelope = NextEnvelope(std::abs(input_data[i * input_stride]),
+                                envelope, attack, release);
+        output_data[i * output_stride] = envelope;
+      }
+      envelope_[0] = envelope;
+    } else {
+      // Vectorized across channels, as in NextEnvelope().
+      for (int i = start; i < end; ++i) {
+        const auto difference = input.col(i).abs() - envelope_;
+        envelope_ += current_attack_ * difference.max(0.0f) +
+                     current_release_ * difference.min(0.0f);
+        output.col(i) = envelope_;
+      }
+    }
+    start = end;
+  }
 }
 
 }  // namespace audio_dsp
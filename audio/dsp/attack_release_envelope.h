@@ -18,6 +18,7 @@
 #define AUDIO_DSP_ATTACK_RELEASE_ENVELOPE_H_
 
 #include "audio/linear_filters/biquad_filter.h"
+#include "third_party/eigen3/Eigen/Core"
 
 #include "audio/dsp/porting.h"  // auto-added.
 
@@ -28,18 +29,26 @@ struct AttackReleaseEnvelopeParams {
   AttackReleaseEnvelopeParams()
     : attack_s(0.05f),
       release_s(0.2f),
-      interpolation_rate_hz(200.0f) {}
+      interpolation_rate_hz(200.0f),
+      max_control_period_samples(1) {}
 
   AttackReleaseEnvelopeParams(float attack_seconds, float release_seconds)
     : attack_s(attack_seconds),
       release_s(release_seconds),
-      interpolation_rate_hz(200.0f) {}
+      interpolation_rate_hz(200.0f),
+      max_control_period_samples(1) {}
   // Time constant when input <= output.
   float attack_s;
   // Time constant when input > output.
   float release_s;
   // The rate at which coefficents can change on parameter change.
   float interpolation_rate_hz;
+  // The coefficient smoothing steps once per control period of at most this
+  // many samples, and at least 16 times per period of interpolation_rate_hz.
+  // The default of 1 smooths every sample. Longer periods make changes of the
+  // time constants cheaper, but hold the coefficients in between, e.g. for 15
+  // samples at 48kHz.
+  int max_control_period_samples;
 };
 
 // Computes an approximate envelope of a rectified signal with an asymmetrical
@@ -47,43 +56,86 @@ struct AttackReleaseEnvelopeParams {
   // attack_s and release_s are time constants for the filter in seconds. When
   // input > output, the attack coefficient is used. When input < output, the
   // release coefficient is used.
-// TODO: Add multichannel support.
+//
+// Several independent envelopes can be computed at once with ProcessBlock(),
+// which vectorizes across them. They share their time constants unless these
+// are set per channel.
+//
+// After a change in time constants, the filter coefficients are smoothed
+// toward their new values, by default every sample, or optionally at a lower
+// control rate (see max_control_period_samples). The smoothing stops, and the
+// coefficients snap to their targets, once they are within -80 dB of them.
 // TODO: Add an Init function and make this class a little less
 // bare-bones.
 class AttackReleaseEnvelope {
  public:
   AttackReleaseEnvelope(const AttackReleaseEnvelopeParams& params,
-                        float sample_rate_hz);
+                        float sample_rate_hz)
+    : AttackReleaseEnvelope(1, params, sample_rate_hz) {}
 
   AttackReleaseEnvelope(float attack_s, float release_s, float sample_rate_hz)
     : AttackReleaseEnvelope(AttackReleaseEnvelopeParams(attack_s, release_s),
                             sample_rate_hz) {}
 
+  // Computes num_channels independent envelopes.
+  AttackReleaseEnvelope(int num_channels,
+                        const AttackReleaseEnvelopeParams& params,
+                        float sample_rate_hz);
+
   // Note that the rectified signal is not guaranteed to be positive after a
   // recent change in filter coefficients.
   void SetAttackTimeSeconds(float attack_s);
   void SetReleaseTimeSeconds(float release_s);
 
+  // Set the time constants of one channel.
+  void SetAttackTimeSeconds(int channel, float attack_s);
+  void SetReleaseTimeSeconds(int channel, float release_s);
+
   // Note that this leaves the time constants set to the last values passed
   // to SetAttackTimeSeconds (or the constructor).
-  void Reset() {
-    envelope_ = 0;
-    attack_param_smoother_.SetSteadyStateCondition(attack_);
-    release_param_smoother_.SetSteadyStateCondition(release_);
-  }
-  // Process a single sample.
+  void Reset();
+
+  int num_channels() const { return num_channels_; }
+
+  // Process a single sample. Only for single-channel envelopes.
   float Output(float input);
 
+  // Process a block of samples, with a row per channel and a column per
+  // sample. output must be presized to the size of input. In-place
+  // computation is supported (&input = output). This gives the same result as
+  // calling Output() on each sample of a single-channel envelope.
+  void ProcessBlock(const Eigen::Ref<const Eigen::ArrayXXf>& input,
+                    Eigen::Ref<Eigen::ArrayXXf> output);
+
  private:
-  // State variable.
-  float envelope_;
+  // Steps the coefficient smoothing by one control period.
+  void UpdateCoefficients();
+
+  int num_channels_;
+
+  // State variables, one per channel.
+  Eigen::ArrayXf envelope_;
 
-  float attack_;
-  float release_;
+  // Target coefficients, one per channel.
+  Eigen::ArrayXf attack_;
+  Eigen::ArrayXf release_;
   float sample_rate_hz_;
 
-  linear_filters::BiquadFilter<float> attack_param_smoother_;
-  linear_filters::BiquadFilter<float> release_param_smoother_;
+  // Coefficients for the current control period.
+  Eigen::ArrayXf current_attack_;
+  Eigen::ArrayXf current_release_;
+
+  // The number of samples per control period, and the number of samples left
+  // in the current one.
+  int control_period_samples_;
+  int samples_until_update_;
+  // The number of control periods until the coefficients have settled after a
+  // change, and its value right after the change.
+  int smoothing_updates_;
+  int smoothing_updates_max_;
+
+  linear_filters::BiquadFilter<Eigen::ArrayXf> attack_param_smoother_;
+  linear_filters::BiquadFilter<Eigen::ArrayXf> release_param_smoother_;
 };
 
 }  // namespace audio_dsp
@@ -16,8 +16,19 @@
 
 #include "audio/dsp/attack_release_envelope.h"
 
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "audio/dsp/testing_util.h"
+#include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
 
+#include "audio/linear_filters/biquad_filter.h"
+#include "audio/linear_filters/biquad_filter_coefficients.h"
+#include "audio/linear_filters/biquad_filter_design.h"
 #include "audio/linear_filters/discretization.h"
 
 #include "audio/dsp/porting.h"  // auto-added.
@@ -26,6 +37,7 @@
 namespace audio_dsp {
 namespace {
 
+using ::Eigen::ArrayXXf;
 using ::linear_filters::FirstOrderCoefficientFromTimeConstant;
 
 constexpr float kAttackSeconds = 5.0f;
@@ -141,5 +153,198 @@ TEST(AttackReleaseEnvelopeTest, ChangingReleaseCoeffsTest) {
   }
 }
 
+TEST(AttackReleaseEnvelopeTest, ProcessBlockMatchesOutput) {
+  // At this sample rate, the coefficients are smoothed at a control rate below
+  // the sample rate.
+  constexpr float kAudioSampleRateHz = 48000.0f;
+  AttackReleaseEnvelopeParams params(0.002f, 0.05f);
+  params.max_control_period_samples = 32;
+  AttackReleaseEnvelope sample_envelope(params, kAudioSampleRateHz);
+  AttackReleaseEnvelope block_envelope(params, kAudioSampleRateHz);
+
+  std::mt19937 rng(0 /* seed */);
+  std::uniform_int_distribution<int> block_size_distribution(1, 100);
+  for (int block = 0; block < 200; ++block) {
+    if (block % 50 == 25) {
+      // Change the time constants mid-stream.
+      const float attack_s = 0.001f * (1 + block / 50);
+      const float release_s = 0.02f * (1 + block / 50);
+      sample_envelope.SetAttackTimeSeconds(attack_s);
+      sample_envelope.SetReleaseTimeSeconds(release_s);
+      block_envelope.SetAttackTimeSeconds(attack_s);
+      block_envelope.SetReleaseTimeSeconds(release_s);
+    }
+    const int block_size = block_size_distribution(rng);
+    const ArrayXXf input = ArrayXXf::Random(1, block_size);
+    ArrayXXf expected(1, block_size);
+    for (int i = 0; i < block_size; ++i) {
+      expected(0, i) = sample_envelope.Output(input(0, i));
+    }
+    ArrayXXf output(1, block_size);
+    block_envelope.ProcessBlock(input, output);
+    ASSERT_THAT(output, EigenArrayNear(expected, 1e-7));
+  }
+}
+
+// The envelope with its coefficients smoothed every sample and never snapped
+// to their targets.
+class PerSampleReferenceEnvelope {
+ public:
+  PerSampleReferenceEnvelope(const AttackReleaseEnvelopeParams& params,
+                             float sample_rate_hz)
+      : envelope_(0.0f),
+        attack_(FirstOrderCoefficientFromTimeConstant(params.attack_s,
+                                                      sample_rate_hz)),
+        release_(FirstOrderCoefficientFromTimeConstant(params.release_s,
+                                                       sample_rate_hz)),
+        sample_rate_hz_(sample_rate_hz) {
+    const linear_filters::BiquadFilterCoefficients smoothing_coeffs =
+        linear_filters::LowpassBiquadFilterCoefficients(
+            sample_rate_hz, params.interpolation_rate_hz, 0.49);
+    attack_param_smoother_.Init(1, smoothing_coeffs);
+    release_param_smoother_.Init(1, smoothing_coeffs);
+    attack_param_smoother_.SetSteadyStateCondition(attack_);
+    release_param_smoother_.SetSteadyStateCondition(release_);
+  }
+
+  void SetAttackTimeSeconds(float attack_s) {
+    attack_ = FirstOrderCoefficientFromTimeConstant(attack_s, sample_rate_hz_);
+  }
+
+  void SetReleaseTimeSeconds(float release_s) {
+    release_ =
+        FirstOrderCoefficientFromTimeConstant(release_s, sample_rate_hz_);
+  }
+
+  float Output(float input) {
+    const float rectified = std::abs(input);
+    float current_attack;
+    attack_param_smoother_.ProcessSample(attack_, &current_attack);
+    float current_release;
+    release_param_smoother_.ProcessSample(release_, &current_release);
+    const float coefficient =
+        rectified > envelope_ ? current_attack : current_release;
+    envelope_ += coefficient * (rectified - envelope_);
+    return envelope_;
+  }
+
+ private:
+  float envelope_;
+  float attack_;
+  float release_;
+  float sample_rate_hz_;
+  linear_filters::BiquadFilter<float> attack_param_smoother_;
+  linear_filters::BiquadFilter<float> release_param_smoother_;
+};
+
+// Compares against smoothing the coefficients every sample, at a sample rate
+// where the opt-in control period is 15 samples.
+void CheckMatchesPerSampleReference(int max_control_period_samples,
+                                    float tolerance) {
+  constexpr float kAudioSampleRateHz = 48000.0f;
+  AttackReleaseEnvelopeParams params(0.002f, 0.05f);
+  params.max_control_period_samples = max_control_period_samples;
+  PerSampleReferenceEnvelope reference(params, kAudioSampleRateHz);
+  AttackReleaseEnvelope envelope(params, kAudioSampleRateHz);
+
+  std::mt19937 rng(0 /* seed */);
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  float max_error = 0.0f;
+  for (int i = 0; i < 48000; ++i) {
+    if (i % 12000 == 6000) {
+      const float attack_s = 0.001f * (1 + i / 6000);
+      const float release_s = 0.02f * (1 + i / 6000);
+      reference.SetAttackTimeSeconds(attack_s);
+      reference.SetReleaseTimeSeconds(release_s);
+      envelope.SetAttackTimeSeconds(attack_s);
+      envelope.SetReleaseTimeSeconds(release_s);
+    }
+    const float input = distribution(rng);
+    max_error = std::max(
+        max_error, std::abs(envelope.Output(input) - reference.Output(input)));
+  }
+  EXPECT_LE(max_error, tolerance);
+}
+
+TEST(AttackReleaseEnvelopeTest, MatchesPerSampleSmoothing) {
+  // By default the only difference is snapping the coefficients to their
+  // targets after they have settled.
+  CheckMatchesPerSampleReference(1, 5e-5f);
+}
+
+TEST(AttackReleaseEnvelopeTest, ControlRateSmoothingIsClose) {
+  // Holding the coefficients over a control period lags the smoothing by half
+  // a period on average, which changes the envelope slightly while the time
+  // constants move.
+  CheckMatchesPerSampleReference(32, 5e-3f);
+}
+
+TEST(AttackReleaseEnvelopeTest, MultichannelMatchesSingleChannel) {
+  constexpr int kNumChannels = 5;
+  constexpr float kAudioSampleRateHz = 16000.0f;
+  const AttackReleaseEnvelopeParams params(0.002f, 0.05f);
+  AttackReleaseEnvelope multichannel_envelope(kNumChannels, params,
+                                              kAudioSampleRateHz);
+  std::vector<AttackReleaseEnvelope> envelopes(
+      kNumChannels, AttackReleaseEnvelope(params, kAudioSampleRateHz));
+  for (int block = 0; block < 10; ++block) {
+    if (block == 4) {
+      multichannel_envelope.SetReleaseTimeSeconds(0.01f);
+      for (AttackReleaseEnvelope& envelope : envelopes) {
+        envelope.SetReleaseTimeSeconds(0.01f);
+      }
+    }
+    if (block == 6) {
+      // Time constants of a single channel.
+      multichannel_envelope.SetAttackTimeSeconds(2, 0.005f);
+      envelopes[2].SetAttackTimeSeconds(0.005f);
+      multichannel_envelope.SetReleaseTimeSeconds(3, 0.1f);
+      envelopes[3].SetReleaseTimeSeconds(0.1f);
+    }
+    ArrayXXf signal = ArrayXXf::Random(kNumChannels, 300);
+    ArrayXXf expected(kNumChannels, signal.cols());
+    ArrayXXf channel_output(1, signal.cols());
+    for (int channel = 0; channel < kNumChannels; ++channel) {
+      envelopes[channel].ProcessBlock(signal.row(channel), channel_output);
+      expected.row(channel) = channel_output;
+    }
+    // In place.
+    multichannel_envelope.ProcessBlock(signal, signal);
+    // The coefficient smoothers round differently when vectorized across
+    // channels.
+    ASSERT_THAT(signal, EigenArrayNear(expected, 1e-5));
+  }
+}
+
+void BM_AttackReleaseEnvelopeOutput(benchmark::State& state) {
+  constexpr int kNumSamples = 512;
+  AttackReleaseEnvelope envelope(0.001f, 0.05f, 48000.0f);
+  const ArrayXXf input = ArrayXXf::Random(1, kNumSamples);
+  ArrayXXf output(1, kNumSamples);
+  while (state.KeepRunning()) {
+    for (int i = 0; i < kNumSamples; ++i) {
+      output(0, i) = envelope.Output(input(0, i));
+    }
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kNumSamples * state.iterations());
+}
+BENCHMARK(BM_AttackReleaseEnvelopeOutput);
+
+void BM_AttackReleaseEnvelopeProcessBlock(benchmark::State& state) {
+  const int num_channels = state.range(0);
+  constexpr int kNumSamples = 512;
+  AttackReleaseEnvelope envelope(
+      num_channels, AttackReleaseEnvelopeParams(0.001f, 0.05f), 48000.0f);
+  const ArrayXXf input = ArrayXXf::Random(num_channels, kNumSamples);
+  ArrayXXf output(num_channels, kNumSamples);
+  while (state.KeepRunning()) {
+    envelope.ProcessBlock(input, output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(num_channels * kNumSamples * state.iterations());
+}
+BENCHMARK(BM_AttackReleaseEnvelopeProcessBlock)->Arg(1)->Arg(8)->Arg(64);
+
 }  // namespace
 }  // namespace audio_dsp
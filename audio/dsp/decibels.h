@@ -19,7 +19,11 @@
 #ifndef AUDIO_DSP_DECIBELS_H_
 #define AUDIO_DSP_DECIBELS_H_
 
+#include <algorithm>
 #include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
 
 #include "third_party/eigen3/Eigen/Core"
 
@@ -81,6 +85,198 @@ void DecibelsToPowerRatio(const InputEigenType& db,
   *linear = (klog10_10 * db.array()).exp();
 }
 
+// Fast float versions of the conversions above, for per-sample use where
+// audio-grade accuracy is enough. The logarithm and exponential are computed
+// from the float exponent bits and a low-order polynomial in the mantissa, so
+// they are branchless and, with the Eigen versions below, vectorized. For
+// finite positive normal floats, and levels that map to them, the error is
+// below 0.001 dB, in decibels or relative to the exact ratio.
+//
+// Ratios below the smallest normal float, including zero, give a level around
+// -760 dB (-380 dB for power) rather than -inf. Levels whose ratio is below the
+// smallest normal float flush to zero, and levels whose ratio overflows give
+// infinity. Negative and NaN inputs give unspecified (but not undefined)
+// results.
+
+namespace internal {
+
+#if defined(__GNUC__)
+// With GCC and Clang, the Eigen versions process kFastLanes floats at a time
+// using vector extensions. The lane count is fixed, rather than chosen from
+// the target's SIMD width, so that these types are the same in every
+// translation unit. Four lanes fit the baseline SSE2 and NEON registers.
+constexpr int kFastLanes = 4;
+typedef float FastFloats __attribute__((vector_size(4 * kFastLanes)));
+typedef int32_t FastInts __attribute__((vector_size(4 * kFastLanes)));
+
+inline FastFloats ToFloat(FastInts x) {
+  return __builtin_convertvector(x, FastFloats);
+}
+inline FastInts TruncateToInt(FastFloats x) {
+  return __builtin_convertvector(x, FastInts);
+}
+#endif  // defined(__GNUC__)
+
+inline float ToFloat(int32_t x) { return static_cast<float>(x); }
+inline int32_t TruncateToInt(float x) { return static_cast<int32_t>(x); }
+
+template <typename To, typename From>
+inline To BitCast(const From& from) {
+  static_assert(sizeof(To) == sizeof(From), "Sizes must match.");
+  To to;
+  std::memcpy(&to, &from, sizeof(to));
+  return to;
+}
+
+// Int is int32_t for float, or the matching vector of int32_t.
+template <typename Float>
+using FastInt = decltype(TruncateToInt(Float()));
+
+// Approximates log2(x) with a maximum absolute error of 1.1e-4.
+template <typename Float>
+inline Float FastLog2(Float x) {
+  FastInt<Float> bits = BitCast<FastInt<Float>>(x);
+  const Float exponent = ToFloat((bits >> 23) - 127);
+  // Replace the exponent to get the mantissa in [1, 2).
+  bits = (bits & 0x007fffff) | 0x3f800000;
+  // Minimax fit of log2(1 + t) on [0, 1].
+  const Float t = BitCast<Float>(bits) - 1.0f;
+  return exponent +
+      t * (1.4390144f + t * (-0.679942f + t * (0.3255915f + t * -0.0847661f)));
+}
+
+// Approximates 2^x with a maximum relative error of 8e-5, for x in
+// [-127, 128]. Clamping is left to the caller, since comparisons are not
+// branchless for scalars.
+template <typename Float>
+inline Float FastExp2InRange(Float x) {
+  // Truncating a positive value rounds down. Rounding in the addition may make
+  // t slightly negative, which the polynomial tolerates.
+  const FastInt<Float> exponent = TruncateToInt(x + 128.0f) - 128;
+  // Minimax fit of 2^t on [0, 1], relative to 2^t.
+  const Float t = x - ToFloat(exponent);
+  const Float fraction =
+      0.99992526f + t * (0.69583315f + t * (0.22606774f + t * 0.07802436f));
+  // Build 2^exponent from its bits. An exponent of -127 gives zero and 128
+  // gives infinity.
+  return BitCast<Float>((exponent + 127) << 23) * fraction;
+}
+
+// Applies kernel, a functor over float (and FastFloats), in place to the
+// coefficients of output.
+template <typename Kernel, typename OutputEigenType>
+void FastTransformInPlace(const Kernel& kernel_ref, OutputEigenType* output) {
+  static_assert(std::is_same<typename OutputEigenType::Scalar, float>::value,
+                "Fast decibel conversions are only for float.");
+  // A local copy, which the stores to output cannot alias, so that the
+  // kernel's members stay in registers.
+  const Kernel kernel = kernel_ref;
+  if (output->innerStride() != 1) {
+    for (int col = 0; col < output->cols(); ++col) {
+      for (int row = 0; row < output->rows(); ++row) {
+        (*output)(row, col) = kernel((*output)(row, col));
+      }
+    }
+    return;
+  }
+  for (int outer = 0; outer < output->outerSize(); ++outer) {
+    float* data = output->data() + outer * output->outerStride();
+    const int size = output->innerSize();
+    int i = 0;
+#if defined(__GNUC__)
+    for (; i + kFastLanes <= size; i += kFastLanes) {
+      FastFloats values;
+      std::memcpy(&values, data + i, sizeof(values));
+      values = kernel(values);
+      std::memcpy(data + i, &values, sizeof(values));
+    }
+#endif  // defined(__GNUC__)
+    for (; i < size; ++i) {
+      data[i] = kernel(data[i]);
+    }
+  }
+}
+
+// Scales log2 of the input.
+struct FastScaledLog2 {
+  template <typename Float>
+  Float operator()(Float x) const { return scale * FastLog2(x); }
+  float scale;
+};
+
+struct FastExp2InRangeKernel {
+  template <typename Float>
+  Float operator()(Float x) const { return FastExp2InRange(x); }
+};
+
+// 20 log10(2), 10 log10(2) and their inverses.
+constexpr float kAmplitudeDecibelsPerOctave = 20 * M_LN2 / M_LN10;
+constexpr float kPowerDecibelsPerOctave = 10 * M_LN2 / M_LN10;
+constexpr float kOctavesPerAmplitudeDecibel = M_LN10 / (20 * M_LN2);
+constexpr float kOctavesPerPowerDecibel = M_LN10 / (10 * M_LN2);
+
+}  // namespace internal
+
+// Approximates std::log2(x) with a maximum absolute error of 1.1e-4.
+inline float FastLog2(float x) { return internal::FastLog2(x); }
+
+// Approximates std::exp2(x) with a maximum relative error of 8e-5.
+inline float FastExp2(float x) {
+  // Clamp to where the result is zero or infinity. This also maps NaN to zero.
+  return internal::FastExp2InRange(std::min(128.0f, std::max(-127.0f, x)));
+}
+
+inline float FastAmplitudeRatioToDecibels(float linear) {
+  return internal::kAmplitudeDecibelsPerOctave * FastLog2(linear);
+}
+
+inline float FastDecibelsToAmplitudeRatio(float decibels) {
+  return FastExp2(internal::kOctavesPerAmplitudeDecibel * decibels);
+}
+
+inline float FastPowerRatioToDecibels(float linear) {
+  return internal::kPowerDecibelsPerOctave * FastLog2(linear);
+}
+
+inline float FastDecibelsToPowerRatio(float decibels) {
+  return FastExp2(internal::kOctavesPerPowerDecibel * decibels);
+}
+
+// The Eigen versions take float arrays or matrices, and may work in place. The
+// output must be a plain object or a block of one.
+template <typename InputEigenType, typename OutputEigenType>
+void FastAmplitudeRatioToDecibels(const InputEigenType& linear,
+                                  OutputEigenType* db) {
+  *db = linear;
+  internal::FastTransformInPlace(
+      internal::FastScaledLog2{internal::kAmplitudeDecibelsPerOctave}, db);
+}
+
+template <typename InputEigenType, typename OutputEigenType>
+void FastDecibelsToAmplitudeRatio(const InputEigenType& db,
+                                  OutputEigenType* linear) {
+  // Eigen vectorizes the clamping.
+  *linear = (internal::kOctavesPerAmplitudeDecibel * db.array())
+                .max(-127.0f).min(128.0f);
+  internal::FastTransformInPlace(internal::FastExp2InRangeKernel(), linear);
+}
+
+template <typename InputEigenType, typename OutputEigenType>
+void FastPowerRatioToDecibels(const InputEigenType& linear,
+                              OutputEigenType* db) {
+  *db = linear;
+  internal::FastTransformInPlace(
+      internal::FastScaledLog2{internal::kPowerDecibelsPerOctave}, db);
+}
+
+template <typename InputEigenType, typename OutputEigenType>
+void FastDecibelsToPowerRatio(const InputEigenType& db,
+                              OutputEigenType* linear) {
+  *linear = (internal::kOctavesPerPowerDecibel * db.array())
+                .max(-127.0f).min(128.0f);
+  internal::FastTransformInPlace(internal::FastExp2InRangeKernel(), linear);
+}
+
 }  // namespace audio_dsp
 
 #endif  // AUDIO_DSP_DECIBELS_H_
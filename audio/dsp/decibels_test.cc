@@ -16,7 +16,14 @@
 
 #include "audio/dsp/decibels.h"
 
+#include <cmath>
+#include <cstdint>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
 #include "audio/dsp/testing_util.h"
+#include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
 #include "third_party/eigen3/Eigen/Core"
 
@@ -141,5 +148,195 @@ TEST(DecibelsTest, EigenInPlaceTest) {
   }
 }
 
+// The documented error bound of the fast conversions.
+constexpr double kFastMaxErrorDb = 0.001;
+
+float FloatFromBits(uint32_t bits) {
+  float x;
+  std::memcpy(&x, &bits, sizeof(x));
+  return x;
+}
+
+// Tracks the largest error in decibels of the scalar and the vectorized Eigen
+// versions of a fast conversion, over inputs in chunks.
+class MaxErrorTracker {
+ public:
+  MaxErrorTracker() : max_error_db_(0) {}
+
+  // exact_db(i) is the exact level in decibels for input[i], and to_db maps an
+  // output to decibels.
+  template <typename ScalarFunction, typename EigenFunction,
+            typename ExactFunction, typename ToDbFunction>
+  void Add(const Eigen::ArrayXf& input, ScalarFunction scalar_function,
+           EigenFunction eigen_function, ExactFunction exact_db,
+           ToDbFunction to_db) {
+    Eigen::ArrayXf output;
+    eigen_function(input, &output);
+    for (int i = 0; i < input.size(); ++i) {
+      const double exact = exact_db(i);
+      max_error_db_ = std::max(
+          {max_error_db_, std::abs(to_db(scalar_function(input[i])) - exact),
+           std::abs(to_db(output[i]) - exact)});
+    }
+  }
+
+  double max_error_db() const { return max_error_db_; }
+
+ private:
+  double max_error_db_;
+};
+
+TEST(DecibelsTest, FastRatioToDecibelsSweepFloatRange) {
+  MaxErrorTracker amplitude;
+  MaxErrorTracker power;
+  const auto identity = [](double db) { return db; };
+  // Every 101st finite positive normal float, in chunks.
+  constexpr int kChunkSize = 4096;
+  constexpr uint32_t kStride = 101;
+  for (uint32_t start = 0x00800000; start <= 0x7f7fffff;
+       start += kChunkSize * kStride) {
+    Eigen::ArrayXf linear(kChunkSize);
+    int size = 0;
+    for (uint32_t bits = start; size < kChunkSize && bits <= 0x7f7fffff;
+         bits += kStride) {
+      linear[size++] = FloatFromBits(bits);
+    }
+    linear.conservativeResize(size);
+    const auto exact_power_db = [&linear](int i) {
+      return 10 * std::log10(static_cast<double>(linear[i]));
+    };
+    amplitude.Add(
+        linear, [](float x) { return FastAmplitudeRatioToDecibels(x); },
+        [](const Eigen::ArrayXf& x, Eigen::ArrayXf* y) {
+          FastAmplitudeRatioToDecibels(x, y);
+        },
+        [&exact_power_db](int i) { return 2 * exact_power_db(i); }, identity);
+    power.Add(
+        linear, [](float x) { return FastPowerRatioToDecibels(x); },
+        [](const Eigen::ArrayXf& x, Eigen::ArrayXf* y) {
+          FastPowerRatioToDecibels(x, y);
+        },
+        exact_power_db, identity);
+  }
+  EXPECT_LT(amplitude.max_error_db(), kFastMaxErrorDb);
+  EXPECT_LT(power.max_error_db(), kFastMaxErrorDb);
+}
+
+TEST(DecibelsTest, FastDecibelsToRatioSweepFloatRange) {
+  MaxErrorTracker amplitude;
+  MaxErrorTracker power;
+  // Levels whose ratios are normal floats, in chunks.
+  constexpr int kChunkSize = 4096;
+  constexpr double kStepDb = 0.001;
+  constexpr double kMaxDb = 770;
+  for (double start_db = -758; start_db < kMaxDb;
+       start_db += kChunkSize * kStepDb) {
+    const int size = std::min<int>(kChunkSize, (kMaxDb - start_db) / kStepDb);
+    const Eigen::ArrayXf db = Eigen::ArrayXf::LinSpaced(
+        size, start_db, start_db + (size - 1) * kStepDb);
+    const auto exact_db = [&db](int i) { return db[i]; };
+    amplitude.Add(
+        db, [](float x) { return FastDecibelsToAmplitudeRatio(x); },
+        [](const Eigen::ArrayXf& x, Eigen::ArrayXf* y) {
+          FastDecibelsToAmplitudeRatio(x, y);
+        },
+        exact_db, [](float x) { return 20 * std::log10(double{x}); });
+    const Eigen::ArrayXf half_db = db / 2;
+    const auto exact_half_db = [&half_db](int i) { return half_db[i]; };
+    power.Add(
+        half_db, [](float x) { return FastDecibelsToPowerRatio(x); },
+        [](const Eigen::ArrayXf& x, Eigen::ArrayXf* y) {
+          FastDecibelsToPowerRatio(x, y);
+        },
+        exact_half_db, [](float x) { return 10 * std::log10(double{x}); });
+  }
+  EXPECT_LT(amplitude.max_error_db(), kFastMaxErrorDb);
+  EXPECT_LT(power.max_error_db(), kFastMaxErrorDb);
+}
+
+TEST(DecibelsTest, FastConversionsOutOfRange) {
+  const float level_of_zero_db = FastAmplitudeRatioToDecibels(0.0f);
+  EXPECT_LT(level_of_zero_db, -750);
+  EXPECT_GT(level_of_zero_db, -770);
+  EXPECT_LT(FastPowerRatioToDecibels(0.0f), -375);
+  EXPECT_EQ(FastDecibelsToAmplitudeRatio(-800.0f), 0.0f);
+  EXPECT_EQ(FastDecibelsToAmplitudeRatio(-1e30f), 0.0f);
+  EXPECT_EQ(FastDecibelsToPowerRatio(-400.0f), 0.0f);
+  constexpr float kInfinity = std::numeric_limits<float>::infinity();
+  EXPECT_EQ(FastDecibelsToAmplitudeRatio(800.0f), kInfinity);
+  EXPECT_EQ(FastDecibelsToAmplitudeRatio(1e30f), kInfinity);
+  EXPECT_EQ(FastDecibelsToPowerRatio(400.0f), kInfinity);
+  // Exact at 0 dB within float rounding of the polynomials.
+  EXPECT_NEAR(FastDecibelsToAmplitudeRatio(0.0f), 1.0f, 1e-4);
+  EXPECT_NEAR(FastAmplitudeRatioToDecibels(1.0f), 0.0f, 1e-6);
+}
+
+TEST(DecibelsTest, EigenFastConversions) {
+  Eigen::ArrayXXf linear = 20 * (Eigen::ArrayXXf::Random(2, 100) + 2);
+  Eigen::ArrayXXf db;
+  AmplitudeRatioToDecibels(linear, &db);
+  Eigen::ArrayXXf fast_db;
+  FastAmplitudeRatioToDecibels(linear, &fast_db);
+  EXPECT_THAT(fast_db, EigenArrayNear(db, kFastMaxErrorDb));
+  Eigen::ArrayXXf fast_linear;
+  FastDecibelsToAmplitudeRatio(fast_db, &fast_linear);
+  // A round trip error of 0.002 dB is a relative error of 2.3e-4.
+  EXPECT_THAT(fast_linear, EigenArrayNear(linear, 0.03));
+
+  PowerRatioToDecibels(linear, &db);
+  FastPowerRatioToDecibels(linear, &fast_db);
+  EXPECT_THAT(fast_db, EigenArrayNear(db, kFastMaxErrorDb));
+  FastDecibelsToPowerRatio(fast_db, &fast_linear);
+  EXPECT_THAT(fast_linear, EigenArrayNear(linear, 0.03));
+
+  // In place, on a vector.
+  Eigen::VectorXf vector = linear.row(0).transpose().matrix();
+  Eigen::VectorXf vector_db;
+  FastAmplitudeRatioToDecibels(vector, &vector_db);
+  FastAmplitudeRatioToDecibels(vector, &vector);
+  EXPECT_THAT(vector, EigenArrayNear(vector_db, 0));
+
+  // On a row, which is not contiguous.
+  auto row = linear.row(1);
+  const Eigen::ArrayXXf row_db = linear.row(1).unaryExpr(
+      [](float x) { return FastAmplitudeRatioToDecibels(x); });
+  FastAmplitudeRatioToDecibels(row, &row);
+  EXPECT_THAT(row, EigenArrayNear(row_db, 0));
+}
+
+template <bool kFast>
+void BM_AmplitudeRatioToDecibels(benchmark::State& state) {
+  const Eigen::ArrayXf linear = Eigen::ArrayXf::Random(1024).abs() + 1e-3f;
+  Eigen::ArrayXf db(linear.size());
+  while (state.KeepRunning()) {
+    if (kFast) {
+      FastAmplitudeRatioToDecibels(linear, &db);
+    } else {
+      AmplitudeRatioToDecibels(linear, &db);
+    }
+    benchmark::DoNotOptimize(db);
+  }
+  state.SetItemsProcessed(linear.size() * state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_AmplitudeRatioToDecibels, false);
+BENCHMARK_TEMPLATE(BM_AmplitudeRatioToDecibels, true);
+
+template <bool kFast>
+void BM_DecibelsToAmplitudeRatio(benchmark::State& state) {
+  const Eigen::ArrayXf db = 60 * Eigen::ArrayXf::Random(1024);
+  Eigen::ArrayXf linear(db.size());
+  while (state.KeepRunning()) {
+    if (kFast) {
+      FastDecibelsToAmplitudeRatio(db, &linear);
+    } else {
+      DecibelsToAmplitudeRatio(db, &linear);
+    }
+    benchmark::DoNotOptimize(linear);
+  }
+  state.SetItemsProcessed(db.size() * state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_DecibelsToAmplitudeRatio, false);
+BENCHMARK_TEMPLATE(BM_DecibelsToAmplitudeRatio, true);
+
 }  // namespace
 }  // namespace audio_dsp
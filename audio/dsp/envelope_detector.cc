@@ -37,6 +37,7 @@ void EnvelopeDetector::Init(
   envelope_cutoff_hz_ = envelope_cutoff_hz;
   envelope_sample_rate_hz_ = envelope_sample_rate_hz;
   most_recent_output_ = ArrayXf::Zero(num_channels_);
+  workspace_.resize(num_channels_, 0);
 
   prefilter_.Init(num_channels, coeffs);
 
@@ -47,19 +48,27 @@ void EnvelopeDetector::Init(
           sample_rate_hz_, envelope_cutoff_hz_, kOverdamped);
   envelope_smoother_.Init(num_channels, smoother_coeffs_);
 
-  auto resampling_kernel = DefaultResamplingKernel(
-      sample_rate_hz, envelope_sample_rate_hz);
-  for (int channel = 0; channel < num_channels_; ++channel) {
-    downsamplers_.emplace_back(resampling_kernel, 500);
+  if (!downsampler_.Init(
+      num_channels, DefaultResamplingKernel(sample_rate_hz,
+                                            envelope_sample_rate_hz), 500)) {
+    LOG(ERROR) << "Failed to initialize the downsampler from "
+               << sample_rate_hz << "Hz to " << envelope_sample_rate_hz
+               << "Hz.";
+    // Leave uninitialized, so that ProcessBlock() fails.
+    num_channels_ = 0;
   }
 }
 
+void EnvelopeDetector::Prepare(int max_block_size_samples) {
+  CHECK_GT(num_channels_, 0) << "You must initialize!";
+  CHECK_GE(max_block_size_samples, 0);
+  workspace_.resize(num_channels_, max_block_size_samples);
+}
+
 void EnvelopeDetector::Reset() {
   prefilter_.Reset();
   envelope_smoother_.Reset();
-  for (auto& downsampler : downsamplers_) {
-    downsampler.Reset();
-  }
+  downsampler_.Reset();
 }
 
 bool EnvelopeDetector::ProcessBlock(const ArrayXXf& input, ArrayXXf* output) {
@@ -67,27 +76,22 @@ bool EnvelopeDetector::ProcessBlock(const ArrayXXf& input, ArrayXXf* output) {
     LOG(WARNING) << "You must initialize!";
     return false;
   }
+  if (workspace_.cols() < input.cols()) {
+    Prepare(input.cols());
+  }
+  auto workspace = workspace_.leftCols(input.cols());
   // Process with the prefilter.
-  prefilter_.ProcessBlock(input, &workspace_);
+  prefilter_.ProcessBlock(input, &workspace);
   // Rectify the signal and smooth to get the RMS envelope.
-  workspace_ = workspace_.abs2();
+  workspace = workspace.abs2();
   if (envelope_sample_rate_hz_ == sample_rate_hz_) {
     // Bypass downsampling, which may add a few samples of delay for identity
     // resampling.
-    envelope_smoother_.ProcessBlock(workspace_, output);
+    envelope_smoother_.ProcessBlock(workspace, output);
   } else {
-    envelope_smoother_.ProcessBlock(workspace_, &workspace_);
-    // Downsample the signal.
-    Eigen::ArrayXf out;
-    for (int channel = 0; channel < num_channels_; ++channel) {
-      downsamplers_[channel].ProcessSamplesEigen(
-          workspace_.row(channel).matrix(), &out);
-      // Make output the correct shape.
-      if (channel == 0) {
-        output->resize(num_channels_, out.size());
-      }
-      output->row(channel) = out;
-    }
+    envelope_smoother_.ProcessBlock(workspace, &workspace);
+    // Downsample all channels at once.
+    downsampler_.ProcessBlock(workspace, output);
   }
   // Undo the square to obtain the RMS value.
   *output = output->array().abs().sqrt();
@@ -20,9 +20,7 @@
 #ifndef AUDIO_DSP_ENVELOPE_DETECTOR_H_
 #define AUDIO_DSP_ENVELOPE_DETECTOR_H_
 
-#include <vector>
-
-#include "audio/dsp/resampler_rational_factor.h"
+#include "audio/dsp/multichannel_resampler_rational_factor.h"
 #include "audio/linear_filters/biquad_filter.h"
 #include "third_party/eigen3/Eigen/Core"
 
@@ -46,6 +44,9 @@ class EnvelopeDetector {
   // NOTE: If envelope_sample_rate_hz identically equals sample_rate_hz, the
   // number of output samples for each call to process block is guaranteed to
   // be equal to the number of input samples (the resampler is bypassed).
+  //
+  // If the resampler can't be initialized for these rates, logs an error and
+  // leaves the detector uninitialized, so that ProcessBlock() returns false.
   void Init(int num_channels, float sample_rate_hz,
             float envelope_cutoff_hz, float envelope_sample_rate_hz,
             const linear_filters::BiquadFilterCascadeCoefficients& coeffs);
@@ -65,6 +66,13 @@ class EnvelopeDetector {
          linear_filters::BiquadFilterCascadeCoefficients());
   }
 
+  // Allocates the workspace for blocks of up to max_block_size_samples
+  // samples. After this, ProcessBlock() does not allocate for such blocks
+  // unless it needs to resize the output, so it is safe to call from a realtime
+  // thread. Without this, the workspace grows as needed. Must be called after
+  // Init().
+  void Prepare(int max_block_size_samples);
+
   // Clear the state of the filters and resampler.
   void Reset();
 
@@ -73,6 +81,11 @@ class EnvelopeDetector {
   // of envelope_cutoff_hz_ or small blocks of input samples, this
   // may not produce samples at every call.
   // You must initialize first. Returns true when successful.
+  //
+  // output is resized to the number of envelope samples produced, which
+  // allocates if that number changes from the previous call. It is the same
+  // for every call if the block size is a multiple of
+  // sample_rate_hz / envelope_sample_rate_hz.
   bool ProcessBlock(const Eigen::ArrayXXf& input, Eigen::ArrayXXf* output);
 
   // Returns an array containing the smoothed energy at each channel for the
@@ -89,14 +102,14 @@ class EnvelopeDetector {
   float envelope_sample_rate_hz_;
 
   // Space for intermediate computations so that we don't need to reallocate
-  // every time Process(...) is called.
+  // every time Process(...) is called. Blocks are processed in its leftmost
+  // columns.
   Eigen::ArrayXXf workspace_;
   Eigen::ArrayXf most_recent_output_;
 
   linear_filters::BiquadFilterCascade<Eigen::ArrayXf> prefilter_;
   linear_filters::BiquadFilter<Eigen::ArrayXf> envelope_smoother_;
-  // We need one of these for each channel.
-  std::vector<audio_dsp::RationalFactorResampler<float>> downsamplers_;
+  MultichannelRationalFactorResampler downsampler_;
 };
 
 }  // namespace audio_dsp
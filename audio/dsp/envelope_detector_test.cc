@@ -19,6 +19,7 @@
 #include <cmath>
 #include <random>
 
+#include "audio/dsp/heap_allocation_counter.h"
 #include "audio/dsp/testing_util.h"
 #include "audio/linear_filters/biquad_filter_design.h"
 #include "gtest/gtest.h"
@@ -128,5 +129,37 @@ TEST(EnvelopeDetectorTypedTest, NoDownsamplingTest) {
   EXPECT_EQ(output.cols(), kNumSamples);
   EXPECT_NEAR(detector.MostRecentRmsEnvelopeValue()[0], 1 / M_SQRT2, 1e-2);
 }
+TEST(EnvelopeDetectorTypedTest, PreparedDoesNotAllocate) {
+  constexpr float kSampleRate = 16000.0f;
+  constexpr float kEnvelopeSampleRate = 100.0f;
+  // One envelope sample per block.
+  constexpr int kBlockSize = 160;
+  const linear_filters::BiquadFilterCascadeCoefficients coeffs =
+      linear_filters::ButterworthFilterDesign(2).
+          BandpassCoefficients(kSampleRate, 20, 1000);
+
+  for (float envelope_sample_rate : {kSampleRate, kEnvelopeSampleRate}) {
+    SCOPED_TRACE("envelope_sample_rate: " +
+                 testing::PrintToString(envelope_sample_rate));
+    EnvelopeDetector detector;
+    detector.Init(2, kSampleRate, 5.0, envelope_sample_rate, coeffs);
+    detector.Prepare(kBlockSize);
+    const Eigen::ArrayXXf input = Eigen::ArrayXXf::Random(2, kBlockSize);
+    Eigen::ArrayXXf output(2, envelope_sample_rate == kSampleRate
+                                  ? kBlockSize : 1);
+    if (envelope_sample_rate != kSampleRate) {
+      // Wait until the resampler produces output.
+      do {
+        ASSERT_TRUE(detector.ProcessBlock(input, &output));
+      } while (output.cols() == 0);
+    }
+    for (int i = 0; i < 5; ++i) {
+      ScopedHeapAllocationCounter counter;
+      ASSERT_TRUE(detector.ProcessBlock(input, &output));
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+  }
+}
+
 }  // namespace
 }  // namespace audio_dsp
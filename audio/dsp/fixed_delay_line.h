@@ -65,26 +65,23 @@ class FixedDelayLine {
   Eigen::Map<const Eigen::ArrayXXf> ProcessBlock(const InputType& input) {
     DCHECK_GT(num_channels_, 0);
     DCHECK_EQ(input.rows(), num_channels_);
-    // Make the allocated block bigger if necessary.
-    const int needed_size_frames = last_frame_ + input.cols();
-    if (buffer_.cols() < last_frame_ + input.cols()) {
+    // Make the allocated block bigger if necessary. The buffer holds the
+    // delay_samples_ most recent samples followed by the new chunk.
+    const int needed_size_frames = delay_samples_ + input.cols();
+    if (buffer_.cols() < needed_size_frames) {
       buffer_.conservativeResize(num_channels_, needed_size_frames);
     }
-    // Remove the old block of data by copying the later part of the buffer into
-    // the beginning of the buffer. We do this in chunks of maximum size
-    // last_request_size_frames_ to be sure that there is no memory overlap in
-    // the copy instruction.
-    int start_frame = 0;
-    while (true) {
-      const int sample_shift = last_request_size_frames_;
-      // If we get a small block when the previous block is large,
-      // we won't actually have sample_shift samples to move.
-      const int available_to_move = std::min<int>(
-          sample_shift, needed_size_frames - (start_frame + sample_shift));
-      if (available_to_move <= 0) { break; }
+    // Remove the old block of data by copying the delay_samples_ samples
+    // that follow it (ending at last_frame_) to the beginning of the buffer. We
+    // do this in chunks of maximum size last_request_size_frames_ to be sure
+    // that there is no memory overlap in the copy instruction.
+    const int sample_shift = last_request_size_frames_;
+    for (int start_frame = 0; sample_shift > 0 && start_frame < delay_samples_;
+         start_frame += sample_shift) {
+      const int available_to_move =
+          std::min<int>(sample_shift, delay_samples_ - start_frame);
       buffer_.middleCols(start_frame, available_to_move) =
           buffer_.middleCols(start_frame + sample_shift, available_to_move);
-      start_frame += sample_shift;
     }
     // Move the new chunk into the buffer.
     buffer_.middleCols(last_frame_ - last_request_size_frames_,
@@ -18,6 +18,7 @@
 
 #include <random>
 
+#include "audio/dsp/heap_allocation_counter.h"
 #include "audio/dsp/testing_util.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
@@ -211,6 +212,30 @@ TEST(FixedDelayLineTest, RandomBlockSizes) {
   }
 }
 
+// Blocks no larger than the block size passed to Init() never reallocate, even
+// when a small block follows a large one.
+TEST(FixedDelayLineTest, RandomBlockSizesDoNotAllocate) {
+  FixedDelayLine delay_line;
+  constexpr int kChannels = 3;
+  constexpr int kMaxBlockSize = 50;
+  for (int delay_samples : {0, 3, 9, 80}) {
+    delay_line.Init(kChannels, delay_samples, kMaxBlockSize);
+    std::mt19937 rng(0 /* seed */);
+    std::uniform_int_distribution<int> block_size_distribution(
+        0, kMaxBlockSize);
+    Eigen::ArrayXXf output_buffer(kChannels, kMaxBlockSize);
+    for (int i = 0; i < 100; ++i) {
+      const int block_size = block_size_distribution(rng);
+      const Eigen::ArrayXXf input =
+          Eigen::ArrayXXf::Random(kChannels, block_size);
+      auto output = output_buffer.leftCols(block_size);
+      audio_dsp::ScopedHeapAllocationCounter counter;
+      delay_line.ProcessBlock(input, &output);
+      ASSERT_EQ(counter.num_allocations(), 0);
+    }
+  }
+}
+
 TEST(FixedDelayLineTest, ResetTest) {
   FixedDelayLine delay_line;
   delay_line.Init(1, 2, 4);
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/heap_allocation_counter.h"
+
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+namespace {
+
+// Total number of allocations made by the process. This is constant
+// initialized, so it is usable by allocations made during static
+// initialization.
+std::atomic<int> total_allocations(0);
+
+inline void RecordAllocation() {
+  total_allocations.fetch_add(1, std::memory_order_relaxed);
+}
+
+}  // namespace
+
+#if defined(__GLIBC__)
+
+// glibc exports its allocator under these names, so the standard functions can
+// be replaced with wrappers. This also covers operator new, which calls
+// malloc, and free() needs no wrapper.
+extern "C" {
+void* __libc_malloc(size_t size);
+void* __libc_calloc(size_t num, size_t size);
+void* __libc_realloc(void* ptr, size_t size);
+void* __libc_memalign(size_t alignment, size_t size);
+
+void* malloc(size_t size) {
+  RecordAllocation();
+  return __libc_malloc(size);
+}
+
+void* calloc(size_t num, size_t size) {
+  RecordAllocation();
+  return __libc_calloc(num, size);
+}
+
+void* realloc(void* ptr, size_t size) {
+  RecordAllocation();
+  return __libc_realloc(ptr, size);
+}
+
+void* memalign(size_t alignment, size_t size) {
+  RecordAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+void* aligned_alloc(size_t alignment, size_t size) {
+  RecordAllocation();
+  return __libc_memalign(alignment, size);
+}
+
+int posix_memalign(void** ptr, size_t alignment, size_t size) {
+  RecordAllocation();
+  void* result = __libc_memalign(alignment, size);
+  if (result == nullptr) {
+    return ENOMEM;
+  }
+  *ptr = result;
+  return 0;
+}
+}  // extern "C"
+
+#else  // defined(__GLIBC__)
+
+// Without a way to wrap malloc, count the allocations made through the global
+// operator new. The remaining forms of operator new and delete forward to
+// these.
+void* operator new(size_t size) {
+  RecordAllocation();
+  void* ptr = std::malloc(size == 0 ? 1 : size);
+  if (ptr == nullptr) {
+    throw std::bad_alloc();
+  }
+  return ptr;
+}
+
+void operator delete(void* ptr) noexcept {
+  std::free(ptr);
+}
+
+#endif  // defined(__GLIBC__)
+
+namespace audio_dsp {
+
+ScopedHeapAllocationCounter::ScopedHeapAllocationCounter()
+    : initial_count_(total_allocations.load(std::memory_order_relaxed)),
+      eigen_malloc_was_allowed_(true) {
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+  eigen_malloc_was_allowed_ = Eigen::internal::is_malloc_allowed();
+  Eigen::internal::set_is_malloc_allowed(false);
+#endif  // EIGEN_RUNTIME_NO_MALLOC
+}
+
+ScopedHeapAllocationCounter::~ScopedHeapAllocationCounter() {
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+  Eigen::internal::set_is_malloc_allowed(eigen_malloc_was_allowed_);
+#endif  // EIGEN_RUNTIME_NO_MALLOC
+}
+
+int ScopedHeapAllocationCounter::num_allocations() const {
+  return total_allocations.load(std::memory_order_relaxed) - initial_count_;
+}
+
+}  // namespace audio_dsp
@@ -0,0 +1,71 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Test utility for checking that code does not touch the heap, e.g. that
+// ProcessBlock() of a prepared processor is safe to call on a realtime audio
+// thread.
+//
+// Example:
+//   processor.Init(num_channels, ...);
+//   processor.Prepare(max_block_size_samples);
+//   {
+//     ScopedHeapAllocationCounter counter;
+//     processor.ProcessBlock(input, &output);
+//     EXPECT_EQ(counter.num_allocations(), 0);
+//   }
+//
+// Allocations are counted by replacing malloc, calloc, realloc, and the
+// aligned variants (with glibc) or the global operator new (elsewhere), so
+// linking this library into a binary affects every allocation in it. Eigen's
+// allocations go through malloc. When the whole binary is built with
+// EIGEN_RUNTIME_NO_MALLOC defined (e.g. --copt=-DEIGEN_RUNTIME_NO_MALLOC),
+// Eigen additionally asserts while a counter is in scope that it does not
+// allocate, which pinpoints the offending expression in debug builds.
+
+#ifndef AUDIO_DSP_HEAP_ALLOCATION_COUNTER_H_
+#define AUDIO_DSP_HEAP_ALLOCATION_COUNTER_H_
+
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+
+// Counts heap allocations made by any thread while in scope. Counters may be
+// nested, in which case each counts the allocations made during its own
+// lifetime.
+class ScopedHeapAllocationCounter {
+ public:
+  ScopedHeapAllocationCounter();
+  ~ScopedHeapAllocationCounter();
+
+  ScopedHeapAllocationCounter(const ScopedHeapAllocationCounter&) = delete;
+  ScopedHeapAllocationCounter& operator=(
+      const ScopedHeapAllocationCounter&) = delete;
+
+  // Number of allocations since construction.
+  int num_allocations() const;
+
+ private:
+  int initial_count_;
+  // Unused unless Eigen's runtime malloc check is compiled in.
+  bool eigen_malloc_was_allowed_;
+};
+
+}  // namespace audio_dsp
+
+#endif  // AUDIO_DSP_HEAP_ALLOCATION_COUNTER_H_
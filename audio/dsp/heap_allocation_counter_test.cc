@@ -0,0 +1,80 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/heap_allocation_counter.h"
+
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+namespace {
+
+TEST(HeapAllocationCounterTest, NoAllocations) {
+  std::vector<float> values(10);
+  ScopedHeapAllocationCounter counter;
+  values.assign(5, 1.0f);  // Fits in the existing capacity.
+  EXPECT_EQ(counter.num_allocations(), 0);
+}
+
+TEST(HeapAllocationCounterTest, CountsOperatorNew) {
+  ScopedHeapAllocationCounter counter;
+  std::unique_ptr<int> value(new int(3));
+  std::vector<float> values(10);
+  EXPECT_EQ(counter.num_allocations(), 2);
+}
+
+TEST(HeapAllocationCounterTest, CountsEigenAllocations) {
+  ScopedHeapAllocationCounter counter;
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+  // Otherwise Eigen asserts that it does not allocate.
+  Eigen::internal::set_is_malloc_allowed(true);
+#endif  // EIGEN_RUNTIME_NO_MALLOC
+  Eigen::ArrayXXf array(3, 100);
+  array.resize(3, 100);  // Same size, so this does not allocate.
+  array.resize(3, 99);
+  EXPECT_EQ(counter.num_allocations(), 2);
+}
+
+TEST(HeapAllocationCounterTest, Nested) {
+  ScopedHeapAllocationCounter outer;
+  std::vector<float> values(10);
+  {
+    ScopedHeapAllocationCounter inner;
+    EXPECT_EQ(inner.num_allocations(), 0);
+    values.resize(100);
+    EXPECT_EQ(inner.num_allocations(), 1);
+  }
+  EXPECT_EQ(outer.num_allocations(), 2);
+}
+
+#ifdef EIGEN_RUNTIME_NO_MALLOC
+TEST(HeapAllocationCounterTest, RestoresEigenMallocAllowed) {
+  {
+    ScopedHeapAllocationCounter counter;
+    EXPECT_FALSE(Eigen::internal::is_malloc_allowed());
+  }
+  EXPECT_TRUE(Eigen::internal::is_malloc_allowed());
+}
+#endif  // EIGEN_RUNTIME_NO_MALLOC
+
+}  // namespace
+}  // namespace audio_dsp
@@ -0,0 +1,303 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/hifi/batched_dynamic_range_control.h"
+
+#include <algorithm>
+
+#include "audio/dsp/decibels.h"
+
+namespace audio_dsp {
+
+using ::Eigen::ArrayXf;
+using ::Eigen::ArrayXXf;
+
+namespace {
+void VerifyParams(const DynamicRangeControlParams& params) {
+  CHECK_GE(params.knee_width_db, 0);
+  CHECK_GT(params.ratio, 0);
+  CHECK_GT(params.attack_s, 0);
+  CHECK_GT(params.release_s, 0);
+  CHECK_GE(params.control_decimation_factor, 1);
+  CHECK_NE(params.dynamics_type, kTwoWayCompressor)
+      << "Two-way compression is not supported.";
+}
+}  // namespace
+
+void BatchedDynamicRangeControl::GainCurves::Resize(int num_streams) {
+  level_scale.resize(num_streams);
+  knee_start_offset_db.resize(num_streams);
+  knee_width_db.resize(num_streams);
+  knee_width_inv.resize(num_streams);
+  hard_knee_half.resize(num_streams);
+  relu_total_slope.resize(num_streams);
+  expander_slope.resize(num_streams);
+  constant_db.resize(num_streams);
+}
+
+void BatchedDynamicRangeControl::GainCurves::Set(
+    int stream, const DynamicRangeControlParams& params) {
+  // The slopes of the curves in
+  // DynamicRangeControl::ComputeGainForSpecificDynamicRangeControlType().
+  float relu_slope = 0.0f;
+  float expander = 0.0f;
+  switch (params.dynamics_type) {
+    case kCompressor:
+      relu_slope = 1.0f - 1.0f / params.ratio;
+      break;
+    case kLimiter:
+      relu_slope = 1.0f;
+      break;
+    case kExpander:
+      expander = params.ratio - 1.0f;
+      break;
+    case kNoiseGate: {
+      // As for DynamicRangeControl, a ratio of 1000 stands in for infinity.
+      constexpr float kInfiniteRatio = 1000;
+      expander = kInfiniteRatio - 1.0f;
+      break;
+    }
+    case kTwoWayCompressor:
+      LOG(FATAL) << "Two-way compression is not supported.";
+  }
+  level_scale[stream] = params.envelope_type == kRms ? 1.0f : 2.0f;
+  knee_start_offset_db[stream] =
+      params.input_gain_db - params.threshold_db + params.knee_width_db / 2;
+  knee_width_db[stream] = params.knee_width_db;
+  const bool hard_knee = params.knee_width_db == 0;
+  knee_width_inv[stream] = hard_knee ? 0.0f : 1.0f / params.knee_width_db;
+  hard_knee_half[stream] = hard_knee ? 0.5f : 0.0f;
+  relu_total_slope[stream] = relu_slope + expander;
+  expander_slope[stream] = expander;
+  constant_db[stream] =
+      params.input_gain_db + params.output_gain_db +
+      expander * (params.input_gain_db - params.threshold_db);
+}
+
+BatchedDynamicRangeControl::BatchedDynamicRangeControl(
+    const DynamicRangeControlParams& initial_params)
+    : num_channels_(0),
+      num_streams_(0),
+      initial_params_(initial_params),
+      params_change_needed_(false) {
+  VerifyParams(initial_params);
+}
+
+void BatchedDynamicRangeControl::Init(const std::vector<int>& channel_streams,
+                                      int max_block_size_samples,
+                                      float sample_rate_hz) {
+  CHECK(!channel_streams.empty());
+  CHECK_GT(max_block_size_samples, 0);
+  CHECK_GT(sample_rate_hz, 0);
+  num_channels_ = channel_streams.size();
+  num_streams_ =
+      *std::max_element(channel_streams.begin(), channel_streams.end()) + 1;
+  max_block_size_samples_ = max_block_size_samples;
+  channel_streams_ = channel_streams;
+
+  // Weight each channel by the inverse number of channels in its stream.
+  std::vector<int> stream_num_channels(num_streams_, 0);
+  one_channel_per_stream_ = num_streams_ == num_channels_;
+  for (int channel = 0; channel < num_channels_; ++channel) {
+    const int stream = channel_streams[channel];
+    CHECK_GE(stream, 0);
+    ++stream_num_channels[stream];
+    one_channel_per_stream_ &= stream == channel;
+  }
+  for (int stream = 0; stream < num_streams_; ++stream) {
+    CHECK_GT(stream_num_channels[stream], 0)
+        << "Stream " << stream << " has no channels.";
+  }
+  channel_weights_.resize(num_channels_);
+  for (int channel = 0; channel < num_channels_; ++channel) {
+    channel_weights_[channel] =
+        1.0f / stream_num_channels[channel_streams[channel]];
+  }
+  square_weights_.resize(num_channels_);
+  linear_weights_.resize(num_channels_);
+
+  params_.assign(num_streams_, initial_params_);
+  next_params_ = params_;
+  params_change_needed_ = false;
+  curves_.Resize(num_streams_);
+  for (int stream = 0; stream < num_streams_; ++stream) {
+    curves_.Set(stream, initial_params_);
+  }
+  next_curves_ = curves_;
+  UpdateDetectionWeights();
+
+  workspace_ = ArrayXXf::Zero(num_streams_, max_block_size_samples_);
+  workspace_gain_db_ = ArrayXXf::Zero(num_streams_, max_block_size_samples_);
+  workspace_interp_gain_db_ =
+      ArrayXXf::Zero(num_streams_, max_block_size_samples_);
+  // Each full control period has a control point, and so does the end of the
+  // block.
+  workspace_control_ = ArrayXXf::Zero(
+      num_streams_,
+      max_block_size_samples_ / initial_params_.control_decimation_factor + 1);
+  previous_control_gain_ = ArrayXf::Zero(num_streams_);
+  control_gain_step_ = ArrayXf::Zero(num_streams_);
+  has_previous_control_gain_ = false;
+  envelope_.reset(new AttackReleaseEnvelope(
+      num_streams_,
+      AttackReleaseEnvelopeParams(initial_params_.attack_s,
+                                  initial_params_.release_s),
+      sample_rate_hz));
+  const int lookahead_samples =
+      std::round(initial_params_.lookahead_s * sample_rate_hz);
+  lookahead_delay_.Init(num_channels_, lookahead_samples,
+                        max_block_size_samples);
+}
+
+void BatchedDynamicRangeControl::Reset() {
+  envelope_->Reset();
+  has_previous_control_gain_ = false;
+}
+
+void BatchedDynamicRangeControl::SetDynamicRangeControlParams(
+    int stream, const DynamicRangeControlParams& params) {
+  CHECK_GE(stream, 0);
+  CHECK_LT(stream, num_streams_);
+  VerifyParams(params);
+  CHECK_EQ(params.lookahead_s, initial_params_.lookahead_s)
+      << "This parameter is shared by all streams and cannot be changed.";
+  CHECK_EQ(params.control_decimation_factor,
+           initial_params_.control_decimation_factor)
+      << "This parameter is shared by all streams and cannot be changed.";
+  CHECK_EQ(params.fast_decibel_conversions,
+           initial_params_.fast_decibel_conversions)
+      << "This parameter is shared by all streams and cannot be changed.";
+  next_params_[stream] = params;
+  next_curves_.Set(stream, params);
+  // Update envelope time constants now. The rest will get interpolated via
+  // crossfade.
+  envelope_->SetAttackTimeSeconds(stream, params.attack_s);
+  envelope_->SetReleaseTimeSeconds(stream, params.release_s);
+  params_change_needed_ = true;
+}
+
+void BatchedDynamicRangeControl::UpdateDetectionWeights() {
+  for (int channel = 0; channel < num_channels_; ++channel) {
+    const bool rms = params_[channel_streams_[channel]].envelope_type == kRms;
+    square_weights_[channel] = rms ? channel_weights_[channel] : 0.0f;
+    linear_weights_[channel] = rms ? 0.0f : channel_weights_[channel];
+  }
+}
+
+void BatchedDynamicRangeControl::ComputeGainFromDetectedSignal(
+    int num_samples) {
+  BlockType data = workspace_.leftCols(num_samples);
+  // Apply attack/release smoothing, vectorized across streams.
+  envelope_->ProcessBlock(data, data);
+  // Occasionally a negative will come up due to numerical imprecision.
+  data = data.max(1e-12f);
+
+  const int control_period = initial_params_.control_decimation_factor;
+  if (control_period == 1) {
+    ComputeGainFromEnvelope(1, num_samples, &data);
+    return;
+  }
+  // Sample the envelope at the end of each control period and of the block.
+  const int num_control_points =
+      (num_samples + control_period - 1) / control_period;
+  BlockType control = workspace_control_.leftCols(num_control_points);
+  for (int i = 0; i < num_control_points - 1; ++i) {
+    control.col(i) = data.col((i + 1) * control_period - 1);
+  }
+  control.col(num_control_points - 1) = data.col(num_samples - 1);
+  ComputeGainFromEnvelope(control_period, num_samples, &control);
+
+  // Linearly interpolate the gain from the previous control point, which is
+  // the last sample of the previous block for the first one.
+  ArrayXf& gain = previous_control_gain_;
+  if (!has_previous_control_gain_) {
+    gain = control.col(0);
+  }
+  int end = 0;
+  for (int i = 0; i < num_control_points; ++i) {
+    const int start = end;
+    end = std::min(start + control_period, num_samples);
+    control_gain_step_ = (control.col(i) - gain) / (end - start);
+    for (int j = start; j < end; ++j) {
+      gain += control_gain_step_;
+      data.col(j) = gain;
+    }
+    // Avoid accumulating rounding error across control periods.
+    gain = control.col(i);
+  }
+  has_previous_control_gain_ = true;
+}
+
+void BatchedDynamicRangeControl::ComputeGainFromEnvelope(
+    int control_period, int block_size, BlockType* data_ptr) {
+  BlockType& data = *data_ptr;
+  // Convert to decibels, as a power and then scaled for the streams with a
+  // peak envelope.
+  if (initial_params_.fast_decibel_conversions) {
+    FastPowerRatioToDecibels(data, &data);
+  } else {
+    PowerRatioToDecibels(data, &data);
+  }
+  data.colwise() *= curves_.level_scale;
+
+  BlockType gain_db = workspace_gain_db_.leftCols(data.cols());
+  ComputeGainDb(curves_, data, &gain_db);
+  if (params_change_needed_) {
+    // The streams whose params did not change have the same curves in
+    // next_curves_, so crossfading all of them leaves those unchanged.
+    BlockType interp_gain_db = workspace_interp_gain_db_.leftCols(data.cols());
+    ComputeGainDb(next_curves_, data, &interp_gain_db);
+    const float block_size_inv = 1.0f / block_size;
+    for (int i = 0; i < data.cols(); ++i) {
+      const float k =
+          std::min((i + 1) * control_period, block_size) * block_size_inv;
+      gain_db.col(i) += k * (interp_gain_db.col(i) - gain_db.col(i));
+    }
+    params_ = next_params_;
+    curves_ = next_curves_;
+    UpdateDetectionWeights();
+    params_change_needed_ = false;
+  }
+  // Convert back to linear.
+  if (initial_params_.fast_decibel_conversions) {
+    FastDecibelsToAmplitudeRatio(gain_db, &data);
+  } else {
+    DecibelsToAmplitudeRatio(gain_db, &data);
+  }
+  DCHECK(data.allFinite());
+}
+
+void BatchedDynamicRangeControl::ComputeGainDb(const GainCurves& curves,
+                                               const BlockType& level_db,
+                                               BlockType* gain_db) {
+  // See GainCurves. Each column is evaluated for all streams at once.
+  for (int i = 0; i < level_db.cols(); ++i) {
+    const auto level = level_db.col(i);
+    // The level above the start of the knee.
+    const auto above_knee_start = level + curves.knee_start_offset_db;
+    const auto rectified = above_knee_start.max(0.0f);
+    // The negated smooth ReLU.
+    const auto relu_magnitude =
+        0.5f * (rectified.min(curves.knee_width_db) * above_knee_start *
+                    curves.knee_width_inv +
+                (above_knee_start - curves.knee_width_db).max(0.0f)) +
+        curves.hard_knee_half * rectified;
+    gain_db->col(i) = curves.constant_db + curves.expander_slope * level -
+                      curves.relu_total_slope * relu_magnitude;
+  }
+}
+
+}  // namespace audio_dsp
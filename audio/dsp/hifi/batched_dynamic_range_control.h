@@ -0,0 +1,271 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Dynamic range control of many independent streams with one object, e.g. the
+// calls handled by a server.
+//
+// Each stream is a group of channels (rows) of the input, and is processed as
+// by a DynamicRangeControl of its own: the gain is computed from the mean
+// power or amplitude over the channels of the stream, and applied to all of
+// them. Rather than running one DynamicRangeControl per stream, with its own
+// workspaces, delay line and envelope, the streams are processed in lockstep.
+// The envelopes, the decibel conversions and the gain curves are vectorized
+// across streams, with the parameters of each stream held in arrays. When a
+// stream has several channels, summing the levels of its channels and applying
+// its gain to them are scalar loops; see BM_BatchedCompressors for how this
+// compares with a DynamicRangeControl per stream.
+//
+// Each stream has its own DynamicRangeControlParams, except for lookahead_s,
+// control_decimation_factor and fast_decibel_conversions, which are shared by
+// all streams and set by the params passed to the constructor. The gain curves
+// are always computed directly, so use_gain_curve_table is ignored, and
+// kTwoWayCompressor is not supported.
+//
+// Example use, for two mono streams and a stereo one:
+//   BatchedDynamicRangeControl drc(
+//       DynamicRangeControlParams::ReasonableCompressorParams());
+//   drc.Init({0, 1, 2, 2}, kMaxBlockSize, 48000.0f);
+//   drc.SetDynamicRangeControlParams(
+//       1, DynamicRangeControlParams::ReasonableLimiterParams());
+//   ArrayXXf input = ...  // 4 rows, one per channel.
+//   ArrayXXf output(4, input.cols());
+//   drc.ProcessBlock(input, &output);
+//
+// This class is not thread safe.
+
+#ifndef AUDIO_DSP_HIFI_BATCHED_DYNAMIC_RANGE_CONTROL_H_
+#define AUDIO_DSP_HIFI_BATCHED_DYNAMIC_RANGE_CONTROL_H_
+
+#include <cmath>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+#include "audio/dsp/attack_release_envelope.h"
+#include "audio/dsp/fixed_delay_line.h"
+#include "audio/dsp/hifi/dynamic_range_control.h"
+#include "glog/logging.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+
+class BatchedDynamicRangeControl {
+ public:
+  // initial_params are the params of every stream.
+  explicit BatchedDynamicRangeControl(
+      const DynamicRangeControlParams& initial_params);
+
+  // channel_streams[c] is the stream of channel c. The streams are numbered
+  // from 0 to num_streams - 1, and each has at least one channel. The
+  // channels of a stream need not be adjacent. Every stream starts with the
+  // initial params.
+  void Init(const std::vector<int>& channel_streams,
+            int max_block_size_samples, float sample_rate_hz);
+
+  void Reset();
+
+  int num_channels() const { return num_channels_; }
+  int num_streams() const { return num_streams_; }
+
+  // Sets the params of one stream. As for DynamicRangeControl, this should be
+  // called in between calls to ProcessBlock, and the stream crossfades to the
+  // new params over the next block.
+  void SetDynamicRangeControlParams(int stream,
+                                    const DynamicRangeControlParams& params);
+
+  // InputType and OutputType are Eigen 2D arrays, or mapped arrays, with a row
+  // per channel and at most max_block_size_samples columns.
+  template <typename InputType, typename OutputType>
+  void ProcessBlock(const InputType& input, OutputType* output) {
+    ProcessBlockWithSidechain(input, input, output);
+  }
+
+  // The sidechain signal of each stream determines the gain applied to it.
+  template <typename InputType, typename SidechainType, typename OutputType>
+  void ProcessBlockWithSidechain(const InputType& input,
+                                 const SidechainType& sidechain,
+                                 OutputType* output) {
+    static_assert(std::is_same<typename InputType::Scalar, float>::value,
+                  "Scalar type must be float.");
+    static_assert(std::is_same<typename SidechainType::Scalar, float>::value,
+                  "Scalar type must be float.");
+    static_assert(std::is_same<typename OutputType::Scalar, float>::value,
+                  "Scalar type must be float.");
+    DCHECK_EQ(input.rows(), num_channels_);
+    DCHECK_EQ(input.cols(), output->cols());
+    DCHECK_EQ(input.rows(), output->rows());
+    DCHECK_EQ(input.cols(), sidechain.cols());
+    DCHECK_EQ(input.rows(), sidechain.rows());
+
+    DetectLevels(sidechain);
+    ComputeGainFromDetectedSignal(sidechain.cols());
+    ApplyGainToSignal(input, workspace_.leftCols(sidechain.cols()), output);
+  }
+
+  // Computes the gains that would be applied to the signal, with a row per
+  // stream and a column per sample, so that more processing can be done prior
+  // to applying them. gain is resized if needed.
+  template <typename InputType, typename GainType>
+  void ComputeGainSignalOnly(const InputType& input_or_sidechain,
+                             GainType* gain) {
+    DetectLevels(input_or_sidechain);
+    ComputeGainFromDetectedSignal(input_or_sidechain.cols());
+    *gain = workspace_.leftCols(input_or_sidechain.cols());
+  }
+
+  // To be used with ComputeGainSignalOnly above. In-place processing is
+  // supported (&input = output).
+  template <typename GainType, typename InputType, typename OutputType>
+  void ApplyGainToSignal(const InputType& input, const GainType& gain,
+                         OutputType* output) {
+    DCHECK_EQ(gain.rows(), num_streams_);
+    DCHECK_EQ(input.cols(), gain.cols());
+    Eigen::Map<const Eigen::ArrayXXf> delayed =
+        lookahead_delay_.ProcessBlock(input);
+    if (one_channel_per_stream_) {
+      *output = delayed * gain;
+      return;
+    }
+    for (int i = 0; i < input.cols(); ++i) {
+      for (int channel = 0; channel < num_channels_; ++channel) {
+        (*output)(channel, i) =
+            delayed(channel, i) * gain(channel_streams_[channel], i);
+      }
+    }
+  }
+
+ private:
+  using BlockType = Eigen::Block<Eigen::ArrayXXf, Eigen::Dynamic,
+                                 Eigen::Dynamic, true>;
+
+  // The gain curves of all streams, in a form shared by all dynamics types so
+  // that they can be evaluated together. For a level x in decibels after the
+  // input gain and the smooth ReLU
+  //   relu = SmoothReLU(x, threshold_db, knee_width_db) <= 0
+  // of dynamic_range_control_functions.h, the output level is
+  //   x + relu_slope * relu + expander_slope * (x - threshold_db + relu),
+  // which is a compressor, limiter, expander or noise gate depending on the
+  // slopes. Each array has an entry per stream.
+  struct GainCurves {
+    // Scales the level in decibels of the power to that of the envelope, 1
+    // for an RMS envelope and 2 for a peak envelope.
+    Eigen::ArrayXf level_scale;
+    // input_gain_db - threshold_db + knee_width_db / 2, where the knee starts.
+    Eigen::ArrayXf knee_start_offset_db;
+    Eigen::ArrayXf knee_width_db;
+    // 1 / knee_width_db, or 0 for a hard knee.
+    Eigen::ArrayXf knee_width_inv;
+    // 0.5 for a hard knee, where the smooth ReLU is a ReLU, and 0 otherwise.
+    Eigen::ArrayXf hard_knee_half;
+    // relu_slope + expander_slope.
+    Eigen::ArrayXf relu_total_slope;
+    Eigen::ArrayXf expander_slope;
+    // The gain at relu = 0 and a level of 0 dB, including the output gain.
+    Eigen::ArrayXf constant_db;
+
+    void Resize(int num_streams);
+    void Set(int stream, const DynamicRangeControlParams& params);
+  };
+
+  // Computes the mean power or amplitude over the channels of each stream
+  // into workspace_.
+  template <typename InputType>
+  void DetectLevels(const InputType& input) {
+    static_assert(std::is_same<typename InputType::Scalar, float>::value,
+                  "Scalar type must be float.");
+    DCHECK_LE(input.cols(), max_block_size_samples_);
+    DCHECK_EQ(input.rows(), num_channels_);
+    BlockType levels = workspace_.leftCols(input.cols());
+    // A rectified sample a contributes a * (a * square_weights_ +
+    // linear_weights_), the power or the amplitude divided by the number of
+    // channels of the stream.
+    if (one_channel_per_stream_) {
+      levels = input.abs() *
+               ((input.abs().colwise() * square_weights_).colwise() +
+                linear_weights_);
+      return;
+    }
+    levels.setZero();
+    for (int i = 0; i < input.cols(); ++i) {
+      for (int channel = 0; channel < num_channels_; ++channel) {
+        const float rectified = std::abs(input(channel, i));
+        levels(channel_streams_[channel], i) +=
+            rectified * (rectified * square_weights_[channel] +
+                         linear_weights_[channel]);
+      }
+    }
+  }
+
+  // Sets the detection weights of the channels from the current params.
+  void UpdateDetectionWeights();
+  // Computes the linear gain to apply from the detected levels in the first
+  // num_samples columns of workspace_, in place.
+  void ComputeGainFromDetectedSignal(int num_samples);
+  // Converts envelope samples to linear gains in place, as
+  // DynamicRangeControl::ComputeGainFromEnvelope() does for a single stream.
+  void ComputeGainFromEnvelope(int control_period, int block_size,
+                               BlockType* data_ptr);
+  // Computes the gain in decibels from the envelope level in decibels, with a
+  // row per stream.
+  static void ComputeGainDb(const GainCurves& curves, const BlockType& level_db,
+                            BlockType* gain_db);
+
+  int num_channels_;
+  int num_streams_;
+  int max_block_size_samples_;
+  std::vector<int> channel_streams_;
+  // True when channel c is stream c, so that no grouping is needed.
+  bool one_channel_per_stream_;
+  // 1 / the number of channels in the stream of each channel.
+  Eigen::ArrayXf channel_weights_;
+  // Detection weights per channel, see DetectLevels().
+  Eigen::ArrayXf square_weights_;
+  Eigen::ArrayXf linear_weights_;
+
+  // The params shared by all streams.
+  DynamicRangeControlParams initial_params_;
+  // The params of each stream, and those they will change to on the next
+  // block.
+  std::vector<DynamicRangeControlParams> params_;
+  std::vector<DynamicRangeControlParams> next_params_;
+  bool params_change_needed_;
+  GainCurves curves_;
+  GainCurves next_curves_;
+
+  // Workspaces with a row per stream. workspace_ holds the levels, then the
+  // envelope and then the gain.
+  Eigen::ArrayXXf workspace_;
+  Eigen::ArrayXXf workspace_gain_db_;
+  Eigen::ArrayXXf workspace_interp_gain_db_;
+  // The envelope and then the gain at the control points of a block.
+  Eigen::ArrayXXf workspace_control_;
+  // The gain at the last sample of the previous block, when using a control
+  // rate, and the step of its linear interpolation.
+  Eigen::ArrayXf previous_control_gain_;
+  Eigen::ArrayXf control_gain_step_;
+  bool has_previous_control_gain_;
+
+  FixedDelayLine lookahead_delay_;
+  // An envelope per stream.
+  std::unique_ptr<AttackReleaseEnvelope> envelope_;
+};
+
+}  // namespace audio_dsp
+
+#endif  // AUDIO_DSP_HIFI_BATCHED_DYNAMIC_RANGE_CONTROL_H_
@@ -0,0 +1,331 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/hifi/batched_dynamic_range_control.h"
+
+#include <memory>
+#include <vector>
+
+#include "audio/dsp/heap_allocation_counter.h"
+#include "audio/dsp/hifi/dynamic_range_control.h"
+#include "audio/dsp/testing_util.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+namespace {
+
+using ::Eigen::ArrayXXf;
+
+constexpr float kSampleRate = 48000.0f;
+
+// Processes each stream with a DynamicRangeControl of its own, for comparison.
+class SeparateDynamicRangeControls {
+ public:
+  SeparateDynamicRangeControls(const DynamicRangeControlParams& initial_params,
+                               const std::vector<int>& channel_streams,
+                               int max_block_size_samples)
+      : channel_streams_(channel_streams) {
+    for (int channel = 0; channel < channel_streams.size(); ++channel) {
+      const int stream = channel_streams[channel];
+      if (stream >= stream_channels_.size()) {
+        stream_channels_.resize(stream + 1);
+      }
+      stream_channels_[stream].push_back(channel);
+    }
+    for (const std::vector<int>& channels : stream_channels_) {
+      drcs_.emplace_back(new DynamicRangeControl(initial_params));
+      drcs_.back()->Init(channels.size(), max_block_size_samples, kSampleRate);
+    }
+  }
+
+  void SetDynamicRangeControlParams(int stream,
+                                    const DynamicRangeControlParams& params) {
+    drcs_[stream]->SetDynamicRangeControlParams(params);
+  }
+
+  void ProcessBlock(const ArrayXXf& input, ArrayXXf* output) {
+    output->resize(input.rows(), input.cols());
+    for (int stream = 0; stream < drcs_.size(); ++stream) {
+      const std::vector<int>& channels = stream_channels_[stream];
+      ArrayXXf stream_input(channels.size(), input.cols());
+      for (int i = 0; i < channels.size(); ++i) {
+        stream_input.row(i) = input.row(channels[i]);
+      }
+      ArrayXXf stream_output(channels.size(), input.cols());
+      drcs_[stream]->ProcessBlock(stream_input, &stream_output);
+      for (int i = 0; i < channels.size(); ++i) {
+        output->row(channels[i]) = stream_output.row(i);
+      }
+    }
+  }
+
+ private:
+  std::vector<int> channel_streams_;
+  std::vector<std::vector<int>> stream_channels_;
+  std::vector<std::unique_ptr<DynamicRangeControl>> drcs_;
+};
+
+// Params of four streams that exercise all dynamics types, both envelope
+// types and hard and soft knees.
+std::vector<DynamicRangeControlParams> MixedParams(
+    const DynamicRangeControlParams& shared_params) {
+  std::vector<DynamicRangeControlParams> params(4, shared_params);
+  params[0].dynamics_type = kCompressor;
+  params[0].envelope_type = kRms;
+  params[0].threshold_db = -20.0f;
+  params[0].ratio = 4.0f;
+  params[0].knee_width_db = 6.0f;
+  params[0].input_gain_db = 3.0f;
+  params[1].dynamics_type = kLimiter;
+  params[1].envelope_type = kPeak;
+  params[1].threshold_db = -10.0f;
+  params[1].knee_width_db = 0.0f;
+  params[1].output_gain_db = -2.0f;
+  params[1].attack_s = 0.0005f;
+  params[2].dynamics_type = kExpander;
+  params[2].envelope_type = kRms;
+  params[2].threshold_db = -8.0f;
+  params[2].ratio = 2.0f;
+  params[2].knee_width_db = 4.0f;
+  params[2].release_s = 0.05f;
+  params[3].dynamics_type = kNoiseGate;
+  params[3].envelope_type = kPeak;
+  params[3].threshold_db = -15.0f;
+  params[3].knee_width_db = 10.0f;
+  return params;
+}
+
+// Two mono streams, a stereo stream whose channels are not adjacent and a
+// mono stream.
+const std::vector<int> kMixedChannelStreams = {0, 1, 2, 1, 3};
+
+// Compares against separate DynamicRangeControls over blocks of varying
+// size, changing the params of a stream midway.
+void ExpectMatchesSeparateControls(
+    const DynamicRangeControlParams& shared_params) {
+  constexpr int kMaxBlockSize = 256;
+  const int num_channels = kMixedChannelStreams.size();
+  const std::vector<DynamicRangeControlParams> params =
+      MixedParams(shared_params);
+
+  BatchedDynamicRangeControl batched(shared_params);
+  batched.Init(kMixedChannelStreams, kMaxBlockSize, kSampleRate);
+  SeparateDynamicRangeControls separate(shared_params, kMixedChannelStreams,
+                                        kMaxBlockSize);
+  ASSERT_EQ(batched.num_channels(), num_channels);
+  ASSERT_EQ(batched.num_streams(), params.size());
+  for (int stream = 0; stream < params.size(); ++stream) {
+    batched.SetDynamicRangeControlParams(stream, params[stream]);
+    separate.SetDynamicRangeControlParams(stream, params[stream]);
+  }
+
+  int block = 0;
+  for (int num_samples : {kMaxBlockSize, 100, 1, 37, kMaxBlockSize, 200, 64}) {
+    SCOPED_TRACE("block: " + testing::PrintToString(block));
+    if (block == 3) {
+      DynamicRangeControlParams new_params = params[2];
+      new_params.dynamics_type = kCompressor;
+      new_params.envelope_type = kPeak;
+      new_params.attack_s = 0.002f;
+      batched.SetDynamicRangeControlParams(2, new_params);
+      separate.SetDynamicRangeControlParams(2, new_params);
+    }
+    // Vary the level so that every curve is exercised on both sides of its
+    // threshold.
+    const ArrayXXf input = ArrayXXf::Random(num_channels, num_samples) *
+                           (block % 2 == 0 ? 0.8f : 0.05f);
+    ArrayXXf output(num_channels, num_samples);
+    batched.ProcessBlock(input, &output);
+    ArrayXXf expected;
+    separate.ProcessBlock(input, &expected);
+    EXPECT_THAT(output, EigenArrayNear(expected, 2e-4));
+    ++block;
+  }
+}
+
+TEST(BatchedDynamicRangeControl, MatchesSeparateControls) {
+  DynamicRangeControlParams params;
+  params.lookahead_s = 10 / kSampleRate;
+  ExpectMatchesSeparateControls(params);
+}
+
+TEST(BatchedDynamicRangeControl, ControlRateMatchesSeparateControls) {
+  DynamicRangeControlParams params;
+  params.control_decimation_factor = 16;
+  ExpectMatchesSeparateControls(params);
+}
+
+TEST(BatchedDynamicRangeControl, FastDecibelConversionsMatchSeparateControls) {
+  DynamicRangeControlParams params;
+  params.fast_decibel_conversions = true;
+  ExpectMatchesSeparateControls(params);
+}
+
+TEST(BatchedDynamicRangeControl, OneChannelPerStreamMatchesSeparateControls) {
+  constexpr int kNumStreams = 4;
+  constexpr int kNumSamples = 128;
+  const std::vector<int> channel_streams = {0, 1, 2, 3};
+  const std::vector<DynamicRangeControlParams> params =
+      MixedParams(DynamicRangeControlParams());
+  BatchedDynamicRangeControl batched(params[0]);
+  batched.Init(channel_streams, kNumSamples, kSampleRate);
+  SeparateDynamicRangeControls separate(params[0], channel_streams,
+                                        kNumSamples);
+  for (int stream = 1; stream < kNumStreams; ++stream) {
+    batched.SetDynamicRangeControlParams(stream, params[stream]);
+    separate.SetDynamicRangeControlParams(stream, params[stream]);
+  }
+  for (int block = 0; block < 4; ++block) {
+    const ArrayXXf input = ArrayXXf::Random(kNumStreams, kNumSamples);
+    ArrayXXf output(kNumStreams, kNumSamples);
+    batched.ProcessBlock(input, &output);
+    ArrayXXf expected;
+    separate.ProcessBlock(input, &expected);
+    EXPECT_THAT(output, EigenArrayNear(expected, 2e-4));
+  }
+}
+
+TEST(BatchedDynamicRangeControl, GainSignalMatchesProcessBlock) {
+  constexpr int kNumSamples = 64;
+  const int num_channels = kMixedChannelStreams.size();
+  const DynamicRangeControlParams params =
+      DynamicRangeControlParams::ReasonableCompressorParams();
+  BatchedDynamicRangeControl drc1(params);
+  BatchedDynamicRangeControl drc2(params);
+  drc1.Init(kMixedChannelStreams, kNumSamples, kSampleRate);
+  drc2.Init(kMixedChannelStreams, kNumSamples, kSampleRate);
+
+  const ArrayXXf input = ArrayXXf::Random(num_channels, kNumSamples);
+  ArrayXXf output(num_channels, kNumSamples);
+  drc1.ProcessBlock(input, &output);
+  ArrayXXf gain;
+  drc2.ComputeGainSignalOnly(input, &gain);
+  ASSERT_EQ(gain.rows(), drc2.num_streams());
+  ArrayXXf in_place = input;
+  drc2.ApplyGainToSignal(in_place, gain, &in_place);
+  EXPECT_THAT(in_place, EigenArrayNear(output, 1e-6));
+}
+
+TEST(BatchedDynamicRangeControl, ResetTest) {
+  constexpr int kNumSamples = 64;
+  const int num_channels = kMixedChannelStreams.size();
+  BatchedDynamicRangeControl drc(
+      DynamicRangeControlParams::ReasonableCompressorParams());
+  drc.Init(kMixedChannelStreams, kNumSamples, kSampleRate);
+  const ArrayXXf input = ArrayXXf::Random(num_channels, kNumSamples);
+  ArrayXXf output1(num_channels, kNumSamples);
+  ArrayXXf output2(num_channels, kNumSamples);
+  drc.ProcessBlock(input, &output1);
+  drc.Reset();
+  drc.ProcessBlock(input, &output2);
+  EXPECT_THAT(output1, EigenArrayNear(output2, 1e-6));
+}
+
+TEST(BatchedDynamicRangeControl, DoesNotAllocate) {
+  constexpr int kMaxBlockSize = 64;
+  const int num_channels = kMixedChannelStreams.size();
+  for (int decimation : {1, 16}) {
+    SCOPED_TRACE("decimation: " + testing::PrintToString(decimation));
+    DynamicRangeControlParams params =
+        DynamicRangeControlParams::ReasonableCompressorParams();
+    params.lookahead_s = 10 / kSampleRate;
+    params.control_decimation_factor = decimation;
+    BatchedDynamicRangeControl drc(params);
+    drc.Init(kMixedChannelStreams, kMaxBlockSize, kSampleRate);
+    // Change the parameters so that the crossfade is exercised too.
+    params.threshold_db = -20.0f;
+    drc.SetDynamicRangeControlParams(1, params);
+
+    ArrayXXf output_buffer(num_channels, kMaxBlockSize);
+    for (int num_samples : {kMaxBlockSize, 5, 1, 33}) {
+      SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+      const ArrayXXf input = ArrayXXf::Random(num_channels, num_samples);
+      auto output = output_buffer.leftCols(num_samples);
+      ScopedHeapAllocationCounter counter;
+      drc.ProcessBlock(input, &output);
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+  }
+}
+
+// Streams of 10ms blocks, as for the calls handled by a server. The first
+// argument is the number of streams, the second the number of channels per
+// stream, and the channels of a stream are adjacent rows. Compared with a
+// DynamicRangeControl per stream, the batched compressors processed about twice
+// as many samples per second for mono streams, and about 1.4-1.7 times as many
+// for stereo streams, whose grouping is not vectorized.
+constexpr int kBenchmarkBlockSize = 480;
+
+void BM_BatchedCompressors(benchmark::State& state) {
+  const int num_streams = state.range(0);
+  const int stream_channels = state.range(1);
+  const int num_channels = num_streams * stream_channels;
+  std::vector<int> channel_streams(num_channels);
+  for (int channel = 0; channel < num_channels; ++channel) {
+    channel_streams[channel] = channel / stream_channels;
+  }
+  const ArrayXXf input = ArrayXXf::Random(num_channels, kBenchmarkBlockSize);
+  ArrayXXf output(num_channels, kBenchmarkBlockSize);
+  BatchedDynamicRangeControl drc(
+      DynamicRangeControlParams::ReasonableCompressorParams());
+  drc.Init(channel_streams, kBenchmarkBlockSize, kSampleRate);
+
+  while (state.KeepRunning()) {
+    drc.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(num_channels * kBenchmarkBlockSize *
+                          state.iterations());
+}
+BENCHMARK(BM_BatchedCompressors)
+    ->Args({8, 1})->Args({64, 1})->Args({8, 2})->Args({64, 2});
+
+void BM_SeparateCompressors(benchmark::State& state) {
+  const int num_streams = state.range(0);
+  const int stream_channels = state.range(1);
+  const int num_channels = num_streams * stream_channels;
+  const ArrayXXf input = ArrayXXf::Random(num_channels, kBenchmarkBlockSize);
+  ArrayXXf output(num_channels, kBenchmarkBlockSize);
+  std::vector<std::unique_ptr<DynamicRangeControl>> drcs;
+  for (int stream = 0; stream < num_streams; ++stream) {
+    drcs.emplace_back(new DynamicRangeControl(
+        DynamicRangeControlParams::ReasonableCompressorParams()));
+    drcs.back()->Init(stream_channels, kBenchmarkBlockSize, kSampleRate);
+  }
+
+  while (state.KeepRunning()) {
+    for (int stream = 0; stream < num_streams; ++stream) {
+      auto stream_output =
+          output.middleRows(stream * stream_channels, stream_channels);
+      drcs[stream]->ProcessBlock(
+          input.middleRows(stream * stream_channels, stream_channels),
+          &stream_output);
+    }
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(num_channels * kBenchmarkBlockSize *
+                          state.iterations());
+}
+BENCHMARK(BM_SeparateCompressors)
+    ->Args({8, 1})->Args({64, 1})->Args({8, 2})->Args({64, 2});
+
+}  // namespace
+}  // namespace audio_dsp
@@ -16,6 +16,8 @@
 
 #include "audio/dsp/hifi/dynamic_range_control.h"
 
+#include <algorithm>
+
 #include "audio/dsp/decibels.h"
 #include "audio/dsp/hifi/dynamic_range_control_functions.h"
 
@@ -29,6 +31,98 @@ void VerifyParams(const DynamicRangeControlParams& params) {
   CHECK_GT(params.ratio, 0);
   CHECK_GT(params.attack_s, 0);
   CHECK_GT(params.release_s, 0);
+  CHECK_GE(params.control_decimation_factor, 1);
+  if (params.dynamics_type == kTwoWayCompressor) {
+    CHECK_EQ(internal::VerifyParams(params.two_way_compression),
+             internal::kNoParamError);
+  }
+}
+
+// The spacing of the points of the gain curve tables.
+constexpr float kGainCurveTableStepDb = 1.0f / 32;
+
+bool UsesGainCurveTable(const DynamicRangeControlParams& params) {
+  return params.use_gain_curve_table ||
+         params.dynamics_type == kTwoWayCompressor;
+}
+
+// Computes the gain in decibels to apply for an input level in decibels,
+// excluding the output gain.
+template <typename InputEigenType, typename OutputEigenType>
+void ComputeGainDb(const DynamicRangeControlParams& params,
+                   const InputEigenType& input_level,
+                   OutputEigenType* output_gain) {
+  switch (params.dynamics_type) {
+    case kCompressor:
+      OutputLevelCompressor(
+          input_level + params.input_gain_db, params.threshold_db,
+          params.ratio, params.knee_width_db, output_gain);
+
+      break;
+    case kLimiter:
+      OutputLevelLimiter(
+          input_level + params.input_gain_db,
+          params.threshold_db, params.knee_width_db, output_gain);
+
+      break;
+    case kExpander:
+      OutputLevelExpander(
+          input_level + params.input_gain_db, params.threshold_db,
+          params.ratio, params.knee_width_db, output_gain);
+      break;
+    case kNoiseGate: {
+      // Avoid actually using infinity, which could cause numerical problems.
+      // 1000dB of suppression is way more than enough for any use case.
+      constexpr float kInfiniteRatio = 1000;
+      OutputLevelExpander(
+          input_level + params.input_gain_db, params.threshold_db,
+          kInfiniteRatio, params.knee_width_db, output_gain);
+      break;
+    }
+    case kTwoWayCompressor:
+      OutputLevelTwoWayCompressor(input_level + params.input_gain_db,
+                                  params.two_way_compression, output_gain);
+      break;
+  }
+  // Compute the gain to apply rather than the output level.
+  *output_gain -= input_level;
+}
+
+// Tabulates the gain curve of params over its knees, on the input levels
+// before the input gain.
+void InitGainCurveTable(const DynamicRangeControlParams& params,
+                        GainCurveLookupTable* table) {
+  float knees_start_db;
+  float knees_end_db;
+  if (params.dynamics_type == kTwoWayCompressor) {
+    const TwoWayCompressionParams& curve = params.two_way_compression;
+    // The hard compressor and the expander are applied after the soft
+    // compressor and the upwards compressor, so their knees are wider by the
+    // ratios of those when measured at the input.
+    knees_start_db = std::min(
+        curve.expander_region.threshold_db -
+            curve.expander_region.knee_width_db *
+                curve.upwards_compressor_region.ratio / 2,
+        curve.upwards_compressor_region.threshold_db -
+            curve.upwards_compressor_region.knee_width_db / 2);
+    knees_end_db = std::max(
+        curve.soft_compressor_region.threshold_db +
+            curve.soft_compressor_region.knee_width_db / 2,
+        curve.hard_compressor_region.threshold_db +
+            curve.hard_compressor_region.knee_width_db *
+                std::max(curve.soft_compressor_region.ratio, 1.0f) / 2);
+  } else {
+    knees_start_db = params.threshold_db - params.knee_width_db / 2;
+    knees_end_db = params.threshold_db + params.knee_width_db / 2;
+  }
+  // The first table point is at the start of the knees, so that a single hard
+  // knee is exact.
+  table->Init(
+      [&params](const ArrayXf& input_level, ArrayXf* output_gain) {
+        ComputeGainDb(params, input_level, output_gain);
+      },
+      knees_start_db - params.input_gain_db,
+      knees_end_db - params.input_gain_db, kGainCurveTableStepDb);
 }
 }  // namespace
 
@@ -37,6 +131,9 @@ DynamicRangeControl::DynamicRangeControl(
       : params_(initial_params),
         params_change_needed_(false) {
   VerifyParams(initial_params);
+  if (UsesGainCurveTable(params_)) {
+    InitGainCurveTable(params_, &gain_table_);
+  }
 }
 
 void DynamicRangeControl::Init(int num_channels, int max_block_size_samples,
@@ -49,6 +146,12 @@ void DynamicRangeControl::Init(int num_channels, int max_block_size_samples,
   max_block_size_samples_ = max_block_size_samples;
   workspace_ = ArrayXf::Zero(max_block_size_samples_);
   workspace_drc_output_ = ArrayXf::Zero(max_block_size_samples_);
+  workspace_drc_interp_output_ = ArrayXf::Zero(max_block_size_samples_);
+  // Each full control period has a control point, and so does the end of the
+  // block.
+  workspace_control_ = ArrayXf::Zero(
+      max_block_size_samples_ / params_.control_decimation_factor + 1);
+  has_previous_control_gain_ = false;
   envelope_.reset(new AttackReleaseEnvelope(params_.attack_s,
                                             params_.release_s,
                                             sample_rate_hz_));
@@ -61,6 +164,9 @@ void DynamicRangeControl::SetDynamicRangeControlParams(
     const DynamicRangeControlParams& params) {
   VerifyParams(params);
   next_params_ = params;
+  if (UsesGainCurveTable(next_params_)) {
+    InitGainCurveTable(next_params_, &next_gain_table_);
+  }
   // Update envelope time constants now. The rest will get interpolated via
   // crossfade.
   envelope_->SetAttackTimeSeconds(next_params_.attack_s);
@@ -69,29 +175,80 @@ void DynamicRangeControl::SetDynamicRangeControlParams(
   CHECK_EQ(params.lookahead_s, params_.lookahead_s)
       << "This parameter cannot be changed without reinitializing the "
          "DynamicRangeControl. Please call Init(...) again.";
+  CHECK_EQ(params.control_decimation_factor, params_.control_decimation_factor)
+      << "This parameter cannot be changed without reinitializing the "
+         "DynamicRangeControl. Please call Init(...) again.";
 }
 
 void DynamicRangeControl::Reset() {
   envelope_->Reset();
+  has_previous_control_gain_ = false;
 }
 
 void DynamicRangeControl::ComputeGainFromDetectedSignal(VectorType* data_ptr) {
   // Most of the computation for this function happens in-place on *data_ptr.
   VectorType& data = *data_ptr;
-  for (int i = 0; i < data.rows(); ++i) {
-    // Occasionally a negative will come up due to numerical imprecision.
-    // Apply attack/release smoothing.
-    data[i] = std::max(1e-12f, envelope_->Output(data[i]));
+  // Apply attack/release smoothing.
+  Eigen::Map<Eigen::ArrayXXf> envelope(data.data(), 1, data.size());
+  envelope_->ProcessBlock(envelope, envelope);
+  // Occasionally a negative will come up due to numerical imprecision.
+  data = data.max(1e-12f);
+
+  const int control_period = params_.control_decimation_factor;
+  if (control_period == 1) {
+    ComputeGainFromEnvelope(1, data.size(), &data);
+    return;
   }
+  // Sample the envelope at the end of each control period and of the block.
+  const int num_control_points = (data.size() + control_period - 1) /
+                                 control_period;
+  VectorType control = workspace_control_.head(num_control_points);
+  for (int i = 0; i < num_control_points - 1; ++i) {
+    control[i] = data[(i + 1) * control_period - 1];
+  }
+  control[num_control_points - 1] = data[data.size() - 1];
+  ComputeGainFromEnvelope(control_period, data.size(), &control);
+
+  // Linearly interpolate the gain from the previous control point, which is
+  // the last sample of the previous block for the first one.
+  float gain = has_previous_control_gain_ ? previous_control_gain_ : control[0];
+  int end = 0;
+  for (int i = 0; i < num_control_points; ++i) {
+    const int start = end;
+    end = std::min<int>(start + control_period, data.size());
+    const float step = (control[i] - gain) / (end - start);
+    for (int j = start; j < end; ++j) {
+      gain += step;
+      data[j] = gain;
+    }
+    // Avoid accumulating rounding error across control periods.
+    gain = control[i];
+  }
+  previous_control_gain_ = gain;
+  has_previous_control_gain_ = true;
+}
+
+void DynamicRangeControl::ComputeGainFromEnvelope(int control_period,
+                                                  int block_size,
+                                                  VectorType* data_ptr) {
+  VectorType& data = *data_ptr;
   // Convert to decibels.
-  // TODO: Consider downsampling the envelope by an integer factor
-  // to 8k or lower.
   if (params_.envelope_type == kRms) {
-    PowerRatioToDecibels(data /* rectified envelope */,
-                         &data /* signal level in decibels */);
+    if (params_.fast_decibel_conversions) {
+      FastPowerRatioToDecibels(data /* rectified envelope */,
+                               &data /* signal level in decibels */);
+    } else {
+      PowerRatioToDecibels(data /* rectified envelope */,
+                           &data /* signal level in decibels */);
+    }
   } else {
-    AmplitudeRatioToDecibels(data /* rectified envelope */,
-                             &data /* signal level in decibels */);
+    if (params_.fast_decibel_conversions) {
+      FastAmplitudeRatioToDecibels(data /* rectified envelope */,
+                                   &data /* signal level in decibels */);
+    } else {
+      AmplitudeRatioToDecibels(data /* rectified envelope */,
+                               &data /* signal level in decibels */);
+    }
   }
   // Store the gain computation in the workspace.
   // A second workspace variable is needed because data is actually workspace_
@@ -104,56 +261,38 @@ void DynamicRangeControl::ComputeGainFromDetectedSignal(VectorType* data_ptr) {
 
   if (params_change_needed_) {
     params_ = next_params_;
+    gain_table_.swap(next_gain_table_);
     VectorType interp_signal_gain_db =
-        workspace_drc_output_.head(data.size());
+        workspace_drc_interp_output_.head(data.size());
     ComputeGainForSpecificDynamicRangeControlType(
         data /* signal level in decibels */, &interp_signal_gain_db);
     interp_signal_gain_db += params_.output_gain_db;
     params_change_needed_ = false;
 
-    const float data_size_inv = 1.0f / data.size();
-    float k = 0;
+    // Crossfade over the block, by the position of each sample in it.
+    const float block_size_inv = 1.0f / block_size;
     for (int i = 0; i < data.size(); ++i) {
-      k += data_size_inv;
+      const float k =
+          std::min((i + 1) * control_period, block_size) * block_size_inv;
       signal_gain_db[i] += k * (interp_signal_gain_db[i] - signal_gain_db[i]);
     }
   }
   // Convert back to linear.
-  DecibelsToAmplitudeRatio(signal_gain_db, &data /* linear gain */);
+  if (params_.fast_decibel_conversions) {
+    FastDecibelsToAmplitudeRatio(signal_gain_db, &data /* linear gain */);
+  } else {
+    DecibelsToAmplitudeRatio(signal_gain_db, &data /* linear gain */);
+  }
   DCHECK(data.allFinite());
 }
 
 void DynamicRangeControl::ComputeGainForSpecificDynamicRangeControlType(
     const VectorType& input_level, VectorType* output_gain) {
-  switch (params_.dynamics_type) {
-    case kCompressor:
-      OutputLevelCompressor(
-          input_level + params_.input_gain_db, params_.threshold_db,
-          params_.ratio, params_.knee_width_db, output_gain);
-
-      break;
-    case kLimiter:
-      OutputLevelLimiter(
-          input_level + params_.input_gain_db,
-          params_.threshold_db, params_.knee_width_db, output_gain);
-
-      break;
-    case kExpander:
-      OutputLevelExpander(
-          input_level + params_.input_gain_db, params_.threshold_db,
-          params_.ratio, params_.knee_width_db, output_gain);
-      break;
-    case kNoiseGate:
-      // Avoid actually using infinity, which could cause numerical problems.
-      // 1000dB of suppression is way more than enough for any use case.
-      constexpr float kInfiniteRatio = 1000;
-      OutputLevelExpander(
-          input_level + params_.input_gain_db, params_.threshold_db,
-          kInfiniteRatio, params_.knee_width_db, output_gain);
-      break;
+  if (UsesGainCurveTable(params_)) {
+    gain_table_.GainDb(input_level, output_gain);
+  } else {
+    ComputeGainDb(params_, input_level, output_gain);
   }
-  // Compute the gain to apply rather than the output level.
-  *output_gain -= input_level;
 }
 
 }  // namespace audio_dsp
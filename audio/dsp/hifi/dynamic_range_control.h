@@ -99,6 +99,7 @@
 
 #include "audio/dsp/attack_release_envelope.h"
 #include "audio/dsp/fixed_delay_line.h"
+#include "audio/dsp/hifi/dynamic_range_control_functions.h"
 #include "glog/logging.h"
 #include "third_party/eigen3/Eigen/Core"
 
@@ -131,6 +132,11 @@ enum DynamicsControlType {
   // Noise gates leave signals above the threshold alone and silence sounds that
   // are less than the threshold.
   kNoiseGate,
+  // Two-way compression compresses both downwards and upwards around a center
+  // level, as configured by two_way_compression. See TwoWayCompressionParams
+  // in dynamic_range_control_functions.h. The curve is always evaluated from a
+  // lookup table, see use_gain_curve_table.
+  kTwoWayCompressor,
 };
 
 // NOTE: There is no one-size-fits-all solution for dynamic range control.
@@ -147,7 +153,10 @@ struct DynamicRangeControlParams {
         knee_width_db(0),
         attack_s(0.001f),
         release_s(0.05f),
-        lookahead_s(0) {}
+        fast_decibel_conversions(false),
+        use_gain_curve_table(false),
+        lookahead_s(0),
+        control_decimation_factor(1) {}
 
   // See NOTE above.
   static DynamicRangeControlParams ReasonableCompressorParams() {
@@ -211,11 +220,15 @@ struct DynamicRangeControlParams {
   //   output_db = input_db, for input_db > threshold_db
   //   output_db = threshold_db + (input_db - threshold_db) * ratio,
   //     for input_db < threshold_db.
-  float ratio;  // Ignored for limiter and noise gate.
+  float ratio;  // Ignored for limiter, noise gate and two-way compressor.
 
   // A gentle transition between into range control around the threshold.
   float knee_width_db;  // Two-sided (diameter).
 
+  // The curve of a two-way compressor, which has its own thresholds, ratios
+  // and knees instead of the ones above. The input and output gains apply.
+  TwoWayCompressionParams two_way_compression;
+
   // Exponential time constants associated with the gain estimator. Depending
   // on the application, these may range from 1ms to over 1s.
   //
@@ -230,12 +243,36 @@ struct DynamicRangeControlParams {
   float attack_s;
   float release_s;
 
+  // Use the fast conversions to and from decibels in decibels.h, which are
+  // accurate to 0.001 dB, instead of the full precision ones.
+  bool fast_decibel_conversions;
+
+  // Evaluate the gain curve from a lookup table with linear interpolation (see
+  // GainCurveLookupTable) instead of computing it for every sample. The table
+  // is built when the params are set and has a point every 1/32 dB over the
+  // knees, so it is exact for hard knees and accurate to 0.001 dB for the knees
+  // of typical compressors and limiters. Very steep soft knees, like those of
+  // a noise gate, have errors of up to 0.12 dB / knee_width_db. The table costs
+  // about as much as computing a single-threshold curve directly, and half as
+  // much as a two-way curve, which always uses it.
+  bool use_gain_curve_table;
+
   // The following parameters must not change after initialization:
 
   // Delay the incoming audio to make the gain control more predictive.
   // This has the effect of delaying the audio output (advancing the compression
   // action relative to the signal).
   float lookahead_s;
+
+  // When greater than 1, the gain is computed only at every
+  // control_decimation_factor-th sample and at the last sample of each block,
+  // and is linearly interpolated in between. The envelope is still computed at
+  // the audio rate, so the attack and release behavior is unchanged, but the
+  // conversions to and from decibels and the gain curve run at the lower
+  // control rate. For typical time constants, a control rate of a few kHz
+  // (e.g. a factor of 16 at 48kHz) is not audible. The control period should
+  // be well below attack_s.
+  int control_decimation_factor;
 };
 
 // Multichannel, feed-forward dynamic range control. Note that the gain
@@ -343,7 +380,14 @@ class DynamicRangeControl {
   // a rectified signal envelope. After calling this function it will contain
   // a linear gain to apply to the signal.
   void ComputeGainFromDetectedSignal(VectorType* data_ptr);
-  // Defer gain computation to specific types of dynamic range control.
+  // Converts envelope samples to linear gains in place. Sample i of data_ptr
+  // is at (i + 1) * control_period - 1 in a block of block_size samples, or
+  // at the last sample for the last one, which sets its share of a parameter
+  // crossfade.
+  void ComputeGainFromEnvelope(int control_period, int block_size,
+                               VectorType* data_ptr);
+  // Defer gain computation to specific types of dynamic range control, or to
+  // gain_table_.
   void ComputeGainForSpecificDynamicRangeControlType(
       const VectorType& input_level, VectorType* output_gain);
 
@@ -353,10 +397,20 @@ class DynamicRangeControl {
 
   Eigen::ArrayXf workspace_;
   Eigen::ArrayXf workspace_drc_output_;
+  Eigen::ArrayXf workspace_drc_interp_output_;
+  // The envelope and then the gain at the control points of a block.
+  Eigen::ArrayXf workspace_control_;
+  // The gain at the last sample of the previous block, when using a control
+  // rate.
+  float previous_control_gain_;
+  bool has_previous_control_gain_;
   DynamicRangeControlParams params_;
   // When parameters change, we need to smoothly transition to them.
   bool params_change_needed_;
   DynamicRangeControlParams next_params_;
+  // The gain curve tables of params_ and next_params_, when they use one.
+  GainCurveLookupTable gain_table_;
+  GainCurveLookupTable next_gain_table_;
 
   FixedDelayLine lookahead_delay_;
   std::unique_ptr<AttackReleaseEnvelope> envelope_;
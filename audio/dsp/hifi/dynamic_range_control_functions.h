@@ -20,8 +20,12 @@
 #ifndef AUDIO_DSP_HIFI_DYNAMIC_RANGE_CONTROL_FUNCTIONS_H_
 #define AUDIO_DSP_HIFI_DYNAMIC_RANGE_CONTROL_FUNCTIONS_H_
 
+#include <algorithm>
+#include <cmath>
 #include <type_traits>
+#include <utility>
 
+#include "audio/dsp/decibels.h"
 #include "glog/logging.h"
 #include "third_party/eigen3/Eigen/Core"
 
@@ -310,6 +314,151 @@ void OutputLevelTwoWayCompressor(const InputEigenType& input_level_db,
                       expander.knee_width_db, output_level_db);
 }
 
+namespace internal {
+
+// Looks up table[index], lane by lane for vectors.
+inline float Gather(const float* table, int32_t index) { return table[index]; }
+#if defined(__GNUC__)
+inline FastFloats Gather(const float* table, FastInts index) {
+  FastFloats values;
+  for (int lane = 0; lane < kFastLanes; ++lane) {
+    values[lane] = table[index[lane]];
+  }
+  return values;
+}
+#endif  // defined(__GNUC__)
+
+// Evaluates a GainCurveLookupTable, for FastTransformInPlace().
+struct GainCurveLookupKernel {
+  template <typename Float>
+  Float operator()(Float level_db) const {
+    // Bound the position so that infinite levels extrapolate to finite gains
+    // and the index below stays in the table. NaN fails the first comparison,
+    // so NaN levels are treated like levels far below the table.
+    constexpr float kMaxSteps = 1 << 24;
+    Float position = (level_db - min_db) * step_db_inv;
+    position = position > -kMaxSteps ? position : -kMaxSteps;
+    position = position < kMaxSteps ? position : kMaxSteps;
+    // How far the level is below and above the table, in steps.
+    const Float below = position < 0.0f ? position : 0.0f;
+    const Float above_last = position - last_index;
+    const Float above = above_last > 0.0f ? above_last : 0.0f;
+    const Float clamped = position - below - above;
+    // The last point is interpolated from the last interval.
+    FastInt<Float> index = TruncateToInt(clamped);
+    index = index < last_interval ? index : last_interval;
+    const Float fraction = clamped - ToFloat(index);
+    const Float start = Gather(table, index);
+    const Float end = Gather(table, index + 1);
+    return start + fraction * (end - start) + low_slope_per_step * below +
+           high_slope_per_step * above;
+  }
+
+  const float* table;
+  float min_db;
+  float step_db_inv;
+  float low_slope_per_step;
+  float high_slope_per_step;
+  int32_t last_interval;
+  float last_index;
+};
+
+}  // namespace internal
+
+// A lookup table of a static gain curve, such as one of the curves above with
+// the input level subtracted from the output level. The table is evaluated by
+// linear interpolation, which is much cheaper per sample than the chains of
+// Eigen expressions above, especially for OutputLevelTwoWayCompressor().
+//
+// The table has points every step_db from min_db to at least max_db, and the
+// curve is extrapolated linearly beyond them. This is exact when
+// [min_db, max_db] contains all the knees, since the curves above are linear
+// outside of their knees. Inside a knee of width w over which the slope
+// changes by s, the interpolation error is at most s * step_db^2 / (8 * w) dB.
+// A hard knee that is not on a table point is rounded off over one step.
+// Infinite levels give the finite gain 2^24 steps beyond the table, and NaN
+// levels give the gain 2^24 steps below it.
+class GainCurveLookupTable {
+ public:
+  GainCurveLookupTable()
+      : min_db_(0.0f),
+        step_db_inv_(1.0f),
+        low_slope_per_step_(0.0f),
+        high_slope_per_step_(0.0f) {}
+
+  // Tabulates the curve. gain_curve(level_db, &gain_db) computes the gain of
+  // the curve in decibels for an Eigen::ArrayXf of levels in decibels.
+  template <typename GainCurveFunction>
+  void Init(const GainCurveFunction& gain_curve, float min_db, float max_db,
+            float step_db) {
+    CHECK_GT(step_db, 0.0f);
+    CHECK_GE(max_db, min_db);
+    // At least two points, so that there is an interval to interpolate over.
+    const int num_intervals =
+        std::max<int>(std::ceil((max_db - min_db) / step_db), 1);
+    const float table_max_db = min_db + num_intervals * step_db;
+    // The slopes of the linear extrapolation are measured over a long span, so
+    // that rounding errors in the curve are not magnified.
+    constexpr float kSlopeSpanDb = 100.0f;
+    Eigen::ArrayXf level_db(num_intervals + 3);
+    level_db[0] = min_db - kSlopeSpanDb;
+    level_db.segment(1, num_intervals + 1) =
+        Eigen::ArrayXf::LinSpaced(num_intervals + 1, min_db, table_max_db);
+    level_db[num_intervals + 2] = table_max_db + kSlopeSpanDb;
+    Eigen::ArrayXf gain_db(level_db.size());
+    gain_curve(level_db, &gain_db);
+
+    min_db_ = min_db;
+    step_db_inv_ = 1.0f / step_db;
+    table_ = gain_db.segment(1, num_intervals + 1);
+    low_slope_per_step_ =
+        (table_[0] - gain_db[0]) * step_db / kSlopeSpanDb;
+    high_slope_per_step_ =
+        (gain_db[num_intervals + 2] - table_[num_intervals]) * step_db /
+        kSlopeSpanDb;
+  }
+
+  // Computes the gain in decibels for input_level_db. gain_db must have the
+  // same size as input_level_db, and may alias it. The output must be a plain
+  // object or a block of one. Like the fast decibel conversions in
+  // decibels.h, this is vectorized with GCC and Clang.
+  template <typename InputEigenType, typename OutputEigenType>
+  void GainDb(const InputEigenType& input_level_db,
+              OutputEigenType* gain_db) const {
+    static_assert(std::is_same<typename InputEigenType::Scalar, float>::value,
+                  "Scalar type must be float.");
+    DCHECK_GE(table_.size(), 2);
+    DCHECK_EQ(input_level_db.size(), gain_db->size());
+    const int last_interval = table_.size() - 2;
+    *gain_db = input_level_db;
+    internal::FastTransformInPlace(
+        internal::GainCurveLookupKernel{
+            table_.data(), min_db_, step_db_inv_, low_slope_per_step_,
+            high_slope_per_step_, last_interval, last_interval + 1.0f},
+        gain_db);
+  }
+
+  // Swaps tables without allocating, e.g. to switch to a table built ahead of
+  // time.
+  void swap(GainCurveLookupTable& other) {
+    std::swap(min_db_, other.min_db_);
+    std::swap(step_db_inv_, other.step_db_inv_);
+    std::swap(low_slope_per_step_, other.low_slope_per_step_);
+    std::swap(high_slope_per_step_, other.high_slope_per_step_);
+    table_.swap(other.table_);
+  }
+
+  int size() const { return table_.size(); }
+
+ private:
+  float min_db_;
+  float step_db_inv_;
+  // The slopes of the curve below and above the table, in decibels per step.
+  float low_slope_per_step_;
+  float high_slope_per_step_;
+  Eigen::ArrayXf table_;
+};
+
 }  // namespace audio_dsp
 
 #endif  // AUDIO_DSP_HIFI_DYNAMIC_RANGE_CONTROL_FUNCTIONS_H_
@@ -17,6 +17,7 @@
 #include "audio/dsp/hifi/dynamic_range_control.h"
 
 #include "audio/dsp/decibels.h"
+#include "audio/dsp/heap_allocation_counter.h"
 #include "audio/dsp/hifi/dynamic_range_control_functions.h"
 #include "audio/dsp/testing_util.h"
 #include "benchmark/benchmark.h"
@@ -357,6 +358,31 @@ TEST(DynamicRangeControl, BlockSizeTest) {
   EXPECT_THAT(output_2, EigenArrayNear(output_1, 1e-6));
 }
 
+TEST(DynamicRangeControl, DoesNotAllocate) {
+  constexpr int kNumChannels = 2;
+  constexpr int kMaxBlockSize = 64;
+  constexpr float kSampleRate = 48000.0f;
+  DynamicRangeControlParams params =
+      DynamicRangeControlParams::ReasonableCompressorParams();
+  params.lookahead_s = 10 / kSampleRate;
+  DynamicRangeControl drc(params);
+  drc.Init(kNumChannels, kMaxBlockSize, kSampleRate);
+  // Change the parameters so that the crossfade is exercised too.
+  params.threshold_db = -20.0f;
+  drc.SetDynamicRangeControlParams(params);
+
+  Eigen::ArrayXXf output_buffer(kNumChannels, kMaxBlockSize);
+  for (int num_samples : {kMaxBlockSize, 5, 1, 33}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    const Eigen::ArrayXXf input =
+        Eigen::ArrayXXf::Random(kNumChannels, num_samples);
+    auto output = output_buffer.leftCols(num_samples);
+    ScopedHeapAllocationCounter counter;
+    drc.ProcessBlock(input, &output);
+    EXPECT_EQ(counter.num_allocations(), 0);
+  }
+}
+
 TEST(DynamicRangeControl, LookaheadTest) {
   constexpr int kOneChannel = 1;
   constexpr int kSampleRate = 48000.0f;
@@ -435,13 +461,482 @@ TEST(DynamicRangeControl, LookaheadImpulseTest) {
   EXPECT_GT(output_impulse_energy, output_delayed_impulse_energy * 1.5);
 }
 
+// Before, the gains for the old and new parameters were written to the same
+// buffer, so that the crossfade was an immediate switch to the new parameters.
+TEST(DynamicRangeControl, CrossfadeInterpolatesGains) {
+  constexpr int kNumChannels = 1;
+  constexpr int kNumSamples = 200;
+  const Eigen::ArrayXXf input =
+      Eigen::ArrayXXf::Random(kNumChannels, kNumSamples);
+
+  DynamicRangeControlParams before_params =
+      DynamicRangeControlParams::ReasonableCompressorParams();
+  DynamicRangeControlParams after_params = before_params;
+  after_params.threshold_db = -30.0f;
+  after_params.output_gain_db = 6.0f;
+  DynamicRangeControl before_drc(before_params);
+  DynamicRangeControl after_drc(after_params);
+  DynamicRangeControl interp_drc(before_params);
+  before_drc.Init(kNumChannels, kNumSamples, 48000.0f);
+  after_drc.Init(kNumChannels, kNumSamples, 48000.0f);
+  interp_drc.Init(kNumChannels, kNumSamples, 48000.0f);
+
+  Eigen::ArrayXf gain_buffer(3 * kNumSamples);
+  auto before_gain = gain_buffer.segment(0, kNumSamples);
+  auto after_gain = gain_buffer.segment(kNumSamples, kNumSamples);
+  auto interp_gain = gain_buffer.segment(2 * kNumSamples, kNumSamples);
+  // The time constants are unchanged, so the envelopes stay the same and the
+  // gain in decibels crossfades from one curve to the other over the block.
+  interp_drc.SetDynamicRangeControlParams(after_params);
+  before_drc.ComputeGainSignalOnly(input, &before_gain);
+  after_drc.ComputeGainSignalOnly(input, &after_gain);
+  interp_drc.ComputeGainSignalOnly(input, &interp_gain);
+  for (int i = 0; i < kNumSamples; ++i) {
+    const float k = (i + 1.0f) / kNumSamples;
+    EXPECT_NEAR(AmplitudeRatioToDecibels(interp_gain[i]),
+                (1 - k) * AmplitudeRatioToDecibels(before_gain[i]) +
+                    k * AmplitudeRatioToDecibels(after_gain[i]),
+                1e-3);
+  }
+  // The curves are far apart in the middle of the block.
+  ASSERT_GT(std::abs(AmplitudeRatioToDecibels(after_gain[kNumSamples / 2] /
+                                              before_gain[kNumSamples / 2])),
+            3.0f);
+}
+
+// Returns a random signal whose level steps by 10dB every 200 samples.
+Eigen::ArrayXXf LevelSteppedNoise(int num_channels, int num_samples) {
+  constexpr float kLevelsDb[] = {0.0f, -10.0f, -20.0f, -10.0f};
+  Eigen::ArrayXXf signal = Eigen::ArrayXXf::Random(num_channels, num_samples);
+  for (int i = 0; i < num_samples; ++i) {
+    signal.col(i) *= DecibelsToAmplitudeRatio(kLevelsDb[(i / 200) % 4]);
+  }
+  return signal;
+}
+
+TEST(DynamicRangeControl, ControlRateGainMatchesAudioRateGain) {
+  constexpr int kNumChannels = 2;
+  constexpr int kNumSamples = 4000;
+  constexpr int kControlDecimationFactor = 16;
+  const Eigen::ArrayXXf input = LevelSteppedNoise(kNumChannels, kNumSamples);
+
+  DynamicRangeControlParams params =
+      DynamicRangeControlParams::ReasonableCompressorParams();
+  DynamicRangeControl drc(params);
+  params.control_decimation_factor = kControlDecimationFactor;
+  DynamicRangeControl decimated_drc(params);
+  drc.Init(kNumChannels, kNumSamples, 48000.0f);
+  decimated_drc.Init(kNumChannels, kNumSamples, 48000.0f);
+
+  Eigen::ArrayXf gain_buffer(kNumSamples);
+  Eigen::ArrayXf decimated_gain_buffer(kNumSamples);
+  // Blocks that are not a multiple of the control period.
+  int start = 0;
+  for (int block_size : {100, 37, 1, 16, 2000, 1846}) {
+    SCOPED_TRACE("block_size: " + testing::PrintToString(block_size));
+    const Eigen::ArrayXXf block = input.middleCols(start, block_size);
+    auto gain = gain_buffer.head(block_size);
+    drc.ComputeGainSignalOnly(block, &gain);
+    auto decimated_gain = decimated_gain_buffer.head(block_size);
+    decimated_drc.ComputeGainSignalOnly(block, &decimated_gain);
+    // The gain is exact at the end of each control period and of the block,
+    for (int i = kControlDecimationFactor - 1; i < block_size;
+         i += kControlDecimationFactor) {
+      EXPECT_NEAR(decimated_gain[i], gain[i], 1e-5 * gain[i]);
+    }
+    EXPECT_NEAR(decimated_gain[block_size - 1], gain[block_size - 1],
+                1e-5 * gain[block_size - 1]);
+    // and within 0.2dB in between, even across the abrupt level changes. The
+    // exception is the attack from silence at the start of the stream, which
+    // is too fast for the control rate.
+    if (start > 0) {
+      EXPECT_LT((decimated_gain / gain - 1).abs().maxCoeff(), 0.02f);
+    }
+    start += block_size;
+  }
+}
+
+// Between control points, the gain is linear in time, starting from the last
+// gain of the previous block.
+TEST(DynamicRangeControl, ControlRateInterpolatesBetweenControlPoints) {
+  constexpr int kNumChannels = 1;
+  constexpr int kControlDecimationFactor = 8;
+  constexpr int kMaxBlockSize = 100;
+  DynamicRangeControlParams params =
+      DynamicRangeControlParams::ReasonableCompressorParams();
+  params.control_decimation_factor = kControlDecimationFactor;
+  DynamicRangeControl drc(params);
+  drc.Init(kNumChannels, kMaxBlockSize, 48000.0f);
+  const Eigen::ArrayXXf input = LevelSteppedNoise(kNumChannels, 400);
+
+  Eigen::ArrayXf gain_buffer(kMaxBlockSize);
+  float previous_gain = 0.0f;
+  int start = 0;
+  // Block sizes that are not multiples of the control period.
+  for (int block_size : {100, 37, 20, 1, 64}) {
+    SCOPED_TRACE("block_size: " + testing::PrintToString(block_size));
+    auto gain = gain_buffer.head(block_size);
+    drc.ComputeGainSignalOnly(input.middleCols(start, block_size), &gain);
+    // The control points are at the end of each control period and of the
+    // block. The first block starts at its first control point.
+    int period_start = 0;
+    float period_start_gain = start == 0 ? gain[kControlDecimationFactor - 1]
+                                         : previous_gain;
+    while (period_start < block_size) {
+      const int period_end =
+          std::min(period_start + kControlDecimationFactor, block_size);
+      const float period_end_gain = gain[period_end - 1];
+      for (int i = period_start; i < period_end; ++i) {
+        const float k = static_cast<float>(i + 1 - period_start) /
+                        (period_end - period_start);
+        EXPECT_NEAR(gain[i],
+                    period_start_gain + k * (period_end_gain -
+                                             period_start_gain),
+                    1e-5f);
+      }
+      period_start = period_end;
+      period_start_gain = period_end_gain;
+    }
+    previous_gain = gain[block_size - 1];
+    start += block_size;
+  }
+}
+
+// The parameter crossfade at the control rate matches that at the audio rate.
+TEST(DynamicRangeControl, ControlRateCrossfadeMatchesAudioRate) {
+  constexpr int kNumChannels = 1;
+  constexpr int kNumSamples = 400;
+  const Eigen::ArrayXXf input = LevelSteppedNoise(kNumChannels, kNumSamples);
+
+  DynamicRangeControlParams params =
+      DynamicRangeControlParams::ReasonableCompressorParams();
+  DynamicRangeControl drc(params);
+  params.control_decimation_factor = 8;
+  DynamicRangeControl decimated_drc(params);
+  drc.Init(kNumChannels, kNumSamples, 48000.0f);
+  decimated_drc.Init(kNumChannels, kNumSamples, 48000.0f);
+  Eigen::ArrayXf gain_buffer(kNumSamples);
+  Eigen::ArrayXf decimated_gain_buffer(kNumSamples);
+  auto gain = gain_buffer.head(kNumSamples);
+  auto decimated_gain = decimated_gain_buffer.head(kNumSamples);
+  drc.ComputeGainSignalOnly(input, &gain);
+  decimated_drc.ComputeGainSignalOnly(input, &decimated_gain);
+
+  // The crossfade to the new parameters is also interpolated.
+  params.threshold_db = -20.0f;
+  params.output_gain_db = 10.0f;
+  decimated_drc.SetDynamicRangeControlParams(params);
+  params.control_decimation_factor = 1;
+  drc.SetDynamicRangeControlParams(params);
+  drc.ComputeGainSignalOnly(input, &gain);
+  decimated_drc.ComputeGainSignalOnly(input, &decimated_gain);
+  EXPECT_LT((decimated_gain / gain - 1).abs().maxCoeff(), 0.01f);
+}
+
+TEST(DynamicRangeControl, ControlRateDoesNotAllocate) {
+  constexpr int kNumChannels = 2;
+  constexpr int kMaxBlockSize = 64;
+  DynamicRangeControlParams params =
+      DynamicRangeControlParams::ReasonableCompressorParams();
+  params.control_decimation_factor = 16;
+  DynamicRangeControl drc(params);
+  drc.Init(kNumChannels, kMaxBlockSize, 48000.0f);
+  params.threshold_db = -20.0f;
+  drc.SetDynamicRangeControlParams(params);
+
+  Eigen::ArrayXXf output_buffer(kNumChannels, kMaxBlockSize);
+  for (int num_samples : {kMaxBlockSize, 5, 1, 33, 63}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    const Eigen::ArrayXXf input =
+        Eigen::ArrayXXf::Random(kNumChannels, num_samples);
+    auto output = output_buffer.leftCols(num_samples);
+    ScopedHeapAllocationCounter counter;
+    drc.ProcessBlock(input, &output);
+    EXPECT_EQ(counter.num_allocations(), 0);
+  }
+}
+
+TEST(DynamicRangeControl, FastDecibelConversionsMatch) {
+  constexpr int kNumChannels = 2;
+  constexpr int kNumSamples = 1000;
+  const Eigen::ArrayXXf input = LevelSteppedNoise(kNumChannels, kNumSamples);
+  for (const DynamicRangeControlParams& params :
+       {DynamicRangeControlParams::ReasonableCompressorParams(),
+        DynamicRangeControlParams::ReasonableLimiterParams()}) {
+    DynamicRangeControl drc(params);
+    DynamicRangeControlParams fast_params = params;
+    fast_params.fast_decibel_conversions = true;
+    DynamicRangeControl fast_drc(fast_params);
+    drc.Init(kNumChannels, kNumSamples, 48000.0f);
+    fast_drc.Init(kNumChannels, kNumSamples, 48000.0f);
+    Eigen::ArrayXf gain_buffer(kNumSamples);
+    Eigen::ArrayXf fast_gain_buffer(kNumSamples);
+    auto gain = gain_buffer.head(kNumSamples);
+    auto fast_gain = fast_gain_buffer.head(kNumSamples);
+    drc.ComputeGainSignalOnly(input, &gain);
+    fast_drc.ComputeGainSignalOnly(input, &fast_gain);
+    // Each conversion is accurate to 0.001 dB, a relative error of 1.2e-4.
+    EXPECT_LT((fast_gain / gain - 1).abs().maxCoeff(), 3e-4f);
+  }
+}
+
+// A two-way curve with soft knees in all four regions.
+TwoWayCompressionParams ExampleTwoWayCompressionParams() {
+  TwoWayCompressionParams params;
+  params.expander_region.threshold_db = -70.0f;
+  params.expander_region.ratio = 2.0f;
+  params.expander_region.knee_width_db = 4.0f;
+  params.upwards_compressor_region.threshold_db = -50.0f;
+  params.upwards_compressor_region.ratio = 2.0f;
+  params.upwards_compressor_region.knee_width_db = 4.0f;
+  params.soft_compressor_region.threshold_db = -30.0f;
+  params.soft_compressor_region.ratio = 2.0f;
+  params.soft_compressor_region.knee_width_db = 4.0f;
+  params.hard_compressor_region.threshold_db = -15.0f;
+  params.hard_compressor_region.ratio = 6.0f;
+  params.hard_compressor_region.knee_width_db = 2.0f;
+  return params;
+}
+
+TEST(GainCurveLookupTable, MatchesCurveAndExtrapolates) {
+  constexpr float kThresholdDb = -20.0f;
+  constexpr float kRatio = 4.0f;
+  constexpr float kKneeWidthDb = 6.0f;
+  auto compressor_gain = [](const Eigen::ArrayXf& input_level_db,
+                            Eigen::ArrayXf* gain_db) {
+    ::audio_dsp::OutputLevelCompressor(input_level_db, kThresholdDb, kRatio,
+                                       kKneeWidthDb, gain_db);
+    *gain_db -= input_level_db;
+  };
+  GainCurveLookupTable table;
+  // Only the knee is tabulated.
+  table.Init(compressor_gain, kThresholdDb - kKneeWidthDb / 2,
+             kThresholdDb + kKneeWidthDb / 2, 0.1f);
+  EXPECT_EQ(table.size(), 61);
+
+  const Eigen::ArrayXf input_level_db =
+      Eigen::ArrayXf::LinSpaced(10000, -120.0f, 40.0f);
+  Eigen::ArrayXf expected(input_level_db.size());
+  compressor_gain(input_level_db, &expected);
+  Eigen::ArrayXf gain_db(input_level_db.size());
+  table.GainDb(input_level_db, &gain_db);
+  // The error bound is (1 - 1 / ratio) * step^2 / (8 * knee) ~= 1.6e-4 dB.
+  EXPECT_THAT(gain_db, EigenArrayNear(expected, 2e-4));
+}
+
+TEST(GainCurveLookupTable, NonFiniteLevels) {
+  constexpr float kInf = std::numeric_limits<float>::infinity();
+  constexpr float kNaN = std::numeric_limits<float>::quiet_NaN();
+  auto expander_gain = [](const Eigen::ArrayXf& input_level_db,
+                          Eigen::ArrayXf* gain_db) {
+    ::audio_dsp::OutputLevelExpander(input_level_db, -20.0f, 2.0f, 6.0f,
+                                     gain_db);
+    *gain_db -= input_level_db;
+  };
+  GainCurveLookupTable table;
+  table.Init(expander_gain, -23.0f, -17.0f, 1.0f / 32);
+
+  // Enough levels for both the vectorized and the scalar paths.
+  for (int size : {1, 37}) {
+    SCOPED_TRACE("size: " + testing::PrintToString(size));
+    for (float level_db : {-kInf, kInf, kNaN}) {
+      SCOPED_TRACE("level_db: " + testing::PrintToString(level_db));
+      const Eigen::ArrayXf input_level_db =
+          Eigen::ArrayXf::Constant(size, level_db);
+      Eigen::ArrayXf gain_db(size);
+      table.GainDb(input_level_db, &gain_db);
+      EXPECT_TRUE(gain_db.allFinite());
+      if (level_db > 0.0f) {
+        // Above the threshold, the expander does not change the level.
+        EXPECT_THAT(gain_db, EigenArrayNear(Eigen::ArrayXf::Zero(size), 1e-4));
+      } else {
+        // Below it, the level is expanded towards silence.
+        EXPECT_LT(gain_db.maxCoeff(), -1e5f);
+      }
+    }
+  }
+}
+
+TEST(DynamicRangeControl, GainCurveTableNonFiniteInput) {
+  constexpr int kNumChannels = 1;
+  constexpr int kNumSamples = 40;
+  constexpr float kInf = std::numeric_limits<float>::infinity();
+  constexpr float kNaN = std::numeric_limits<float>::quiet_NaN();
+  for (DynamicRangeControlParams params :
+       {DynamicRangeControlParams::ReasonableCompressorParams(),
+        DynamicRangeControlParams::ReasonableLimiterParams()}) {
+    params.use_gain_curve_table = true;
+    // Zeros give a level of -inf.
+    for (float sample : {0.0f, -kInf, kInf, kNaN}) {
+      SCOPED_TRACE("sample: " + testing::PrintToString(sample));
+      DynamicRangeControl drc(params);
+      drc.Init(kNumChannels, kNumSamples, 48000.0f);
+      const Eigen::ArrayXXf input =
+          Eigen::ArrayXXf::Constant(kNumChannels, kNumSamples, sample);
+      Eigen::ArrayXf gain_buffer(kNumSamples);
+      auto gain = gain_buffer.head(kNumSamples);
+      drc.ComputeGainSignalOnly(input, &gain);
+      EXPECT_TRUE(gain.allFinite());
+      EXPECT_GE(gain.minCoeff(), 0.0f);
+    }
+  }
+}
+
+TEST(DynamicRangeControl, GainCurveTableMatches) {
+  constexpr int kNumChannels = 2;
+  constexpr int kNumSamples = 1000;
+  const Eigen::ArrayXXf input = LevelSteppedNoise(kNumChannels, kNumSamples);
+  DynamicRangeControlParams hard_knee_limiter =
+      DynamicRangeControlParams::ReasonableLimiterParams();
+  hard_knee_limiter.knee_width_db = 0.0f;
+  hard_knee_limiter.input_gain_db = 3.0f;
+  DynamicRangeControlParams expander;
+  expander.dynamics_type = kExpander;
+  expander.threshold_db = -20.0f;
+  expander.ratio = 2.0f;
+  expander.knee_width_db = 6.0f;
+  for (const DynamicRangeControlParams& params :
+       {DynamicRangeControlParams::ReasonableCompressorParams(),
+        DynamicRangeControlParams::ReasonableLimiterParams(),
+        hard_knee_limiter, expander}) {
+    DynamicRangeControl drc(params);
+    DynamicRangeControlParams table_params = params;
+    table_params.use_gain_curve_table = true;
+    DynamicRangeControl table_drc(table_params);
+    drc.Init(kNumChannels, kNumSamples, 48000.0f);
+    table_drc.Init(kNumChannels, kNumSamples, 48000.0f);
+    Eigen::ArrayXf gain_buffer(kNumSamples);
+    Eigen::ArrayXf table_gain_buffer(kNumSamples);
+    auto gain = gain_buffer.head(kNumSamples);
+    auto table_gain = table_gain_buffer.head(kNumSamples);
+    drc.ComputeGainSignalOnly(input, &gain);
+    table_drc.ComputeGainSignalOnly(input, &table_gain);
+    // Within 0.001 dB, a relative error of 1.2e-4.
+    EXPECT_LT((table_gain / gain - 1).abs().maxCoeff(), 1.2e-4f);
+  }
+}
+
+TEST(DynamicRangeControl, TwoWayCompressorTest) {
+  constexpr int kNumChannels = 1;
+  constexpr int kNumSamples = 64;
+  DynamicRangeControlParams params;
+  params.dynamics_type = kTwoWayCompressor;
+  params.two_way_compression = ExampleTwoWayCompressionParams();
+  params.input_gain_db = 5.0f;
+  params.output_gain_db = -2.0f;
+  // Make the envelope follow the level immediately.
+  params.attack_s = 1e-6;
+  params.release_s = 1e-6;
+  DynamicRangeControl drc(params);
+  drc.Init(kNumChannels, kNumSamples, 48000.0f);
+
+  Eigen::ArrayXf gain_buffer(kNumSamples);
+  auto gain = gain_buffer.head(kNumSamples);
+  Eigen::ArrayXf level_db(1);
+  Eigen::ArrayXf output_level_db(1);
+  // Sweep the level across all regions of the curve.
+  for (float input_level_db = -100.0f; input_level_db < 0.0f;
+       input_level_db += 0.7f) {
+    SCOPED_TRACE("input_level_db: " + testing::PrintToString(input_level_db));
+    // The RMS level of a constant signal is its amplitude.
+    const Eigen::ArrayXXf input = Eigen::ArrayXXf::Constant(
+        kNumChannels, kNumSamples, DecibelsToAmplitudeRatio(input_level_db));
+    drc.ComputeGainSignalOnly(input, &gain);
+    level_db[0] = input_level_db + params.input_gain_db;
+    OutputLevelTwoWayCompressor(level_db, params.two_way_compression,
+                                &output_level_db);
+    EXPECT_NEAR(AmplitudeRatioToDecibels(gain[kNumSamples - 1]),
+                output_level_db[0] - input_level_db + params.output_gain_db,
+                1e-3);
+  }
+}
+
+TEST(DynamicRangeControl, GainCurveTableInterpolatesCoeffs) {
+  constexpr int kNumChannels = 1;
+  constexpr int kNumSamples = 400;
+  const Eigen::ArrayXXf input = LevelSteppedNoise(kNumChannels, kNumSamples);
+  Eigen::ArrayXXf before_output(kNumChannels, kNumSamples);
+  Eigen::ArrayXXf after_output(kNumChannels, kNumSamples);
+  Eigen::ArrayXXf interp_output(kNumChannels, kNumSamples);
+
+  // Crossfade between the tables of a compressor and a two-way compressor.
+  DynamicRangeControlParams before_params =
+      DynamicRangeControlParams::ReasonableCompressorParams();
+  before_params.use_gain_curve_table = true;
+  DynamicRangeControlParams after_params = before_params;
+  after_params.dynamics_type = kTwoWayCompressor;
+  after_params.two_way_compression = ExampleTwoWayCompressionParams();
+  DynamicRangeControl before_drc(before_params);
+  DynamicRangeControl after_drc(after_params);
+  DynamicRangeControl interp_drc(before_params);
+  before_drc.Init(kNumChannels, kNumSamples, 48000.0f);
+  after_drc.Init(kNumChannels, kNumSamples, 48000.0f);
+  interp_drc.Init(kNumChannels, kNumSamples, 48000.0f);
+
+  before_drc.ProcessBlock(input, &before_output);
+  after_drc.ProcessBlock(input, &after_output);
+  interp_drc.ProcessBlock(input, &interp_output);
+  EXPECT_THAT(interp_output, EigenArrayNear(before_output, 1e-6));
+
+  // The time constants are unchanged, so the envelopes stay the same and the
+  // crossfade goes from one curve to the other over the block.
+  interp_drc.SetDynamicRangeControlParams(after_params);
+  before_drc.ProcessBlock(input, &before_output);
+  after_drc.ProcessBlock(input, &after_output);
+  interp_drc.ProcessBlock(input, &interp_output);
+  for (int i = 0; i < kNumSamples; ++i) {
+    const float k = (i + 1.0f) / kNumSamples;
+    const float gain_db =
+        (1 - k) * AmplitudeRatioToDecibels(before_output(0, i) / input(0, i)) +
+        k * AmplitudeRatioToDecibels(after_output(0, i) / input(0, i));
+    EXPECT_NEAR(AmplitudeRatioToDecibels(interp_output(0, i) / input(0, i)),
+                gain_db, 1e-3);
+  }
+  after_drc.ProcessBlock(input, &after_output);
+  interp_drc.ProcessBlock(input, &interp_output);
+  // Slightly looser tolerance, since setting the parameters restarted the
+  // per-sample smoothing of the (unchanged) envelope coefficients, which
+  // rounds them differently.
+  EXPECT_THAT(interp_output, EigenArrayNear(after_output, 1e-5));
+}
+
+TEST(DynamicRangeControl, GainCurveTableDoesNotAllocate) {
+  constexpr int kNumChannels = 2;
+  constexpr int kMaxBlockSize = 64;
+  DynamicRangeControlParams params =
+      DynamicRangeControlParams::ReasonableCompressorParams();
+  params.use_gain_curve_table = true;
+  DynamicRangeControl drc(params);
+  drc.Init(kNumChannels, kMaxBlockSize, 48000.0f);
+  // Switching tables does not allocate either.
+  params.dynamics_type = kTwoWayCompressor;
+  params.two_way_compression = ExampleTwoWayCompressionParams();
+  drc.SetDynamicRangeControlParams(params);
+
+  Eigen::ArrayXXf output_buffer(kNumChannels, kMaxBlockSize);
+  for (int num_samples : {kMaxBlockSize, 5, 1, 33}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    const Eigen::ArrayXXf input =
+        Eigen::ArrayXXf::Random(kNumChannels, num_samples);
+    auto output = output_buffer.leftCols(num_samples);
+    ScopedHeapAllocationCounter counter;
+    drc.ProcessBlock(input, &output);
+    EXPECT_EQ(counter.num_allocations(), 0);
+  }
+}
+
 void BM_Compressor(benchmark::State& state) {
+  constexpr int kNumChannels = 2;
   constexpr int kNumSamples = 1000;
-  Eigen::ArrayXf input = Eigen::ArrayXf::Random(kNumSamples);
-  Eigen::ArrayXf output(kNumSamples);
-  DynamicRangeControl drc(
-      DynamicRangeControlParams::ReasonableCompressorParams());
-  drc.Init(2, kNumSamples, 48000.0f);
+  Eigen::ArrayXXf input = Eigen::ArrayXXf::Random(kNumChannels, kNumSamples);
+  Eigen::ArrayXXf output(kNumChannels, kNumSamples);
+  DynamicRangeControlParams params =
+      DynamicRangeControlParams::ReasonableCompressorParams();
+  params.control_decimation_factor = state.range(0);
+  params.fast_decibel_conversions = state.range(1);
+  params.use_gain_curve_table = state.range(2);
+  DynamicRangeControl drc(params);
+  drc.Init(kNumChannels, kNumSamples, 48000.0f);
 
   while (state.KeepRunning()) {
     drc.ProcessBlock(input, &output);
@@ -449,7 +944,39 @@ void BM_Compressor(benchmark::State& state) {
   }
   state.SetItemsProcessed(kNumSamples * state.iterations());
 }
-BENCHMARK(BM_Compressor);
+// Gain computed at the audio rate and at a 3kHz control rate, with full
+// precision and fast decibel conversions, and with the gain curve table.
+BENCHMARK(BM_Compressor)->Args({1, false, false})->Args({16, false, false})
+                        ->Args({1, true, false})->Args({16, true, false})
+                        ->Args({1, true, true})->Args({16, true, true});
+
+void BM_TwoWayCompressorCurve(benchmark::State& state) {
+  constexpr int kNumSamples = 1000;
+  const Eigen::ArrayXf input_level_db =
+      Eigen::ArrayXf::LinSpaced(kNumSamples, -90.0f, 0.0f);
+  Eigen::ArrayXf output_level_db(kNumSamples);
+  const TwoWayCompressionParams params = ExampleTwoWayCompressionParams();
+  GainCurveLookupTable table;
+  table.Init([&params](const Eigen::ArrayXf& level_db,
+                       Eigen::ArrayXf* gain_db) {
+    OutputLevelTwoWayCompressor(level_db, params, gain_db);
+    *gain_db -= level_db;
+  }, -80.0f, -10.0f, 1.0f / 32);
+  const bool use_table = state.range(0);
+
+  while (state.KeepRunning()) {
+    if (use_table) {
+      table.GainDb(input_level_db, &output_level_db);
+      output_level_db += input_level_db;
+    } else {
+      OutputLevelTwoWayCompressor(input_level_db, params, &output_level_db);
+    }
+    benchmark::DoNotOptimize(output_level_db);
+  }
+  state.SetItemsProcessed(kNumSamples * state.iterations());
+}
+// The curve computed directly and from a table.
+BENCHMARK(BM_TwoWayCompressorCurve)->Arg(false)->Arg(true);
 
 }  // namespace
 }  // namespace audio_dsp
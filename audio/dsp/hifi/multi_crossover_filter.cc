@@ -71,12 +71,31 @@ void MultiCrossoverFilter::SetCrossoverFrequenciesInternal(
 //                         \-> LP_0 -------> Output band 0
 void MultiCrossoverFilter::ProcessBlock(const Eigen::ArrayXXf& input) {
   DCHECK_GT(num_bands_, 1);
-  const Eigen::ArrayXXf* next_in = &input;
+  using OutputBlock =
+      Eigen::Block<Eigen::ArrayXXf, Eigen::Dynamic, Eigen::Dynamic, true>;
+  num_output_samples_ = input.cols();
+  if (!prepared_) {
+    for (auto& output : filtered_output_) {
+      output.resize(num_channels_, num_output_samples_);
+    }
+  } else if (filtered_output_[0].cols() < num_output_samples_) {
+    Prepare(num_output_samples_);
+  }
+  // The band outputs are the leftmost columns of filtered_output_.
   for (int stage = num_bands_ - 2; stage >= 0; --stage) {
-    lowpass_filters_[stage].ProcessBlock(*next_in, &filtered_output_[stage]);
-    highpass_filters_[stage].ProcessBlock(
-        *next_in, &filtered_output_[stage + 1]);
-    next_in = &filtered_output_[stage];
+    OutputBlock lowpass_output =
+        filtered_output_[stage].leftCols(num_output_samples_);
+    OutputBlock highpass_output =
+        filtered_output_[stage + 1].leftCols(num_output_samples_);
+    if (stage == num_bands_ - 2) {
+      lowpass_filters_[stage].ProcessBlock(input, &lowpass_output);
+      highpass_filters_[stage].ProcessBlock(input, &highpass_output);
+    } else {
+      // The input is the lowpass output of the previous stage, which the
+      // highpass filter overwrites in place.
+      lowpass_filters_[stage].ProcessBlock(highpass_output, &lowpass_output);
+      highpass_filters_[stage].ProcessBlock(highpass_output, &highpass_output);
+    }
   }
 }
 
@@ -37,6 +37,11 @@ namespace audio_dsp {
 // The crossover frequencies can be changed without generating audio artifacts.
 class MultiCrossoverFilter {
  public:
+  // Filtered output of a band. This is a view of the filter's buffers, valid
+  // until the next call to a non-const method.
+  using ConstOutputBlock =
+      Eigen::Block<const Eigen::ArrayXXf, Eigen::Dynamic, Eigen::Dynamic, true>;
+
   MultiCrossoverFilter(int num_bands, int order,
                        linear_filters::CrossoverType type =
                            linear_filters::kLinkwitzRiley)
@@ -47,6 +52,8 @@ class MultiCrossoverFilter {
         sample_rate_hz_(0 /* uninitialized */),
         highpass_filters_(num_bands - 1),
         lowpass_filters_(num_bands - 1),
+        prepared_(false),
+        num_output_samples_(0),
         filtered_output_(num_bands) {
     CHECK_GT(num_bands, 1);
   }
@@ -56,6 +63,20 @@ class MultiCrossoverFilter {
   void Init(int num_channels, float sample_rate_hz,
             const std::vector<float>& crossover_frequencies_hz);
 
+  // Allocates the buffers for blocks of up to max_block_size_samples samples.
+  // After this, ProcessBlock() does not allocate for such blocks, so it is safe
+  // to call from a realtime thread, and the outputs should be read with
+  // FilteredOutputBlock(). Without this, the buffers are resized to each block.
+  // Must be called after Init().
+  void Prepare(int max_block_size_samples) {
+    DCHECK_GT(num_channels_, 0);
+    DCHECK_GE(max_block_size_samples, 0);
+    prepared_ = true;
+    for (auto& output : filtered_output_) {
+      output.setZero(num_channels_, max_block_size_samples);
+    }
+  }
+
   void Reset() {
     for (auto& f : highpass_filters_) { f.Reset(); }
     for (auto& f : lowpass_filters_) { f.Reset(); }
@@ -79,12 +100,22 @@ class MultiCrossoverFilter {
   }
 
   // Filtered output from the filter_stage-th of the filterbank. Channels are
-  // ordered by increasing passband frequency.
+  // ordered by increasing passband frequency. After Prepare(), this keeps the
+  // prepared number of columns, and only the leftmost columns are the output
+  // of the last block.
   const Eigen::ArrayXXf& FilteredOutput(int band_number) const {
     DCHECK_LT(band_number, num_bands_);
     return filtered_output_[band_number];
   }
 
+  // Like FilteredOutput(), but always has one column per sample of the last
+  // block.
+  ConstOutputBlock FilteredOutputBlock(int band_number) const {
+    DCHECK_LT(band_number, num_bands_);
+    return ConstOutputBlock(filtered_output_[band_number], 0, 0, num_channels_,
+                            num_output_samples_);
+  }
+
  private:
   void SetCrossoverFrequenciesInternal(
       const std::vector<float>& crossover_frequencies_hz, bool initial);
@@ -100,8 +131,14 @@ class MultiCrossoverFilter {
   std::vector<linear_filters::LadderFilter<Eigen::ArrayXf>> highpass_filters_;
   std::vector<linear_filters::LadderFilter<Eigen::ArrayXf>> lowpass_filters_;
 
+  // Whether Prepare() was called, in which case filtered_output_ only grows.
+  bool prepared_;
+
   // filtered_output_[i] is the filtered output for the ith stage of the
   // cascade.
+  // The leftmost num_output_samples_ columns of filtered_output_[i] are the
+  // output of band i.
+  int num_output_samples_;
   std::vector<Eigen::ArrayXXf> filtered_output_;
 };
 
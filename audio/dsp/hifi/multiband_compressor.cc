@@ -40,6 +40,8 @@ void MultibandCompressor::Init(int num_channels,
   sample_rate_hz_ = sample_rate_hz;
   band_splitter_.Init(num_channels_, sample_rate_hz_,
                       crossover_frequencies_hz_);
+  band_splitter_.Prepare(max_block_size_samples);
+  workspace_.resize(num_channels_, max_block_size_samples);
   for (auto& drc : per_band_drc_) {
     drc.Init(num_channels_, max_block_size_samples, sample_rate_hz_);
   }
@@ -57,14 +59,15 @@ void MultibandCompressor::Reset() {
 void MultibandCompressor::ProcessBlock(const Eigen::ArrayXXf& input,
                                        Eigen::ArrayXXf* output) {
   // TODO: Do we care about the phase delay introduced by each stage?
+  DCHECK_LE(input.cols(), workspace_.cols());
   band_splitter_.ProcessBlock(input);
-  workspace_.resizeLike(input);
+  auto workspace = workspace_.leftCols(input.cols());
   output->resizeLike(input);
   output->setZero();
   for (int i = 0; i < band_splitter_.num_bands(); ++i) {
-    per_band_drc_[i].ProcessBlock(band_splitter_.FilteredOutput(i),
-                                  &workspace_);
-    *output += workspace_;
+    per_band_drc_[i].ProcessBlock(band_splitter_.FilteredOutputBlock(i),
+                                  &workspace);
+    *output += workspace;
   }
 }
 
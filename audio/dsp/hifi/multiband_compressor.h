@@ -137,7 +137,10 @@ class MultibandCompressor {
   }
 
   // Process a block of samples. input is a 2D Eigen array with contiguous
-  // column-major data, where the number of rows equals GetNumChannels().
+  // column-major data, where the number of rows equals GetNumChannels(). The
+  // number of samples must not exceed max_block_size_samples. The buffers are
+  // allocated by Init(), so this does not allocate as long as output already
+  // has the size of input.
   void ProcessBlock(const Eigen::ArrayXXf& input,
                     Eigen::ArrayXXf* output);
 
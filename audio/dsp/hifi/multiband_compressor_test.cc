@@ -0,0 +1,79 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/hifi/multiband_compressor.h"
+
+#include <vector>
+
+#include "audio/dsp/heap_allocation_counter.h"
+#include "audio/dsp/testing_util.h"
+#include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+namespace {
+
+constexpr int kNumChannels = 2;
+constexpr int kMaxBlockSize = 64;
+constexpr float kSampleRate = 48000.0f;
+
+MultibandCompressorParams ThreeBandParams() {
+  MultibandCompressorParams params(3, {300.0f, 3000.0f});
+  for (int band = 0; band < params.num_bands(); ++band) {
+    *params.MutableDynamicRangeControlParams(band) =
+        DynamicRangeControlParams::ReasonableCompressorParams();
+  }
+  return params;
+}
+
+// Processing with varying block sizes, without allocating, gives the same
+// result as processing all at once.
+TEST(MultibandCompressorTest, VaryingBlockSizesDoNotAllocate) {
+  const std::vector<int> block_sizes = {kMaxBlockSize, 5, 1, 33, 64, 17};
+  int total_samples = 0;
+  for (int num_samples : block_sizes) { total_samples += num_samples; }
+  const Eigen::ArrayXXf input =
+      0.1f * Eigen::ArrayXXf::Random(kNumChannels, total_samples);
+
+  MultibandCompressor reference(ThreeBandParams());
+  reference.Init(kNumChannels, total_samples, kSampleRate);
+  Eigen::ArrayXXf expected;
+  reference.ProcessBlock(input, &expected);
+
+  MultibandCompressor compressor(ThreeBandParams());
+  compressor.Init(kNumChannels, kMaxBlockSize, kSampleRate);
+  Eigen::ArrayXXf output(kNumChannels, total_samples);
+  int start = 0;
+  for (int num_samples : block_sizes) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    const Eigen::ArrayXXf block = input.middleCols(start, num_samples);
+    Eigen::ArrayXXf block_output(kNumChannels, num_samples);
+    {
+      ScopedHeapAllocationCounter counter;
+      compressor.ProcessBlock(block, &block_output);
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+    output.middleCols(start, num_samples) = block_output;
+    start += num_samples;
+  }
+  EXPECT_THAT(output, EigenArrayNear(expected, 1e-5));
+}
+
+}  // namespace
+}  // namespace audio_dsp
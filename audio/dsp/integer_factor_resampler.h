@@ -0,0 +1,534 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Multichannel resampling by small integer factors, specialized at compile
+// time.
+//
+// IntegerFactorDecimator<kFactor, kTaps> and IntegerFactorInterpolator<kFactor,
+// kTaps> resample by kFactor with a Kaiser-windowed sinc prototype filter of
+// kTaps taps at the higher rate, cut off at the Nyquist rate of the lower rate.
+// This is a Nyquist filter: every kFactor-th tap other than the center is zero,
+// e.g. every other tap for a halfband filter (kFactor = 2). The zero taps are
+// skipped, and the symmetry of the filter is used to halve the multiplies:
+//  - The decimator adds the input samples under symmetric taps before
+//    multiplying.
+//  - The interpolator's center phase is a copy of the input, and mirrored
+//    phases p and kFactor - p share their products.
+//
+// The filter is the DefaultResamplingKernel with cutoff at the lower Nyquist
+// rate, so the output matches a RationalFactorResampler with that kernel up to
+// rounding, and is aligned the same way: output sample m is centered at time
+// m / output_sample_rate. As for any Nyquist filter, the transition band is
+// centered on the lower Nyquist rate, so signal in the upper half of the
+// transition band aliases into the lower half.
+//
+// Frames are the columns of a column-major ArrayXXf, as in
+// MultichannelRationalFactorResampler. The input is split into polyphase
+// components so that each tap applies to a contiguous range of samples over
+// all channels and many frames, which vectorizes for any number of channels.
+// IntegerFactorResamplerCascade chains stages for factors like 2^k.
+//
+// Example use:
+//   // Decimate stereo from 48kHz to 24kHz with a 23-tap halfband filter.
+//   IntegerFactorDecimator<2, 23> decimator;
+//   decimator.Init(2);
+//   Eigen::ArrayXXf output;
+//   decimator.ProcessBlock(input, &output);
+
+#ifndef AUDIO_DSP_INTEGER_FACTOR_RESAMPLER_H_
+#define AUDIO_DSP_INTEGER_FACTOR_RESAMPLER_H_
+
+#include <algorithm>
+#include <array>
+
+#include "audio/dsp/resampler_rational_factor.h"
+#include "glog/logging.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+
+namespace integer_factor_resampler_internal {
+
+// The minimum number of input frames that fit in the buffer after the
+// history, as in MultichannelRationalFactorResampler.
+constexpr int kMinChunkFrames = 256;
+
+// Number of samples computed at a time, small enough that the accumulators
+// stay in registers.
+constexpr int kTileSize = 16;
+
+// Appends input frames, starting at *start, to buffer after its first
+// *num_buffered columns, skipping none. Returns the number appended.
+inline int AppendFrames(const Eigen::Ref<const Eigen::ArrayXXf>& input,
+                        int start, Eigen::ArrayXXf* buffer,
+                        int* num_buffered) {
+  const int num_frames =
+      std::min<int>(buffer->cols() - *num_buffered, input.cols() - start);
+  if (input.outerStride() == input.rows()) {
+    // Copy contiguous frames in one go rather than frame by frame.
+    std::copy(input.data() + start * input.rows(),
+              input.data() + (start + num_frames) * input.rows(),
+              buffer->data() + *num_buffered * buffer->rows());
+  } else {
+    buffer->middleCols(*num_buffered, num_frames) =
+        input.middleCols(start, num_frames);
+  }
+  *num_buffered += num_frames;
+  return num_frames;
+}
+
+// Moves the buffered frames from column first onward to the front.
+inline void DiscardFrames(int first, Eigen::ArrayXXf* buffer,
+                          int* num_buffered) {
+  *num_buffered -= first;
+  std::copy(buffer->data() + first * buffer->rows(),
+            buffer->data() + (first + *num_buffered) * buffer->rows(),
+            buffer->data());
+}
+
+// Copies num_frames frames of num_channels samples from every
+// source_stride-th frame of source to every dest_stride-th frame of dest.
+// Eigen's strided maps copy frame by frame, which is slow for few channels.
+inline void CopyStridedFrames(const float* source, int source_stride,
+                              int num_frames, int num_channels,
+                              int dest_stride, float* dest) {
+  if (num_channels == 1) {
+    for (int i = 0; i < num_frames; ++i) {
+      dest[i * dest_stride] = source[i * source_stride];
+    }
+    return;
+  }
+  for (int i = 0; i < num_frames; ++i) {
+    const float* source_frame = source + i * source_stride * num_channels;
+    std::copy(source_frame, source_frame + num_channels,
+              dest + i * dest_stride * num_channels);
+  }
+}
+
+}  // namespace integer_factor_resampler_internal
+
+// Downsamples by kFactor. kTaps must be 2 kFactor R - 1 for a positive integer
+// R, the radius of the filter in output samples.
+template <int kFactor, int kTaps>
+class IntegerFactorDecimator {
+ public:
+  static constexpr int kRadius = (kTaps + 1) / (2 * kFactor);
+  static_assert(kFactor >= 2, "kFactor must be at least 2");
+  static_assert(kRadius >= 1 && kTaps == 2 * kFactor * kRadius - 1,
+                "kTaps must be 2 kFactor R - 1 for a positive integer R");
+
+  IntegerFactorDecimator(): num_channels_(0 /* uninitialized */) {}
+
+  // Initializes for num_channels channels. kaiser_beta is as for
+  // DefaultResamplingKernel. Returns false if the parameters are invalid.
+  bool Init(int num_channels, double kaiser_beta = 6.0) {
+    // In units of input samples, the kernel is zero at multiples of kFactor.
+    DefaultResamplingKernel kernel(kFactor, 1, kFactor * kRadius, 0.5,
+                                   kaiser_beta);
+    if (num_channels <= 0 || !kernel.Valid()) {
+      return false;
+    }
+    num_channels_ = num_channels;
+    for (int k = 0; k < kHalfTaps + 1; ++k) {
+      kernel_[k] = kernel.Eval(k);
+    }
+    buffer_.resize(num_channels_,
+                   kTaps - 1 + std::max(integer_factor_resampler_internal::
+                                            kMinChunkFrames, kTaps));
+    // Each phase holds the window frames of up to MaxChunkOutputs() outputs.
+    for (Eigen::ArrayXXf& phase : phases_) {
+      phase.resize(num_channels_, MaxChunkOutputs() + 2 * kRadius - 1);
+    }
+    Reset();
+    return true;
+  }
+
+  void Reset() {
+    // As for RationalFactorResampler, the stream starts with zeros so that
+    // the first output is centered on the first input frame.
+    buffer_.leftCols(kHalfTaps).setZero();
+    num_buffered_ = kHalfTaps;
+  }
+
+  // Returns the number of output frames that the next call to ProcessBlock()
+  // produces for input_size input frames.
+  int ComputeOutputSize(int input_size) const {
+    const int available = num_buffered_ + input_size;
+    return available < kTaps ? 0 : (available - kTaps) / kFactor + 1;
+  }
+
+  // Resamples a block of frames, where input has num_channels() rows. output
+  // is resized to ComputeOutputSize(input.cols()) columns, so this does not
+  // allocate if output already has that size.
+  void ProcessBlock(const Eigen::Ref<const Eigen::ArrayXXf>& input,
+                    Eigen::ArrayXXf* output) {
+    DCHECK_NE(num_channels_, 0) << "You must call Init() first!";
+    DCHECK_EQ(input.rows(), num_channels_);
+    DCHECK(output != nullptr);
+    output->resize(num_channels_, ComputeOutputSize(input.cols()));
+    int output_frames = 0;
+    for (int start = 0; start < input.cols();) {
+      start += integer_factor_resampler_internal::AppendFrames(
+          input, start, &buffer_, &num_buffered_);
+      const int num_outputs = (num_buffered_ < kTaps) ?
+          0 : (num_buffered_ - kTaps) / kFactor + 1;
+      if (num_outputs > 0) {
+        DCHECK_LE(output_frames + num_outputs, output->cols());
+        Deinterleave(num_outputs);
+        ComputeFrames(num_outputs,
+                      output->data() + output_frames * num_channels_);
+        output_frames += num_outputs;
+      }
+      integer_factor_resampler_internal::DiscardFrames(
+          kFactor * num_outputs, &buffer_, &num_buffered_);
+    }
+    DCHECK_EQ(output_frames, output->cols());
+  }
+
+  // Processes enough zeros that all previous input is fully processed, then
+  // Reset(). Allocates.
+  void Flush(Eigen::ArrayXXf* output) {
+    ProcessBlock(Eigen::ArrayXXf::Zero(num_channels_, kTaps - 1), output);
+    Reset();
+  }
+
+  int num_channels() const { return num_channels_; }
+  static constexpr int factor() { return kFactor; }
+
+ private:
+  static constexpr int kHalfTaps = (kTaps - 1) / 2;
+
+  int MaxChunkOutputs() const {
+    return (buffer_.cols() - kTaps) / kFactor + 1;
+  }
+
+  // Splits the buffered frames under the windows of the next num_outputs
+  // outputs into kFactor phases, so that phases_[r].col(q) is buffer column
+  // kFactor * q + r.
+  void Deinterleave(int num_outputs) {
+    const int num_frames = kFactor * (num_outputs - 1) + kTaps;
+    for (int r = 0; r < kFactor; ++r) {
+      const int num_phase_frames = (num_frames - r + kFactor - 1) / kFactor;
+      integer_factor_resampler_internal::CopyStridedFrames(
+          buffer_.data() + r * num_channels_, kFactor, num_phase_frames,
+          num_channels_, 1, phases_[r].data());
+    }
+  }
+
+  // Computes num_outputs output frames from the deinterleaved input. Frames
+  // are contiguous, so the output and the window frames of each tap are
+  // contiguous ranges of num_channels * num_outputs samples, which are
+  // computed in tiles that stay in registers for any number of channels.
+  void ComputeFrames(int num_outputs, float* output) const {
+    const int size = num_channels_ * num_outputs;
+    int i = 0;
+    for (; i + integer_factor_resampler_internal::kTileSize <= size;
+         i += integer_factor_resampler_internal::kTileSize) {
+      ComputeTile<integer_factor_resampler_internal::kTileSize>(i, output);
+    }
+    for (; i < size; ++i) {
+      ComputeTile<1>(i, output);
+    }
+  }
+
+  // Computes the kTileSize output samples starting at output[offset]. The
+  // loop has compile-time bounds, so the zero taps are skipped at compile
+  // time.
+  template <int kTileSize>
+  void ComputeTile(int offset, float* output) const {
+    using Tile = Eigen::Array<float, kTileSize, 1>;
+    // The samples at window index s are phases_[s % kFactor] starting at
+    // column s / kFactor.
+    auto window = [this, offset](int s) {
+      return Eigen::Map<const Tile>(phases_[s % kFactor].data() +
+                                    (s / kFactor) * num_channels_ + offset);
+    };
+    Tile sum = kernel_[0] * window(kHalfTaps);
+    for (int k = 1; k <= kHalfTaps; ++k) {
+      if (k % kFactor == 0) { continue; }
+      sum += kernel_[k] * (window(kHalfTaps - k) + window(kHalfTaps + k));
+    }
+    Eigen::Map<Tile>(output + offset) = sum;
+  }
+
+  int num_channels_;
+  // kernel_[k] is the tap at offset k from the center, in input samples.
+  std::array<float, kHalfTaps + 1> kernel_;
+  // Input frames, with the window of the next output frame starting at column
+  // 0, as in MultichannelRationalFactorResampler.
+  Eigen::ArrayXXf buffer_;
+  int num_buffered_;
+  std::array<Eigen::ArrayXXf, kFactor> phases_;
+};
+
+// Upsamples by kFactor. kTaps must be 2 kFactor R - 1 for a positive integer R,
+// the radius of the filter in input samples.
+template <int kFactor, int kTaps>
+class IntegerFactorInterpolator {
+ public:
+  static constexpr int kRadius = (kTaps + 1) / (2 * kFactor);
+  static_assert(kFactor >= 2, "kFactor must be at least 2");
+  static_assert(kRadius >= 1 && kTaps == 2 * kFactor * kRadius - 1,
+                "kTaps must be 2 kFactor R - 1 for a positive integer R");
+
+  IntegerFactorInterpolator(): num_channels_(0 /* uninitialized */) {}
+
+  // Initializes for num_channels channels. kaiser_beta is as for
+  // DefaultResamplingKernel. Returns false if the parameters are invalid.
+  bool Init(int num_channels, double kaiser_beta = 6.0) {
+    DefaultResamplingKernel kernel(1, kFactor, kRadius, 0.5, kaiser_beta);
+    if (num_channels <= 0 || !kernel.Valid()) {
+      return false;
+    }
+    num_channels_ = num_channels;
+    // The window of 2 kRadius input frames has the frame at the current
+    // position at index kRadius - 1. For phase p, the tap for window index i
+    // is at offset p / kFactor + kRadius - 1 - i. The filter for phase
+    // kFactor - p is that of phase p reversed, so for mirrored phases the
+    // window is split into the sums and differences of mirrored frames.
+    for (int p = 1; 2 * p <= kFactor; ++p) {
+      for (int i = 0; i < kRadius; ++i) {
+        const double tap =
+            kernel.Eval(static_cast<double>(p) / kFactor + kRadius - 1 - i);
+        const double mirrored_tap =
+            kernel.Eval(static_cast<double>(p) / kFactor - kRadius + i);
+        sum_kernel_[p - 1][i] = 0.5 * (tap + mirrored_tap);
+        difference_kernel_[p - 1][i] = 0.5 * (tap - mirrored_tap);
+      }
+    }
+    buffer_.resize(num_channels_,
+                   kWindow - 1 + std::max(integer_factor_resampler_internal::
+                                              kMinChunkFrames, kWindow));
+    for (Eigen::ArrayXXf& phase_output : phase_output_) {
+      phase_output.resize(num_channels_, MaxChunkInputs());
+    }
+    Reset();
+    return true;
+  }
+
+  void Reset() {
+    // The first output is centered on the first input frame.
+    buffer_.leftCols(kRadius - 1).setZero();
+    num_buffered_ = kRadius - 1;
+  }
+
+  // Returns the number of output frames that the next call to ProcessBlock()
+  // produces for input_size input frames.
+  int ComputeOutputSize(int input_size) const {
+    return kFactor * std::max(0, num_buffered_ + input_size - kWindow + 1);
+  }
+
+  // Resamples a block of frames, where input has num_channels() rows. output
+  // is resized to ComputeOutputSize(input.cols()) columns, so this does not
+  // allocate if output already has that size.
+  void ProcessBlock(const Eigen::Ref<const Eigen::ArrayXXf>& input,
+                    Eigen::ArrayXXf* output) {
+    DCHECK_NE(num_channels_, 0) << "You must call Init() first!";
+    DCHECK_EQ(input.rows(), num_channels_);
+    DCHECK(output != nullptr);
+    output->resize(num_channels_, ComputeOutputSize(input.cols()));
+    int output_frames = 0;
+    for (int start = 0; start < input.cols();) {
+      start += integer_factor_resampler_internal::AppendFrames(
+          input, start, &buffer_, &num_buffered_);
+      const int num_inputs = std::max(0, num_buffered_ - kWindow + 1);
+      if (num_inputs > 0) {
+        DCHECK_LE(output_frames + kFactor * num_inputs, output->cols());
+        ComputeFrames(num_inputs,
+                      output->data() + output_frames * num_channels_);
+        output_frames += kFactor * num_inputs;
+      }
+      integer_factor_resampler_internal::DiscardFrames(
+          num_inputs, &buffer_, &num_buffered_);
+    }
+    DCHECK_EQ(output_frames, output->cols());
+  }
+
+  // Processes enough zeros that all previous input is fully processed, then
+  // Reset(). Allocates.
+  void Flush(Eigen::ArrayXXf* output) {
+    ProcessBlock(Eigen::ArrayXXf::Zero(num_channels_, kWindow - 1), output);
+    Reset();
+  }
+
+  int num_channels() const { return num_channels_; }
+  static constexpr int factor() { return kFactor; }
+
+ private:
+  // Number of input frames under the filter.
+  static constexpr int kWindow = 2 * kRadius;
+  // Number of mirrored pairs of phases, including phase kFactor / 2 for even
+  // kFactor, which is its own mirror image.
+  static constexpr int kNumPhasePairs = kFactor / 2;
+
+  int MaxChunkInputs() const { return buffer_.cols() - kWindow + 1; }
+
+  // Computes the kFactor output frames for each of the next num_inputs
+  // windows. As in IntegerFactorDecimator, the computation runs over tiles of
+  // the contiguous range of num_channels * num_inputs samples, writing each
+  // output phase to phase_output_ before interleaving.
+  void ComputeFrames(int num_inputs, float* output) {
+    const int size = num_channels_ * num_inputs;
+    int i = 0;
+    for (; i + integer_factor_resampler_internal::kTileSize <= size;
+         i += integer_factor_resampler_internal::kTileSize) {
+      ComputeTile<integer_factor_resampler_internal::kTileSize>(i);
+    }
+    for (; i < size; ++i) {
+      ComputeTile<1>(i);
+    }
+    // Phase 0 is a copy of the input frame at the current position.
+    integer_factor_resampler_internal::CopyStridedFrames(
+        buffer_.data() + (kRadius - 1) * num_channels_, 1, num_inputs,
+        num_channels_, kFactor, output);
+    for (int p = 1; p < kFactor; ++p) {
+      integer_factor_resampler_internal::CopyStridedFrames(
+          phase_output_[p - 1].data(), 1, num_inputs, num_channels_, kFactor,
+          output + p * num_channels_);
+    }
+  }
+
+  // Computes the kTileSize samples starting at offset of each output phase
+  // other than phase 0.
+  template <int kTileSize>
+  void ComputeTile(int offset) {
+    using Tile = Eigen::Array<float, kTileSize, 1>;
+    auto window = [this, offset](int i) {
+      return Eigen::Map<const Tile>(buffer_.data() + i * num_channels_ +
+                                    offset);
+    };
+    std::array<Tile, kNumPhasePairs> even;
+    std::array<Tile, kNumPhasePairs> odd;
+    for (int i = 0; i < kRadius; ++i) {
+      const Tile a = window(i);
+      const Tile b = window(kWindow - 1 - i);
+      const Tile sum = a + b;
+      const Tile difference = a - b;
+      for (int p = 0; p < kNumPhasePairs; ++p) {
+        if (i == 0) {
+          even[p] = sum_kernel_[p][i] * sum;
+          odd[p] = difference_kernel_[p][i] * difference;
+        } else {
+          even[p] += sum_kernel_[p][i] * sum;
+          odd[p] += difference_kernel_[p][i] * difference;
+        }
+      }
+    }
+    for (int p = 1; 2 * p <= kFactor; ++p) {
+      // For p = kFactor / 2, the odd part is zero and both writes are to the
+      // same phase.
+      Eigen::Map<Tile>(phase_output_[p - 1].data() + offset) =
+          even[p - 1] + odd[p - 1];
+      Eigen::Map<Tile>(phase_output_[kFactor - p - 1].data() + offset) =
+          even[p - 1] - odd[p - 1];
+    }
+  }
+
+  int num_channels_;
+  // For mirrored phases p and kFactor - p, the even and odd parts of the filter
+  // of phase p, applied to the sums and differences of mirrored window frames.
+  std::array<std::array<float, kRadius>, kNumPhasePairs> sum_kernel_;
+  std::array<std::array<float, kRadius>, kNumPhasePairs> difference_kernel_;
+  Eigen::ArrayXXf buffer_;
+  int num_buffered_;
+  // Output phase p + 1 of each chunk.
+  std::array<Eigen::ArrayXXf, kFactor - 1> phase_output_;
+};
+
+// Runs kNumStages instances of Stage, an IntegerFactorDecimator or
+// IntegerFactorInterpolator, in sequence, e.g. three halfband stages for a
+// factor of 8.
+template <typename Stage, int kNumStages>
+class IntegerFactorResamplerCascade {
+ public:
+  static_assert(kNumStages >= 1, "kNumStages must be positive");
+
+  bool Init(int num_channels, double kaiser_beta = 6.0) {
+    for (Stage& stage : stages_) {
+      if (!stage.Init(num_channels, kaiser_beta)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void Reset() {
+    for (Stage& stage : stages_) {
+      stage.Reset();
+    }
+  }
+
+  int ComputeOutputSize(int input_size) const {
+    for (const Stage& stage : stages_) {
+      input_size = stage.ComputeOutputSize(input_size);
+    }
+    return input_size;
+  }
+
+  // Does not allocate once the intermediate buffers have grown to the block
+  // size and output has ComputeOutputSize(input.cols()) columns.
+  void ProcessBlock(const Eigen::Ref<const Eigen::ArrayXXf>& input,
+                    Eigen::ArrayXXf* output) {
+    if (kNumStages == 1) {
+      stages_[0].ProcessBlock(input, output);
+      return;
+    }
+    stages_[0].ProcessBlock(input, &intermediate_[0]);
+    for (int i = 1; i + 1 < kNumStages; ++i) {
+      stages_[i].ProcessBlock(intermediate_[i - 1], &intermediate_[i]);
+    }
+    stages_[kNumStages - 1].ProcessBlock(intermediate_[kNumStages - 2],
+                                         output);
+  }
+
+  // Flushes each stage in order, passing its remaining output through the
+  // later stages. Allocates.
+  void Flush(Eigen::ArrayXXf* output) {
+    Eigen::ArrayXXf pending(stages_[0].num_channels(), 0);
+    Eigen::ArrayXXf processed;
+    Eigen::ArrayXXf flushed;
+    for (Stage& stage : stages_) {
+      stage.ProcessBlock(pending, &processed);
+      stage.Flush(&flushed);
+      pending.resize(processed.rows(), processed.cols() + flushed.cols());
+      pending.leftCols(processed.cols()) = processed;
+      pending.rightCols(flushed.cols()) = flushed;
+    }
+    output->swap(pending);
+  }
+
+  int num_channels() const { return stages_[0].num_channels(); }
+  static constexpr int factor() {
+    int factor = 1;
+    for (int i = 0; i < kNumStages; ++i) {
+      factor *= Stage::factor();
+    }
+    return factor;
+  }
+
+ private:
+  std::array<Stage, kNumStages> stages_;
+  // Output of stage i for i < kNumStages - 1.
+  std::array<Eigen::ArrayXXf, (kNumStages > 1) ? kNumStages - 1 : 1>
+      intermediate_;
+};
+
+}  // namespace audio_dsp
+
+#endif  // AUDIO_DSP_INTEGER_FACTOR_RESAMPLER_H_
@@ -0,0 +1,271 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/integer_factor_resampler.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "audio/dsp/heap_allocation_counter.h"
+#include "audio/dsp/multichannel_resampler_rational_factor.h"
+#include "audio/dsp/resampler_rational_factor.h"
+#include "audio/dsp/testing_util.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+namespace {
+
+using ::Eigen::ArrayXf;
+using ::Eigen::ArrayXXf;
+
+constexpr double kKaiserBeta = 7.0;
+
+// Resamples each row of input with a RationalFactorResampler<float> using the
+// kernel of the integer factor resampler.
+ArrayXXf ResampleEachChannel(const ResamplingKernel& kernel,
+                             int factor_numerator, int factor_denominator,
+                             const ArrayXXf& input) {
+  std::vector<ArrayXf> rows;
+  for (int channel = 0; channel < input.rows(); ++channel) {
+    RationalFactorResampler<float> resampler(kernel, factor_numerator,
+                                             factor_denominator);
+    ArrayXf row;
+    resampler.ProcessSamplesEigen(input.row(channel).transpose(), &row);
+    rows.push_back(row);
+  }
+  ArrayXXf output(input.rows(), rows[0].size());
+  for (int channel = 0; channel < input.rows(); ++channel) {
+    output.row(channel) = rows[channel].transpose();
+  }
+  return output;
+}
+
+// Streams input through resampler in blocks of random sizes.
+template <typename ResamplerType>
+ArrayXXf ProcessInRandomBlocks(const ArrayXXf& input,
+                               ResamplerType* resampler) {
+  std::mt19937 rng(0 /* seed */);
+  ArrayXXf output(input.rows(), 0);
+  ArrayXXf block_output;
+  for (int start = 0; start < input.cols();) {
+    std::uniform_int_distribution<int> block_size_distribution(
+        0, std::min<int>(300, input.cols() - start));
+    const int block_size = block_size_distribution(rng);
+    const int expected_size = resampler->ComputeOutputSize(block_size);
+    resampler->ProcessBlock(input.middleCols(start, block_size),
+                            &block_output);
+    EXPECT_EQ(block_output.cols(), expected_size);
+    output.conservativeResize(input.rows(),
+                              output.cols() + block_output.cols());
+    output.rightCols(block_output.cols()) = block_output;
+    start += block_size;
+  }
+  return output;
+}
+
+template <typename DecimatorType>
+void TestDecimator(int num_channels) {
+  constexpr int kFactor = DecimatorType::factor();
+  constexpr int kRadius = DecimatorType::kRadius;
+  SCOPED_TRACE(testing::Message() << "factor: " << kFactor << ", radius: "
+               << kRadius << ", channels: " << num_channels);
+  const ArrayXXf input = ArrayXXf::Random(num_channels, 2000);
+  DecimatorType decimator;
+  ASSERT_TRUE(decimator.Init(num_channels, kKaiserBeta));
+  EXPECT_EQ(decimator.num_channels(), num_channels);
+  const ArrayXXf output = ProcessInRandomBlocks(input, &decimator);
+  DefaultResamplingKernel kernel(kFactor, 1, kFactor * kRadius, 0.5,
+                                 kKaiserBeta);
+  const ArrayXXf expected = ResampleEachChannel(kernel, kFactor, 1, input);
+  // The zero taps at the ends of the support let the decimator produce output
+  // a little earlier.
+  ASSERT_GE(output.cols(), expected.cols());
+  EXPECT_THAT(output.leftCols(expected.cols()),
+              EigenArrayNear(expected, 1e-5));
+}
+
+template <typename InterpolatorType>
+void TestInterpolator(int num_channels) {
+  constexpr int kFactor = InterpolatorType::factor();
+  constexpr int kRadius = InterpolatorType::kRadius;
+  SCOPED_TRACE(testing::Message() << "factor: " << kFactor << ", radius: "
+               << kRadius << ", channels: " << num_channels);
+  const ArrayXXf input = ArrayXXf::Random(num_channels, 1000);
+  InterpolatorType interpolator;
+  ASSERT_TRUE(interpolator.Init(num_channels, kKaiserBeta));
+  const ArrayXXf output = ProcessInRandomBlocks(input, &interpolator);
+  DefaultResamplingKernel kernel(1, kFactor, kRadius, 0.5, kKaiserBeta);
+  const ArrayXXf expected = ResampleEachChannel(kernel, 1, kFactor, input);
+  ASSERT_GE(output.cols(), expected.cols());
+  EXPECT_THAT(output.leftCols(expected.cols()),
+              EigenArrayNear(expected, 1e-5));
+  // Every kFactor-th output is a copy of the input.
+  for (int m = 0; m < output.cols() / kFactor; ++m) {
+    ASSERT_TRUE((output.col(kFactor * m) == input.col(m)).all());
+  }
+}
+
+TEST(IntegerFactorResamplerTest, DecimatorMatchesRationalFactorResampler) {
+  for (int num_channels : {1, 3, 8}) {
+    TestDecimator<IntegerFactorDecimator<2, 3>>(num_channels);
+    TestDecimator<IntegerFactorDecimator<2, 23>>(num_channels);
+    TestDecimator<IntegerFactorDecimator<3, 29>>(num_channels);
+    TestDecimator<IntegerFactorDecimator<4, 31>>(num_channels);
+  }
+}
+
+TEST(IntegerFactorResamplerTest, InterpolatorMatchesRationalFactorResampler) {
+  for (int num_channels : {1, 3, 8}) {
+    TestInterpolator<IntegerFactorInterpolator<2, 3>>(num_channels);
+    TestInterpolator<IntegerFactorInterpolator<2, 23>>(num_channels);
+    TestInterpolator<IntegerFactorInterpolator<3, 29>>(num_channels);
+    TestInterpolator<IntegerFactorInterpolator<4, 31>>(num_channels);
+  }
+}
+
+TEST(IntegerFactorResamplerTest, CascadeMatchesChainedStages) {
+  constexpr int kNumChannels = 2;
+  using Stage = IntegerFactorDecimator<2, 15>;
+  IntegerFactorResamplerCascade<Stage, 3> cascade;
+  EXPECT_EQ(cascade.factor(), 8);
+  ASSERT_TRUE(cascade.Init(kNumChannels));
+  EXPECT_EQ(cascade.num_channels(), kNumChannels);
+  std::array<Stage, 3> stages;
+  for (Stage& stage : stages) {
+    ASSERT_TRUE(stage.Init(kNumChannels));
+  }
+  const ArrayXXf input = ArrayXXf::Random(kNumChannels, 3000);
+  ArrayXXf output = ProcessInRandomBlocks(input, &cascade);
+  ArrayXXf flushed;
+  cascade.Flush(&flushed);
+  output.conservativeResize(kNumChannels, output.cols() + flushed.cols());
+  output.rightCols(flushed.cols()) = flushed;
+
+  ArrayXXf expected = input;
+  for (Stage& stage : stages) {
+    ArrayXXf stage_output;
+    stage.ProcessBlock(expected, &stage_output);
+    stage.Flush(&flushed);
+    expected.resize(kNumChannels, stage_output.cols() + flushed.cols());
+    expected.leftCols(stage_output.cols()) = stage_output;
+    expected.rightCols(flushed.cols()) = flushed;
+  }
+  EXPECT_THAT(output, EigenArrayNear(expected, 1e-6));
+}
+
+TEST(IntegerFactorResamplerTest, DoesNotAllocate) {
+  constexpr int kNumChannels = 4;
+  IntegerFactorDecimator<2, 23> decimator;
+  IntegerFactorInterpolator<3, 29> interpolator;
+  ASSERT_TRUE(decimator.Init(kNumChannels));
+  ASSERT_TRUE(interpolator.Init(kNumChannels));
+  for (int block_size : {480, 1, 0, 1000, 50, 480}) {
+    SCOPED_TRACE("block_size: " + testing::PrintToString(block_size));
+    const ArrayXXf input = ArrayXXf::Random(kNumChannels, block_size);
+    ArrayXXf decimated(kNumChannels, decimator.ComputeOutputSize(block_size));
+    ArrayXXf interpolated(kNumChannels,
+                          interpolator.ComputeOutputSize(block_size));
+    ScopedHeapAllocationCounter counter;
+    decimator.ProcessBlock(input, &decimated);
+    interpolator.ProcessBlock(input, &interpolated);
+    EXPECT_EQ(counter.num_allocations(), 0);
+  }
+}
+
+TEST(IntegerFactorResamplerTest, InvalidParameters) {
+  IntegerFactorDecimator<2, 23> decimator;
+  EXPECT_FALSE(decimator.Init(0));
+  EXPECT_FALSE(decimator.Init(1, -1.0));
+  IntegerFactorInterpolator<2, 23> interpolator;
+  EXPECT_FALSE(interpolator.Init(0));
+}
+
+// Compares 48kHz to 24kHz and back with a 23-tap halfband filter in 10ms
+// blocks against RationalFactorResampler and
+// MultichannelRationalFactorResampler with the same kernel.
+constexpr int kBenchmarkBlockSize = 480;
+constexpr int kBenchmarkTaps = 23;
+
+template <typename ResamplerType>
+void BM_IntegerFactorResampler(benchmark::State& state) {
+  const int num_channels = state.range(0);
+  srand(0 /* seed */);
+  const ArrayXXf input = ArrayXXf::Random(num_channels, kBenchmarkBlockSize);
+  ResamplerType resampler;
+  resampler.Init(num_channels);
+  ArrayXXf output;
+  while (state.KeepRunning()) {
+    resampler.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_IntegerFactorResampler,
+                   IntegerFactorDecimator<2, kBenchmarkTaps>)
+    ->Arg(1)->Arg(8);
+BENCHMARK_TEMPLATE(BM_IntegerFactorResampler,
+                   IntegerFactorInterpolator<2, kBenchmarkTaps>)
+    ->Arg(1)->Arg(8);
+
+template <bool kDecimate>
+void BM_RationalFactorResamplerByTwo(benchmark::State& state) {
+  srand(0 /* seed */);
+  const Eigen::VectorXf input = Eigen::VectorXf::Random(kBenchmarkBlockSize);
+  constexpr int kRadius = (kBenchmarkTaps + 1) / 4;
+  RationalFactorResampler<float> resampler(
+      kDecimate ? DefaultResamplingKernel(2, 1, 2 * kRadius, 0.5, 6.0)
+                : DefaultResamplingKernel(1, 2, kRadius, 0.5, 6.0),
+      kDecimate ? 2 : 1, kDecimate ? 1 : 2);
+  Eigen::VectorXf output;
+  while (state.KeepRunning()) {
+    resampler.ProcessSamplesEigen(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_RationalFactorResamplerByTwo, true);
+BENCHMARK_TEMPLATE(BM_RationalFactorResamplerByTwo, false);
+
+template <bool kDecimate>
+void BM_MultichannelRationalFactorResamplerByTwo(benchmark::State& state) {
+  constexpr int kNumChannels = 8;
+  srand(0 /* seed */);
+  const ArrayXXf input = ArrayXXf::Random(kNumChannels, kBenchmarkBlockSize);
+  constexpr int kRadius = (kBenchmarkTaps + 1) / 4;
+  MultichannelRationalFactorResampler resampler;
+  resampler.Init(
+      kNumChannels,
+      kDecimate ? DefaultResamplingKernel(2, 1, 2 * kRadius, 0.5, 6.0)
+                : DefaultResamplingKernel(1, 2, kRadius, 0.5, 6.0),
+      kDecimate ? 2 : 1, kDecimate ? 1 : 2);
+  ArrayXXf output;
+  while (state.KeepRunning()) {
+    resampler.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_MultichannelRationalFactorResamplerByTwo, true);
+BENCHMARK_TEMPLATE(BM_MultichannelRationalFactorResamplerByTwo, false);
+
+}  // namespace
+}  // namespace audio_dsp
@@ -0,0 +1,163 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/multichannel_resampler_rational_factor.h"
+
+#include <algorithm>
+#include <cmath>
+
+#include "audio/dsp/number_util.h"
+#include "glog/logging.h"
+
+namespace audio_dsp {
+
+namespace {
+
+// The minimum number of input frames that fit in the buffer after the
+// history. Buffered frames are shifted to the front once per chunk.
+constexpr int kMinChunkFrames = 256;
+
+}  // namespace
+
+bool MultichannelRationalFactorResampler::Init(int num_channels,
+                                               const ResamplingKernel& kernel,
+                                               int max_denominator) {
+  if (num_channels <= 0 || !kernel.Valid() || max_denominator <= 0) {
+    return false;
+  }
+  const std::pair<int, int> factor = RationalApproximation(
+      kernel.input_sample_rate() / kernel.output_sample_rate(),
+      max_denominator);
+  InitInternal(num_channels, kernel, factor.first, factor.second);
+  return true;
+}
+
+bool MultichannelRationalFactorResampler::Init(int num_channels,
+                                               const ResamplingKernel& kernel,
+                                               int factor_numerator,
+                                               int factor_denominator) {
+  if (num_channels <= 0 || !kernel.Valid() || factor_numerator <= 0 ||
+      factor_denominator <= 0) {
+    return false;
+  }
+  const int gcd = GreatestCommonDivisor(factor_numerator, factor_denominator);
+  InitInternal(num_channels, kernel, factor_numerator / gcd,
+               factor_denominator / gcd);
+  return true;
+}
+
+void MultichannelRationalFactorResampler::InitInternal(
+    int num_channels, const ResamplingKernel& kernel, int factor_numerator,
+    int factor_denominator) {
+  if (factor_denominator > 1000) {
+    LOG(WARNING) << "Resampling factor " << factor_numerator << "/"
+                 << factor_denominator << " is not a ratio of small "
+                 << "integers, so a large table of " << factor_denominator
+                 << " filters is needed.";
+  }
+  num_channels_ = num_channels;
+  factor_numerator_ = factor_numerator;
+  factor_denominator_ = factor_denominator;
+  factor_floor_ = factor_numerator_ / factor_denominator_;  // Integer divide.
+  radius_ = std::ceil(kernel.radius());
+  phase_step_ = factor_numerator_ % factor_denominator_;
+  num_taps_ = 2 * radius_ + 1;
+
+  filters_ = GetPolyphaseFilters<float>(kernel, factor_denominator_);
+  buffer_.resize(num_channels_,
+                 num_taps_ - 1 + std::max(kMinChunkFrames, num_taps_));
+  Reset();
+}
+
+void MultichannelRationalFactorResampler::Reset() {
+  // As for RationalFactorResampler, the stream starts with radius_ zeros so
+  // that the first output is centered on the first input frame.
+  buffer_.leftCols(radius_).setZero();
+  num_buffered_ = radius_;
+  num_to_skip_ = 0;
+  phase_ = 0;
+}
+
+int MultichannelRationalFactorResampler::ComputeOutputSize(
+    int input_size) const {
+  // See RationalFactorResampler::ComputeOutputSizeFromCurrentState().
+  const int64 min_consumed_input =
+      static_cast<int64>(num_buffered_) + input_size - num_to_skip_ -
+      num_taps_ + 1;
+  if (min_consumed_input <= 0) {
+    return 0;
+  }
+  return (min_consumed_input * factor_denominator_ - phase_ +
+          factor_numerator_ - 1) /
+         factor_numerator_;
+}
+
+void MultichannelRationalFactorResampler::ProcessBlock(
+    const Eigen::Ref<const Eigen::ArrayXXf>& input, Eigen::ArrayXXf* output) {
+  DCHECK_NE(num_channels_, 0) << "You must call Init() first!";
+  DCHECK_EQ(input.rows(), num_channels_);
+  DCHECK(output != nullptr);
+  output->resize(num_channels_, ComputeOutputSize(input.cols()));
+  int output_frames = 0;
+  for (int start = 0; start < input.cols();) {
+    const int num_skipped =
+        std::min<int>(num_to_skip_, input.cols() - start);
+    num_to_skip_ -= num_skipped;
+    start += num_skipped;
+    const int num_frames =
+        std::min<int>(buffer_.cols() - num_buffered_, input.cols() - start);
+    buffer_.middleCols(num_buffered_, num_frames) =
+        input.middleCols(start, num_frames);
+    num_buffered_ += num_frames;
+    start += num_frames;
+
+    // Below, the position in the buffer is (i + phase_ / factor_denominator_)
+    // in units of input frames, with phase_ tracking the fractional part.
+    int i = 0;
+    while (i + num_taps_ <= num_buffered_) {
+      DCHECK_LT(output_frames, output->cols());
+      output->col(output_frames).matrix().noalias() =
+          buffer_.middleCols(i, num_taps_).matrix() * filters_->col(phase_);
+      ++output_frames;
+      i += factor_floor_;
+      phase_ += phase_step_;
+      if (phase_ >= factor_denominator_) {
+        phase_ -= factor_denominator_;
+        ++i;
+      }
+    }
+
+    // Move the frames needed for the next output to the front.
+    if (i >= num_buffered_) {
+      num_to_skip_ += i - num_buffered_;
+      num_buffered_ = 0;
+    } else {
+      num_buffered_ -= i;
+      std::copy(buffer_.data() + i * num_channels_,
+                buffer_.data() + (i + num_buffered_) * num_channels_,
+                buffer_.data());
+    }
+  }
+  DCHECK_EQ(output_frames, output->cols());
+}
+
+void MultichannelRationalFactorResampler::Flush(Eigen::ArrayXXf* output) {
+  // After num_taps_ - 1 zeros, the buffer contains only zeros.
+  ProcessBlock(Eigen::ArrayXXf::Zero(num_channels_, num_taps_ - 1), output);
+  Reset();
+}
+
+}  // namespace audio_dsp
@@ -0,0 +1,108 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Multichannel audio resampling by a rational factor.
+//
+// MultichannelRationalFactorResampler computes the same output as one
+// RationalFactorResampler<float> per channel, but shares a single polyphase
+// filter table between the channels. Input frames are the columns of a
+// column-major ArrayXXf, so each output frame is a (channels x taps) by taps
+// matrix-vector product that vectorizes across channels.
+
+#ifndef AUDIO_DSP_MULTICHANNEL_RESAMPLER_RATIONAL_FACTOR_H_
+#define AUDIO_DSP_MULTICHANNEL_RESAMPLER_RATIONAL_FACTOR_H_
+
+#include <memory>
+
+#include "audio/dsp/resampler_rational_factor.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+
+class MultichannelRationalFactorResampler {
+ public:
+  MultichannelRationalFactorResampler()
+      : num_channels_(0 /* uninitialized */) {}
+
+  // Initialize for num_channels channels, approximating the resampling factor
+  // of kernel by a rational a/b with 0 < b <= max_denominator, as in the
+  // corresponding RationalFactorResampler constructor. Returns false and
+  // leaves the resampler uninitialized if the parameters are invalid.
+  bool Init(int num_channels, const ResamplingKernel& kernel,
+            int max_denominator = 1000);
+
+  // Initialize for num_channels channels with the rational resampling factor
+  // factor_numerator / factor_denominator. A factor of 2 / 1 indicates that
+  // the signal is being downsampled by a factor of 2.
+  bool Init(int num_channels, const ResamplingKernel& kernel,
+            int factor_numerator, int factor_denominator);
+
+  // Clear the state of the resampler.
+  void Reset();
+
+  // Resample a block of frames, where input has num_channels() rows and one
+  // column per frame. output is resized to num_channels() x
+  // ComputeOutputSize(input.cols()), so this does not allocate if output
+  // already has that size. In-place processing is not supported.
+  void ProcessBlock(const Eigen::Ref<const Eigen::ArrayXXf>& input,
+                    Eigen::ArrayXXf* output);
+
+  // Process enough zeros that all previous input is fully processed, then
+  // Reset(). Allocates.
+  void Flush(Eigen::ArrayXXf* output);
+
+  // Returns the number of output frames that the next call to ProcessBlock()
+  // produces for input_size input frames.
+  int ComputeOutputSize(int input_size) const;
+
+  int num_channels() const { return num_channels_; }
+  int factor_numerator() const { return factor_numerator_; }
+  int factor_denominator() const { return factor_denominator_; }
+  int radius() const { return radius_; }
+
+ private:
+  void InitInternal(int num_channels, const ResamplingKernel& kernel,
+                    int factor_numerator, int factor_denominator);
+
+  int num_channels_;
+  int factor_numerator_;
+  int factor_denominator_;
+  int factor_floor_;
+  int radius_;
+  int phase_step_;
+  int num_taps_;
+  // Shared with other resamplers using the same kernel and denominator. Column
+  // p, the filter for phase p, multiplies a (channels x taps) block of frames.
+  std::shared_ptr<const PolyphaseFilters<float>> filters_;
+
+  // Input frames, with the window of the next output frame starting at column
+  // 0. Between calls, fewer than num_taps_ columns are buffered. The remaining
+  // columns leave room to append input in chunks, so the buffer is never
+  // reallocated.
+  Eigen::ArrayXXf buffer_;
+  int num_buffered_;
+  // Number of upcoming input frames to discard, when downsampling steps past
+  // the end of the buffered input.
+  int num_to_skip_;
+  int phase_;
+};
+
+}  // namespace audio_dsp
+
+#endif  // AUDIO_DSP_MULTICHANNEL_RESAMPLER_RATIONAL_FACTOR_H_
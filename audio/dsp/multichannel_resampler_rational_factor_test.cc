@@ -0,0 +1,202 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/multichannel_resampler_rational_factor.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "audio/dsp/heap_allocation_counter.h"
+#include "audio/dsp/resampler_rational_factor.h"
+#include "audio/dsp/testing_util.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_format.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+namespace {
+
+using ::Eigen::ArrayXf;
+using ::Eigen::ArrayXXf;
+
+// Resamples each row of input with its own RationalFactorResampler<float>.
+ArrayXXf ResampleEachChannel(const ResamplingKernel& kernel,
+                             const ArrayXXf& input) {
+  std::vector<ArrayXf> rows;
+  for (int channel = 0; channel < input.rows(); ++channel) {
+    RationalFactorResampler<float> resampler(kernel);
+    ArrayXf row;
+    resampler.ProcessSamplesEigen(input.row(channel).transpose(), &row);
+    ArrayXf flushed;
+    resampler.FlushEigen(&flushed);
+    rows.push_back(ArrayXf(row.size() + flushed.size()));
+    rows.back() << row, flushed;
+  }
+  ArrayXXf output(input.rows(), rows[0].size());
+  for (int channel = 0; channel < input.rows(); ++channel) {
+    output.row(channel) = rows[channel].transpose();
+  }
+  return output;
+}
+
+TEST(MultichannelRationalFactorResamplerTest, MatchesSingleChannelResamplers) {
+  constexpr int kNumChannels = 3;
+  constexpr int kNumFrames = 2000;
+  const ArrayXXf input = ArrayXXf::Random(kNumChannels, kNumFrames);
+  std::mt19937 rng(0 /* seed */);
+  for (double input_sample_rate : {8000, 16000, 44100, 48000}) {
+    for (double output_sample_rate : {8000, 16000, 44100, 48000}) {
+      SCOPED_TRACE(absl::StrFormat("Resampling from %gHz to %gHz",
+                                   input_sample_rate, output_sample_rate));
+      DefaultResamplingKernel kernel(input_sample_rate, output_sample_rate);
+      const ArrayXXf expected = ResampleEachChannel(kernel, input);
+
+      MultichannelRationalFactorResampler resampler;
+      ASSERT_TRUE(resampler.Init(kNumChannels, kernel));
+      RationalFactorResampler<float> single_channel(kernel);
+      EXPECT_EQ(resampler.num_channels(), kNumChannels);
+      EXPECT_EQ(resampler.factor_numerator(),
+                single_channel.factor_numerator());
+      EXPECT_EQ(resampler.factor_denominator(),
+                single_channel.factor_denominator());
+      EXPECT_EQ(resampler.radius(), single_channel.radius());
+
+      ArrayXXf output(kNumChannels, expected.cols());
+      int num_output_frames = 0;
+      ArrayXXf block_output;
+      for (int start = 0; start < kNumFrames;) {
+        std::uniform_int_distribution<int> block_size_distribution(
+            0, std::min(300, kNumFrames - start));
+        const int block_size = block_size_distribution(rng);
+        const int expected_size = resampler.ComputeOutputSize(block_size);
+        resampler.ProcessBlock(input.middleCols(start, block_size),
+                               &block_output);
+        ASSERT_EQ(block_output.cols(), expected_size);
+        output.middleCols(num_output_frames, block_output.cols()) =
+            block_output;
+        num_output_frames += block_output.cols();
+        start += block_size;
+      }
+      resampler.Flush(&block_output);
+      ASSERT_EQ(num_output_frames + block_output.cols(), expected.cols());
+      output.rightCols(block_output.cols()) = block_output;
+      EXPECT_THAT(output, EigenArrayNear(expected, 1e-5));
+    }
+  }
+}
+
+// With a short kernel, downsampling steps over whole blocks of input.
+TEST(MultichannelRationalFactorResamplerTest, StepsPastBufferedInput) {
+  constexpr int kNumFrames = 100;
+  const ArrayXXf input = ArrayXXf::Random(2, kNumFrames);
+  // A radius of one input sample for decimation by 7.
+  DefaultResamplingKernel kernel(7, 1, 1.0, 0.45, 6.0);
+  MultichannelRationalFactorResampler resampler;
+  ASSERT_TRUE(resampler.Init(2, kernel, 7, 1));
+  ArrayXXf output(2, 0);
+  ArrayXXf block_output;
+  for (int start = 0; start < kNumFrames; start += 2) {
+    resampler.ProcessBlock(input.middleCols(start, 2), &block_output);
+    output.conservativeResize(2, output.cols() + block_output.cols());
+    output.rightCols(block_output.cols()) = block_output;
+  }
+  // Output frame m is centered on input frame 7 m.
+  ASSERT_EQ(output.cols(), (kNumFrames - 2) / 7 + 1);
+  for (int m = 1; m < output.cols(); ++m) {
+    const ArrayXf expected = kernel.Eval(1) * input.col(7 * m - 1) +
+        kernel.Eval(0) * input.col(7 * m) +
+        kernel.Eval(-1) * input.col(7 * m + 1);
+    EXPECT_THAT(output.col(m), EigenArrayNear(expected, 1e-6));
+  }
+}
+
+TEST(MultichannelRationalFactorResamplerTest, DoesNotAllocate) {
+  constexpr int kNumChannels = 4;
+  DefaultResamplingKernel kernel(44100, 16000);
+  MultichannelRationalFactorResampler resampler;
+  ASSERT_TRUE(resampler.Init(kNumChannels, kernel));
+  for (int block_size : {441, 1, 0, 1000, 50, 441}) {
+    SCOPED_TRACE("block_size: " + testing::PrintToString(block_size));
+    const ArrayXXf input = ArrayXXf::Random(kNumChannels, block_size);
+    ArrayXXf output(kNumChannels, resampler.ComputeOutputSize(block_size));
+    {
+      ScopedHeapAllocationCounter counter;
+      resampler.ProcessBlock(input, &output);
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+  }
+}
+
+TEST(MultichannelRationalFactorResamplerTest, InvalidParameters) {
+  DefaultResamplingKernel kernel(44100, 16000);
+  MultichannelRationalFactorResampler resampler;
+  EXPECT_FALSE(resampler.Init(0, kernel));
+  EXPECT_FALSE(resampler.Init(2, kernel, 0, 1));
+  EXPECT_FALSE(resampler.Init(2, DefaultResamplingKernel(44100, -1)));
+  EXPECT_EQ(resampler.num_channels(), 0);
+}
+
+// Downsamples 32 channels from 48kHz to 16kHz in 10ms blocks.
+constexpr int kBenchmarkChannels = 32;
+constexpr int kBenchmarkBlockSize = 480;
+
+void BM_MultichannelRationalFactorResampler(benchmark::State& state) {
+  srand(0 /* seed */);
+  const ArrayXXf input = ArrayXXf::Random(kBenchmarkChannels,
+                                          kBenchmarkBlockSize);
+  DefaultResamplingKernel kernel(48000, 16000);
+  MultichannelRationalFactorResampler resampler;
+  resampler.Init(kBenchmarkChannels, kernel);
+  ArrayXXf output;
+  while (state.KeepRunning()) {
+    resampler.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK(BM_MultichannelRationalFactorResampler);
+
+void BM_RationalFactorResamplerPerChannel(benchmark::State& state) {
+  srand(0 /* seed */);
+  const ArrayXXf input = ArrayXXf::Random(kBenchmarkChannels,
+                                          kBenchmarkBlockSize);
+  DefaultResamplingKernel kernel(48000, 16000);
+  std::vector<RationalFactorResampler<float>> resamplers(
+      kBenchmarkChannels, RationalFactorResampler<float>(kernel));
+  ArrayXXf output;
+  while (state.KeepRunning()) {
+    // All resamplers have the same state, so they produce the same number of
+    // samples.
+    output.resize(kBenchmarkChannels,
+                  resamplers[0].ComputeOutputSize(kBenchmarkBlockSize));
+    for (int channel = 0; channel < kBenchmarkChannels; ++channel) {
+      auto output_row = output.row(channel);
+      resamplers[channel].ProcessSamplesEigen(input.row(channel).matrix(),
+                                              &output_row);
+    }
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK(BM_RationalFactorResamplerPerChannel);
+
+}  // namespace
+}  // namespace audio_dsp
@@ -0,0 +1,187 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/multistage_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "audio/dsp/number_util.h"
+
+namespace audio_dsp {
+
+namespace {
+
+// Returns the stopband attenuation in dB of a Kaiser window with parameter
+// beta, inverting Kaiser's empirical formulas for beta.
+double KaiserAttenuation(double kaiser_beta) {
+  if (kaiser_beta > 4.5513) {  // Attenuation > 50 dB.
+    return kaiser_beta / 0.1102 + 8.7;
+  }
+  // For 21 < A <= 50, beta = 0.5842 (A - 21)^0.4 + 0.07886 (A - 21), which is
+  // increasing in A. Solve by bisection.
+  double low = 21.0;
+  double high = 50.0;
+  for (int i = 0; i < 50; ++i) {
+    const double mid = 0.5 * (low + high);
+    const double beta = 0.5842 * std::pow(mid - 21.0, 0.4) +
+        0.07886 * (mid - 21.0);
+    (beta < kaiser_beta ? low : high) = mid;
+  }
+  return 0.5 * (low + high);
+}
+
+// Returns the quantity B such that a Kaiser-windowed sinc kernel of the given
+// radius in input samples has a transition band of B * input_sample_rate /
+// radius Hz [see the table in resampler_rational_factor.h]. From Kaiser's
+// formula for the filter order, 2 radius = (A - 7.95) / (14.36 width / rate).
+double KaiserTransitionFactor(double kaiser_beta) {
+  return (KaiserAttenuation(kaiser_beta) - 7.95) / 28.72;
+}
+
+class PlanSearch {
+ public:
+  PlanSearch(double input_sample_rate, double radius, double cutoff,
+             double kaiser_beta)
+      : input_sample_rate_(input_sample_rate),
+        radius_(radius),
+        cutoff_(cutoff),
+        kaiser_beta_(kaiser_beta),
+        transition_factor_(KaiserTransitionFactor(kaiser_beta)) {
+    const double transition_width =
+        transition_factor_ * input_sample_rate / radius;
+    passband_edge_ = std::max(0.0, cutoff - 0.5 * transition_width);
+    stopband_edge_ = cutoff + 0.5 * transition_width;
+    best_.cost = std::numeric_limits<double>::infinity();
+  }
+
+  // Searches the chains of at most max_stages stages whose factors multiply
+  // to factor_numerator / factor_denominator.
+  ResamplingPlan Search(int factor_numerator, int factor_denominator,
+                        int max_stages) {
+    SearchFrom(input_sample_rate_, factor_numerator, factor_denominator,
+               max_stages, 0.0);
+    return best_;
+  }
+
+ private:
+  // Extends stages_, which ends at sample rate rate and costs cost, with
+  // stages for the remaining factor numerator / denominator.
+  void SearchFrom(double rate, int numerator, int denominator, int stages_left,
+                  double cost) {
+    ResamplingStage stage;
+    if (MakeStage(rate, numerator, denominator, true, &stage) &&
+        cost + stage.cost < best_.cost) {
+      stages_.push_back(stage);
+      best_.stages = stages_;
+      best_.cost = cost + stage.cost;
+      stages_.pop_back();
+    }
+    if (stages_left <= 1) {
+      return;
+    }
+    for (int a = 1; a <= numerator; ++a) {
+      if (numerator % a != 0) { continue; }
+      for (int b = 1; b <= denominator; ++b) {
+        if (denominator % b != 0 || a == b ||
+            (a == numerator && b == denominator)) {
+          continue;
+        }
+        if (MakeStage(rate, a, b, false, &stage) &&
+            cost + stage.cost < best_.cost) {
+          stages_.push_back(stage);
+          SearchFrom(stage.output_sample_rate, numerator / a, denominator / b,
+                     stages_left - 1, cost + stage.cost);
+          stages_.pop_back();
+        }
+      }
+    }
+  }
+
+  // Designs a stage resampling from rate by the factor numerator /
+  // denominator. Returns false if no stage meets the specification.
+  bool MakeStage(double rate, int numerator, int denominator, bool is_final,
+                 ResamplingStage* stage) const {
+    stage->factor_numerator = numerator;
+    stage->factor_denominator = denominator;
+    stage->input_sample_rate = rate;
+    stage->output_sample_rate = rate * denominator / numerator;
+    stage->kaiser_beta = kaiser_beta_;
+    if (is_final) {
+      // The final stage uses the specified kernel, scaled to its input rate.
+      if (cutoff_ > 0.5 * rate) {
+        return false;
+      }
+      stage->cutoff = cutoff_;
+      stage->radius = radius_ * rate / input_sample_rate_;
+    } else {
+      // Earlier stages keep the passband and only need to attenuate what
+      // would alias or image into [0, stopband_edge_) at the lower of their
+      // rates. The later stages remove the rest.
+      const double lower_rate = std::min(rate, stage->output_sample_rate);
+      const double stop = lower_rate - stopband_edge_;
+      if (stop <= passband_edge_) {
+        return false;
+      }
+      stage->cutoff = 0.5 * (passband_edge_ + stop);
+      stage->radius = transition_factor_ * rate / (stop - passband_edge_);
+    }
+    stage->cost = (2 * std::ceil(stage->radius) + 1) *
+        stage->output_sample_rate / input_sample_rate_;
+    return true;
+  }
+
+  const double input_sample_rate_;
+  const double radius_;
+  const double cutoff_;
+  const double kaiser_beta_;
+  const double transition_factor_;
+  double passband_edge_;
+  double stopband_edge_;
+
+  std::vector<ResamplingStage> stages_;
+  ResamplingPlan best_;
+};
+
+}  // namespace
+
+ResamplingPlan PlanResampling(double input_sample_rate,
+                              double output_sample_rate, double radius,
+                              double cutoff, double kaiser_beta,
+                              int max_denominator, int max_stages) {
+  if (input_sample_rate <= 0.0 || output_sample_rate <= 0.0 ||
+      radius <= 0.0 || cutoff <= 0.0 || cutoff > 0.5 * input_sample_rate ||
+      kaiser_beta <= 0.0 || max_denominator <= 0 || max_stages <= 0) {
+    return {{}, 0.0};
+  }
+  const std::pair<int, int> factor = RationalApproximation(
+      input_sample_rate / output_sample_rate, max_denominator);
+  return PlanSearch(input_sample_rate, radius, cutoff, kaiser_beta)
+      .Search(factor.first, factor.second, max_stages);
+}
+
+ResamplingPlan PlanResampling(double input_sample_rate,
+                              double output_sample_rate) {
+  // The parameters of DefaultResamplingKernel.
+  const double radius = input_sample_rate <= output_sample_rate
+      ? 5.0 : 5.0 * (input_sample_rate / output_sample_rate);
+  const double cutoff = 0.45 * std::min(input_sample_rate, output_sample_rate);
+  return PlanResampling(input_sample_rate, output_sample_rate, radius, cutoff,
+                        6.0);
+}
+
+}  // namespace audio_dsp
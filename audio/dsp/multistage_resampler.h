@@ -0,0 +1,283 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Resampling as a cascade of rational factor stages.
+//
+// A single RationalFactorResampler stage needs a kernel whose transition band
+// is narrow relative to the higher of the two rates. For large conversion
+// factors like 192kHz -> 16kHz with a sharp filter, that kernel is long.
+// Splitting the conversion into stages, e.g. 192kHz -> 48kHz -> 16kHz, lets the
+// early stages use short kernels with wide transition bands, since they only
+// need to keep aliases out of the band that the final stage passes, and the
+// final stage runs its long kernel at a lower rate.
+//
+// PlanResampling() searches the factorizations of the rational resampling
+// factor for the chain of stages with the fewest multiply-adds per input
+// sample that meets the same specification as a single
+// DefaultResamplingKernel. MultistageResampler runs a plan.
+//
+// Example use:
+//   MultistageResampler<float> resampler(
+//       PlanResampling(192000, 16000, 17 * 12, 7200, 7.865));
+//   std::vector<float> output;
+//   resampler.ProcessSamples(input, &output);
+
+#ifndef AUDIO_DSP_MULTISTAGE_RESAMPLER_H_
+#define AUDIO_DSP_MULTISTAGE_RESAMPLER_H_
+
+#include <algorithm>
+#include <vector>
+
+#include "audio/dsp/resampler.h"
+#include "audio/dsp/resampler_rational_factor.h"
+#include "glog/logging.h"
+#include "absl/types/span.h"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+
+// One stage of a ResamplingPlan: a RationalFactorResampler by the factor
+// factor_numerator / factor_denominator with a DefaultResamplingKernel of the
+// given parameters.
+struct ResamplingStage {
+  int factor_numerator;
+  int factor_denominator;
+  double input_sample_rate;
+  double output_sample_rate;
+  double radius;
+  double cutoff;
+  double kaiser_beta;
+  // Multiply-adds per sample of the plan's input.
+  double cost;
+};
+
+struct ResamplingPlan {
+  // Empty if the parameters are invalid.
+  std::vector<ResamplingStage> stages;
+  // Total multiply-adds per input sample.
+  double cost;
+};
+
+// Plans resampling from input_sample_rate to output_sample_rate that meets the
+// specification of DefaultResamplingKernel(input_sample_rate,
+// output_sample_rate, radius, cutoff, kaiser_beta): the passband and stopband
+// edges are those of that kernel, and each stage attenuates by at least
+// kaiser_beta's stopband attenuation anything that would alias into the band
+// below the stopband edge. The resampling factor is approximated as in
+// RationalFactorResampler with max_denominator, and is split into at most
+// max_stages stages. The single-stage plan is always a candidate, so the plan
+// is never more expensive than one RationalFactorResampler.
+//
+// The cost model counts 2 * ceil(radius) + 1 multiply-adds per output sample
+// of each stage, as computed by RationalFactorResampler with an exact table.
+ResamplingPlan PlanResampling(double input_sample_rate,
+                              double output_sample_rate, double radius,
+                              double cutoff, double kaiser_beta,
+                              int max_denominator = 1000, int max_stages = 3);
+
+// As above, with the parameters of DefaultResamplingKernel(input_sample_rate,
+// output_sample_rate).
+ResamplingPlan PlanResampling(double input_sample_rate,
+                              double output_sample_rate);
+
+// Resampler running the stages of a ResamplingPlan in sequence. ValueType may
+// be float, double, complex<float>, or complex<double>. As with
+// RationalFactorResampler, the output is not delayed: output sample m is
+// centered at time m / output_sample_rate. The span versions of
+// ProcessSamples() and Flush() do not allocate after Prepare().
+template <typename ValueType>
+class MultistageResampler: public Resampler<ValueType> {
+ public:
+  explicit MultistageResampler(const ResamplingPlan& plan): plan_(plan) {
+    for (const ResamplingStage& stage : plan_.stages) {
+      stages_.emplace_back(
+          DefaultResamplingKernel(stage.input_sample_rate,
+                                  stage.output_sample_rate, stage.radius,
+                                  stage.cutoff, stage.kaiser_beta),
+          stage.factor_numerator, stage.factor_denominator);
+    }
+    if (!stages_.empty()) {
+      intermediate_.resize(stages_.size() - 1);
+    }
+  }
+
+  MultistageResampler(double input_sample_rate, double output_sample_rate)
+      : MultistageResampler(
+            PlanResampling(input_sample_rate, output_sample_rate)) {}
+
+  ~MultistageResampler() override {}
+
+  const ResamplingPlan& plan() const { return plan_; }
+  int num_stages() const { return stages_.size(); }
+
+  // Returns the number of output samples that the next call to
+  // ProcessSamples() produces for input_size input samples.
+  int ComputeOutputSize(int input_size) const {
+    for (const RationalFactorResampler<ValueType>& stage : stages_) {
+      input_size = stage.ComputeOutputSize(input_size);
+    }
+    return input_size;
+  }
+
+  // Returns an upper bound of ComputeOutputSize(input_size) over all states.
+  int MaxOutputSize(int input_size) const {
+    for (const RationalFactorResampler<ValueType>& stage : stages_) {
+      input_size = stage.MaxOutputSize(input_size);
+    }
+    return input_size;
+  }
+
+  // Returns the number of output samples that Flush() produces.
+  int ComputeFlushSize() const {
+    // Each stage flushes by processing 2 * radius() zeros after the output of
+    // the stages before it.
+    int size = 0;
+    for (const RationalFactorResampler<ValueType>& stage : stages_) {
+      size = stage.ComputeOutputSize(size + 2 * stage.radius());
+    }
+    return size;
+  }
+
+  // Allocates the buffers between the stages for blocks of up to
+  // max_block_size_samples input samples and for Flush(). After this, the span
+  // versions of ProcessSamples() and Flush() do not allocate for such blocks,
+  // so they are safe to call from a realtime thread. Without this, the buffers
+  // grow as needed.
+  void Prepare(int max_block_size_samples) {
+    DCHECK(this->Valid());
+    DCHECK_GE(max_block_size_samples, 0);
+    int max_process_size = max_block_size_samples;
+    int max_flush_size = 0;
+    for (int i = 0; i + 1 < stages_.size(); ++i) {
+      max_process_size = stages_[i].MaxOutputSize(max_process_size);
+      max_flush_size = stages_[i].MaxOutputSize(max_flush_size +
+                                                2 * stages_[i].radius());
+      intermediate_[i].resize(std::max(max_process_size, max_flush_size));
+    }
+  }
+
+  // Versions of ProcessSamples() and Flush() that write to caller-owned
+  // output, which must have at least ComputeOutputSize(input.size()) or
+  // ComputeFlushSize() samples, and return the number of samples written.
+  using Resampler<ValueType>::ProcessSamples;
+  int ProcessSamples(absl::Span<const ValueType> input,
+                     absl::Span<ValueType> output) {
+    DCHECK(this->Valid());
+    absl::Span<const ValueType> stage_input = input;
+    for (int i = 0; i + 1 < stages_.size(); ++i) {
+      if (stage_input.empty()) {
+        return 0;  // The later stages have no new input either.
+      }
+      absl::Span<ValueType> stage_output = IntermediateBuffer(
+          i, stages_[i].ComputeOutputSize(stage_input.size()));
+      stages_[i].ProcessSamples(stage_input, stage_output);
+      stage_input = stage_output;
+    }
+    return stages_.back().ProcessSamples(stage_input, output);
+  }
+
+  using Resampler<ValueType>::Flush;
+  int Flush(absl::Span<ValueType> output) {
+    DCHECK(this->Valid());
+    DCHECK_LE(ComputeFlushSize(), output.size());
+    // As in FlushImpl(), each stage's remaining output passes through the later
+    // stages before they are flushed.
+    absl::Span<const ValueType> pending;
+    for (int i = 0; i < stages_.size(); ++i) {
+      RationalFactorResampler<ValueType>& stage = stages_[i];
+      absl::Span<ValueType> stage_output =
+          (i + 1 == stages_.size()) ?
+          output :
+          IntermediateBuffer(
+              i, stage.ComputeOutputSize(pending.size() + 2 * stage.radius()));
+      int stage_output_size = 0;
+      if (!pending.empty()) {
+        stage_output_size = stage.ProcessSamples(pending, stage_output);
+      }
+      stage_output_size +=
+          stage.Flush(stage_output.subspan(stage_output_size));
+      pending = stage_output.first(stage_output_size);
+    }
+    this->Reset();
+    return pending.size();
+  }
+
+  void ResetImpl() override {
+    for (RationalFactorResampler<ValueType>& stage : stages_) {
+      stage.Reset();
+    }
+  }
+
+  bool ValidImpl() const override {
+    if (stages_.empty()) {
+      return false;
+    }
+    for (const RationalFactorResampler<ValueType>& stage : stages_) {
+      if (!stage.Valid()) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  void ProcessSamplesImpl(const std::vector<ValueType>& input,
+                          std::vector<ValueType>* output) override {
+    const std::vector<ValueType>* stage_input = &input;
+    for (int i = 0; i < stages_.size(); ++i) {
+      std::vector<ValueType>* stage_output =
+          (i + 1 == stages_.size()) ? output : &intermediate_[i];
+      stages_[i].ProcessSamples(*stage_input, stage_output);
+      stage_input = stage_output;
+    }
+  }
+
+  void FlushImpl(std::vector<ValueType>* output) override {
+    // Flush each stage in order, passing its remaining output through the
+    // later stages before they are flushed.
+    std::vector<ValueType> pending;
+    std::vector<ValueType> processed;
+    std::vector<ValueType> flushed;
+    for (int i = 0; i < stages_.size(); ++i) {
+      stages_[i].ProcessSamples(pending, &processed);
+      stages_[i].Flush(&flushed);
+      processed.insert(processed.end(), flushed.begin(), flushed.end());
+      pending.swap(processed);
+    }
+    output->swap(pending);
+  }
+
+ private:
+  // Returns the first size samples of intermediate_[stage], growing it if
+  // needed.
+  absl::Span<ValueType> IntermediateBuffer(int stage, int size) {
+    std::vector<ValueType>& buffer = intermediate_[stage];
+    if (buffer.size() < size) {
+      buffer.resize(size);
+    }
+    return absl::MakeSpan(buffer).first(size);
+  }
+
+  ResamplingPlan plan_;
+  std::vector<RationalFactorResampler<ValueType>> stages_;
+  // Output of stage i for i < num_stages() - 1.
+  std::vector<std::vector<ValueType>> intermediate_;
+};
+
+}  // namespace audio_dsp
+
+#endif  // AUDIO_DSP_MULTISTAGE_RESAMPLER_H_
@@ -0,0 +1,271 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/multistage_resampler.h"
+
+#include <algorithm>
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "audio/dsp/heap_allocation_counter.h"
+#include "audio/dsp/resampler_rational_factor.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "absl/strings/str_format.h"
+#include "absl/types/span.h"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+namespace {
+
+// High quality conversion from 192kHz to 16kHz: a radius of 17 output samples
+// and -80 dB stopband.
+constexpr double kHighRate = 192000;
+constexpr double kLowRate = 16000;
+constexpr double kRadius = 17 * 12;
+constexpr double kCutoff = 0.45 * kLowRate;
+constexpr double kKaiserBeta = 7.865;
+
+std::vector<float> Sine(double frequency, double sample_rate, int num_samples) {
+  std::vector<float> samples(num_samples);
+  for (int n = 0; n < num_samples; ++n) {
+    samples[n] = std::sin(2 * M_PI * frequency * n / sample_rate);
+  }
+  return samples;
+}
+
+// For small factors, a single stage is cheapest.
+TEST(MultistageResamplerTest, SingleStageMatchesRationalFactorResampler) {
+  for (const auto& rates : std::vector<std::pair<double, double>>{
+           {44100, 48000}, {48000, 44100}, {16000, 48000}, {48000, 32000}}) {
+    SCOPED_TRACE(absl::StrFormat("Resampling from %gHz to %gHz", rates.first,
+                                 rates.second));
+    const ResamplingPlan plan = PlanResampling(rates.first, rates.second);
+    ASSERT_EQ(plan.stages.size(), 1);
+    MultistageResampler<float> resampler(plan);
+    ASSERT_TRUE(resampler.Valid());
+    RationalFactorResampler<float> expected_resampler(rates.first,
+                                                      rates.second);
+    EXPECT_EQ(plan.stages[0].factor_numerator,
+              expected_resampler.factor_numerator());
+    EXPECT_EQ(plan.stages[0].factor_denominator,
+              expected_resampler.factor_denominator());
+    EXPECT_DOUBLE_EQ(plan.cost, (2 * expected_resampler.radius() + 1) *
+                     rates.second / rates.first);
+
+    const std::vector<float> input = Sine(1000, rates.first, 1000);
+    std::vector<float> output;
+    std::vector<float> expected;
+    resampler.ProcessSamples(input, &output);
+    expected_resampler.ProcessSamples(input, &expected);
+    ASSERT_EQ(output.size(), expected.size());
+    for (int i = 0; i < output.size(); ++i) {
+      EXPECT_FLOAT_EQ(output[i], expected[i]);
+    }
+  }
+}
+
+TEST(MultistageResamplerTest, PlansCheaperCascade) {
+  const ResamplingPlan single_stage_plan =
+      PlanResampling(kHighRate, kLowRate, kRadius, kCutoff, kKaiserBeta,
+                     1000, 1);
+  ASSERT_EQ(single_stage_plan.stages.size(), 1);
+  const ResamplingPlan plan =
+      PlanResampling(kHighRate, kLowRate, kRadius, kCutoff, kKaiserBeta);
+  ASSERT_GT(plan.stages.size(), 1);
+  EXPECT_LT(plan.cost, 0.6 * single_stage_plan.cost);
+
+  double rate = kHighRate;
+  double cost = 0.0;
+  for (const ResamplingStage& stage : plan.stages) {
+    EXPECT_DOUBLE_EQ(stage.input_sample_rate, rate);
+    EXPECT_DOUBLE_EQ(stage.output_sample_rate, rate *
+                     stage.factor_denominator / stage.factor_numerator);
+    EXPECT_LE(stage.cutoff, 0.5 * std::min(stage.input_sample_rate,
+                                           stage.output_sample_rate));
+    rate = stage.output_sample_rate;
+    cost += stage.cost;
+  }
+  EXPECT_DOUBLE_EQ(rate, kLowRate);
+  EXPECT_DOUBLE_EQ(cost, plan.cost);
+  // The last stage runs the specified kernel at its input rate.
+  const ResamplingStage& last = plan.stages.back();
+  EXPECT_DOUBLE_EQ(last.cutoff, kCutoff);
+  EXPECT_DOUBLE_EQ(last.radius, kRadius * last.input_sample_rate / kHighRate);
+}
+
+// The cascade passes the passband and attenuates aliases like a single stage.
+TEST(MultistageResamplerTest, MeetsSpecification) {
+  MultistageResampler<float> resampler(
+      PlanResampling(kHighRate, kLowRate, kRadius, kCutoff, kKaiserBeta));
+  ASSERT_TRUE(resampler.Valid());
+  constexpr int kNumSamples = 48000;
+  constexpr int kSettleSamples = 100;
+  // In the passband, the output is the resampled sine.
+  std::vector<float> output;
+  resampler.ProcessSamples(Sine(1000, kHighRate, kNumSamples), &output);
+  ASSERT_GT(output.size(), 3900);
+  const std::vector<float> expected = Sine(1000, kLowRate, output.size());
+  for (int i = kSettleSamples; i < output.size(); ++i) {
+    EXPECT_NEAR(output[i], expected[i], 1e-3);
+  }
+
+  // Tones that alias to the passband at any of the rates of the cascade are
+  // attenuated.
+  for (double frequency : {14000, 30000, 46000, 90000}) {
+    SCOPED_TRACE(absl::StrFormat("frequency: %gHz", frequency));
+    resampler.Reset();
+    resampler.ProcessSamples(Sine(frequency, kHighRate, kNumSamples), &output);
+    float max_abs = 0.0f;
+    for (int i = kSettleSamples; i < output.size(); ++i) {
+      max_abs = std::max(max_abs, std::abs(output[i]));
+    }
+    EXPECT_LT(max_abs, 3e-4);  // -70 dB.
+  }
+}
+
+TEST(MultistageResamplerTest, StreamingRandomBlockSizes) {
+  std::mt19937 rng(0 /* seed */);
+  std::uniform_real_distribution<float> distribution(-1.0f, 1.0f);
+  constexpr int kNumSamples = 5000;
+  std::vector<float> input(kNumSamples);
+  for (float& sample : input) {
+    sample = distribution(rng);
+  }
+  MultistageResampler<float> resampler(
+      PlanResampling(kHighRate, kLowRate, kRadius, kCutoff, kKaiserBeta));
+  ASSERT_GT(resampler.num_stages(), 1);
+  std::vector<float> expected;
+  resampler.ProcessSamples(input, &expected);
+  std::vector<float> flushed;
+  resampler.Flush(&flushed);
+  expected.insert(expected.end(), flushed.begin(), flushed.end());
+  // Flushing produces at least the output samples centered on the input.
+  EXPECT_GE(expected.size(), (kNumSamples - 1) / 12 + 1);
+
+  std::vector<float> output;
+  std::vector<float> block_output;
+  for (int start = 0; start < kNumSamples;) {
+    std::uniform_int_distribution<int> block_size_distribution(
+        0, std::min(500, kNumSamples - start));
+    const int block_size = block_size_distribution(rng);
+    resampler.ProcessSamples(std::vector<float>(
+        input.begin() + start, input.begin() + start + block_size),
+        &block_output);
+    output.insert(output.end(), block_output.begin(), block_output.end());
+    start += block_size;
+  }
+  resampler.Flush(&block_output);
+  output.insert(output.end(), block_output.begin(), block_output.end());
+  ASSERT_EQ(output.size(), expected.size());
+  for (int i = 0; i < output.size(); ++i) {
+    EXPECT_NEAR(output[i], expected[i], 1e-6);
+  }
+}
+
+TEST(MultistageResamplerTest, SpanApi) {
+  constexpr int kBlockSize = 1920;
+  const ResamplingPlan plan =
+      PlanResampling(kHighRate, kLowRate, kRadius, kCutoff, kKaiserBeta);
+  MultistageResampler<float> resampler(plan);
+  MultistageResampler<float> expected_resampler(plan);
+  const std::vector<float> input = Sine(1000, kHighRate, kBlockSize);
+  std::vector<float> output(resampler.MaxOutputSize(kBlockSize));
+  std::vector<float> expected;
+  for (int i = 0; i < 3; ++i) {
+    expected_resampler.ProcessSamples(input, &expected);
+    ASSERT_EQ(resampler.ComputeOutputSize(kBlockSize), expected.size());
+    ASSERT_EQ(resampler.ProcessSamples(input, absl::MakeSpan(output)),
+              expected.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), output.begin()));
+  }
+}
+
+TEST(MultistageResamplerTest, SpanFlush) {
+  const ResamplingPlan plan =
+      PlanResampling(kHighRate, kLowRate, kRadius, kCutoff, kKaiserBeta);
+  MultistageResampler<float> resampler(plan);
+  MultistageResampler<float> expected_resampler(plan);
+  ASSERT_GT(resampler.num_stages(), 1);
+  std::vector<float> output(resampler.MaxOutputSize(1000) + 1000);
+  std::vector<float> expected;
+  for (int input_size : {0, 1, 37, 1000}) {
+    SCOPED_TRACE("input_size: " + testing::PrintToString(input_size));
+    const std::vector<float> input = Sine(1000, kHighRate, input_size);
+    expected_resampler.ProcessSamples(input, &expected);
+    resampler.ProcessSamples(input, absl::MakeSpan(output));
+    expected_resampler.Flush(&expected);
+    ASSERT_EQ(resampler.ComputeFlushSize(), expected.size());
+    ASSERT_EQ(resampler.Flush(absl::MakeSpan(output)), expected.size());
+    EXPECT_TRUE(std::equal(expected.begin(), expected.end(), output.begin()));
+  }
+}
+
+TEST(MultistageResamplerTest, PreparedDoesNotAllocate) {
+  constexpr int kMaxBlockSize = 480;
+  MultistageResampler<float> resampler(
+      PlanResampling(kHighRate, kLowRate, kRadius, kCutoff, kKaiserBeta));
+  ASSERT_GT(resampler.num_stages(), 1);
+  resampler.Prepare(kMaxBlockSize);
+  const std::vector<float> input = Sine(1000, kHighRate, kMaxBlockSize);
+  // Resampling by 1/12 makes much fewer output samples than input samples.
+  std::vector<float> output(kMaxBlockSize);
+  for (int num_samples : {kMaxBlockSize, 1, 0, 37, kMaxBlockSize}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    ScopedHeapAllocationCounter counter;
+    resampler.ProcessSamples(
+        absl::MakeConstSpan(input.data(), num_samples),
+        absl::MakeSpan(output));
+    EXPECT_EQ(counter.num_allocations(), 0);
+  }
+  ASSERT_LE(resampler.ComputeFlushSize(), output.size());
+  ScopedHeapAllocationCounter counter;
+  resampler.Flush(absl::MakeSpan(output));
+  EXPECT_EQ(counter.num_allocations(), 0);
+}
+
+TEST(MultistageResamplerTest, InvalidParameters) {
+  EXPECT_TRUE(PlanResampling(-1, 16000).stages.empty());
+  EXPECT_TRUE(PlanResampling(16000, 0).stages.empty());
+  // Cutoff above the input Nyquist rate.
+  EXPECT_TRUE(PlanResampling(16000, 48000, 5, 9000, 6.0).stages.empty());
+  EXPECT_TRUE(PlanResampling(16000, 48000, 5, 7200, 6.0, 1000, 0)
+              .stages.empty());
+  MultistageResampler<float> resampler(16000, -1);
+  EXPECT_FALSE(resampler.Valid());
+}
+
+// Compares the planned cascade to a single stage for high quality conversion
+// from 192kHz to 16kHz in 10ms blocks.
+void BM_MultistageResampler(benchmark::State& state) {
+  const int max_stages = state.range(0);
+  const std::vector<float> input = Sine(1000, kHighRate, 1920);
+  MultistageResampler<float> resampler(PlanResampling(
+      kHighRate, kLowRate, kRadius, kCutoff, kKaiserBeta, 1000, max_stages));
+  std::vector<float> output;
+  while (state.KeepRunning()) {
+    resampler.ProcessSamples(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(input.size() * state.iterations());
+}
+BENCHMARK(BM_MultistageResampler)->Arg(1)->Arg(3);
+
+}  // namespace
+}  // namespace audio_dsp
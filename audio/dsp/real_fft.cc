@@ -0,0 +1,151 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/real_fft.h"
+
+#include <cmath>
+
+#include "audio/dsp/number_util.h"
+#include "glog/logging.h"
+
+namespace audio_dsp {
+
+using ::std::complex;
+
+namespace {
+
+// std::complex multiplication checks for infinities and NaNs unless compiled
+// with -ffast-math, which makes it several times slower than this.
+inline complex<float> Multiply(const complex<float>& a,
+                               const complex<float>& b) {
+  return complex<float>(a.real() * b.real() - a.imag() * b.imag(),
+                        a.real() * b.imag() + a.imag() * b.real());
+}
+
+inline complex<float> MultiplyByConj(const complex<float>& a,
+                                     const complex<float>& b) {
+  return complex<float>(a.real() * b.real() + a.imag() * b.imag(),
+                        a.imag() * b.real() - a.real() * b.imag());
+}
+
+}  // namespace
+
+void RealFft::Init(int fft_size) {
+  CHECK_GE(fft_size, 2);
+  CHECK(IsPowerOfTwoOrZero(fft_size))
+      << "fft_size must be a power of two, got " << fft_size;
+  fft_size_ = fft_size;
+  const int half_size = fft_size_ / 2;
+
+  complex_twiddles_.resize(half_size / 2);
+  for (int k = 0; k < complex_twiddles_.size(); ++k) {
+    complex_twiddles_[k] = std::polar(1.0, -2 * M_PI * k / half_size);
+  }
+  split_twiddles_.resize(half_size + 1);
+  for (int k = 0; k <= half_size; ++k) {
+    split_twiddles_[k] = std::polar(1.0, -2 * M_PI * k / fft_size_);
+  }
+
+  const int num_bits = Log2Floor(half_size);
+  bit_reverse_.resize(half_size);
+  for (int k = 0; k < half_size; ++k) {
+    int reversed = 0;
+    for (int bit = 0; bit < num_bits; ++bit) {
+      reversed |= ((k >> bit) & 1) << (num_bits - 1 - bit);
+    }
+    bit_reverse_[k] = reversed;
+  }
+  work_.resize(half_size);
+}
+
+void RealFft::ComplexTransform(bool inverse) {
+  const int size = work_.size();
+  for (int span = 1; span < size; span *= 2) {
+    const int twiddle_stride = size / (2 * span);
+    for (int start = 0; start < size; start += 2 * span) {
+      complex<float>* first = work_.data() + start;
+      complex<float>* second = first + span;
+      for (int j = 0; j < span; ++j) {
+        const complex<float>& twiddle = complex_twiddles_[j * twiddle_stride];
+        const complex<float> product = inverse ?
+            MultiplyByConj(second[j], twiddle) : Multiply(second[j], twiddle);
+        second[j] = first[j] - product;
+        first[j] += product;
+      }
+    }
+  }
+}
+
+void RealFft::ForwardTransform(const Eigen::Ref<const Eigen::ArrayXf>& input,
+                               Eigen::Ref<Eigen::ArrayXcf> spectrum) {
+  DCHECK_GT(fft_size_, 0) << "You must call Init() first!";
+  DCHECK_EQ(input.size(), fft_size_);
+  DCHECK_EQ(spectrum.size(), num_bins());
+  const int half_size = work_.size();
+  // Pack even samples as the real parts and odd samples as the imaginary parts.
+  for (int k = 0; k < half_size; ++k) {
+    work_[bit_reverse_[k]] = complex<float>(input[2 * k], input[2 * k + 1]);
+  }
+  ComplexTransform(false);
+
+  // Separate the spectra of the even and odd samples,
+  //   even[k] = (work[k] + conj(work[half_size - k])) / 2,
+  //   odd[k] = (work[k] - conj(work[half_size - k])) / 2i,
+  // and combine them with a final radix-2 butterfly. The DC and Nyquist bins
+  // are real.
+  spectrum[0] = work_[0].real() + work_[0].imag();
+  spectrum[half_size] = work_[0].real() - work_[0].imag();
+  for (int k = 1; k < half_size; ++k) {
+    const complex<float> current = work_[k];
+    const complex<float> mirror = std::conj(work_[half_size - k]);
+    const complex<float> even = 0.5f * (current + mirror);
+    const complex<float> difference = current - mirror;
+    const complex<float> odd(0.5f * difference.imag(),
+                             -0.5f * difference.real());
+    spectrum[k] = even + Multiply(split_twiddles_[k], odd);
+  }
+}
+
+void RealFft::InverseTransform(
+    const Eigen::Ref<const Eigen::ArrayXcf>& spectrum,
+    Eigen::Ref<Eigen::ArrayXf> output) {
+  DCHECK_GT(fft_size_, 0) << "You must call Init() first!";
+  DCHECK_EQ(spectrum.size(), num_bins());
+  DCHECK_EQ(output.size(), fft_size_);
+  const int half_size = work_.size();
+  // Recover twice the spectra of the even and odd samples and pack them as
+  // work = even + i odd, undoing the split step of ForwardTransform().
+  const float dc = spectrum[0].real();
+  const float nyquist = spectrum[half_size].real();
+  work_[0] = complex<float>(dc + nyquist, dc - nyquist);
+  for (int k = 1; k < half_size; ++k) {
+    const complex<float> current = spectrum[k];
+    const complex<float> mirror = std::conj(spectrum[half_size - k]);
+    const complex<float> even = current + mirror;
+    const complex<float> odd =
+        MultiplyByConj(current - mirror, split_twiddles_[k]);
+    work_[bit_reverse_[k]] = complex<float>(even.real() - odd.imag(),
+                                            even.imag() + odd.real());
+  }
+  ComplexTransform(true);
+
+  for (int k = 0; k < half_size; ++k) {
+    output[2 * k] = work_[k].real();
+    output[2 * k + 1] = work_[k].imag();
+  }
+}
+
+}  // namespace audio_dsp
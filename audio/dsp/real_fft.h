@@ -0,0 +1,89 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Fast Fourier transform of real-valued signals with power-of-two size.
+//
+// The N-point real transform is computed with an N/2-point complex radix-2
+// FFT on the even and odd samples packed as real and imaginary parts, followed
+// by a split step that separates their spectra. Twiddle factors and the
+// bit-reversal permutation are precomputed by Init(), and the transforms do not
+// allocate, so they may be called on a realtime thread.
+//
+// Example:
+//   RealFft fft;
+//   fft.Init(1024);
+//   Eigen::ArrayXcf spectrum(fft.num_bins());
+//   fft.ForwardTransform(signal, &spectrum);
+//   fft.InverseTransform(spectrum, &signal);  // signal is now 1024 * signal.
+
+#ifndef AUDIO_DSP_REAL_FFT_H_
+#define AUDIO_DSP_REAL_FFT_H_
+
+#include <complex>
+#include <vector>
+
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+
+class RealFft {
+ public:
+  RealFft(): fft_size_(0 /* uninitialized */) {}
+
+  // fft_size must be a power of two and at least 2.
+  void Init(int fft_size);
+
+  int fft_size() const { return fft_size_; }
+  // Number of nonredundant frequency bins, fft_size / 2 + 1. Bin k corresponds
+  // to frequency k / fft_size in cycles per sample.
+  int num_bins() const { return fft_size_ / 2 + 1; }
+
+  // Computes spectrum[k] = sum_n input[n] exp(-2 pi i k n / fft_size) for
+  // k = 0, ..., fft_size / 2. input must have fft_size elements and spectrum
+  // num_bins() elements. The imaginary parts of the DC and Nyquist bins are
+  // zero.
+  void ForwardTransform(const Eigen::Ref<const Eigen::ArrayXf>& input,
+                        Eigen::Ref<Eigen::ArrayXcf> spectrum);
+
+  // Unnormalized inverse of ForwardTransform(), so that the forward transform
+  // followed by the inverse scales the signal by fft_size. The imaginary parts
+  // of the DC and Nyquist bins are ignored.
+  void InverseTransform(const Eigen::Ref<const Eigen::ArrayXcf>& spectrum,
+                        Eigen::Ref<Eigen::ArrayXf> output);
+
+ private:
+  // In-place complex FFT of size fft_size_ / 2 on work_, which must be in
+  // bit-reversed order. The inverse transform uses conjugated twiddles.
+  void ComplexTransform(bool inverse);
+
+  int fft_size_;
+  // exp(-2 pi i k / (fft_size / 2)) for k < fft_size / 4, used by the
+  // complex FFT.
+  std::vector<std::complex<float>> complex_twiddles_;
+  // exp(-2 pi i k / fft_size) for k <= fft_size / 2, used by the split step.
+  std::vector<std::complex<float>> split_twiddles_;
+  // bit_reverse_[k] is the index of work_ that element k of the packed input
+  // is written to.
+  std::vector<int> bit_reverse_;
+  std::vector<std::complex<float>> work_;
+};
+
+}  // namespace audio_dsp
+
+#endif  // AUDIO_DSP_REAL_FFT_H_
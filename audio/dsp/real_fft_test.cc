@@ -0,0 +1,145 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/dsp/real_fft.h"
+
+#include <cmath>
+#include <complex>
+
+#include "audio/dsp/heap_allocation_counter.h"
+#include "audio/dsp/testing_util.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace audio_dsp {
+namespace {
+
+using ::Eigen::ArrayXcd;
+using ::Eigen::ArrayXcf;
+using ::Eigen::ArrayXf;
+using ::std::complex;
+
+// Direct evaluation of the DFT in double precision.
+ArrayXcd NaiveDft(const ArrayXf& input) {
+  const int size = input.size();
+  ArrayXcd spectrum(size / 2 + 1);
+  for (int k = 0; k < spectrum.size(); ++k) {
+    complex<double> sum = 0.0;
+    for (int n = 0; n < size; ++n) {
+      sum += static_cast<double>(input[n]) *
+          std::polar(1.0, -2 * M_PI * ((k * n) % size) / size);
+    }
+    spectrum[k] = sum;
+  }
+  return spectrum;
+}
+
+class RealFftTest : public ::testing::TestWithParam<int> {};
+
+TEST_P(RealFftTest, MatchesNaiveDft) {
+  const int fft_size = GetParam();
+  RealFft fft;
+  fft.Init(fft_size);
+  EXPECT_EQ(fft.fft_size(), fft_size);
+  EXPECT_EQ(fft.num_bins(), fft_size / 2 + 1);
+
+  srand(0 /* seed */);
+  const ArrayXf input = ArrayXf::Random(fft_size);
+  ArrayXcf spectrum(fft.num_bins());
+  fft.ForwardTransform(input, spectrum);
+
+  const ArrayXcf expected = NaiveDft(input).cast<complex<float>>();
+  EXPECT_THAT(spectrum, EigenArrayNear(expected, 2e-6 * fft_size));
+  EXPECT_EQ(spectrum[0].imag(), 0.0f);
+  EXPECT_EQ(spectrum[fft_size / 2].imag(), 0.0f);
+}
+
+TEST_P(RealFftTest, InverseTransform) {
+  const int fft_size = GetParam();
+  RealFft fft;
+  fft.Init(fft_size);
+
+  srand(0 /* seed */);
+  const ArrayXf input = ArrayXf::Random(fft_size);
+  ArrayXcf spectrum(fft.num_bins());
+  fft.ForwardTransform(input, spectrum);
+  // The imaginary parts of the DC and Nyquist bins are ignored.
+  spectrum[0] += complex<float>(0.0f, 3.0f);
+  spectrum[fft_size / 2] += complex<float>(0.0f, -5.0f);
+  ArrayXf output(fft_size);
+  fft.InverseTransform(spectrum, output);
+
+  EXPECT_THAT(output / fft_size, EigenArrayNear(input, 1e-6));
+}
+
+TEST_P(RealFftTest, Impulse) {
+  const int fft_size = GetParam();
+  RealFft fft;
+  fft.Init(fft_size);
+
+  ArrayXf input = ArrayXf::Zero(fft_size);
+  input[1] = 1.0f;
+  ArrayXcf spectrum(fft.num_bins());
+  fft.ForwardTransform(input, spectrum);
+
+  ArrayXcf expected(fft.num_bins());
+  for (int k = 0; k < expected.size(); ++k) {
+    expected[k] = std::polar(1.0, -2 * M_PI * k / fft_size);
+  }
+  EXPECT_THAT(spectrum, EigenArrayNear(expected, 1e-6));
+}
+
+TEST_P(RealFftTest, DoesNotAllocate) {
+  const int fft_size = GetParam();
+  RealFft fft;
+  fft.Init(fft_size);
+  const ArrayXf input = ArrayXf::Random(fft_size);
+  ArrayXcf spectrum(fft.num_bins());
+  ArrayXf output(fft_size);
+  {
+    ScopedHeapAllocationCounter counter;
+    fft.ForwardTransform(input, spectrum);
+    fft.InverseTransform(spectrum, output);
+    EXPECT_EQ(counter.num_allocations(), 0);
+  }
+}
+
+INSTANTIATE_TEST_SUITE_P(FftSizes, RealFftTest,
+                         ::testing::Values(2, 4, 8, 16, 64, 512, 2048));
+
+void BM_RealFftRoundTrip(benchmark::State& state) {
+  const int fft_size = state.range(0);
+  RealFft fft;
+  fft.Init(fft_size);
+  srand(0 /* seed */);
+  ArrayXf signal = ArrayXf::Random(fft_size);
+  ArrayXcf spectrum(fft.num_bins());
+  while (state.KeepRunning()) {
+    fft.ForwardTransform(signal, spectrum);
+    fft.InverseTransform(spectrum, signal);
+    signal *= 1.0f / fft_size;
+    benchmark::DoNotOptimize(signal);
+  }
+  state.SetItemsProcessed(fft_size * state.iterations());
+}
+BENCHMARK(BM_RealFftRoundTrip)->Range(64, 8192);
+
+}  // namespace
+}  // namespace audio_dsp
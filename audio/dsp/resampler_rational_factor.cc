@@ -19,6 +19,11 @@
 #include <algorithm>
 #include <cfloat>
 #include <cmath>
+#include <map>
+#include <mutex>  // NOLINT
+#include <tuple>
+#include <typeindex>
+#include <typeinfo>
 
 #include "audio/dsp/bessel_functions.h"
 
@@ -78,6 +83,14 @@ void DefaultResamplingKernel::Init(double cutoff, double kaiser_beta) {
   valid_ = true;
 }
 
+bool DefaultResamplingKernel::GetParameters(
+    std::vector<double>* parameters) const {
+  parameters->insert(parameters->end(),
+                     {input_sample_rate(), output_sample_rate(), radius(),
+                      normalization_, radians_per_sample_, kaiser_beta_});
+  return true;
+}
+
 double DefaultResamplingKernel::Eval(double x) const {
   return normalization_ * Sinc(radians_per_sample_ * x) * KaiserWindow(x);
 }
@@ -97,4 +110,149 @@ double DefaultResamplingKernel::KaiserWindow(double x) const {
   }
 }
 
+namespace {
+
+// Builds the filters for phases first_phase to first_phase + num_phases - 1
+// of denominator. Phases outside [0, denominator) are offsets by more than an
+// input sample.
+template <typename CoefficientType>
+PolyphaseFilters<CoefficientType>* BuildPolyphaseFilters(
+    const ResamplingKernel& kernel, int denominator, int first_phase,
+    int num_phases) {
+  const int radius = std::ceil(kernel.radius());
+  auto* filters =
+      new PolyphaseFilters<CoefficientType>(2 * radius + 1, num_phases);
+  for (int i = 0; i < num_phases; ++i) {
+    const double offset = static_cast<double>(first_phase + i) / denominator;
+    for (int k = -radius; k <= radius; ++k) {
+      (*filters)(radius - k, i) =
+          static_cast<CoefficientType>(kernel.Eval(offset + k));
+    }
+  }
+  return filters;
+}
+
+// Process-wide cache of the polyphase filter tables that are in use. The cache
+// holds weak references, and a table is removed when its last user releases
+// it.
+class PolyphaseFilterCache {
+ public:
+  static PolyphaseFilterCache* Get() {
+    static PolyphaseFilterCache* cache = new PolyphaseFilterCache;
+    return cache;
+  }
+
+  template <typename CoefficientType>
+  std::shared_ptr<const PolyphaseFilters<CoefficientType>> GetFilters(
+      const ResamplingKernel& kernel, int denominator, int first_phase,
+      int num_phases) {
+    Key key{typeid(kernel), {}, denominator, first_phase, num_phases,
+            typeid(CoefficientType)};
+    if (!kernel.GetParameters(&key.kernel_parameters)) {
+      return std::shared_ptr<const PolyphaseFilters<CoefficientType>>(
+          BuildPolyphaseFilters<CoefficientType>(kernel, denominator,
+                                                 first_phase, num_phases));
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto it = tables_.find(key);
+    if (it != tables_.end()) {
+      std::shared_ptr<const void> table = it->second.lock();
+      if (table != nullptr) {
+        ++stats_.hits;
+        return std::static_pointer_cast<
+            const PolyphaseFilters<CoefficientType>>(table);
+      }
+    }
+    ++stats_.misses;
+    // The table is built while holding the lock so that concurrent callers do
+    // not build duplicates.
+    const PolyphaseFilters<CoefficientType>* filters =
+        BuildPolyphaseFilters<CoefficientType>(kernel, denominator,
+                                               first_phase, num_phases);
+    const int64 bytes = filters->size() * sizeof(CoefficientType);
+    std::shared_ptr<const PolyphaseFilters<CoefficientType>> table(
+        filters, [this, key, bytes](
+                     const PolyphaseFilters<CoefficientType>* filters) {
+          delete filters;
+          Release(key, bytes);
+        });
+    tables_[key] = table;
+    ++stats_.num_tables;
+    stats_.bytes += bytes;
+    return table;
+  }
+
+  PolyphaseFilterCacheStats GetStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+  }
+
+ private:
+  struct Key {
+    std::type_index kernel_type;
+    std::vector<double> kernel_parameters;
+    int denominator;
+    int first_phase;
+    int num_phases;
+    std::type_index coefficient_type;
+
+    bool operator<(const Key& other) const {
+      return std::tie(kernel_type, kernel_parameters, denominator, first_phase,
+                      num_phases, coefficient_type) <
+             std::tie(other.kernel_type, other.kernel_parameters,
+                      other.denominator, other.first_phase, other.num_phases,
+                      other.coefficient_type);
+    }
+  };
+
+  PolyphaseFilterCache() : stats_{0, 0, 0, 0} {}
+
+  void Release(const Key& key, int64 bytes) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    // The entry may already have been replaced by a new table for the same
+    // key.
+    auto it = tables_.find(key);
+    if (it != tables_.end() && it->second.expired()) {
+      tables_.erase(it);
+    }
+    --stats_.num_tables;
+    stats_.bytes -= bytes;
+  }
+
+  std::mutex mutex_;
+  std::map<Key, std::weak_ptr<const void>> tables_;
+  PolyphaseFilterCacheStats stats_;
+};
+
+}  // namespace
+
+template <typename CoefficientType>
+std::shared_ptr<const PolyphaseFilters<CoefficientType>> GetPolyphaseFilters(
+    const ResamplingKernel& kernel, int factor_denominator) {
+  CHECK_GT(factor_denominator, 0);
+  return PolyphaseFilterCache::Get()->GetFilters<CoefficientType>(
+      kernel, factor_denominator, 0, factor_denominator);
+}
+
+template <typename CoefficientType>
+std::shared_ptr<const PolyphaseFilters<CoefficientType>> GetOversampledFilters(
+    const ResamplingKernel& kernel, int oversampling) {
+  CHECK_GT(oversampling, 0);
+  return PolyphaseFilterCache::Get()->GetFilters<CoefficientType>(
+      kernel, oversampling, -1, oversampling + 3);
+}
+
+template std::shared_ptr<const PolyphaseFilters<float>>
+GetPolyphaseFilters<float>(const ResamplingKernel&, int);
+template std::shared_ptr<const PolyphaseFilters<double>>
+GetPolyphaseFilters<double>(const ResamplingKernel&, int);
+template std::shared_ptr<const PolyphaseFilters<float>>
+GetOversampledFilters<float>(const ResamplingKernel&, int);
+template std::shared_ptr<const PolyphaseFilters<double>>
+GetOversampledFilters<double>(const ResamplingKernel&, int);
+
+PolyphaseFilterCacheStats GetPolyphaseFilterCacheStats() {
+  return PolyphaseFilterCache::Get()->GetStats();
+}
+
 }  // namespace audio_dsp
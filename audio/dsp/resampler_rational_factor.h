@@ -24,10 +24,15 @@
 #ifndef AUDIO_DSP_RESAMPLER_RATIONAL_FACTOR_H_
 #define AUDIO_DSP_RESAMPLER_RATIONAL_FACTOR_H_
 
+#include <algorithm>
+#include <memory>
+#include <vector>
+
 #include "audio/dsp/number_util.h"
 #include "audio/dsp/resampler.h"
 #include "audio/dsp/types.h"
 #include "glog/logging.h"
+#include "absl/types/span.h"
 #include "third_party/eigen3/Eigen/Core"
 
 #include "audio/dsp/porting.h"  // auto-added.
@@ -50,6 +55,15 @@ class ResamplingKernel {
   // Return whether the ResamplingKernel was initialized with valid parameters.
   virtual bool Valid() const = 0;
 
+  // Appends the parameters that, together with the kernel's class, determine
+  // Eval() to parameters and returns true. Filter tables are shared between
+  // resamplers whose kernels have the same class and parameters [see
+  // GetPolyphaseFilters()]. The default returns false, so tables for the
+  // kernel are not shared.
+  virtual bool GetParameters(std::vector<double>* parameters) const {
+    return false;
+  }
+
   double input_sample_rate() const { return input_sample_rate_; }
 
   double output_sample_rate() const { return output_sample_rate_; }
@@ -121,6 +135,8 @@ class DefaultResamplingKernel: public ResamplingKernel {
     return valid_;
   }
 
+  bool GetParameters(std::vector<double>* parameters) const override;
+
  private:
   // Initialize from constructor parameters.
   void Init(double cutoff, double kaiser_beta);
@@ -138,6 +154,85 @@ class DefaultResamplingKernel: public ResamplingKernel {
   double kaiser_denominator_;
 };
 
+// A polyphase filter table for resampling with a rational factor a/b. Column p
+// is the filter for phase p of b, stored backwards so that convolution becomes
+// a dot product [see RationalFactorResampler below].
+template <typename CoefficientType>
+using PolyphaseFilters =
+    Eigen::Matrix<CoefficientType, Eigen::Dynamic, Eigen::Dynamic>;
+
+// Returns the polyphase filter table of factor_denominator filters of
+// 2 * ceil(kernel.radius()) + 1 taps for kernel. The tables are immutable and
+// shared: while a table is in use, calls with a kernel of the same class and
+// parameters [see ResamplingKernel::GetParameters()] and the same
+// factor_denominator return the same table. Thread safe. CoefficientType may be
+// float or double.
+template <typename CoefficientType>
+std::shared_ptr<const PolyphaseFilters<CoefficientType>> GetPolyphaseFilters(
+    const ResamplingKernel& kernel, int factor_denominator);
+
+// Returns a table of the filters for phases i / oversampling, i = -1, 0, ...,
+// oversampling + 1, in columns 0 to oversampling + 2, from which filters for
+// other phases can be interpolated. Shared like the tables of
+// GetPolyphaseFilters().
+template <typename CoefficientType>
+std::shared_ptr<const PolyphaseFilters<CoefficientType>> GetOversampledFilters(
+    const ResamplingKernel& kernel, int oversampling);
+
+struct PolyphaseFilterCacheStats {
+  // Number of calls that returned a table in use.
+  int64 hits;
+  // Number of calls that built a shared table.
+  int64 misses;
+  // Number and total size of the shared tables that are in use.
+  int64 num_tables;
+  int64 bytes;
+};
+
+PolyphaseFilterCacheStats GetPolyphaseFilterCacheStats();
+
+// How RationalFactorResampler stores its filters.
+enum class PolyphaseTableMode {
+  // A table of the exact filter for each of the factor_denominator phases.
+  kExact,
+  // A table of the kernel oversampled by kLinearInterpolationOversampling,
+  // from which the filter for each phase is linearly interpolated on the fly.
+  // Costs twice the multiply-adds of kExact.
+  kLinearInterpolation,
+  // As above, oversampled by kCubicInterpolationOversampling with cubic
+  // Lagrange interpolation. Costs four times the multiply-adds of kExact.
+  kCubicInterpolation,
+};
+
+// With these oversampling factors, the interpolated DefaultResamplingKernel is
+// within about -85 dB of its peak, except near the ends of its support, where
+// the Kaiser window is discontinuous and the error is up to about -60 dB.
+// Summed over the taps, the output differs from that of kExact by less than
+// 3e-3 (about -50 dB) for input in [-1, 1]. This is above the -63 dB stopband
+// of the default kernel, so use kExact where that matters.
+constexpr int kLinearInterpolationOversampling = 128;
+constexpr int kCubicInterpolationOversampling = 16;
+
+// Computes the weights that interpolate the filter for phase
+// (index + a) / oversampling, where 0 <= a < 1, from a table returned by
+// GetOversampledFilters(). For kLinearInterpolation, weights[0] and weights[1]
+// apply to columns index + 1 and index + 2. For kCubicInterpolation,
+// weights[0] to weights[3] apply to columns index to index + 3.
+template <typename CoefficientType>
+void ComputeInterpolationWeights(PolyphaseTableMode table_mode, double a,
+                                 CoefficientType* weights) {
+  if (table_mode == PolyphaseTableMode::kLinearInterpolation) {
+    weights[0] = 1.0 - a;
+    weights[1] = a;
+  } else {
+    DCHECK(table_mode == PolyphaseTableMode::kCubicInterpolation);
+    weights[0] = -a * (a - 1.0) * (a - 2.0) / 6.0;
+    weights[1] = (a + 1.0) * (a - 1.0) * (a - 2.0) / 2.0;
+    weights[2] = -(a + 1.0) * a * (a - 2.0) / 2.0;
+    weights[3] = (a + 1.0) * a * (a - 1.0) / 6.0;
+  }
+}
+
 // Resampler for rational resampling factors. ValueType may be float, double,
 // complex<float>, or complex<double>.
 //
@@ -168,6 +263,11 @@ class DefaultResamplingKernel: public ResamplingKernel {
 // The filter is nonzero for k from ceil(-p/b - r) to floor(-p/b + r). Supposing
 // that r is a positive integer, and since 0 <= p < b, the range is contained by
 // -r <= k <= r.
+//
+// The table of the b filters h_p costs b (2 r + 1) coefficients, which for
+// awkward factors like 147/160 or larger denominators no longer fits in cache.
+// The interpolated PolyphaseTableMode modes instead store a table whose size
+// does not depend on b, at the cost of more arithmetic per output sample.
 template <typename ValueType>
 class RationalFactorResampler: public Resampler<ValueType> {
  public:
@@ -185,22 +285,25 @@ class RationalFactorResampler: public Resampler<ValueType> {
   // faster or slower than the specified output sample rate. For example,
   // downsampling (input_sample_rate > output_sample_rate) with max_denominator
   // = 500 guarantees error no greater than 0.1% of the input sample rate.
-  RationalFactorResampler(const ResamplingKernel& kernel,
-                          int max_denominator = 1000) {
+  RationalFactorResampler(
+      const ResamplingKernel& kernel, int max_denominator = 1000,
+      PolyphaseTableMode table_mode = PolyphaseTableMode::kExact) {
     // Skip initialization on invalid parameters.
     if (!kernel.Valid() || max_denominator <= 0) {
       return;
     }
     Init(kernel, RationalApproximation(
         kernel.input_sample_rate() / kernel.output_sample_rate(),
-        max_denominator));
+        max_denominator), table_mode);
   }
 
   // Construct a RationalFactorResampler where the rational resampling factor is
   // specified directly by factor_numerator / factor_denominator. A factor of
   // 2 / 1 indicates that the signal is being downsampled by a factor of 2.
-  RationalFactorResampler(const ResamplingKernel& kernel,
-                          int factor_numerator, int factor_denominator) {
+  RationalFactorResampler(
+      const ResamplingKernel& kernel, int factor_numerator,
+      int factor_denominator,
+      PolyphaseTableMode table_mode = PolyphaseTableMode::kExact) {
     // Skip initialization on invalid parameters.
     if (!kernel.Valid() || factor_numerator <= 0 || factor_denominator <= 0) {
       return;
@@ -210,35 +313,38 @@ class RationalFactorResampler: public Resampler<ValueType> {
     const int reduced_denominator = factor_denominator / gcd;
 
     // Warn if filters_ will be unusually large.
-    if (reduced_denominator > 1000) {
+    if (table_mode == PolyphaseTableMode::kExact &&
+        reduced_denominator > 1000) {
       LOG(WARNING) << "Resampling factor "
           << factor_numerator << "/" << factor_denominator
           << " = " << reduced_numerator << "/" << reduced_denominator
           << " is not a ratio of small integers, so a large table of "
           << reduced_denominator << " filters is needed.";
     }
-    Init(kernel, {reduced_numerator, reduced_denominator});
+    Init(kernel, {reduced_numerator, reduced_denominator}, table_mode);
   }
 
   // Construct a RationalFactorResampler where the rational resampling factor is
   // specified directly by factor_numerator / factor_denominator. A factor of
   // 2 / 1 indicates that the signal is being downsampled by a factor of 2.
-  RationalFactorResampler(float input_rate_hz, float output_rate_hz,
-                          int max_denominator = 1000)
+  RationalFactorResampler(
+      float input_rate_hz, float output_rate_hz, int max_denominator = 1000,
+      PolyphaseTableMode table_mode = PolyphaseTableMode::kExact)
       : RationalFactorResampler(
           DefaultResamplingKernel(input_rate_hz, output_rate_hz),
-          max_denominator) {}
+          max_denominator, table_mode) {}
 
   ~RationalFactorResampler() override {}
 
   int factor_denominator() const { return factor_denominator_; }
   int factor_numerator() const { return factor_numerator_; }
   int radius() const { return radius_; }
+  PolyphaseTableMode table_mode() const { return table_mode_; }
 
   void ResetImpl() override {
     phase_ = 0;
-    delayed_input_.reserve(num_taps_);
-    delayed_input_.assign(radius_, ValueType(0));
+    history_.head(radius_).setZero();
+    num_delayed_ = radius_;
   }
 
   bool ValidImpl() const override {
@@ -256,91 +362,71 @@ class RationalFactorResampler: public Resampler<ValueType> {
   }
 
   // These templates allow one dimensional Eigen types to be processed by the
-  // resampler.
+  // resampler. This does not allocate if output already has
+  // ComputeOutputSize(input.size()) samples, so it is realtime safe.
   template <typename EigenType1, typename EigenType2>
   void ProcessSamplesEigen(const EigenType1& input, EigenType2* output) {
     DCHECK(output != nullptr);
-    DCHECK_LT(static_cast<int>(delayed_input_.size()), num_taps_);
-    DCHECK_LT(phase_, static_cast<int>(filters_.size()));
+    DCHECK_LT(num_delayed_, num_taps_);
+    DCHECK_LT(phase_, factor_denominator_);
 
     static_assert(std::is_same<typename EigenType1::Scalar,
                                typename EigenType2::Scalar>::value,
                   "input and output must have the same scalar type");
 
-    if (static_cast<int>(delayed_input_.size() + input.size()) < num_taps_) {
-      // Because this function should support processing on Eigen generator and
-      // expression types, like MatrixXf::Zero(...) that do not have a .data()
-      // member, we cannot use functions like insert(input.data(), ...).
-      for (int sample = 0; sample < input.size(); ++sample) {
-        delayed_input_.push_back(input[sample]);
-      }
-      // Not enough samples available to produce any output yet.
-      return;
-    }
-
-    using EigenVectorType = Eigen::Matrix<ValueType, Eigen::Dynamic, 1>;
-    Eigen::Map<const EigenVectorType> delayed_input_map(
-        delayed_input_.data(), delayed_input_.size());
-    int i_end = static_cast<int>(
-        delayed_input_.size() + input.size() - num_taps_ + 1);
-    // Below, the position in the input is (i + phase_ / factor_denominator) in
-    // units of input samples, with phase_ tracking the fractional part.
-    int i = 0;
-    output->resize(ComputeOutputSizeFromCurrentState(
-        static_cast<int>(input.size())));
+    const int input_size = static_cast<int>(input.size());
+    output->resize(ComputeOutputSizeFromCurrentState(input_size));
     int output_samples = 0;
-
-    // Process samples where the filter straddles delayed_input_ and input.
-    while (i < static_cast<int>(delayed_input_.size()) && i < i_end) {
-      const int num_state = static_cast<int>(delayed_input_map.size() - i);
-      const int num_input = num_taps_ - num_state;
-      const auto& filter = filters_[phase_];
-      DCHECK_LT(output_samples, output->size());
-      (*output)[output_samples] =
-          filter.head(num_state).dot(delayed_input_map.tail(num_state)) +
-          filter.tail(num_input).dot(input.matrix().head(num_input));
-      ++output_samples;
-      i += factor_floor_;
-      phase_ += phase_step_;
-      if (phase_ >= factor_denominator_) {
-        phase_ -= factor_denominator_;
-        ++i;
+    // Below, the position in the input is
+    // (window_start + phase_ / factor_denominator) in units of input samples,
+    // with phase_ tracking the fractional part. The filter window starts in the
+    // delayed input while window_start is negative.
+    int window_start = -num_delayed_;
+
+    if (num_delayed_ > 0) {
+      // Process samples where the filter straddles the delayed input and input.
+      // Appending num_taps_ - 1 input samples to the delayed input makes every
+      // such window contiguous in history_.
+      const int num_appended = std::min(num_taps_ - 1, input_size);
+      history_.segment(num_delayed_, num_appended) =
+          input.matrix().head(num_appended);
+      const int history_size = num_delayed_ + num_appended;
+      while (window_start < 0 &&
+             window_start + num_delayed_ + num_taps_ <= history_size) {
+        DCHECK_LT(output_samples, output->size());
+        (*output)[output_samples] = ApplyFilter(
+            phase_, history_.segment(window_start + num_delayed_, num_taps_));
+        ++output_samples;
+        window_start += Advance(&phase_);
       }
-    }
-
-    if (i < static_cast<int>(delayed_input_.size())) {
-      // Ran out of input samples before consuming everything in
-      // delayed_input_. Discard the samples of delayed_input_ that have been
-      // consumed and append the input.
-      delayed_input_.erase(delayed_input_.begin(), delayed_input_.begin() + i);
-      for (int sample = 0; sample < input.size(); ++sample) {
-        delayed_input_.push_back(input[sample]);
+      if (window_start < 0) {
+        // Ran out of input samples before consuming all the delayed input.
+        // Discard the samples that have been consumed.
+        const int first_needed = window_start + num_delayed_;
+        std::copy(history_.data() + first_needed,
+                  history_.data() + history_size, history_.data());
+        num_delayed_ = history_size - first_needed;
+        return;
       }
-      return;
     }
 
-    // Consumed everything in delayed_input_. Now process output samples that
-    // depend on only the input.
-    i -= delayed_input_map.size();
-    i_end -= delayed_input_map.size();
-    while (i < i_end) {
+    // Now process output samples that depend on only the input. The phase is
+    // kept in a local so that it can stay in a register.
+    int phase = phase_;
+    while (window_start + num_taps_ <= input_size) {
       DCHECK_LT(output_samples, output->size());
       (*output)[output_samples] =
-          filters_[phase_].dot(input.matrix().segment(i, num_taps_));
+          ApplyFilter(phase, input.matrix().segment(window_start, num_taps_));
       ++output_samples;
-      i += factor_floor_;
-      phase_ += phase_step_;
-      if (phase_ >= factor_denominator_) {
-        phase_ -= factor_denominator_;
-        ++i;
-      }
+      window_start += Advance(&phase);
     }
+    phase_ = phase;
 
-    DCHECK_LE(i, static_cast<int>(input.size()));
-    delayed_input_.resize(input.size() - i);
-    for (size_t sample = 0; sample < delayed_input_.size();  ++sample) {
-      delayed_input_[sample] = input[i + sample];
-    }
+    // Save the rest of the input, which is less than a full window.
+    DCHECK_LE(window_start, input_size);
+    num_delayed_ = input_size - window_start;
+    history_.head(num_delayed_) =
+        input.matrix().segment(window_start, num_delayed_);
   }
 
   void FlushImpl(std::vector<ValueType>* output) override {
@@ -362,14 +448,68 @@ class RationalFactorResampler: public Resampler<ValueType> {
     this->Reset();
   }
 
+  // Returns the number of output samples that the next call to
+  // ProcessSamplesEigen() produces for input_size input samples. Callers can
+  // use this to pass an output of the right size, e.g. a segment of a
+  // preallocated buffer, in which case processing does not allocate.
+  int ComputeOutputSize(int input_size) const {
+    return ComputeOutputSizeFromCurrentState(input_size);
+  }
+
+  // Returns an upper bound of ComputeOutputSize(input_size) over all states,
+  // for sizing a buffer once up front.
+  int MaxOutputSize(int input_size) const {
+    if (input_size <= 0) {
+      return 0;
+    }
+    return (static_cast<int64>(input_size) * factor_denominator_ +
+            factor_numerator_ - 1) / factor_numerator_;
+  }
+
+  // Returns the number of output samples that Flush() produces, which is at
+  // most MaxOutputSize(2 * radius()).
+  int ComputeFlushSize() const {
+    return ComputeOutputSizeFromCurrentState(num_taps_ - 1);
+  }
+
+  // Versions of ProcessSamples() and Flush() that write to caller-owned
+  // output, which must have at least ComputeOutputSize(input.size()) or
+  // ComputeFlushSize() samples, and return the number of samples written. This
+  // avoids copying input into a std::vector, and does not allocate.
+  using Resampler<ValueType>::ProcessSamples;
+  int ProcessSamples(absl::Span<const ValueType> input,
+                     absl::Span<ValueType> output) {
+    DCHECK(this->Valid());
+    DCHECK(input.data() != output.data()) << "Cannot resample in place!";
+    const int output_size = ComputeOutputSizeFromCurrentState(input.size());
+    DCHECK_LE(output_size, output.size());
+    using EigenVectorType = Eigen::Matrix<ValueType, Eigen::Dynamic, 1>;
+    Eigen::Map<const EigenVectorType> input_map(input.data(), input.size());
+    Eigen::Map<EigenVectorType> output_map(output.data(), output_size);
+    ProcessSamplesEigen(input_map, &output_map);
+    return output_size;
+  }
+
+  using Resampler<ValueType>::Flush;
+  int Flush(absl::Span<ValueType> output) {
+    DCHECK(this->Valid());
+    const int output_size = ComputeFlushSize();
+    DCHECK_LE(output_size, output.size());
+    Eigen::Map<Eigen::Matrix<ValueType, Eigen::Dynamic, 1>> output_map(
+        output.data(), output_size);
+    FlushEigen(&output_map);
+    return output_size;
+  }
+
   // Accessors for testing.
-  int delayed_input_size() const { return delayed_input_.size(); }
+  int delayed_input_size() const { return num_delayed_; }
   int phase() const { return phase_; }
 
  private:
   typedef typename RealType<ValueType>::Type CoefficientType;
 
-  void Init(const ResamplingKernel& kernel, const std::pair<int, int>& factor) {
+  void Init(const ResamplingKernel& kernel, const std::pair<int, int>& factor,
+            PolyphaseTableMode table_mode) {
     factor_numerator_ = factor.first;
     factor_denominator_ = factor.second;
     factor_floor_ = factor_numerator_ / factor_denominator_;  // Integer divide.
@@ -377,21 +517,78 @@ class RationalFactorResampler: public Resampler<ValueType> {
     phase_step_ = factor_numerator_ % factor_denominator_;
     num_taps_ = 2 * radius_ + 1;
 
-    filters_.resize(factor_denominator_);
-    for (int phase = 0; phase < static_cast<int>(filters_.size()); ++phase) {
-      auto& filter = filters_[phase];
-      filter.resize(num_taps_);
-      const double offset = static_cast<double>(phase) / factor_denominator_;
-      for (int k = -radius_; k <= radius_; ++k) {
-        // Store the filter backwards so that convolution becomes a dot product.
-        filter[radius_ - k] =
-            static_cast<CoefficientType>(kernel.Eval(offset + k));
-      }
+    table_mode_ = table_mode;
+    switch (table_mode_) {
+      case PolyphaseTableMode::kExact:
+        filters_ = GetPolyphaseFilters<CoefficientType>(kernel,
+                                                        factor_denominator_);
+        break;
+      case PolyphaseTableMode::kLinearInterpolation:
+        InitInterpolation(kernel, kLinearInterpolationOversampling, 2);
+        break;
+      case PolyphaseTableMode::kCubicInterpolation:
+        InitInterpolation(kernel, kCubicInterpolationOversampling, 4);
+        break;
     }
+    history_.resize(2 * num_taps_ - 1);
     valid_ = true;
     this->Reset();
   }
 
+  // Computes for each phase p the table columns and weights that interpolate
+  // the filter for phase p from the oversampled table, using the num_points
+  // nearest oversampled phases.
+  void InitInterpolation(const ResamplingKernel& kernel, int oversampling,
+                         int num_points) {
+    filters_ = GetOversampledFilters<CoefficientType>(kernel, oversampling);
+    interpolation_columns_.resize(factor_denominator_);
+    interpolation_weights_.resize(num_points, factor_denominator_);
+    for (int phase = 0; phase < factor_denominator_; ++phase) {
+      // The phase is (index + a) / oversampling with 0 <= a < 1.
+      const int64 scaled_phase = static_cast<int64>(phase) * oversampling;
+      const int index = scaled_phase / factor_denominator_;
+      const double a = static_cast<double>(
+          scaled_phase - static_cast<int64>(index) * factor_denominator_) /
+          factor_denominator_;
+      // Column i + 1 of the table is the filter for phase i / oversampling.
+      interpolation_columns_[phase] = (num_points == 2) ? index + 1 : index;
+      ComputeInterpolationWeights(table_mode_, a,
+                                  interpolation_weights_.col(phase).data());
+    }
+  }
+
+  // Returns the output sample for phase, where window is the num_taps_ input
+  // samples under the filter.
+  template <typename WindowType>
+  ValueType ApplyFilter(int phase, const WindowType& window) const {
+    const PolyphaseFilters<CoefficientType>& filters = *filters_;
+    if (table_mode_ == PolyphaseTableMode::kExact) {
+      return filters.col(phase).dot(window);
+    }
+    const int column = interpolation_columns_[phase];
+    const auto weights = interpolation_weights_.col(phase);
+    if (table_mode_ == PolyphaseTableMode::kLinearInterpolation) {
+      return (weights[0] * filters.col(column) +
+              weights[1] * filters.col(column + 1)).dot(window);
+    } else {
+      return (weights[0] * filters.col(column) +
+              weights[1] * filters.col(column + 1) +
+              weights[2] * filters.col(column + 2) +
+              weights[3] * filters.col(column + 3)).dot(window);
+    }
+  }
+
+  // Advances the position by one output sample and returns the number of
+  // input samples stepped over.
+  int Advance(int* phase) const {
+    *phase += phase_step_;
+    if (*phase >= factor_denominator_) {
+      *phase -= factor_denominator_;
+      return factor_floor_ + 1;
+    }
+    return factor_floor_;
+  }
+
   // Computes the expected number of output samples for a given number of input
   // symbols for the current internal state.
   // Notations:
@@ -422,9 +619,9 @@ class RationalFactorResampler: public Resampler<ValueType> {
   //   o * (ff * fd + ps) >= fd * (a - num_taps + 1) - p,
   // which is
   //   o = ceil((fd * (a - num_taps + 1) - p) / fn).
-  int ComputeOutputSizeFromCurrentState(int input_size) {
+  int ComputeOutputSizeFromCurrentState(int input_size) const {
     const int64 min_consumed_input =
-        delayed_input_.size() + input_size - num_taps_ + 1;
+        static_cast<int64>(num_delayed_) + input_size - num_taps_ + 1;
     if (min_consumed_input <= 0) {
       return 0;
     }
@@ -441,13 +638,24 @@ class RationalFactorResampler: public Resampler<ValueType> {
   int radius_;
   int phase_step_;
   int num_taps_;
-  std::vector<Eigen::Matrix<CoefficientType, 1, Eigen::Dynamic>> filters_;
-
-  // A buffer of recent input samples occurring just before the current stream
-  // position, saved between calls to ProcessSamples(). The size of this buffer
-  // is always less than num_taps_. These samples are needed since they are in
-  // the neighborhood of the resampling filter for the next few output samples.
-  std::vector<ValueType> delayed_input_;
+  PolyphaseTableMode table_mode_;
+  // For kExact, the filter table. Otherwise, the oversampled table, and for
+  // each phase the first of the columns to interpolate and their weights.
+  // The tables are shared with other resamplers using the same kernel.
+  std::shared_ptr<const PolyphaseFilters<CoefficientType>> filters_;
+  std::vector<int> interpolation_columns_;
+  Eigen::Matrix<CoefficientType, Eigen::Dynamic, Eigen::Dynamic>
+      interpolation_weights_;
+
+  // The recent input samples occurring just before the current stream
+  // position, saved between calls to ProcessSamples(), are the first
+  // num_delayed_ samples of history_. num_delayed_ is always less than
+  // num_taps_ between calls. These samples are needed since they are in the
+  // neighborhood of the resampling filter for the next few output samples.
+  // history_ has room for num_taps_ - 1 more samples, so that windows that
+  // straddle the delayed input and the input are contiguous.
+  Eigen::Matrix<ValueType, Eigen::Dynamic, 1> history_;
+  int num_delayed_;
   int phase_;
 };
 
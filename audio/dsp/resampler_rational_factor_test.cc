@@ -21,15 +21,19 @@
 #include <complex>
 #include <limits>
 #include <random>
+#include <thread>  // NOLINT
 #include <type_traits>
 
+#include "audio/dsp/heap_allocation_counter.h"
 #include "audio/dsp/signal_vector_util.h"
 #include "audio/dsp/testing_util.h"
 #include "audio/dsp/types.h"
+#include "benchmark/benchmark.h"
 #include "gmock/gmock.h"
 #include "gtest/gtest.h"
 #include "absl/strings/str_format.h"
 #include "absl/strings/str_join.h"
+#include "absl/types/span.h"
 
 #include "audio/dsp/porting.h"  // auto-added.
 
@@ -254,6 +258,121 @@ TYPED_TEST(ResamplerRationalFactorTypedTest, LinearResamplingKernel) {
   EXPECT_THAT(output, FloatArrayNear(expected, 1e-4));
 }
 
+TEST(ResamplerRationalFactorTest, SharesPolyphaseFilterTables) {
+  const PolyphaseFilterCacheStats before = GetPolyphaseFilterCacheStats();
+  {
+    DefaultResamplingKernel kernel(48000, 44100);
+    RationalFactorResampler<float> resampler1(kernel);
+    ASSERT_EQ(resampler1.factor_denominator(), 147);
+    PolyphaseFilterCacheStats stats = GetPolyphaseFilterCacheStats();
+    EXPECT_EQ(stats.misses, before.misses + 1);
+    EXPECT_EQ(stats.num_tables, before.num_tables + 1);
+    EXPECT_EQ(stats.bytes - before.bytes,
+              (2 * resampler1.radius() + 1) * 147 * sizeof(float));
+
+    // A different kernel object with the same parameters shares the table, as
+    // does a resampler with complex values.
+    RationalFactorResampler<float> resampler2(
+        DefaultResamplingKernel(48000, 44100));
+    RationalFactorResampler<complex<float>> resampler3(kernel);
+    stats = GetPolyphaseFilterCacheStats();
+    EXPECT_EQ(stats.hits, before.hits + 2);
+    EXPECT_EQ(stats.num_tables, before.num_tables + 1);
+
+    // Double coefficients and other kernel parameters need another table.
+    RationalFactorResampler<double> resampler4(kernel);
+    RationalFactorResampler<float> resampler5(
+        DefaultResamplingKernel(48000, 44100, 17, 20000, 6.0));
+    stats = GetPolyphaseFilterCacheStats();
+    EXPECT_EQ(stats.misses, before.misses + 3);
+    EXPECT_EQ(stats.num_tables, before.num_tables + 3);
+
+    // Tables for kernels without parameters are not shared.
+    RationalFactorResampler<float> resampler6(
+        LinearResamplingKernel(48000, 44100));
+    EXPECT_EQ(GetPolyphaseFilterCacheStats().num_tables,
+              before.num_tables + 3);
+  }
+  // The tables are released with the last resampler using them.
+  const PolyphaseFilterCacheStats after = GetPolyphaseFilterCacheStats();
+  EXPECT_EQ(after.num_tables, before.num_tables);
+  EXPECT_EQ(after.bytes, before.bytes);
+}
+
+TEST(ResamplerRationalFactorTest, PolyphaseFilterTablesAreThreadSafe) {
+  constexpr int kNumThreads = 8;
+  const PolyphaseFilterCacheStats before = GetPolyphaseFilterCacheStats();
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumThreads; ++i) {
+    threads.emplace_back([]() {
+      for (int j = 0; j < 100; ++j) {
+        RationalFactorResampler<float> resampler(
+            DefaultResamplingKernel(44100, 16000));
+        ASSERT_TRUE(resampler.Valid());
+      }
+    });
+  }
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+  const PolyphaseFilterCacheStats after = GetPolyphaseFilterCacheStats();
+  EXPECT_EQ(after.hits + after.misses, before.hits + before.misses +
+            100 * kNumThreads);
+  EXPECT_EQ(after.num_tables, before.num_tables);
+}
+
+// Compares the interpolated table modes to the exact table.
+TYPED_TEST(ResamplerRationalFactorTypedTest, InterpolatedTableAccuracy) {
+  typedef TypeParam ValueType;
+  constexpr int kNumSamples = 2000;
+  const std::vector<ValueType> input =
+      GenerateRandomVector<ValueType>(kNumSamples, &this->rng_);
+  for (const auto& rates : std::vector<std::pair<double, double>>{
+           {44100, 48000}, {48000, 44100}, {16000, 44100}, {48000, 44099}}) {
+    SCOPED_TRACE(absl::StrFormat("Resampling from %gHz to %gHz", rates.first,
+                                 rates.second));
+    DefaultResamplingKernel kernel(rates.first, rates.second);
+    RationalFactorResampler<ValueType> exact(kernel);
+    std::vector<ValueType> expected;
+    exact.ProcessSamples(input, &expected);
+    for (auto table_mode : {PolyphaseTableMode::kLinearInterpolation,
+                            PolyphaseTableMode::kCubicInterpolation}) {
+      RationalFactorResampler<ValueType> resampler(kernel, 1000, table_mode);
+      ASSERT_TRUE(resampler.Valid());
+      EXPECT_EQ(resampler.table_mode(), table_mode);
+      EXPECT_EQ(resampler.factor_denominator(), exact.factor_denominator());
+      std::vector<ValueType> output;
+      resampler.ProcessSamples(input, &output);
+      ASSERT_EQ(output.size(), expected.size());
+      double max_error = 0.0;
+      for (int i = 0; i < output.size(); ++i) {
+        max_error = std::max<double>(max_error,
+                                     std::abs(output[i] - expected[i]));
+      }
+      // The input is uniform on [-1, 1]. The error is dominated by the kernel
+      // discontinuity at the edges of its support. This is the bound stated
+      // with kLinearInterpolationOversampling.
+      EXPECT_LT(max_error, 3e-3);
+    }
+  }
+}
+
+TEST(ResamplerRationalFactorTest, InterpolatedTableSize) {
+  DefaultResamplingKernel kernel(48000, 44099);
+  const PolyphaseFilterCacheStats before = GetPolyphaseFilterCacheStats();
+  RationalFactorResampler<float> exact(kernel);
+  const int denominator = exact.factor_denominator();
+  ASSERT_GT(denominator, kCubicInterpolationOversampling + 3);
+  const int num_taps = 2 * exact.radius() + 1;
+  const PolyphaseFilterCacheStats with_exact = GetPolyphaseFilterCacheStats();
+  EXPECT_EQ(with_exact.bytes - before.bytes,
+            num_taps * denominator * sizeof(float));
+  RationalFactorResampler<float> cubic(
+      kernel, 1000, PolyphaseTableMode::kCubicInterpolation);
+  EXPECT_EQ(GetPolyphaseFilterCacheStats().bytes - with_exact.bytes,
+            num_taps * (kCubicInterpolationOversampling + 3) * sizeof(float));
+}
+
 // Resampling a sine wave should produce again a sine wave.
 TYPED_TEST(ResamplerRationalFactorTypedTest, ResampleSineWave) {
   typedef TypeParam ValueType;
@@ -335,6 +454,107 @@ TYPED_TEST(ResamplerRationalFactorTypedTest, StreamingRandomBlockSizes) {
   EXPECT_THAT(streaming, FloatArrayNear(nonstreaming, 1e-6));
 }
 
+// Test that streaming into a preallocated buffer, with output sizes from
+// ComputeOutputSize(), does not allocate.
+TYPED_TEST(ResamplerRationalFactorTypedTest, StreamingDoesNotAllocate) {
+  typedef TypeParam ValueType;
+  using EigenVectorType = Eigen::Matrix<ValueType, Eigen::Dynamic, 1>;
+  constexpr int kNumSamples = 500;
+  constexpr int kMaxBlockSize = 20;
+  constexpr int kFactorNumerator = 44100;
+  constexpr int kFactorDenominator = 12000;
+  DefaultResamplingKernel kernel(kFactorNumerator, kFactorDenominator);
+  RationalFactorResampler<ValueType> resampler(
+      kernel, kFactorNumerator, kFactorDenominator);
+  ASSERT_TRUE(resampler.Valid());
+
+  std::uniform_int_distribution<int> block_size_distribution(0, kMaxBlockSize);
+  std::vector<ValueType> input =
+      GenerateRandomVector<ValueType>(kNumSamples, &this->rng_);
+  std::vector<ValueType> nonstreaming;
+  resampler.ProcessSamples(input, &nonstreaming);
+
+  resampler.Reset();
+  EigenVectorType streaming(nonstreaming.size());
+  int num_output_samples = 0;
+  for (int start = 0; start < input.size();) {
+    const int current_block_size = std::min<int>(
+        block_size_distribution(this->rng_), input.size() - start);
+    Eigen::Map<const EigenVectorType> input_block(
+        input.data() + start, current_block_size);
+    const int output_block_size =
+        resampler.ComputeOutputSize(current_block_size);
+    ASSERT_LE(num_output_samples + output_block_size, streaming.size());
+    auto output_block =
+        streaming.segment(num_output_samples, output_block_size);
+    ScopedHeapAllocationCounter counter;
+    resampler.ProcessSamplesEigen(input_block, &output_block);
+    ASSERT_EQ(counter.num_allocations(), 0);
+    num_output_samples += output_block_size;
+    start += current_block_size;
+  }
+  ASSERT_EQ(num_output_samples, nonstreaming.size());
+  for (int i = 0; i < num_output_samples; ++i) {
+    // EXPECT_NEAR doesn't support complex types.
+    EXPECT_LT(std::abs(streaming[i] - nonstreaming[i]), 1e-6);
+  }
+}
+
+// Streams through the span API into a buffer sized with MaxOutputSize().
+TYPED_TEST(ResamplerRationalFactorTypedTest, SpanApi) {
+  typedef TypeParam ValueType;
+  constexpr int kNumSamples = 500;
+  constexpr int kMaxBlockSize = 20;
+  for (const auto& rates : std::vector<std::pair<int, int>>{
+           {44100, 12000}, {16000, 44100}}) {
+    SCOPED_TRACE(absl::StrFormat("Resampling from %dHz to %dHz", rates.first,
+                                 rates.second));
+    DefaultResamplingKernel kernel(rates.first, rates.second);
+    RationalFactorResampler<ValueType> resampler(kernel);
+    const std::vector<ValueType> input =
+        GenerateRandomVector<ValueType>(kNumSamples, &this->rng_);
+    std::vector<ValueType> expected;
+    resampler.ProcessSamples(input, &expected);
+    std::vector<ValueType> flushed;
+    resampler.Flush(&flushed);
+    expected.insert(expected.end(), flushed.begin(), flushed.end());
+
+    std::vector<ValueType> output(expected.size());
+    std::vector<ValueType> block_output(
+        std::max(resampler.MaxOutputSize(kMaxBlockSize),
+                 resampler.MaxOutputSize(2 * resampler.radius())));
+    std::uniform_int_distribution<int> block_size_distribution(0,
+                                                               kMaxBlockSize);
+    int num_output_samples = 0;
+    for (int start = 0; start < kNumSamples;) {
+      const int block_size = std::min<int>(
+          block_size_distribution(this->rng_), kNumSamples - start);
+      ScopedHeapAllocationCounter counter;
+      const int num_written = resampler.ProcessSamples(
+          absl::MakeConstSpan(input).subspan(start, block_size),
+          absl::MakeSpan(block_output));
+      ASSERT_EQ(counter.num_allocations(), 0);
+      ASSERT_LE(num_written, resampler.MaxOutputSize(block_size));
+      ASSERT_LE(num_output_samples + num_written, output.size());
+      std::copy(block_output.begin(), block_output.begin() + num_written,
+                output.begin() + num_output_samples);
+      num_output_samples += num_written;
+      start += block_size;
+    }
+    const int flush_size = resampler.ComputeFlushSize();
+    ScopedHeapAllocationCounter counter;
+    ASSERT_EQ(resampler.Flush(absl::MakeSpan(block_output)), flush_size);
+    ASSERT_EQ(counter.num_allocations(), 0);
+    ASSERT_EQ(num_output_samples + flush_size, output.size());
+    std::copy(block_output.begin(), block_output.begin() + flush_size,
+              output.begin() + num_output_samples);
+    for (int i = 0; i < output.size(); ++i) {
+      // EXPECT_NEAR doesn't support complex types.
+      EXPECT_LT(std::abs(output[i] - expected[i]), 1e-6);
+    }
+  }
+}
+
 TYPED_TEST(ResamplerRationalFactorTypedTest, WorksWithEigenTypes) {
   typedef TypeParam ValueType;
   constexpr int kNumSamples = 500;
@@ -499,5 +719,98 @@ TYPED_TEST(ResamplerRationalFactorTypedTest,
   resampler.ProcessSamples(input, &output);
 }
 
+// Streams blocks of state.range(0) samples through the resampler. For small
+// blocks, the cost of carrying the delayed input between calls is significant.
+template <int kInputSampleRate, int kOutputSampleRate>
+void BM_RationalFactorResamplerStreaming(benchmark::State& state) {
+  const int block_size = state.range(0);
+  srand(0 /* seed */);
+  const Eigen::VectorXf input = Eigen::VectorXf::Random(block_size);
+  DefaultResamplingKernel kernel(kInputSampleRate, kOutputSampleRate);
+  RationalFactorResampler<float> resampler(kernel);
+  Eigen::VectorXf output;
+  while (state.KeepRunning()) {
+    resampler.ProcessSamplesEigen(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(block_size * state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_RationalFactorResamplerStreaming, 48000, 16000)
+    ->Arg(16)->Arg(480);
+BENCHMARK_TEMPLATE(BM_RationalFactorResamplerStreaming, 44100, 48000)
+    ->Arg(16)->Arg(441);
+BENCHMARK_TEMPLATE(BM_RationalFactorResamplerStreaming, 16000, 48000)
+    ->Arg(16)->Arg(160);
+
+// Compares the std::vector and span APIs for 44.1kHz to 48kHz in blocks of 16
+// samples, where per-call overhead matters.
+constexpr int kApiBenchmarkBlockSize = 16;
+
+void BM_RationalFactorResamplerVectorApi(benchmark::State& state) {
+  srand(0 /* seed */);
+  const Eigen::VectorXf source =
+      Eigen::VectorXf::Random(kApiBenchmarkBlockSize);
+  RationalFactorResampler<float> resampler(DefaultResamplingKernel(44100,
+                                                                   48000));
+  std::vector<float> input;
+  std::vector<float> output;
+  while (state.KeepRunning()) {
+    input.assign(source.data(), source.data() + source.size());
+    resampler.ProcessSamples(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kApiBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK(BM_RationalFactorResamplerVectorApi);
+
+void BM_RationalFactorResamplerSpanApi(benchmark::State& state) {
+  srand(0 /* seed */);
+  const Eigen::VectorXf source =
+      Eigen::VectorXf::Random(kApiBenchmarkBlockSize);
+  RationalFactorResampler<float> resampler(DefaultResamplingKernel(44100,
+                                                                   48000));
+  std::vector<float> output(resampler.MaxOutputSize(kApiBenchmarkBlockSize));
+  while (state.KeepRunning()) {
+    const int num_written = resampler.ProcessSamples(
+        absl::MakeConstSpan(source.data(), source.size()),
+        absl::MakeSpan(output));
+    benchmark::DoNotOptimize(num_written);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kApiBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK(BM_RationalFactorResamplerSpanApi);
+
+// Compares the table modes for resampling 48kHz by the factor
+// 48000 / output_rate. With 44099Hz, the default max_denominator approximates
+// the factor by 283 / 260, whose exact table fits in cache. With 44101Hz, the
+// factor is exact, and its table of 44101 filters does not fit in cache.
+template <PolyphaseTableMode kTableMode>
+void BM_RationalFactorResamplerTableMode(benchmark::State& state) {
+  constexpr int kBlockSize = 480;
+  const int output_rate = state.range(0);
+  srand(0 /* seed */);
+  const Eigen::VectorXf input = Eigen::VectorXf::Random(kBlockSize);
+  DefaultResamplingKernel kernel(48000, output_rate);
+  RationalFactorResampler<float> resampler =
+      output_rate == 44099 ?
+      RationalFactorResampler<float>(kernel, 1000, kTableMode) :
+      RationalFactorResampler<float>(kernel, 48000, output_rate, kTableMode);
+  Eigen::VectorXf output;
+  while (state.KeepRunning()) {
+    resampler.ProcessSamplesEigen(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBlockSize * state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_RationalFactorResamplerTableMode,
+                   PolyphaseTableMode::kExact)->Arg(44099)->Arg(44101);
+BENCHMARK_TEMPLATE(BM_RationalFactorResamplerTableMode,
+                   PolyphaseTableMode::kLinearInterpolation)
+    ->Arg(44099)->Arg(44101);
+BENCHMARK_TEMPLATE(BM_RationalFactorResamplerTableMode,
+                   PolyphaseTableMode::kCubicInterpolation)
+    ->Arg(44099)->Arg(44101);
+
 }  // namespace
 }  // namespace audio_dsp
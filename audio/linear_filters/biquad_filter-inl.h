@@ -17,6 +17,8 @@
 #ifndef AUDIO_LINEAR_FILTERS_BIQUAD_FILTER_INL_H_
 #define AUDIO_LINEAR_FILTERS_BIQUAD_FILTER_INL_H_
 
+#include <algorithm>
+
 #include "audio/linear_filters/biquad_filter.h"
 
 namespace linear_filters {
@@ -31,6 +33,8 @@ void BiquadFilter<_SampleType>::Init(
   }
   CHECK_NE(coeffs.a[0], 0.0) << "Filter coefficient a0 cannot be zero.";
   num_channels_ = num_channels;
+  per_channel_coeffs_ = false;
+  channel_coeffs_.resize(0, 5);
   // Scale the coefficients by 1 / filter_coeff_a[0].
   double scale = 1.0 / coeffs.a[0];
   feedforward0_ = scale * coeffs.b[0];
@@ -41,6 +45,27 @@ void BiquadFilter<_SampleType>::Init(
   Reset();
 }
 
+template <typename _SampleType>
+void BiquadFilter<_SampleType>::Init(
+    int num_channels,
+    const std::vector<BiquadFilterCoefficients>& channel_coeffs) {
+  CHECK_EQ(channel_coeffs.size(), num_channels);
+  Init(num_channels, channel_coeffs[0]);
+  // With one channel, the shared coefficients set above are all we need.
+  per_channel_coeffs_ = num_channels > 1;
+  if (!per_channel_coeffs_) { return; }
+  channel_coeffs_.resize(num_channels, 5);
+  for (int c = 0; c < num_channels; ++c) {
+    const BiquadFilterCoefficients& coeffs = channel_coeffs[c];
+    CHECK_NE(coeffs.a[0], 0.0) << "Filter coefficient a0 cannot be zero.";
+    // Scale the coefficients by 1 / filter_coeff_a[0].
+    const double scale = 1.0 / coeffs.a[0];
+    channel_coeffs_.row(c) << scale * coeffs.b[0], scale * coeffs.b[1],
+                              scale * coeffs.b[2], scale * coeffs.a[1],
+                              scale * coeffs.a[2];
+  }
+}
+
 template <typename _SampleType>
 template <typename InputType>
 void BiquadFilter<_SampleType>::SetSteadyStateCondition(
@@ -53,9 +78,18 @@ void BiquadFilter<_SampleType>::SetSteadyStateCondition(
   //   s = x[n] - a1 * s - a2 * s
   // which is equivalent to
   //   s = x[n] / (1 + a1 + a2).
-  Eigen::Matrix<AccumType, Eigen::Dynamic, 1> initial =
-      Traits::AsEigenArray(initial_value / (feedback12_.sum() + 1))
-      .template cast<AccumType>();
+  Eigen::Matrix<AccumType, Eigen::Dynamic, 1> initial;
+  if (per_channel_coeffs_) {
+    // Each channel has its own s = x[n] / (1 + a1 + a2).
+    initial = (Traits::AsEigenArray(initial_value).array()
+                   .template cast<AccumType>() /
+               (channel_coeffs_.col(3).array() +
+                channel_coeffs_.col(4).array() + CoefficientType(1)))
+              .matrix();
+  } else {
+    initial = Traits::AsEigenArray(initial_value / (feedback12_.sum() + 1))
+        .template cast<AccumType>();
+  }
   state_.col(0) = initial;
   state_.col(1) = initial;
 }
@@ -94,11 +128,16 @@ void BiquadFilter<_SampleType>::ProcessSample(const InputType& input,
   // s[n - 1] * b1 + s[n - 2] * b2.
   // Similarly, feedback12_ is the column vector (a1, a2).
 
-  // The compiler should optimize away this if statement at compile time.
-  if (kFixedNumChannels == Eigen::Dynamic) {
-    // When the number of channels is determined dynamically at run time, loop
-    // over the channels. This tends to be faster than vectorizing over the
-    // channels with Eigen.
+  // The compiler should optimize away this if statement at compile time,
+  // except for the per_channel_coeffs_ check.
+  if (kFixedNumChannels == Eigen::Dynamic || per_channel_coeffs_) {
+    // When the number of channels is determined dynamically at run time,
+    // process the channels in chunks of kSimdChannels using fixed-size Eigen
+    // arrays, which vectorize over channels. The state_ columns are contiguous
+    // over channels (structure of arrays), so each chunk loads s[n - 1] and
+    // s[n - 2] as whole vectors. Remaining channels are handled by
+    // successively narrower kernels. Per-channel coefficients are laid out the
+    // same way, so channels with independent filters use this path too.
     DCHECK_EQ(Traits::AsEigenArray(input).rows(), num_channels_);
     Traits::AsMutableEigenArray(output)->resize(num_channels_);
     DCHECK_EQ(Traits::AsEigenArray(input).innerStride(), 1)
@@ -106,18 +145,12 @@ void BiquadFilter<_SampleType>::ProcessSample(const InputType& input,
     DCHECK_EQ(Traits::AsMutableEigenArray(output)->innerStride(), 1)
         << "Cannot operate on map with inner stride.";
 
-    const InputScalarType* input_data = Traits::GetData(input);
-    OutputScalarType* output_data = Traits::GetMutableData(output);
-    for (int channel = 0; channel < num_channels_; ++channel) {
-      // Compute the next state s[n] = x[n] - a1 * s[n - 1] - a2 * s[n - 2].
-      const AccumType next_state = input_data[channel] -
-          (state_.row(channel) * feedback12_)[0];
-      // Compute the output y[n] = b0 * s[n] + b1 * s[n - 1] + b2 * s[n - 2].
-      output_data[channel] = next_state * feedforward0_ +
-          (state_.row(channel) * feedforward12_)[0];
-      // Update state by sliding.
-      state_(channel, 1) = state_(channel, 0);
-      state_(channel, 0) = next_state;
+    if (per_channel_coeffs_) {
+      ProcessChannelRange<kSimdChannels, true>(
+          0, Traits::GetData(input), Traits::GetMutableData(output));
+    } else {
+      ProcessChannelRange<kSimdChannels, false>(
+          0, Traits::GetData(input), Traits::GetMutableData(output));
     }
   } else if (kFixedNumChannels == 1) {
     // Optimize the known-single-channel case; 0 index optimization, no loop.
@@ -170,6 +203,59 @@ void BiquadFilter<_SampleType>::ProcessSample(const InputType& input,
 }
 
 
+template <typename _SampleType>
+template <int kChannels, bool kPerChannelCoeffs, typename InputScalarType,
+          typename OutputScalarType>
+inline void BiquadFilter<_SampleType>::ProcessChannelRange(
+    int first_channel, const InputScalarType* input, OutputScalarType* output) {
+  using ChannelsArray = Eigen::Array<AccumType, kChannels, 1>;
+  using CoeffsArray = Eigen::Array<CoefficientType, kChannels, 1>;
+  AccumType* state1 = state_.data();  // s[n - 1] for all channels.
+  AccumType* state2 = state_.data() + num_channels_;  // s[n - 2].
+  for (; first_channel + kChannels <= num_channels_;
+       first_channel += kChannels) {
+    Eigen::Map<ChannelsArray> s1(state1 + first_channel);
+    Eigen::Map<ChannelsArray> s2(state2 + first_channel);
+    const auto x =
+        Eigen::Map<const Eigen::Array<InputScalarType, kChannels, 1>>(
+            input + first_channel).template cast<AccumType>();
+    Eigen::Map<Eigen::Array<OutputScalarType, kChannels, 1>> y(
+        output + first_channel);
+    if (kPerChannelCoeffs) {
+      // Column k of channel_coeffs_ starts at k * num_channels_.
+      const CoefficientType* coeffs = channel_coeffs_.data() + first_channel;
+      Eigen::Map<const CoeffsArray> b0(coeffs);
+      Eigen::Map<const CoeffsArray> b1(coeffs + num_channels_);
+      Eigen::Map<const CoeffsArray> b2(coeffs + 2 * num_channels_);
+      Eigen::Map<const CoeffsArray> a1(coeffs + 3 * num_channels_);
+      Eigen::Map<const CoeffsArray> a2(coeffs + 4 * num_channels_);
+      // Compute the next state s[n] = x[n] - a1 * s[n - 1] - a2 * s[n - 2].
+      const ChannelsArray next_state = x - a1 * s1 - a2 * s2;
+      // Compute the output y[n] = b0 * s[n] + b1 * s[n - 1] + b2 * s[n - 2].
+      y = (b0 * next_state + b1 * s1 + b2 * s2)
+          .template cast<OutputScalarType>();
+      // Update state by sliding.
+      s2 = s1;
+      s1 = next_state;
+    } else {
+      // Compute the next state s[n] = x[n] - a1 * s[n - 1] - a2 * s[n - 2].
+      const ChannelsArray next_state =
+          x - feedback12_[0] * s1 - feedback12_[1] * s2;
+      // Compute the output y[n] = b0 * s[n] + b1 * s[n - 1] + b2 * s[n - 2].
+      y = (feedforward0_ * next_state + feedforward12_[0] * s1 +
+           feedforward12_[1] * s2).template cast<OutputScalarType>();
+      // Update state by sliding.
+      s2 = s1;
+      s1 = next_state;
+    }
+  }
+  if (kChannels > 1 && first_channel < num_channels_) {
+    // Fewer than kChannels channels remain; hand them to a narrower kernel.
+    ProcessChannelRange<(kChannels > 1) ? kChannels / 2 : 1,
+                        kPerChannelCoeffs>(first_channel, input, output);
+  }
+}
+
 template <typename _SampleType>
 void BiquadFilterCascade<_SampleType>::Init(
     int num_channels, const BiquadFilterCascadeCoefficients& all_coefficients) {
@@ -180,6 +266,111 @@ void BiquadFilterCascade<_SampleType>::Init(
   for (int i = 0; i < filters_.size(); ++i) {
     filters_[i].Init(num_channels_, all_coefficients.coeffs[i]);
   }
+  InitFused();
+}
+
+template <typename _SampleType>
+void BiquadFilterCascade<_SampleType>::Init(
+    int num_channels,
+    const std::vector<BiquadFilterCascadeCoefficients>& channel_coefficients) {
+  CHECK_EQ(channel_coefficients.size(), num_channels);
+  DCHECK_GE(num_channels, 1);
+  const int num_stages = channel_coefficients[0].coeffs.size();
+  DCHECK_GE(num_stages, 1);
+  num_channels_ = num_channels;
+  filters_.resize(num_stages);
+  std::vector<BiquadFilterCoefficients> stage_coeffs(num_channels);
+  for (int i = 0; i < num_stages; ++i) {
+    for (int c = 0; c < num_channels; ++c) {
+      CHECK_EQ(channel_coefficients[c].coeffs.size(), num_stages)
+          << "All channels must have the same number of stages.";
+      stage_coeffs[c] = channel_coefficients[c].coeffs[i];
+    }
+    filters_[i].Init(num_channels_, stage_coeffs);
+  }
+  InitFused();
+}
+
+template <typename _SampleType>
+void BiquadFilterCascade<_SampleType>::InitFused() {
+  const int num_stages = filters_.size();
+  fused_coeffs_.resize(5, num_stages);
+  for (int i = 0; i < num_stages; ++i) {
+    fused_coeffs_.col(i) << filters_[i].feedforward0_,
+                            filters_[i].feedforward12_,
+                            filters_[i].feedback12_;
+  }
+  const int num_tiles = (num_channels_ + kFusedTileSize - 1) / kFusedTileSize;
+  fused_state_.setZero(kFusedTileSize, 2 * num_tiles * num_stages);
+  if (filters_[0].per_channel_coeffs_) {
+    fused_channel_coeffs_.setZero(kFusedTileSize, 5 * num_tiles * num_stages);
+    for (int tile = 0; tile < num_tiles; ++tile) {
+      const int first_channel = tile * kFusedTileSize;
+      const int tile_channels =
+          std::min<int>(kFusedTileSize, num_channels_ - first_channel);
+      for (int i = 0; i < num_stages; ++i) {
+        fused_channel_coeffs_.block(0, 5 * (tile * num_stages + i),
+                                    tile_channels, 5) =
+            filters_[i].channel_coeffs_.middleRows(first_channel,
+                                                   tile_channels);
+      }
+    }
+  } else {
+    fused_channel_coeffs_.resize(kFusedTileSize, 0);
+  }
+  InitStateSpace();
+}
+
+template <typename _SampleType>
+void BiquadFilterCascade<_SampleType>::InitStateSpace() {
+  // With state x[n] = (s[n - 1], s[n - 2]), each stage evolves as
+  //   x[n + 1] = A x[n] + e1 u[n],  y[n] = c' x[n] + b0 u[n],
+  // where A = [-a1 -a2; 1 0], e1 = (1, 0) and c = (b1 - b0 a1, b2 - b0 a2).
+  // Unrolling K steps gives
+  //   y[n + k] = c' A^k x[n] + sum_{j <= k} h[k - j] u[n + j],
+  //   x[n + K] = A^K x[n] + sum_j A^(K - 1 - j) e1 u[n + j],
+  // with impulse response h[0] = b0 and h[m] = c' A^(m - 1) e1 for m >= 1.
+  // The matrices are computed in double precision.
+  constexpr int K = kStateSpaceBlockSize;
+  const int num_stages = filters_.size();
+  state_space_input_.resize(num_channels_, K);
+  state_space_output_.resize(num_channels_, K);
+  state_space_state_.resize(num_channels_, 2);
+  state_space_d_.setZero(K, K * num_stages);
+  state_space_c_.resize(K, 2 * num_stages);
+  state_space_b_.resize(2, K * num_stages);
+  state_space_a_.resize(2, 2 * num_stages);
+  for (int i = 0; i < num_stages; ++i) {
+    const double b0 = fused_coeffs_(0, i);
+    const double a1 = fused_coeffs_(3, i);
+    const double a2 = fused_coeffs_(4, i);
+    Eigen::Matrix2d a;
+    a << -a1, -a2,
+         1.0, 0.0;
+    const Eigen::RowVector2d c(fused_coeffs_(1, i) - b0 * a1,
+                               fused_coeffs_(2, i) - b0 * a2);
+    Eigen::Matrix<double, K, 1> impulse_response;
+    impulse_response[0] = b0;
+    // a_power is A^k at the start of iteration k.
+    Eigen::Matrix2d a_power = Eigen::Matrix2d::Identity();
+    for (int k = 0; k < K; ++k) {
+      state_space_c_.row(k).segment(2 * i, 2) =
+          (c * a_power).template cast<CoefficientType>();
+      if (k + 1 < K) {
+        impulse_response[k + 1] = (c * a_power.col(0))(0);
+      }
+      // Column K - 1 - k of B is A^k e1.
+      state_space_b_.col(K * i + K - 1 - k) =
+          a_power.col(0).template cast<CoefficientType>();
+      a_power = a * a_power;
+    }
+    state_space_a_.middleCols(2 * i, 2) =
+        a_power.template cast<CoefficientType>();
+    for (int j = 0; j < K; ++j) {
+      state_space_d_.col(K * i + j).tail(K - j) =
+          impulse_response.head(K - j).template cast<CoefficientType>();
+    }
+  }
 }
 
 template <typename _SampleType>
@@ -194,6 +385,20 @@ template <typename InputType, typename OutputType>
 void BiquadFilterCascade<_SampleType>::ProcessBlock(const InputType& input,
                                              OutputType* output) {
   DCHECK_GE(num_channels_, 1);
+  if (processing_mode_ == BiquadCascadeProcessingMode::kFused) {
+    std::conditional<internal::IsEigenType<_SampleType>::Value,
+        ProcessBlockFusedMultichannelHelper,
+        ProcessBlockFusedScalarHelper
+        >::type::Run(this, input, output);
+    return;
+  } else if (processing_mode_ ==
+             BiquadCascadeProcessingMode::kBlockStateSpace) {
+    std::conditional<internal::IsEigenType<_SampleType>::Value,
+        ProcessBlockStateSpaceMultichannelHelper,
+        ProcessBlockStateSpaceScalarHelper
+        >::type::Run(this, input, output);
+    return;
+  }
   filters_[0].ProcessBlock(input, output);
   const int filters_size = filters_.size();
   for (int i = 1; i < filters_size; ++i) {
@@ -201,6 +406,256 @@ void BiquadFilterCascade<_SampleType>::ProcessBlock(const InputType& input,
   }
 }
 
+template <typename _SampleType>
+template <typename InputType, typename OutputType>
+void BiquadFilterCascade<_SampleType>::ProcessBlockFusedMultichannel(
+    const InputType& input, OutputType* output) {
+  CHECK_EQ(input.rows(), num_channels_);
+  DCHECK(output != nullptr);
+  output->resize(input.rows(), input.cols());
+  CHECK_EQ(input.innerStride(), 1)
+      << "Cannot operate on map with inner stride.";
+  CHECK_EQ(output->innerStride(), 1)
+      << "Cannot operate on map with inner stride.";
+  constexpr int kTileSize = kFusedTileSize;
+  const int num_stages = filters_.size();
+  const int num_tiles = (num_channels_ + kTileSize - 1) / kTileSize;
+
+  // Gather the stage states into the tiled workspace.
+  for (int tile = 0; tile < num_tiles; ++tile) {
+    const int first_channel = tile * kTileSize;
+    const int tile_channels =
+        std::min(kTileSize, num_channels_ - first_channel);
+    for (int i = 0; i < num_stages; ++i) {
+      fused_state_.block(0, 2 * (tile * num_stages + i), tile_channels, 2) =
+          filters_[i].state_.middleRows(first_channel, tile_channels);
+    }
+  }
+
+  if (filters_[0].per_channel_coeffs_) {
+    ProcessFramesFused<true>(input, output);
+  } else {
+    ProcessFramesFused<false>(input, output);
+  }
+
+  // Scatter the states back so that ProcessSample() and the stage-by-stage
+  // mode continue seamlessly from here.
+  for (int tile = 0; tile < num_tiles; ++tile) {
+    const int first_channel = tile * kTileSize;
+    const int tile_channels =
+        std::min(kTileSize, num_channels_ - first_channel);
+    for (int i = 0; i < num_stages; ++i) {
+      filters_[i].state_.middleRows(first_channel, tile_channels) =
+          fused_state_.block(0, 2 * (tile * num_stages + i), tile_channels, 2);
+    }
+  }
+}
+
+template <typename _SampleType>
+template <bool kPerChannelCoeffs, typename InputType, typename OutputType>
+void BiquadFilterCascade<_SampleType>::ProcessFramesFused(
+    const InputType& input, OutputType* output) {
+  constexpr int kTileSize = kFusedTileSize;
+  const int num_stages = filters_.size();
+  const int num_full_tiles = num_channels_ / kTileSize;
+  const int remainder = num_channels_ % kTileSize;
+  // Number of state and per-channel coefficient values per tile.
+  const int tile_state_size = 2 * num_stages * kTileSize;
+  const int tile_coeffs_size = kPerChannelCoeffs ? 5 * num_stages * kTileSize
+                                                 : 0;
+  const CoefficientType* first_coeffs = kPerChannelCoeffs
+      ? fused_channel_coeffs_.data() : fused_coeffs_.data();
+
+  for (int n = 0; n < input.cols(); ++n) {
+    const auto* input_data = input.col(n).data();
+    auto* output_data = output->col(n).data();
+    AccumType* state = fused_state_.data();
+    const CoefficientType* coeffs = first_coeffs;
+    for (int tile = 0; tile < num_full_tiles; ++tile) {
+      ProcessTileFused<kTileSize, kPerChannelCoeffs>(
+          coeffs, input_data, state, output_data);
+      input_data += kTileSize;
+      output_data += kTileSize;
+      state += tile_state_size;
+      coeffs += tile_coeffs_size;
+    }
+    // Dispatch the partial last tile to a kernel of exactly its width.
+    switch (remainder) {
+      case 0: break;
+      case 1:
+        ProcessTileFused<1, kPerChannelCoeffs>(coeffs, input_data, state,
+                                                output_data);
+        break;
+      case 2:
+        ProcessTileFused<2, kPerChannelCoeffs>(coeffs, input_data, state,
+                                                output_data);
+        break;
+      case 3:
+        ProcessTileFused<3, kPerChannelCoeffs>(coeffs, input_data, state,
+                                                output_data);
+        break;
+      case 4:
+        ProcessTileFused<4, kPerChannelCoeffs>(coeffs, input_data, state,
+                                                output_data);
+        break;
+      case 5:
+        ProcessTileFused<5, kPerChannelCoeffs>(coeffs, input_data, state,
+                                                output_data);
+        break;
+      case 6:
+        ProcessTileFused<6, kPerChannelCoeffs>(coeffs, input_data, state,
+                                                output_data);
+        break;
+      default:
+        ProcessTileFused<7, kPerChannelCoeffs>(coeffs, input_data, state,
+                                                output_data);
+        break;
+    }
+  }
+}
+
+template <typename _SampleType>
+template <typename InputType, typename OutputType>
+void BiquadFilterCascade<_SampleType>::ProcessBlockStateSpace(
+    const InputType& input, OutputType* output) {
+  DCHECK(output != nullptr);
+  constexpr int K = kStateSpaceBlockSize;
+  using BlockType = Eigen::Matrix<AccumType, K, 1>;
+  using InputScalarType = typename std::decay<decltype(input[0])>::type;
+  using OutputScalarType = typename std::decay<decltype((*output)[0])>::type;
+  const int num_samples = input.size();
+  output->resize(num_samples);
+  const int num_stages = filters_.size();
+  const auto* input_data = input.data();
+  OutputScalarType* output_data = output->data();
+
+  int n = 0;
+  for (; n + K <= num_samples; n += K) {
+    // Loaded before anything is written so that in-place processing works.
+    BlockType block =
+        Eigen::Map<const Eigen::Matrix<InputScalarType, K, 1>>(input_data + n)
+        .template cast<AccumType>();
+    for (int i = 0; i < num_stages; ++i) {
+      // filters_[i].state_ is the 1-by-2 row (s[n - 1], s[n - 2]).
+      const Eigen::Matrix<AccumType, 2, 1> state =
+          filters_[i].state_.transpose();
+      Eigen::Map<const Eigen::Matrix<CoefficientType, K, K>> d(
+          state_space_d_.data() + K * K * i);
+      Eigen::Map<const Eigen::Matrix<CoefficientType, K, 2>> c(
+          state_space_c_.data() + 2 * K * i);
+      Eigen::Map<const Eigen::Matrix<CoefficientType, 2, K>> b(
+          state_space_b_.data() + 2 * K * i);
+      Eigen::Map<const Eigen::Matrix<CoefficientType, 2, 2>> a(
+          state_space_a_.data() + 4 * i);
+      filters_[i].state_.transpose() = a * state + b * block;
+      block = c * state + d * block;
+    }
+    Eigen::Map<Eigen::Matrix<OutputScalarType, K, 1>>(output_data + n) =
+        block.template cast<OutputScalarType>();
+  }
+  // Filter the remaining samples one at a time.
+  for (; n < num_samples; ++n) {
+    ProcessSample(input_data[n], &output_data[n]);
+  }
+}
+
+template <typename _SampleType>
+template <typename InputType, typename OutputType>
+void BiquadFilterCascade<_SampleType>::ProcessBlockStateSpaceMultichannel(
+    const InputType& input, OutputType* output) {
+  if (filters_[0].per_channel_coeffs_) {
+    ProcessBlockFusedMultichannel(input, output);
+    return;
+  }
+  CHECK_EQ(input.rows(), num_channels_);
+  DCHECK(output != nullptr);
+  output->resize(input.rows(), input.cols());
+  constexpr int K = kStateSpaceBlockSize;
+  using OutputScalarType = typename OutputType::Scalar;
+  const int num_samples = input.cols();
+  const int num_stages = filters_.size();
+
+  // Same as ProcessBlockStateSpace(), with the channels along the rows, so
+  // that each product runs over all channels of a block at once,
+  //   Y = X C' + U D',  X' = X (A^K)' + U B'.
+  int n = 0;
+  for (; n + K <= num_samples; n += K) {
+    // Loaded before anything is written so that in-place processing works.
+    state_space_input_ =
+        input.middleCols(n, K).matrix().template cast<AccumType>();
+    for (int i = 0; i < num_stages; ++i) {
+      Eigen::Map<const Eigen::Matrix<CoefficientType, K, K>> d(
+          state_space_d_.data() + K * K * i);
+      Eigen::Map<const Eigen::Matrix<CoefficientType, K, 2>> c(
+          state_space_c_.data() + 2 * K * i);
+      Eigen::Map<const Eigen::Matrix<CoefficientType, 2, K>> b(
+          state_space_b_.data() + 2 * K * i);
+      Eigen::Map<const Eigen::Matrix<CoefficientType, 2, 2>> a(
+          state_space_a_.data() + 4 * i);
+      auto& state = filters_[i].state_;
+      state_space_state_.noalias() = state * a.transpose();
+      state_space_state_.noalias() += state_space_input_ * b.transpose();
+      state_space_output_.noalias() = state * c.transpose();
+      state_space_output_.noalias() += state_space_input_ * d.transpose();
+      state = state_space_state_;
+      state_space_input_.swap(state_space_output_);
+    }
+    output->middleCols(n, K).matrix() =
+        state_space_input_.template cast<OutputScalarType>();
+  }
+  // Filter the remaining samples with the fused kernel.
+  if (n < num_samples) {
+    auto output_tail = output->rightCols(num_samples - n);
+    ProcessBlockFusedMultichannel(input.rightCols(num_samples - n),
+                                  &output_tail);
+  }
+}
+
+template <typename _SampleType>
+template <int kTileChannels, bool kPerChannelCoeffs, typename InputScalarType,
+          typename OutputScalarType>
+inline void BiquadFilterCascade<_SampleType>::ProcessTileFused(
+    const CoefficientType* coeffs, const InputScalarType* input,
+    AccumType* state, OutputScalarType* output) {
+  // The loops over the channels of the tile have a length known at compile
+  // time, so that the compiler can fully unroll and vectorize them.
+  //
+  // Shared coefficients are broadcast to all channels by reading them with a
+  // channel stride of zero. Per-channel coefficients are stored as columns of
+  // kFusedTileSize channels, one column per coefficient.
+  constexpr int kChannelStride = kPerChannelCoeffs ? 1 : 0;
+  constexpr int kCoeffStride = kPerChannelCoeffs ? kFusedTileSize : 1;
+  AccumType samples[kTileChannels];
+  for (int c = 0; c < kTileChannels; ++c) {
+    samples[c] = input[c];
+  }
+  const int num_stages = filters_.size();
+  for (int i = 0; i < num_stages; ++i) {
+    const CoefficientType* b0 = coeffs;
+    const CoefficientType* b1 = coeffs + kCoeffStride;
+    const CoefficientType* b2 = coeffs + 2 * kCoeffStride;
+    const CoefficientType* a1 = coeffs + 3 * kCoeffStride;
+    const CoefficientType* a2 = coeffs + 4 * kCoeffStride;
+    // s1 is s[n - 1] and s2 is s[n - 2] for this stage.
+    AccumType* s1 = state;
+    AccumType* s2 = state + kFusedTileSize;
+    for (int c = 0; c < kTileChannels; ++c) {
+      const int k = kChannelStride * c;
+      // s[n] = x[n] - a1 * s[n - 1] - a2 * s[n - 2].
+      const AccumType next_state = samples[c] - a1[k] * s1[c] - a2[k] * s2[c];
+      // y[n] = b0 * s[n] + b1 * s[n - 1] + b2 * s[n - 2].
+      samples[c] = b0[k] * next_state + b1[k] * s1[c] + b2[k] * s2[c];
+      s2[c] = s1[c];
+      s1[c] = next_state;
+    }
+    coeffs += 5 * kCoeffStride;
+    state += 2 * kFusedTileSize;
+  }
+  for (int c = 0; c < kTileChannels; ++c) {
+    output[c] = static_cast<OutputScalarType>(samples[c]);
+  }
+}
+
 template <typename _SampleType>
 template <typename InputType, typename OutputType>
 void BiquadFilterCascade<_SampleType>::ProcessSample(const InputType& input,
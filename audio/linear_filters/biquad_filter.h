@@ -80,6 +80,11 @@
 //     filter.ProcessBlock(input_samples, &output_samples);
 //     ...
 //   }
+//
+//   /* Many independent streams, each channel with its own coefficients. */
+//   BiquadFilter<Eigen::ArrayXf> filter;
+//   std::vector<BiquadFilterCoefficients> channel_coeffs = ...
+//   filter.Init(channel_coeffs.size(), channel_coeffs);
 
 #ifndef AUDIO_LINEAR_FILTERS_BIQUAD_FILTER_H_
 #define AUDIO_LINEAR_FILTERS_BIQUAD_FILTER_H_
@@ -97,6 +102,8 @@
 
 namespace linear_filters {
 
+template <typename _SampleType> class BiquadFilterCascade;
+
 template <typename _SampleType>
 class BiquadFilter {
   using Traits = typename internal::FilterTraits<
@@ -114,7 +121,9 @@ class BiquadFilter {
   // http://eigen.tuxfamily.org/dox/group__TopicStructHavingEigenMembers.html
   EIGEN_MAKE_ALIGNED_OPERATOR_NEW
 
-  BiquadFilter(): num_channels_(0 /* Mark filter as uninitialized. */) {}
+  BiquadFilter()
+      : num_channels_(0 /* Mark filter as uninitialized. */),
+        per_channel_coeffs_(false) {}
 
   // Initialize the filter with zero state, specifying number of channels and
   // filter coefficients. This function may be called more than once.
@@ -125,6 +134,14 @@ class BiquadFilter {
   // SampleType::RowsAtCompileTime.
   void Init(int num_channels, const BiquadFilterCoefficients& coeffs);
 
+  // Initialize the filter with zero state and independent coefficients for
+  // each channel, where channel_coeffs[c] are the coefficients of channel c.
+  // channel_coeffs must have num_channels elements. All channels are still
+  // filtered together in one pass vectorized over channels, so this is much
+  // more efficient than one filter per channel.
+  void Init(int num_channels,
+            const std::vector<BiquadFilterCoefficients>& channel_coeffs);
+
   // Reset the filter to zero state (left boundary is extended by zero padding).
   void Reset();
 
@@ -199,7 +216,31 @@ class BiquadFilter {
   void ProcessSample(const InputType& input, OutputType* output);
 
  private:
+  // The fused cascade kernel reads the coefficients and state of each stage.
+  friend class BiquadFilterCascade<_SampleType>;
+
+  // Number of channels processed per chunk when the number of channels is
+  // dynamic, two SIMD registers' worth for the instruction set Eigen was
+  // compiled for (e.g. 8 floats with SSE, 16 with AVX, 32 with AVX-512).
+  static constexpr int kSimdChannels =
+      2 * Eigen::internal::packet_traits<AccumType>::size;
+
+  // Filters one sample of channels [first_channel, num_channels_) in chunks of
+  // kChannels channels. The input and output pointers point to channel 0. If
+  // kPerChannelCoeffs is true, the coefficients are read from channel_coeffs_.
+  template <int kChannels, bool kPerChannelCoeffs, typename InputScalarType,
+            typename OutputScalarType>
+  void ProcessChannelRange(int first_channel, const InputScalarType* input,
+                           OutputScalarType* output);
+
   int num_channels_;
+  // True if the channels have independent coefficients in channel_coeffs_.
+  // The members below then hold the coefficients of channel 0.
+  bool per_channel_coeffs_;
+  // Matrix of size num_channels-by-5 with columns (b0, b1, b2, a1, a2), so
+  // that each coefficient is contiguous over channels. Empty unless
+  // per_channel_coeffs_.
+  Eigen::Matrix<CoefficientType, Eigen::Dynamic, 5> channel_coeffs_;
   // Feedforward filter coefficient b0.
   CoefficientType feedforward0_;
   // Column vector (b1, b2).
@@ -211,10 +252,46 @@ class BiquadFilter {
   typename Traits::BiquadStateType state_;
 };
 
+// Strategy used by BiquadFilterCascade::ProcessBlock(). All modes produce the
+// same output up to rounding error.
+enum class BiquadCascadeProcessingMode {
+  // Each stage filters the entire block before the next stage runs, so the
+  // block streams through memory once per stage.
+  kStageByStage,
+  // Each frame is pushed through every stage before moving to the next frame.
+  // The stage states for a tile of channels are held in a small local buffer,
+  // so the block streams through memory only once regardless of the number of
+  // stages. This is usually faster for long cascades on large blocks.
+  kFused,
+  // Block state-space ("look-ahead") formulation. Each stage computes
+  // kStateSpaceBlockSize outputs at once as
+  //   y = C * x + D * u,  x' = A^K * x + B * u,
+  // where u is the block of inputs, x is the stage state, D is the lower
+  // triangular Toeplitz matrix of the first K impulse response samples and
+  // A, B, C are precomputed from the coefficients. This breaks the serial
+  // dependency s[n] -> s[n + 1] into small matrix products that vectorize over
+  // time, at the cost of more multiplies per sample. For a multichannel
+  // SampleType, all channels of a block are multiplied at once. Samples left
+  // over after the last full block are filtered sample by sample (or by the
+  // kFused kernel for a multichannel SampleType). A cascade initialized with
+  // per-channel coefficients uses the kFused kernel instead, since the
+  // matrices are shared by all channels.
+  kBlockStateSpace,
+};
+
 // The BiquadFilterCascade is a filter that processes multiple BiquadFilters in
 // cascade (output of each is input to the next). It can be used in the exact
 // same way that a BiquadFilter is used, with one exception: Init takes a
 // BiquadFilterCascadeCoefficients instead of a BiquadFilterCoefficients.
+//
+// Example:
+//   BiquadFilterCascade<ArrayXf> filter;
+//   filter.Init(num_channels, cascade_coeffs);
+//   /* Optionally process each frame through all stages in one pass. */
+//   filter.set_processing_mode(BiquadCascadeProcessingMode::kFused);
+//   filter.ProcessBlock(input, &output);
+//
+// A single BiquadFilter can use the modes above as a one-stage cascade.
 template <typename _SampleType>
 class BiquadFilterCascade {
   using Traits = typename internal::FilterTraits<
@@ -226,14 +303,25 @@ class BiquadFilterCascade {
   static constexpr int kNumChannelsAtCompileTime =
       Traits::kNumChannelsAtCompileTime;
   using ScalarType = typename Traits::template GetScalarType<_SampleType>::Type;
+  using AccumType = typename Traits::AccumType;
 
-  BiquadFilterCascade() : num_channels_(0) {}
+  BiquadFilterCascade()
+      : num_channels_(0),
+        processing_mode_(BiquadCascadeProcessingMode::kStageByStage) {}
 
   // Adds and initializes a BiquadFilter to the cascade using the parameters,
   // coefficients. The state of all filters is reset when a new stage is added.
   void Init(int num_channels,
             const BiquadFilterCascadeCoefficients& all_coefficients);
 
+  // Initializes the cascade with independent coefficients for each channel,
+  // where channel_coefficients[c] is the cascade of channel c. All channels
+  // must have the same number of stages; pad shorter cascades with identity
+  // stages (default-constructed BiquadFilterCoefficients).
+  void Init(int num_channels,
+            const std::vector<BiquadFilterCascadeCoefficients>&
+                channel_coefficients);
+
   // Resets the state of all stages of the filter.
   void Reset();
 
@@ -246,9 +334,132 @@ class BiquadFilterCascade {
 
   int num_channels() const { return num_channels_; }
 
+  // Selects how ProcessBlock() traverses the stages. The filter state is
+  // preserved, so the mode may be changed between blocks while streaming.
+  void set_processing_mode(BiquadCascadeProcessingMode mode) {
+    processing_mode_ = mode;
+  }
+  BiquadCascadeProcessingMode processing_mode() const {
+    return processing_mode_;
+  }
+
  private:
+  // Number of channels processed together by the fused kernel. Eight lanes
+  // fill an AVX register for float samples; fixed-size types with fewer
+  // channels use a narrower tile.
+  static constexpr int kFusedTileSize =
+      (kNumChannelsAtCompileTime != Eigen::Dynamic &&
+       kNumChannelsAtCompileTime < 8) ? kNumChannelsAtCompileTime : 8;
+
+  // Fused ProcessBlock() for scalar SampleType; each sample passes through all
+  // stages via ProcessSample().
+  struct ProcessBlockFusedScalarHelper {
+    template <typename InputType, typename OutputType>
+    static void Run(BiquadFilterCascade* cascade,
+                    const InputType& input, OutputType* output) {
+      Traits::ProcessBlock(cascade, input, output);
+    }
+  };
+
+  // Block state-space ProcessBlock() for scalar SampleType.
+  struct ProcessBlockStateSpaceScalarHelper {
+    template <typename InputType, typename OutputType>
+    static void Run(BiquadFilterCascade* cascade,
+                    const InputType& input, OutputType* output) {
+      cascade->ProcessBlockStateSpace(input, output);
+    }
+  };
+
+  // Block state-space ProcessBlock() for multichannel SampleType.
+  struct ProcessBlockStateSpaceMultichannelHelper {
+    template <typename InputType, typename OutputType>
+    static void Run(BiquadFilterCascade* cascade,
+                    const InputType& input, OutputType* output) {
+      cascade->ProcessBlockStateSpaceMultichannel(input, output);
+    }
+  };
+
+  // Fused ProcessBlock() for multichannel SampleType.
+  struct ProcessBlockFusedMultichannelHelper {
+    template <typename InputType, typename OutputType>
+    static void Run(BiquadFilterCascade* cascade,
+                    const InputType& input, OutputType* output) {
+      cascade->ProcessBlockFusedMultichannel(input, output);
+    }
+  };
+
+  template <typename InputType, typename OutputType>
+  void ProcessBlockFusedMultichannel(const InputType& input,
+                                     OutputType* output);
+
+  // Runs the fused kernel over all frames, reading the coefficients from
+  // fused_channel_coeffs_ if kPerChannelCoeffs and from fused_coeffs_
+  // otherwise.
+  template <bool kPerChannelCoeffs, typename InputType, typename OutputType>
+  void ProcessFramesFused(const InputType& input, OutputType* output);
+
+  template <typename InputType, typename OutputType>
+  void ProcessBlockStateSpace(const InputType& input, OutputType* output);
+
+  template <typename InputType, typename OutputType>
+  void ProcessBlockStateSpaceMultichannel(const InputType& input,
+                                          OutputType* output);
+
+  // Sets up the fused and block state-space workspaces from filters_.
+  void InitFused();
+
+  // Computes the block state-space matrices of all stages from filters_.
+  void InitStateSpace();
+
+  // Pushes one frame of kTileChannels channels through all stages. state
+  // points to the tile's block of fused_state_. coeffs points to fused_coeffs_,
+  // or if kPerChannelCoeffs, to the tile's block of fused_channel_coeffs_.
+  template <int kTileChannels, bool kPerChannelCoeffs,
+            typename InputScalarType, typename OutputScalarType>
+  void ProcessTileFused(const CoefficientType* coeffs,
+                        const InputScalarType* input, AccumType* state,
+                        OutputScalarType* output);
+
   int num_channels_;
+  BiquadCascadeProcessingMode processing_mode_;
   std::vector<BiquadFilter<SampleType>> filters_;
+  // Coefficients of all stages for the fused kernel. Column i holds
+  // (b0, b1, b2, a1, a2) of stage i, normalized so that a0 = 1.
+  Eigen::Matrix<CoefficientType, 5, Eigen::Dynamic> fused_coeffs_;
+  // Per-channel coefficients for the fused kernel, laid out like fused_state_:
+  // for tile t and stage i, columns 5 * (t * num_stages + i) + k for
+  // k = 0, ..., 4 hold (b0, b1, b2, a1, a2) of the channels in that tile.
+  // Empty unless the stages have per-channel coefficients.
+  Eigen::Matrix<CoefficientType, kFusedTileSize, Eigen::Dynamic>
+      fused_channel_coeffs_;
+  // Workspace for the fused kernel holding the state of all stages, with
+  // channels padded up to a multiple of kFusedTileSize. For tile t and stage i,
+  // columns 2 * (t * num_stages + i) and 2 * (t * num_stages + i) + 1 hold
+  // s[n - 1] and s[n - 2] of the channels in that tile.
+  Eigen::Matrix<AccumType, kFusedTileSize, Eigen::Dynamic> fused_state_;
+
+  // Number of samples computed at once in kBlockStateSpace mode.
+  static constexpr int kStateSpaceBlockSize = 8;
+  // Block state-space matrices for kBlockStateSpace mode, stacked
+  // horizontally over the stages. With K = kStateSpaceBlockSize, stage i uses
+  // the K-by-K block at column K * i of state_space_d_ (the Toeplitz matrix
+  // D), the K-by-2 block at column 2 * i of state_space_c_ (C), the 2-by-K
+  // block at column K * i of state_space_b_ (B) and the 2-by-2 block at column
+  // 2 * i of state_space_a_ (A^K). The state vector is (s[n - 1], s[n - 2]).
+  Eigen::Matrix<CoefficientType, kStateSpaceBlockSize, Eigen::Dynamic>
+      state_space_d_;
+  Eigen::Matrix<CoefficientType, kStateSpaceBlockSize, Eigen::Dynamic>
+      state_space_c_;
+  Eigen::Matrix<CoefficientType, 2, Eigen::Dynamic> state_space_b_;
+  Eigen::Matrix<CoefficientType, 2, Eigen::Dynamic> state_space_a_;
+  // Workspaces of size num_channels-by-K holding the block of samples going
+  // into and coming out of a stage, and num_channels-by-2 for the next stage
+  // state, used by kBlockStateSpace mode with a multichannel SampleType.
+  using StateSpaceBlockType =
+      Eigen::Matrix<AccumType, kNumChannelsAtCompileTime, kStateSpaceBlockSize>;
+  StateSpaceBlockType state_space_input_;
+  StateSpaceBlockType state_space_output_;
+  typename Traits::BiquadStateType state_space_state_;
 };
 
 }  // namespace linear_filters
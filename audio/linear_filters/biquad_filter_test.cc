@@ -243,6 +243,39 @@ TEST(BiquadFilterTest, BiquadFilterMultichannelFloat) {
   }
 }
 
+// Test the channel-vectorized kernel used for a dynamic number of channels,
+// with channel counts that exercise full SIMD chunks and every tail width.
+TEST(BiquadFilterTest, BiquadFilterMultichannelManyChannels) {
+  constexpr int kNumSamples = 20;
+  const BiquadFilterCoefficients coeffs = {{-0.2, 1.9, 0.4}, {0.5, -0.2, 0.1}};
+  srand(0 /* seed */);
+
+  for (int num_channels = 5; num_channels <= 70; ++num_channels) {
+    SCOPED_TRACE("num_channels: " + testing::PrintToString(num_channels));
+    BiquadFilter<ArrayXf> filter;
+    filter.Init(num_channels, coeffs);
+
+    ArrayXXf input = ArrayXXf::Random(num_channels, kNumSamples);
+    ArrayXXf expected = ReferenceBiquadFilter<float>(coeffs, input);
+
+    {  // Process all at once with ProcessBlock, in place.
+      ArrayXXf output = input;
+      filter.ProcessBlock(output, &output);
+      EXPECT_THAT(output, EigenArrayNear(expected, 1e-5));
+    }
+    {  // Sample-by-sample processing with ProcessSample.
+      ArrayXXf output(num_channels, kNumSamples);
+      filter.Reset();
+      for (int n = 0; n < kNumSamples; ++n) {
+        ArrayXf output_sample;
+        filter.ProcessSample(input.col(n), &output_sample);
+        output.col(n) = output_sample;
+      }
+      EXPECT_THAT(output, EigenArrayNear(expected, 1e-5));
+    }
+  }
+}
+
 TEST(BiquadFilterTest, BiquadFilterMultichannelNoncontiguousDynamic) {
   constexpr int kNumSamples = 20;
   constexpr int kNumChannels = 3;
@@ -774,6 +807,280 @@ TYPED_TEST(BiquadFilterTypedTest, BiquadFilterCascade) {
   }
 }
 
+// Test that the fused cascade kernel matches stage-by-stage processing, for
+// channel counts that do and do not fill whole tiles, while streaming and
+// switching modes between blocks.
+TYPED_TEST(BiquadFilterTypedTest, BiquadFilterCascadeFused) {
+  using SampleType = TypeParam;
+  SCOPED_TRACE(
+      absl::StrFormat("SampleType: %s", GetTypeName<SampleType>().c_str()));
+
+  constexpr int kNumSamples = 40;
+  const std::vector<BiquadFilterCoefficients> all_coeffs = {
+      {{-0.2, 1.9, 0.4}, {0.5, -0.2, 0.1}},
+      {{0.3, 0.1, -0.2}, {1.0, 0.4, 0.3}},
+      {{1.0, -1.6, 0.7}, {2.0, -0.9, 0.2}}};
+  srand(0 /* seed */);
+
+  using FilterType = BiquadFilterCascade<SampleType>;
+  const int kNumChannelsAtCompileTime = FilterType::kNumChannelsAtCompileTime;
+  using ScalarType = typename FilterType::ScalarType;
+  using BlockOfSamples = typename Eigen::Array<
+      ScalarType, kNumChannelsAtCompileTime, Dynamic>;
+
+  for (int num_channels : {1, 3, 8, 11, 17}) {
+    if ((kNumChannelsAtCompileTime != Dynamic &&
+         kNumChannelsAtCompileTime != num_channels) ||
+        (!internal::IsEigenType<SampleType>::Value && num_channels != 1)) {
+      continue;  // Skip if SampleType is incompatible with num_channels.
+    }
+    SCOPED_TRACE("num_channels: " + testing::PrintToString(num_channels));
+    const BiquadFilterCascadeCoefficients cascade_coeffs(all_coeffs);
+    FilterType reference_filter;
+    reference_filter.Init(num_channels, cascade_coeffs);
+    FilterType fused_filter;
+    fused_filter.Init(num_channels, cascade_coeffs);
+    fused_filter.set_processing_mode(BiquadCascadeProcessingMode::kFused);
+    EXPECT_EQ(fused_filter.processing_mode(),
+              BiquadCascadeProcessingMode::kFused);
+
+    const BlockOfSamples input =
+        BlockOfSamples::Random(num_channels, kNumSamples);
+    BlockOfSamples expected;
+    reference_filter.ProcessBlock(input, &expected);
+
+    // First half fused, the next few frames sample by sample, the rest fused
+    // again, computing in place.
+    constexpr int kSplit = kNumSamples / 2;
+    constexpr int kSplit2 = kSplit + 3;
+    BlockOfSamples output = input;
+    BlockOfSamples block = output.leftCols(kSplit);
+    fused_filter.ProcessBlock(block, &block);
+    output.leftCols(kSplit) = block;
+    fused_filter.set_processing_mode(
+        BiquadCascadeProcessingMode::kStageByStage);
+    block = output.middleCols(kSplit, kSplit2 - kSplit);
+    fused_filter.ProcessBlock(block, &block);
+    output.middleCols(kSplit, kSplit2 - kSplit) = block;
+    fused_filter.set_processing_mode(BiquadCascadeProcessingMode::kFused);
+    block = output.rightCols(kNumSamples - kSplit2);
+    fused_filter.ProcessBlock(block, &block);
+    output.rightCols(kNumSamples - kSplit2) = block;
+
+    EXPECT_THAT(output, EigenArrayNear(expected, 1e-5));
+  }
+}
+
+// Makes distinct, stable coefficients for each of num_channels channels.
+std::vector<BiquadFilterCoefficients> MakeChannelCoefficients(
+    int num_channels, int stage) {
+  const std::vector<BiquadFilterCoefficients> base_coeffs = {
+      {{-0.2, 1.9, 0.4}, {0.5, -0.2, 0.1}},
+      {{0.3, 0.1, -0.2}, {1.0, 0.4, 0.3}},
+      {{1.0, -1.6, 0.7}, {2.0, -0.9, 0.2}}};
+  std::vector<BiquadFilterCoefficients> channel_coeffs;
+  for (int c = 0; c < num_channels; ++c) {
+    BiquadFilterCoefficients coeffs =
+        base_coeffs[(c + stage) % base_coeffs.size()];
+    coeffs.AdjustGain(1.0 + 0.1 * c);
+    channel_coeffs.push_back(coeffs);
+  }
+  return channel_coeffs;
+}
+
+// Test that a BiquadFilter with per-channel coefficients filters each channel
+// with its own coefficients.
+TYPED_TEST(BiquadFilterTypedTest, BiquadFilterPerChannelCoefficients) {
+  using SampleType = TypeParam;
+  SCOPED_TRACE(
+      absl::StrFormat("SampleType: %s", GetTypeName<SampleType>().c_str()));
+
+  constexpr int kNumSamples = 20;
+  srand(0 /* seed */);
+
+  using FilterType = BiquadFilter<SampleType>;
+  const int kNumChannelsAtCompileTime = FilterType::kNumChannelsAtCompileTime;
+  using ScalarType = typename FilterType::ScalarType;
+  using BlockOfSamples = typename Eigen::Array<
+      ScalarType, kNumChannelsAtCompileTime, Dynamic>;
+  using Samples = Array<ScalarType, Dynamic, Dynamic>;
+
+  for (int num_channels : {1, 3, 11, 17}) {
+    if ((kNumChannelsAtCompileTime != Dynamic &&
+         kNumChannelsAtCompileTime != num_channels) ||
+        (!internal::IsEigenType<SampleType>::Value && num_channels != 1)) {
+      continue;  // Skip if SampleType is incompatible with num_channels.
+    }
+    SCOPED_TRACE("num_channels: " + testing::PrintToString(num_channels));
+    const std::vector<BiquadFilterCoefficients> channel_coeffs =
+        MakeChannelCoefficients(num_channels, 0);
+    FilterType filter;
+    filter.Init(num_channels, channel_coeffs);
+    EXPECT_EQ(filter.num_channels(), num_channels);
+
+    BlockOfSamples input = BlockOfSamples::Random(num_channels, kNumSamples);
+    BlockOfSamples output;
+    filter.ProcessBlock(input, &output);
+
+    for (int c = 0; c < num_channels; ++c) {
+      const Samples input_row = input.row(c);
+      const Samples output_row = output.row(c);
+      EXPECT_THAT(output_row, EigenArrayNear(ReferenceBiquadFilter<ScalarType>(
+          channel_coeffs[c], input_row), 1e-5)) << "channel: " << c;
+    }
+  }
+}
+
+// Test SetSteadyStateCondition() with per-channel coefficients.
+TEST(BiquadFilterTest, BiquadFilterPerChannelSteadyState) {
+  constexpr int kNumChannels = 5;
+  const std::vector<BiquadFilterCoefficients> channel_coeffs =
+      MakeChannelCoefficients(kNumChannels, 0);
+  BiquadFilter<ArrayXf> filter;
+  filter.Init(kNumChannels, channel_coeffs);
+
+  // In steady state, a DC input is scaled by each channel's DC gain.
+  const ArrayXXf input = ArrayXXf::Constant(kNumChannels, 3, 0.5f);
+  filter.SetSteadyStateCondition(input.col(0));
+  ArrayXXf output;
+  filter.ProcessBlock(input, &output);
+  for (int c = 0; c < kNumChannels; ++c) {
+    const BiquadFilterCoefficients& coeffs = channel_coeffs[c];
+    const double dc_gain = (coeffs.b[0] + coeffs.b[1] + coeffs.b[2]) /
+                           (coeffs.a[0] + coeffs.a[1] + coeffs.a[2]);
+    for (int n = 0; n < input.cols(); ++n) {
+      EXPECT_NEAR(output(c, n), 0.5 * dc_gain, 1e-5) << "channel: " << c;
+    }
+  }
+}
+
+// Test that a BiquadFilterCascade with per-channel coefficients matches a
+// per-channel reference in every processing mode.
+TYPED_TEST(BiquadFilterTypedTest, BiquadFilterCascadePerChannelCoefficients) {
+  using SampleType = TypeParam;
+  SCOPED_TRACE(
+      absl::StrFormat("SampleType: %s", GetTypeName<SampleType>().c_str()));
+
+  constexpr int kNumSamples = 40;
+  constexpr int kNumStages = 3;
+  srand(0 /* seed */);
+
+  using FilterType = BiquadFilterCascade<SampleType>;
+  const int kNumChannelsAtCompileTime = FilterType::kNumChannelsAtCompileTime;
+  using ScalarType = typename FilterType::ScalarType;
+  using BlockOfSamples = typename Eigen::Array<
+      ScalarType, kNumChannelsAtCompileTime, Dynamic>;
+  using Samples = Array<ScalarType, Dynamic, Dynamic>;
+
+  for (int num_channels : {1, 3, 8, 11, 17}) {
+    if ((kNumChannelsAtCompileTime != Dynamic &&
+         kNumChannelsAtCompileTime != num_channels) ||
+        (!internal::IsEigenType<SampleType>::Value && num_channels != 1)) {
+      continue;  // Skip if SampleType is incompatible with num_channels.
+    }
+    SCOPED_TRACE("num_channels: " + testing::PrintToString(num_channels));
+    std::vector<BiquadFilterCascadeCoefficients> channel_coeffs(num_channels);
+    for (int i = 0; i < kNumStages; ++i) {
+      const std::vector<BiquadFilterCoefficients> stage_coeffs =
+          MakeChannelCoefficients(num_channels, i);
+      for (int c = 0; c < num_channels; ++c) {
+        channel_coeffs[c].AppendBiquad(stage_coeffs[c]);
+      }
+    }
+    const BlockOfSamples input =
+        BlockOfSamples::Random(num_channels, kNumSamples);
+
+    for (BiquadCascadeProcessingMode mode :
+         {BiquadCascadeProcessingMode::kStageByStage,
+          BiquadCascadeProcessingMode::kFused,
+          BiquadCascadeProcessingMode::kBlockStateSpace}) {
+      SCOPED_TRACE("mode: " + testing::PrintToString(static_cast<int>(mode)));
+      FilterType filter;
+      filter.Init(num_channels, channel_coeffs);
+      filter.set_processing_mode(mode);
+      BlockOfSamples output;
+      filter.ProcessBlock(input, &output);
+
+      for (int c = 0; c < num_channels; ++c) {
+        Samples expected = input.row(c);
+        for (const BiquadFilterCoefficients& coeffs :
+             channel_coeffs[c].coeffs) {
+          expected = ReferenceBiquadFilter<ScalarType>(coeffs, expected);
+        }
+        const Samples output_row = output.row(c);
+        EXPECT_THAT(output_row, EigenArrayNear(expected, 1e-4))
+            << "channel: " << c;
+      }
+    }
+  }
+}
+
+// Test that the block state-space mode matches stage-by-stage processing,
+// including partial blocks and switching modes while streaming.
+TYPED_TEST(BiquadFilterTypedTest, BiquadFilterCascadeBlockStateSpace) {
+  using SampleType = TypeParam;
+  SCOPED_TRACE(
+      absl::StrFormat("SampleType: %s", GetTypeName<SampleType>().c_str()));
+
+  constexpr int kNumSamples = 200;
+  const std::vector<BiquadFilterCoefficients> all_coeffs = {
+      {{-0.2, 1.9, 0.4}, {0.5, -0.2, 0.1}},
+      {{0.3, 0.1, -0.2}, {1.0, 0.4, 0.3}},
+      // Resonant lowpass with poles near z = 1.
+      {{0.001, 0.002, 0.001}, {1.0, -1.97, 0.975}}};
+  srand(0 /* seed */);
+
+  using FilterType = BiquadFilterCascade<SampleType>;
+  const int kNumChannelsAtCompileTime = FilterType::kNumChannelsAtCompileTime;
+  using ScalarType = typename FilterType::ScalarType;
+  using BlockOfSamples = typename Eigen::Array<
+      ScalarType, kNumChannelsAtCompileTime, Dynamic>;
+
+  for (int num_channels : {1, 3, 11}) {
+    if ((kNumChannelsAtCompileTime != Dynamic &&
+         kNumChannelsAtCompileTime != num_channels) ||
+        (!internal::IsEigenType<SampleType>::Value && num_channels != 1)) {
+      continue;  // Skip if SampleType is incompatible with num_channels.
+    }
+    SCOPED_TRACE("num_channels: " + testing::PrintToString(num_channels));
+    for (int num_stages = 1; num_stages <= all_coeffs.size(); ++num_stages) {
+      SCOPED_TRACE("num_stages: " + testing::PrintToString(num_stages));
+      const BiquadFilterCascadeCoefficients cascade_coeffs(
+          std::vector<BiquadFilterCoefficients>(
+              all_coeffs.begin(), all_coeffs.begin() + num_stages));
+      FilterType reference_filter;
+      reference_filter.Init(num_channels, cascade_coeffs);
+      FilterType filter;
+      filter.Init(num_channels, cascade_coeffs);
+      filter.set_processing_mode(
+          BiquadCascadeProcessingMode::kBlockStateSpace);
+
+      const BlockOfSamples input =
+          BlockOfSamples::Random(num_channels, kNumSamples);
+      BlockOfSamples expected;
+      reference_filter.ProcessBlock(input, &expected);
+
+      BlockOfSamples output(num_channels, kNumSamples);
+      int start = 0;
+      for (int block_size : {37, 16, 5, 64, 78}) {
+        // Process one block stage by stage to switch modes midstream.
+        if (block_size == 5) {
+          filter.set_processing_mode(
+              BiquadCascadeProcessingMode::kStageByStage);
+        }
+        BlockOfSamples block = input.middleCols(start, block_size);
+        filter.ProcessBlock(block, &block);  // In place.
+        output.middleCols(start, block_size) = block;
+        filter.set_processing_mode(
+            BiquadCascadeProcessingMode::kBlockStateSpace);
+        start += block_size;
+      }
+      ASSERT_EQ(start, kNumSamples);
+      EXPECT_THAT(output, EigenArrayNear(expected, 1e-4));
+    }
+  }
+}
+
 void BM_BiquadFilterScalarFloat(benchmark::State& state) {
   constexpr int kSamplePerBlock = 1000;
   const BiquadFilterCoefficients coeffs = {{-0.2, 1.9, 0.4}, {0.5, -0.2, 0.1}};
@@ -808,7 +1115,27 @@ void BM_BiquadFilterArrayXf(benchmark::State& state) {
   state.SetItemsProcessed(kSamplePerBlock * state.iterations());
 }
 BENCHMARK(BM_BiquadFilterArrayXf)
-    ->DenseRange(1, 10);
+    ->DenseRange(1, 10)
+    ->RangeMultiplier(2)->Range(16, 256);
+
+void BM_BiquadFilterArrayXfPerChannel(benchmark::State& state) {
+  const int num_channels = state.range(0);
+  constexpr int kSamplePerBlock = 1000;
+  srand(0 /* seed */);
+  ArrayXXf input = ArrayXXf::Random(num_channels, kSamplePerBlock);
+  ArrayXXf output(num_channels, kSamplePerBlock);
+  BiquadFilter<ArrayXf> filter;
+  filter.Init(num_channels, MakeChannelCoefficients(num_channels, 0));
+
+  while (state.KeepRunning()) {
+    filter.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kSamplePerBlock * state.iterations());
+}
+BENCHMARK(BM_BiquadFilterArrayXfPerChannel)
+    ->DenseRange(1, 10)
+    ->RangeMultiplier(2)->Range(16, 256);
 
 template <bool kIsAligned>
 void BM_BiquadFilterMapImpl(benchmark::State& state) {
@@ -910,6 +1237,26 @@ void BM_BiquadFilterCascadeScalarFloatBlock(benchmark::State& state) {
 }
 BENCHMARK(BM_BiquadFilterCascadeScalarFloatBlock);
 
+void BM_BiquadFilterCascadeScalarFloatBlockStateSpace(
+    benchmark::State& state) {
+  constexpr int kSamplePerBlock = 1000;
+  const BiquadFilterCoefficients coeffs = {{-0.2, 1.9, 0.4}, {0.5, -0.2, 0.1}};
+  srand(0 /* seed */);
+  ArrayXf input = ArrayXf::Random(kSamplePerBlock);
+  ArrayXf output(kSamplePerBlock);
+  BiquadFilterCascade<float> filter;
+  std::vector<BiquadFilterCoefficients> all_coeffs(4, coeffs);
+  filter.Init(1, BiquadFilterCascadeCoefficients(all_coeffs));
+  filter.set_processing_mode(BiquadCascadeProcessingMode::kBlockStateSpace);
+
+  while (state.KeepRunning()) {
+    filter.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kSamplePerBlock * state.iterations());
+}
+BENCHMARK(BM_BiquadFilterCascadeScalarFloatBlockStateSpace);
+
 void BM_BiquadFilterCascadeArrayXfSample(benchmark::State& state) {
   const int num_channels = state.range(0);
   constexpr int kSamplePerBlock = 1000;
@@ -953,6 +1300,57 @@ void BM_BiquadFilterCascadeArrayXfBlock(benchmark::State& state) {
 BENCHMARK(BM_BiquadFilterCascadeArrayXfBlock)
     ->DenseRange(1, 10);
 
+void BM_BiquadFilterCascadeArrayXfBlockFused(benchmark::State& state) {
+  const int num_channels = state.range(0);
+  constexpr int kSamplePerBlock = 1000;
+  const BiquadFilterCoefficients coeffs = {{-0.2, 1.9, 0.4}, {0.5, -0.2, 0.1}};
+  srand(0 /* seed */);
+  ArrayXXf input = ArrayXXf::Random(num_channels, kSamplePerBlock);
+  ArrayXXf output(num_channels, kSamplePerBlock);
+  BiquadFilterCascade<ArrayXf> filter;
+  std::vector<BiquadFilterCoefficients> all_coeffs(4, coeffs);
+  filter.Init(num_channels, BiquadFilterCascadeCoefficients(all_coeffs));
+  filter.set_processing_mode(BiquadCascadeProcessingMode::kFused);
+
+  while (state.KeepRunning()) {
+    filter.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kSamplePerBlock * state.iterations());
+}
+BENCHMARK(BM_BiquadFilterCascadeArrayXfBlockFused)
+    ->DenseRange(1, 10);
+
+// An 8-stage equalizer on a large multichannel block, which is memory-bound
+// when processed stage by stage. The first argument selects the mode (0 for
+// stage by stage, 1 for fused), the second the number of channels.
+void BM_BiquadFilterCascadeLargeBlock(benchmark::State& state) {
+  const BiquadCascadeProcessingMode mode = state.range(0) ?
+      BiquadCascadeProcessingMode::kFused :
+      BiquadCascadeProcessingMode::kStageByStage;
+  const int num_channels = state.range(1);
+  constexpr int kSamplePerBlock = 4096;
+  const BiquadFilterCoefficients coeffs = {{-0.2, 1.9, 0.4}, {0.5, -0.2, 0.1}};
+  srand(0 /* seed */);
+  ArrayXXf input = ArrayXXf::Random(num_channels, kSamplePerBlock);
+  ArrayXXf output(num_channels, kSamplePerBlock);
+  BiquadFilterCascade<ArrayXf> filter;
+  std::vector<BiquadFilterCoefficients> all_coeffs(8, coeffs);
+  filter.Init(num_channels, BiquadFilterCascadeCoefficients(all_coeffs));
+  filter.set_processing_mode(mode);
+
+  while (state.KeepRunning()) {
+    filter.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kSamplePerBlock * state.iterations());
+}
+BENCHMARK(BM_BiquadFilterCascadeLargeBlock)
+    ->Args({0, 8})
+    ->Args({1, 8})
+    ->Args({0, 64})
+    ->Args({1, 64});
+
 template <int kNumChannels>
 void BM_BiquadFilterCascadeArrayNfSample(benchmark::State& state) {
   constexpr int kSamplePerBlock = 1000;
@@ -1016,6 +1414,37 @@ BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlock, 8);
 BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlock, 9);
 BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlock, 10);
 
+template <int kNumChannels>
+void BM_BiquadFilterCascadeArrayNfBlockFused(benchmark::State& state) {
+  constexpr int kSamplePerBlock = 1000;
+  const BiquadFilterCoefficients coeffs = {{-0.2, 1.9, 0.4}, {0.5, -0.2, 0.1}};
+  srand(0 /* seed */);
+  using ArrayNf = Eigen::Array<float, kNumChannels, 1>;
+  using ArrayNXf = Eigen::Array<float, kNumChannels, Dynamic>;
+  ArrayNXf input = ArrayNXf::Random(kNumChannels, kSamplePerBlock);
+  ArrayNXf output(kNumChannels, kSamplePerBlock);
+  BiquadFilterCascade<ArrayNf> filter;
+  std::vector<BiquadFilterCoefficients> all_coeffs(4, coeffs);
+  filter.Init(kNumChannels, BiquadFilterCascadeCoefficients(all_coeffs));
+  filter.set_processing_mode(BiquadCascadeProcessingMode::kFused);
+
+  while (state.KeepRunning()) {
+    filter.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kSamplePerBlock * state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlockFused, 1);
+BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlockFused, 2);
+BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlockFused, 3);
+BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlockFused, 4);
+BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlockFused, 5);
+BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlockFused, 6);
+BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlockFused, 7);
+BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlockFused, 8);
+BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlockFused, 9);
+BENCHMARK_TEMPLATE(BM_BiquadFilterCascadeArrayNfBlockFused, 10);
+
 // Creates arrays with 2N rows and only operates on top N rows.
 template <int kNumChannels>
 void BM_BiquadFilterCascadeStridedMapNfBlock(benchmark::State& state) {
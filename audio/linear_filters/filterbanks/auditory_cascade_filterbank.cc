@@ -139,7 +139,30 @@ void AuditoryCascadeFilterbank::Init(int num_mics, float sample_rate) {
   filtered_output_.clear();
 
   filtered_output_.resize(filters_.size());
+  num_output_samples_.assign(filters_.size(), 0);
   initialized_ = true;
+  prepared_ = false;
+}
+
+void AuditoryCascadeFilterbank::Prepare(int max_block_size_samples) {
+  DCHECK(initialized_);
+  DCHECK_GE(max_block_size_samples, 0);
+  prepared_ = true;
+  int max_stage_samples = max_block_size_samples;
+  int decimator_index = 0;
+  for (int stage = 0; stage < filters_.size(); ++stage) {
+    if (stage > 0 && sample_rates_[stage] != sample_rates_[stage - 1]) {
+      if (params_.use_allpass_decimator()) {
+        allpass_decimators_[decimator_index].Prepare(max_stage_samples);
+      } else {
+        decimators_[decimator_index].Prepare(max_stage_samples);
+      }
+      ++decimator_index;
+      max_stage_samples = (max_stage_samples + 1) / 2;
+    }
+    filtered_output_[stage].resize(num_mics_, max_stage_samples);
+    diff_filters_[stage].Prepare(max_stage_samples);
+  }
 }
 
 void AuditoryCascadeFilterbank::Reset() {
@@ -149,42 +172,62 @@ void AuditoryCascadeFilterbank::Reset() {
   for (auto& decimator : decimators_) {
     decimator.Reset();
   }
+  for (auto& decimator : allpass_decimators_) {
+    decimator.Reset();
+  }
   for (auto& filter : diff_filters_) {
     filter.Reset();
   }
 }
 
-// TODO: The calls to resize aren't problematic for fixed,
-// power of two input block sizes, but they could be if the input size is
-// variable (or if there are more decimate stages than there are factors of 2
-// in input.size()).
+AuditoryCascadeFilterbank::StageOutputBlock
+AuditoryCascadeFilterbank::MutableStageOutput(int stage, int num_samples) {
+  if (!prepared_ || filtered_output_[stage].cols() < num_samples) {
+    filtered_output_[stage].resize(num_mics_, num_samples);
+  }
+  num_output_samples_[stage] = num_samples;
+  return filtered_output_[stage].leftCols(num_samples);
+}
+
+AuditoryCascadeFilterbank::ConstOutputBlock AuditoryCascadeFilterbank::Decimate(
+    int decimator_index, const ConstOutputBlock& input) {
+  if (params_.use_allpass_decimator()) {
+    return allpass_decimators_[decimator_index].Decimate(input);
+  } else {
+    return decimators_[decimator_index].Decimate(input);
+  }
+}
+
+// After Prepare(), the stage outputs are the leftmost columns of
+// filtered_output_, so that changing the block size only allocates for a block
+// larger than the prepared size.
 void AuditoryCascadeFilterbank::ProcessBlock(const ArrayXXf& input) {
   // Process the first stage.
-  filtered_output_[0].resize(input.rows(), input.cols());
-  filters_[0].ProcessBlock(input, &filtered_output_[0]);
+  StageOutputBlock first_stage_output = MutableStageOutput(0, input.cols());
+  filters_[0].ProcessBlock(input, &first_stage_output);
   // Process all remaining stages, decimating when the sample rate of the
   // current filterbank channel is not equal to that of the previous filterbank
   // channel.
   int decimator_index = 0;
   for (int stage = 1; stage < filters_.size(); ++stage) {
+    const ConstOutputBlock last_stage_output = StageOutput(stage - 1);
     if (sample_rates_[stage] != sample_rates_[stage - 1]) {
-      auto last_stage_decimated =
-          decimators_[decimator_index].Decimate(filtered_output_[stage - 1]);
+      const ConstOutputBlock last_stage_decimated =
+          Decimate(decimator_index, last_stage_output);
       ++decimator_index;
-      filtered_output_[stage].resize(last_stage_decimated.rows(),
-                                     last_stage_decimated.cols());
-      filters_[stage].ProcessBlock(last_stage_decimated,
-                                   &filtered_output_[stage]);
+      StageOutputBlock stage_output =
+          MutableStageOutput(stage, last_stage_decimated.cols());
+      filters_[stage].ProcessBlock(last_stage_decimated, &stage_output);
     } else {
-      filtered_output_[stage].resize(filtered_output_[stage - 1].rows(),
-                                    filtered_output_[stage - 1].cols());
-      filters_[stage].ProcessBlock(filtered_output_[stage - 1],
-                                   &filtered_output_[stage]);
+      StageOutputBlock stage_output =
+          MutableStageOutput(stage, last_stage_output.cols());
+      filters_[stage].ProcessBlock(last_stage_output, &stage_output);
     }
   }
   for (int stage = 0; stage < filters_.size(); ++stage) {
-    diff_filters_[stage].ProcessBlock(filtered_output_[stage],
-                                      &filtered_output_[stage]);
+    StageOutputBlock stage_output =
+        MutableStageOutput(stage, num_output_samples_[stage]);
+    diff_filters_[stage].ProcessBlock(stage_output, &stage_output);
   }
 }
 
@@ -211,6 +254,7 @@ void AuditoryCascadeFilterbank::DesignFilterbank(float full_sample_rate_hz) {
   bandwidth_hz_.clear();
   exposed_filter_indices_.clear();
   decimators_.clear();
+  allpass_decimators_.clear();
   diff_filters_.clear();
   filters_.clear();
   sample_rates_.clear();
@@ -263,8 +307,13 @@ float AuditoryCascadeFilterbank::DesignFilterbankStage(
   if (decimate_first) {
     // Halve the sample rate to start a new subbank.
     stage_sample_rate /= 2.0;
-    decimators_.emplace_back();
-    decimators_.back().Init(num_mics_);
+    if (params_.use_allpass_decimator()) {
+      allpass_decimators_.emplace_back();
+      allpass_decimators_.back().Init(num_mics_);
+    } else {
+      decimators_.emplace_back();
+      decimators_.back().Init(num_mics_);
+    }
   }
   diff_filters_.emplace_back();
   diff_filters_.back().Init(num_mics_);
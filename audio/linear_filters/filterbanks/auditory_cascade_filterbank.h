@@ -24,6 +24,7 @@
 #include "audio/linear_filters/biquad_filter_coefficients.h"
 #include "audio/linear_filters/filterbanks/auditory_cascade_filterbank_params.pb.h"
 #include "audio/linear_filters/filterbanks/factor_two_decimator.h"
+#include "audio/linear_filters/filterbanks/polyphase_allpass_decimator.h"
 #include "audio/linear_filters/two_tap_fir_filter.h"
 #include "glog/logging.h"
 #include "third_party/eigen3/Eigen/Core"
@@ -41,11 +42,17 @@ namespace linear_filters {
 
 class AuditoryCascadeFilterbank {
  public:
+  // Filtered output of a stage. This is a view of the filterbank's buffers,
+  // valid until the next call to a non-const method.
+  using ConstOutputBlock =
+      Eigen::Block<const Eigen::ArrayXXf, Eigen::Dynamic, Eigen::Dynamic, true>;
+
   explicit AuditoryCascadeFilterbank(
       const AuditoryCascadeFilterbankParams& params,
       bool allow_decimation = true)
       : num_mics_(0),
         initialized_(false),
+        prepared_(false),
         params_(params),
         allow_decimation_(allow_decimation) {}
 
@@ -58,6 +65,13 @@ class AuditoryCascadeFilterbank {
 
   void Init(int num_mics, float sample_rate);
 
+  // Allocates the buffers for blocks of up to max_block_size_samples samples.
+  // After this, ProcessBlock() does not allocate for such blocks, so it is safe
+  // to call from a realtime thread, and the outputs should be read with
+  // FilteredOutputBlock(). Without this, the buffers are resized to each block.
+  // Must be called after Init().
+  void Prepare(int max_block_size_samples);
+
   // Clear the internal state of the filter. This does not reset filter
   // coefficients.
   void Reset();
@@ -66,7 +80,10 @@ class AuditoryCascadeFilterbank {
   // column-major data, where the number of rows equals GetNumChannels().
   void ProcessBlock(const Eigen::ArrayXXf& input);
 
-  // Filtered output from the filter_stage-th of the filterbank.
+  // Filtered output from the filter_stage-th of the filterbank. After
+  // Prepare(), this keeps the prepared number of columns (for the stage's
+  // sample rate), and only the leftmost columns are the output of the last
+  // block.
   const Eigen::ArrayXXf& FilteredOutput(int filter_stage) const {
     DCHECK(initialized_);
 
@@ -74,6 +91,15 @@ class AuditoryCascadeFilterbank {
     return filtered_output_[exposed_filter_indices_[filter_stage]];
   }
 
+  // Like FilteredOutput(), but always has one column per output sample of the
+  // last block.
+  ConstOutputBlock FilteredOutputBlock(int filter_stage) const {
+    DCHECK(initialized_);
+
+    DCHECK_LT(filter_stage, exposed_filter_indices_.size());
+    return StageOutput(exposed_filter_indices_[filter_stage]);
+  }
+
   float GetNumMics() const {
     DCHECK(initialized_);
     return num_mics_;
@@ -113,6 +139,24 @@ class AuditoryCascadeFilterbank {
   }
 
  private:
+  using StageOutputBlock =
+      Eigen::Block<Eigen::ArrayXXf, Eigen::Dynamic, Eigen::Dynamic, true>;
+
+  // Output of internal stage, stage.
+  ConstOutputBlock StageOutput(int stage) const {
+    return ConstOutputBlock(filtered_output_[stage], 0, 0, num_mics_,
+                            num_output_samples_[stage]);
+  }
+
+  // Sets the number of output samples of internal stage, stage, resizing its
+  // buffer (or after Prepare(), growing it) if needed, and returns a view of
+  // the output.
+  StageOutputBlock MutableStageOutput(int stage, int num_samples);
+
+  // Decimates input with the decimator_index-th decimator of the kind selected
+  // by params_.use_allpass_decimator().
+  ConstOutputBlock Decimate(int decimator_index, const ConstOutputBlock& input);
+
   // Design functions.
   void DesignFilterbank(float sample_rate);
 
@@ -123,6 +167,8 @@ class AuditoryCascadeFilterbank {
   int num_mics_;
 
   bool initialized_;
+  // Whether Prepare() was called, in which case filtered_output_ only grows.
+  bool prepared_;
 
   const AuditoryCascadeFilterbankParams params_;
   bool allow_decimation_;
@@ -140,9 +186,10 @@ class AuditoryCascadeFilterbank {
   // The sample rate, in Hz, of each stage of the filterbank.
   std::vector<float> sample_rates_;
 
-  // filtered_output_[i] is the filtered output for the ith stage of the
-  // cascade.
+  // The leftmost num_output_samples_[i] columns of filtered_output_[i] are the
+  // filtered output for the ith stage of the cascade.
   std::vector<Eigen::ArrayXXf> filtered_output_;
+  std::vector<int> num_output_samples_;
 
   // A filter for taking the first difference of each filterbank channel. One
   // of the main intended use cases of CascadedFilterbank is to make models of
@@ -152,8 +199,10 @@ class AuditoryCascadeFilterbank {
 
   std::vector<FirstDifferenceFilter> diff_filters_;
 
-  // Decimators that are used to reduce the sampling rate.
+  // Decimators that are used to reduce the sampling rate. Only one of these is
+  // nonempty, depending on params_.use_allpass_decimator().
   std::vector<FactorTwoDecimator> decimators_;
+  std::vector<PolyphaseAllpassDecimator> allpass_decimators_;
 
   // A mapping from the indices of filters exposed through the public interface
   // to the bank of filters that are used internally (whether exposed or not).
@@ -16,6 +16,10 @@
 
 #include "audio/linear_filters/filterbanks/auditory_cascade_filterbank.h"
 
+#include <cmath>
+#include <vector>
+
+#include "audio/dsp/heap_allocation_counter.h"
 #include "audio/dsp/testing_util.h"
 #include "audio/linear_filters/filterbanks/auditory_cascade_filterbank_params.pb.h"
 #include "glog/logging.h"
@@ -108,6 +112,30 @@ TEST_P(AuditoryFilterbankBuilderTestWithParam, ResetTest) {
   }
 }
 
+TEST_P(AuditoryFilterbankBuilderTestWithParam, PreparedDoesNotAllocate) {
+  constexpr int kMaxBlockSize = 256;
+  AuditoryCascadeFilterbank unprepared_cascade(params_, GetParam());
+  unprepared_cascade.Init(kNumMics, kSampleRate);
+  cascade_.Prepare(kMaxBlockSize);
+  // Odd block sizes make the decimated output sizes vary from block to block.
+  for (int num_samples : {kMaxBlockSize, 37, 1, 0, 255, 100}) {
+    SCOPED_TRACE(StrFormat("num_samples: %d", num_samples));
+    Eigen::ArrayXXf samples = Eigen::ArrayXXf::Random(kNumMics, num_samples);
+    {
+      audio_dsp::ScopedHeapAllocationCounter counter;
+      cascade_.ProcessBlock(samples);
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+    unprepared_cascade.ProcessBlock(samples);
+    for (int stage = 0; stage < cascade_.GetFilterbankSize(); ++stage) {
+      const Eigen::ArrayXXf expected =
+          unprepared_cascade.FilteredOutput(stage);
+      ASSERT_THAT(cascade_.FilteredOutputBlock(stage),
+                  audio_dsp::EigenArrayNear(expected, 1e-6));
+    }
+  }
+}
+
 TEST_P(AuditoryFilterbankBuilderTestWithParam, PeaksAreOneTest) {
   // Computes the gain from all stages and accounts for the differentiator.
   auto FilterbankGainMagnitude = [this](int num_stages, float frequency_hz) {
@@ -232,5 +260,96 @@ TEST(AuditoryFilterbankBuilderTest, SelectSubsetTest) {
   }
 }
 
+// Returns the RMS of the output of the last stage for a sinusoid at
+// frequency_hz, skipping the start-up transient.
+float LastStageRms(const AuditoryCascadeFilterbankParams& params,
+                   float sample_rate, float frequency_hz) {
+  AuditoryCascadeFilterbank filterbank(params);
+  filterbank.Init(1, sample_rate);
+  const int num_samples = static_cast<int>(sample_rate);
+  Eigen::ArrayXXf input(1, num_samples);
+  for (int n = 0; n < num_samples; ++n) {
+    input(0, n) = std::sin(2 * M_PI * frequency_hz * n / sample_rate);
+  }
+  filterbank.ProcessBlock(input);
+  const int last_stage = filterbank.GetFilterbankSize() - 1;
+  const Eigen::ArrayXXf output = filterbank.FilteredOutput(last_stage);
+  const auto steady_state = output.rightCols(output.cols() / 2);
+  return std::sqrt(steady_state.square().mean());
+}
+
+TEST(AuditoryFilterbankBuilderTest, AllpassDecimatorTest) {
+  constexpr float kSampleRate = 48000.0f;
+  constexpr int kNumMics = 2;
+  AuditoryCascadeFilterbankParams params;
+  params.set_use_allpass_decimator(true);
+  // The antialiasing filter makes it safe to decimate earlier.
+  params.set_max_samples_per_cycle(8);
+  AuditoryCascadeFilterbankParams default_params;
+  AuditoryCascadeFilterbank filterbank(params);
+  filterbank.Init(kNumMics, kSampleRate);
+  AuditoryCascadeFilterbank default_filterbank(default_params);
+  default_filterbank.Init(kNumMics, kSampleRate);
+
+  // The stages have the same poles, but more of them run at lower sample
+  // rates.
+  ASSERT_EQ(filterbank.GetFilterbankSize(),
+            default_filterbank.GetFilterbankSize());
+  float total_rate = 0.0f;
+  float default_total_rate = 0.0f;
+  for (int stage = 0; stage < filterbank.GetFilterbankSize(); ++stage) {
+    EXPECT_FLOAT_EQ(filterbank.BandwidthHz(stage),
+                    default_filterbank.BandwidthHz(stage));
+    EXPECT_LE(filterbank.GetSampleRate(stage),
+              default_filterbank.GetSampleRate(stage));
+    total_rate += filterbank.GetSampleRate(stage);
+    default_total_rate += default_filterbank.GetSampleRate(stage);
+  }
+  EXPECT_LT(total_rate, 0.85f * default_total_rate);
+
+  // Processing in blocks of different sizes, including odd sizes, does not
+  // allocate once prepared and matches processing the whole signal at once.
+  constexpr int kMaxBlockSize = 256;
+  const Eigen::ArrayXXf input = Eigen::ArrayXXf::Random(kNumMics, 600);
+  AuditoryCascadeFilterbank whole_signal_filterbank(params);
+  whole_signal_filterbank.Init(kNumMics, kSampleRate);
+  whole_signal_filterbank.ProcessBlock(input);
+  filterbank.Prepare(kMaxBlockSize);
+  std::vector<Eigen::ArrayXXf> outputs(filterbank.GetFilterbankSize(),
+                                       Eigen::ArrayXXf(kNumMics, 0));
+  int start = 0;
+  for (int num_samples : {kMaxBlockSize, 37, 1, 0, 255, 51}) {
+    SCOPED_TRACE(StrFormat("num_samples: %d", num_samples));
+    const Eigen::ArrayXXf block = input.middleCols(start, num_samples);
+    {
+      audio_dsp::ScopedHeapAllocationCounter counter;
+      filterbank.ProcessBlock(block);
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+    for (int stage = 0; stage < filterbank.GetFilterbankSize(); ++stage) {
+      const auto stage_output = filterbank.FilteredOutputBlock(stage);
+      Eigen::ArrayXXf& output = outputs[stage];
+      output.conservativeResize(kNumMics,
+                                output.cols() + stage_output.cols());
+      output.rightCols(stage_output.cols()) = stage_output;
+    }
+    start += num_samples;
+  }
+  for (int stage = 0; stage < filterbank.GetFilterbankSize(); ++stage) {
+    SCOPED_TRACE(StrFormat("stage: %d", stage));
+    const Eigen::ArrayXXf expected =
+        whole_signal_filterbank.FilteredOutput(stage);
+    ASSERT_THAT(outputs[stage], audio_dsp::EigenArrayNear(expected, 1e-5));
+  }
+
+  // A tone near the Nyquist rate of the first decimated stage aliases to low
+  // frequencies when decimating by dropping samples.
+  AuditoryCascadeFilterbankParams plain_params = params;
+  plain_params.set_use_allpass_decimator(false);
+  const float frequency_hz = 0.48f * kSampleRate;
+  EXPECT_LT(LastStageRms(params, kSampleRate, frequency_hz),
+            0.1f * LastStageRms(plain_params, kSampleRate, frequency_hz));
+}
+
 }  // namespace
 }  // namespace linear_filters
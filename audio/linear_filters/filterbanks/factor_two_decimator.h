@@ -35,37 +35,58 @@ class FactorTwoDecimator {
   using ConstDecimatedArrayXXf = Eigen::Map<const Eigen::ArrayXXf, 0,
                                             Eigen::OuterStride<Eigen::Dynamic>>;
 
+  // Decimated output of Decimate(). This is a view of the decimator's
+  // workspace, valid until the next call to a non-const method.
+  using ConstDecimatedBlock =
+      Eigen::Block<const Eigen::ArrayXXf, Eigen::Dynamic, Eigen::Dynamic, true>;
+
   void Init(int num_mics) {
     DCHECK_GE(num_mics, 0);
     num_mics_ = num_mics;
+    workspace_.resize(num_mics_, 0);
     Reset();
   }
 
+  // Allocates the workspace for input blocks of up to max_block_size_samples
+  // samples, so that Decimate() does not allocate for such blocks. Without
+  // this, the workspace grows as needed.
+  void Prepare(int max_block_size_samples) {
+    DCHECK_GE(max_block_size_samples, 0);
+    workspace_.resize(num_mics_, (max_block_size_samples + 1) / 2);
+  }
+
   void Reset() {
     skip_next_sample_ = false;
-    workspace_.resize(num_mics_, 0);
   }
 
-  // It is expected that input is column-major and that the number of rows
-  // equals num_mics (as passed to Init()).
-  const Eigen::ArrayXXf& Decimate(const Eigen::ArrayXXf& input) {
-    // There is a copy involved when the ConstDecimatedArrayXXf is casted to an
-    // ArrayXXf. This forces the output to be a non-strided structure, which
+  // It is expected that input is column-major with contiguous columns and
+  // that the number of rows equals num_mics (as passed to Init()).
+  ConstDecimatedBlock Decimate(const Eigen::Ref<const Eigen::ArrayXXf>& input) {
+    DCHECK_EQ(input.rows(), num_mics_);
+    const int num_output_samples = (input.cols() + !skip_next_sample_) / 2;
+    if (workspace_.cols() < num_output_samples) {
+      workspace_.resize(num_mics_, num_output_samples);
+    }
+    // There is a copy from the strided ConstDecimatedArrayXXf into the
+    // workspace. This forces the output to be a non-strided structure, which
     // allows it to be used by BiquadFilter and similar processing tools.
-    workspace_ = ConstDecimatedArrayXXf(
-        input.data() + (skip_next_sample_ ? num_mics_ : 0),
-        input.rows(), (input.cols() + !skip_next_sample_) / 2,
-        Eigen::OuterStride<Eigen::Dynamic>(2 * num_mics_));
+    workspace_.leftCols(num_output_samples) = ConstDecimatedArrayXXf(
+        input.data() + (skip_next_sample_ ? input.outerStride() : 0),
+        input.rows(), num_output_samples,
+        Eigen::OuterStride<Eigen::Dynamic>(2 * input.outerStride()));
     if (input.cols() % 2 == 1) {
       skip_next_sample_ = !skip_next_sample_;
     }
-    return workspace_;
+    return ConstDecimatedBlock(workspace_, 0, 0, num_mics_,
+                               num_output_samples);
   }
 
  private:
   int num_mics_;
   bool skip_next_sample_;
 
+  // Holds the decimated output in its leftmost columns. It has at least as
+  // many columns as the largest output so far.
   Eigen::ArrayXXf workspace_;
 };
 #endif  // AUDIO_LINEAR_FILTERS_FILTERBANKS_FACTOR_TWO_DECIMATOR_H_
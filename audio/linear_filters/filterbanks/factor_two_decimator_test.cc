@@ -16,6 +16,7 @@
 
 #include "audio/linear_filters/filterbanks/factor_two_decimator.h"
 
+#include "audio/dsp/heap_allocation_counter.h"
 #include "audio/dsp/testing_util.h"
 #include "gtest/gtest.h"
 #include "third_party/eigen3/Eigen/Core"
@@ -89,5 +90,32 @@ TEST(FactorTwoDecimatorTest, NoSamplesTest) {
   EXPECT_EQ(output.cols(), 0);
 }
 
+TEST(FactorTwoDecimatorTest, PreparedDoesNotAllocate) {
+  constexpr int kMaxBlockSize = 9;
+  FactorTwoDecimator decimator;
+  decimator.Init(2);
+  decimator.Prepare(kMaxBlockSize);
+  int total_samples = 0;
+  for (int num_samples : {kMaxBlockSize, 3, 0, 8, 1, 5}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    ArrayXXf data(2, num_samples);
+    for (int i = 0; i < num_samples; ++i) {
+      data.col(i).setConstant(total_samples + i);
+    }
+    audio_dsp::ScopedHeapAllocationCounter counter;
+    auto decimated_data = decimator.Decimate(data);
+    EXPECT_EQ(counter.num_allocations(), 0);
+    // The even-numbered samples of the stream are kept.
+    const int first_kept = total_samples + total_samples % 2;
+    ASSERT_EQ(decimated_data.cols(),
+              (total_samples + num_samples - first_kept + 1) / 2);
+    for (int i = 0; i < decimated_data.cols(); ++i) {
+      EXPECT_EQ(decimated_data(0, i), first_kept + 2 * i);
+      EXPECT_EQ(decimated_data(1, i), first_kept + 2 * i);
+    }
+    total_samples += num_samples;
+  }
+}
+
 }  // namespace
 }  // namespace linear_filters
@@ -0,0 +1,83 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/filterbanks/polyphase_allpass_decimator.h"
+
+#include <cmath>
+
+namespace linear_filters {
+
+using ::std::vector;
+
+namespace {
+
+// The theta function series below converge quickly since the nome is small;
+// terms below this are dropped.
+constexpr double kSeriesTolerance = 1e-100;
+
+}  // namespace
+
+// The poles of an elliptic halfband filter of order 2 * num_coefficients + 1
+// are on the imaginary axis of the z^2-plane, and are found from the Jacobi
+// elliptic functions of the transition band, evaluated with theta function
+// series in the nome q. See
+// R. A. Valenzuela and A. G. Constantinides, "Digital signal processing
+// schemes for efficient interpolation and decimation," IEE Proceedings G,
+// vol. 130, no. 6, 1983.
+vector<double> DesignHalfbandAllpassCoefficients(int num_coefficients,
+                                                 double transition_bandwidth) {
+  CHECK_GE(num_coefficients, 1);
+  CHECK_GT(transition_bandwidth, 0.0);
+  CHECK_LT(transition_bandwidth, 0.5);
+  // Selectivity parameter of the elliptic filter.
+  const double k =
+      std::pow(std::tan((1.0 - 2.0 * transition_bandwidth) * M_PI / 4.0), 2);
+  const double k_prime_sqrt = std::pow(1.0 - k * k, 0.25);
+  const double e = 0.5 * (1.0 - k_prime_sqrt) / (1.0 + k_prime_sqrt);
+  const double e4 = std::pow(e, 4);
+  // The nome, from the first terms of its series in e.
+  const double q = e * (1.0 + e4 * (2.0 + e4 * (15.0 + 150.0 * e4)));
+  const int order = 2 * num_coefficients + 1;
+
+  vector<double> coefficients(num_coefficients);
+  for (int index = 0; index < num_coefficients; ++index) {
+    const int c = index + 1;
+    double numerator = 0.0;
+    double term;
+    int i = 0;
+    do {
+      term = std::pow(q, i * (i + 1)) *
+             std::sin((2 * i + 1) * c * M_PI / order);
+      numerator += (i % 2 == 0) ? term : -term;
+      ++i;
+    } while (std::abs(term) > kSeriesTolerance);
+    numerator *= std::pow(q, 0.25);
+    double denominator = 0.5;
+    i = 1;
+    do {
+      term = std::pow(q, i * i) * std::cos(2 * i * c * M_PI / order);
+      denominator += (i % 2 == 0) ? term : -term;
+      ++i;
+    } while (std::abs(term) > kSeriesTolerance);
+    const double w = numerator / denominator;
+    const double w2 = w * w;
+    const double x = std::sqrt((1.0 - w2 * k) * (1.0 - w2 / k)) / (1.0 + w2);
+    coefficients[index] = (1.0 - x) / (1.0 + x);
+  }
+  return coefficients;
+}
+
+}  // namespace linear_filters
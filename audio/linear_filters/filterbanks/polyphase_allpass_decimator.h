@@ -0,0 +1,175 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Decimation by 2 with a polyphase IIR halfband lowpass filter.
+//
+// The filter is the sum of two allpass branches,
+//   H(z) = (A0(z^2) + z^-1 A1(z^2)) / 2,
+// where each branch is a cascade of first-order allpass sections in z^2,
+//   (a + z^-2) / (1 + a z^-2).
+// Since the branches are functions of z^2, each runs at the output rate on one
+// of the two polyphase components of the input, and each section costs one
+// multiply. With the default three coefficients, that is 4 multiplies per
+// output sample for about 53dB of stopband attenuation. The phase response is
+// not linear, but the passband magnitude is flat to within a few parts per
+// million.
+//
+// Reference:
+// P. A. Regalia, S. K. Mitra, and P. P. Vaidyanathan, "The digital all-pass
+// filter: a versatile signal processing building block," Proceedings of the
+// IEEE, vol. 76, no. 1, 1988.
+
+#ifndef AUDIO_LINEAR_FILTERS_FILTERBANKS_POLYPHASE_ALLPASS_DECIMATOR_H_
+#define AUDIO_LINEAR_FILTERS_FILTERBANKS_POLYPHASE_ALLPASS_DECIMATOR_H_
+
+#include <vector>
+
+#include "glog/logging.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+
+// Designs the allpass coefficients of an elliptic halfband filter with
+// num_coefficients first-order sections. transition_bandwidth is the width of
+// the transition band, centered on a quarter of the input sample rate, as a
+// fraction of the input sample rate: the passband ends at
+// 0.25 - transition_bandwidth / 2 and the stopband starts at
+// 0.25 + transition_bandwidth / 2. The coefficients alternate between the two
+// branches, starting with A0.
+std::vector<double> DesignHalfbandAllpassCoefficients(
+    int num_coefficients, double transition_bandwidth);
+
+// Decimates by 2 after lowpass filtering with a polyphase allpass halfband
+// filter. This has the same interface and output sizes as FactorTwoDecimator:
+// output sample m is the filtered signal at input sample 2m.
+class PolyphaseAllpassDecimator {
+ public:
+  // Decimated output of Decimate(). This is a view of the decimator's
+  // workspace, valid until the next call to a non-const method.
+  using ConstDecimatedBlock =
+      Eigen::Block<const Eigen::ArrayXXf, Eigen::Dynamic, Eigen::Dynamic, true>;
+
+  static constexpr int kDefaultNumCoefficients = 3;
+  static constexpr double kDefaultTransitionBandwidth = 0.1;
+
+  void Init(int num_mics, int num_coefficients = kDefaultNumCoefficients,
+            double transition_bandwidth = kDefaultTransitionBandwidth) {
+    DCHECK_GE(num_mics, 0);
+    DCHECK_GE(num_coefficients, 1);
+    DCHECK_GT(transition_bandwidth, 0.0);
+    DCHECK_LT(transition_bandwidth, 0.5);
+    num_mics_ = num_mics;
+    const std::vector<double> coefficients =
+        DesignHalfbandAllpassCoefficients(num_coefficients,
+                                          transition_bandwidth);
+    coefficients_.assign(coefficients.begin(), coefficients.end());
+    section_input_.resize(num_coefficients, num_mics_);
+    section_output_.resize(num_coefficients, num_mics_);
+    previous_odd_sample_.resize(num_mics_);
+    workspace_.resize(num_mics_, 0);
+    Reset();
+  }
+
+  // Allocates the workspace for input blocks of up to max_block_size_samples
+  // samples, so that Decimate() does not allocate for such blocks. Without
+  // this, the workspace grows as needed.
+  void Prepare(int max_block_size_samples) {
+    DCHECK_GE(max_block_size_samples, 0);
+    workspace_.resize(num_mics_, (max_block_size_samples + 1) / 2);
+  }
+
+  void Reset() {
+    skip_next_sample_ = false;
+    section_input_.setZero();
+    section_output_.setZero();
+    previous_odd_sample_.setZero();
+  }
+
+  const std::vector<float>& coefficients() const { return coefficients_; }
+
+  // It is expected that input is column-major with contiguous columns and
+  // that the number of rows equals num_mics (as passed to Init()).
+  ConstDecimatedBlock Decimate(const Eigen::Ref<const Eigen::ArrayXXf>& input) {
+    DCHECK_EQ(input.rows(), num_mics_);
+    const int num_output_samples = (input.cols() + !skip_next_sample_) / 2;
+    if (workspace_.cols() < num_output_samples) {
+      workspace_.resize(num_mics_, num_output_samples);
+    }
+    // Column of the first even-numbered sample of the stream in this block.
+    const int first_even = skip_next_sample_ ? 1 : 0;
+    const int num_coefficients = coefficients_.size();
+    const float* coefficients = coefficients_.data();
+    const int stride = input.outerStride();
+    // The sections are recursive, so the samples of each mic are processed in
+    // sequence with the state in locals.
+    for (int mic = 0; mic < num_mics_; ++mic) {
+      const float* input_mic = input.data() + mic;
+      float* output_mic = workspace_.data() + mic;
+      float* section_input = section_input_.col(mic).data();
+      float* section_output = section_output_.col(mic).data();
+      for (int m = 0; m < num_output_samples; ++m) {
+        const int even = first_even + 2 * m;
+        // Branch A0 filters the even-numbered samples and A1 the odd-numbered
+        // samples, which the z^-1 in front of A1 pairs with the next even one.
+        float branch[2] = {
+            input_mic[even * stride],
+            even > 0 ? input_mic[(even - 1) * stride]
+                     : previous_odd_sample_[mic]};
+        for (int k = 0; k < num_coefficients; ++k) {
+          float& sample = branch[k % 2];
+          const float filtered =
+              coefficients[k] * (sample - section_output[k]) +
+              section_input[k];
+          section_input[k] = sample;
+          section_output[k] = filtered;
+          sample = filtered;
+        }
+        output_mic[m * num_mics_] = 0.5f * (branch[0] + branch[1]);
+      }
+    }
+    if (input.cols() % 2 == 1) {
+      skip_next_sample_ = !skip_next_sample_;
+    }
+    // If the block ends with an odd-numbered sample, it pairs with the first
+    // sample of the next block.
+    if (!skip_next_sample_ && input.cols() > 0) {
+      previous_odd_sample_ = input.col(input.cols() - 1);
+    }
+    return ConstDecimatedBlock(workspace_, 0, 0, num_mics_,
+                               num_output_samples);
+  }
+
+ private:
+  int num_mics_;
+  bool skip_next_sample_;
+  std::vector<float> coefficients_;
+  // The previous input and output of each section, with a column per mic.
+  Eigen::ArrayXXf section_input_;
+  Eigen::ArrayXXf section_output_;
+  // The last odd-numbered sample of the previous block, for each mic.
+  Eigen::ArrayXf previous_odd_sample_;
+
+  // Holds the decimated output in its leftmost columns. It has at least as
+  // many columns as the largest output so far.
+  Eigen::ArrayXXf workspace_;
+};
+
+}  // namespace linear_filters
+
+#endif  // AUDIO_LINEAR_FILTERS_FILTERBANKS_POLYPHASE_ALLPASS_DECIMATOR_H_
@@ -0,0 +1,174 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/filterbanks/polyphase_allpass_decimator.h"
+
+#include <cmath>
+#include <random>
+#include <vector>
+
+#include "audio/dsp/heap_allocation_counter.h"
+#include "audio/dsp/testing_util.h"
+#include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+namespace {
+
+using ::Eigen::ArrayXXf;
+using ::std::vector;
+
+// Filters each row of input at the full rate with
+// H(z) = (A0(z^2) + z^-1 A1(z^2)) / 2 and keeps the even-numbered samples.
+ArrayXXf ReferenceDecimate(const vector<float>& coefficients,
+                           const ArrayXXf& input) {
+  ArrayXXf output(input.rows(), (input.cols() + 1) / 2);
+  for (int mic = 0; mic < input.rows(); ++mic) {
+    vector<double> branches[2] = {
+        vector<double>(input.cols()), vector<double>(input.cols())};
+    for (int n = 0; n < input.cols(); ++n) {
+      branches[0][n] = branches[1][n] = input(mic, n);
+    }
+    for (int k = 0; k < coefficients.size(); ++k) {
+      vector<double>& branch = branches[k % 2];
+      const vector<double> section_input = branch;
+      for (int n = 0; n < input.cols(); ++n) {
+        const double input_delayed = n >= 2 ? section_input[n - 2] : 0.0;
+        const double output_delayed = n >= 2 ? branch[n - 2] : 0.0;
+        branch[n] = coefficients[k] * (section_input[n] - output_delayed) +
+                    input_delayed;
+      }
+    }
+    for (int m = 0; m < output.cols(); ++m) {
+      output(mic, m) =
+          0.5 * (branches[0][2 * m] + (m > 0 ? branches[1][2 * m - 1] : 0.0));
+    }
+  }
+  return output;
+}
+
+TEST(PolyphaseAllpassDecimatorTest, DesignMatchesKnownCoefficients) {
+  EXPECT_THAT(DesignHalfbandAllpassCoefficients(2, 0.1),
+              testing::Pointwise(testing::DoubleNear(1e-6),
+                                 {0.236471, 0.714542}));
+  EXPECT_THAT(DesignHalfbandAllpassCoefficients(3, 0.1),
+              testing::Pointwise(testing::DoubleNear(1e-6),
+                                 {0.128456, 0.429567, 0.790676}));
+  EXPECT_THAT(DesignHalfbandAllpassCoefficients(4, 0.05),
+              testing::Pointwise(testing::DoubleNear(1e-6),
+                                 {0.120732, 0.390362, 0.663202, 0.890787}));
+}
+
+TEST(PolyphaseAllpassDecimatorTest, MatchesFullRateFilter) {
+  for (int num_coefficients : {1, 2, 3, 4}) {
+    SCOPED_TRACE("num_coefficients: " +
+                 testing::PrintToString(num_coefficients));
+    PolyphaseAllpassDecimator decimator;
+    decimator.Init(3, num_coefficients);
+    const ArrayXXf input = ArrayXXf::Random(3, 101);
+    const ArrayXXf output = decimator.Decimate(input);
+    EXPECT_THAT(output, audio_dsp::EigenArrayNear(
+        ReferenceDecimate(decimator.coefficients(), input), 1e-5));
+  }
+}
+
+TEST(PolyphaseAllpassDecimatorTest, StreamingMatchesSingleBlock) {
+  constexpr int kNumMics = 2;
+  constexpr int kNumSamples = 500;
+  const ArrayXXf input = ArrayXXf::Random(kNumMics, kNumSamples);
+  PolyphaseAllpassDecimator decimator;
+  decimator.Init(kNumMics);
+  const ArrayXXf expected = decimator.Decimate(input);
+  decimator.Reset();
+  std::mt19937 rng(0 /* seed */);
+  std::uniform_int_distribution<int> block_size_distribution(0, 25);
+  ArrayXXf output(kNumMics, 0);
+  for (int start = 0; start < kNumSamples;) {
+    const int block_size =
+        std::min(block_size_distribution(rng), kNumSamples - start);
+    const ArrayXXf block = decimator.Decimate(input.middleCols(start,
+                                                               block_size));
+    output.conservativeResize(kNumMics, output.cols() + block.cols());
+    output.rightCols(block.cols()) = block;
+    start += block_size;
+  }
+  EXPECT_THAT(output, audio_dsp::EigenArrayNear(expected, 1e-6));
+}
+
+// Returns the amplitude of a sinusoid with normalized frequency
+// cycles_per_sample after decimation, ignoring the start-up transient.
+float DecimatedAmplitude(float cycles_per_sample) {
+  constexpr int kNumSamples = 4000;
+  ArrayXXf input(1, kNumSamples);
+  for (int n = 0; n < kNumSamples; ++n) {
+    input(0, n) = std::cos(2 * M_PI * cycles_per_sample * n);
+  }
+  PolyphaseAllpassDecimator decimator;
+  decimator.Init(1);
+  const ArrayXXf output = decimator.Decimate(input);
+  return output.rightCols(output.cols() / 2).abs().maxCoeff();
+}
+
+TEST(PolyphaseAllpassDecimatorTest, FrequencyResponse) {
+  // With the default design, the passband ends at 0.2 and the stopband starts
+  // at 0.3 cycles per sample.
+  for (float cycles_per_sample : {0.01f, 0.1f, 0.15f, 0.2f}) {
+    SCOPED_TRACE("cycles_per_sample: " +
+                 testing::PrintToString(cycles_per_sample));
+    EXPECT_NEAR(DecimatedAmplitude(cycles_per_sample), 1.0f, 1e-2);
+  }
+  const float max_stopband_amplitude = std::pow(10.0f, -50.0f / 20.0f);
+  for (float cycles_per_sample : {0.3f, 0.35f, 0.4f, 0.45f, 0.49f}) {
+    SCOPED_TRACE("cycles_per_sample: " +
+                 testing::PrintToString(cycles_per_sample));
+    EXPECT_LT(DecimatedAmplitude(cycles_per_sample), max_stopband_amplitude);
+  }
+}
+
+TEST(PolyphaseAllpassDecimatorTest, NoSamplesTest) {
+  PolyphaseAllpassDecimator decimator;
+  decimator.Init(4);
+
+  ArrayXXf data(4, 0);
+  ArrayXXf output = decimator.Decimate(data);
+  EXPECT_EQ(output.cols(), 0);
+}
+
+TEST(PolyphaseAllpassDecimatorTest, PreparedDoesNotAllocate) {
+  constexpr int kMaxBlockSize = 9;
+  PolyphaseAllpassDecimator decimator;
+  decimator.Init(2);
+  decimator.Prepare(kMaxBlockSize);
+  int total_samples = 0;
+  for (int num_samples : {kMaxBlockSize, 3, 0, 8, 1, 5}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    const ArrayXXf data = ArrayXXf::Random(2, num_samples);
+    audio_dsp::ScopedHeapAllocationCounter counter;
+    auto decimated_data = decimator.Decimate(data);
+    EXPECT_EQ(counter.num_allocations(), 0);
+    // The output sizes are those of FactorTwoDecimator.
+    const int first_kept = total_samples + total_samples % 2;
+    EXPECT_EQ(decimated_data.cols(),
+              (total_samples + num_samples - first_kept + 1) / 2);
+    total_samples += num_samples;
+  }
+}
+
+}  // namespace
+}  // namespace linear_filters
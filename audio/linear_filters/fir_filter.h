@@ -17,6 +17,9 @@
 #ifndef AUDIO_LINEAR_FILTERS_FIR_FILTER_H_
 #define AUDIO_LINEAR_FILTERS_FIR_FILTER_H_
 
+#include <algorithm>
+
+#include "audio/linear_filters/partitioned_fft_convolver.h"
 #include "glog/logging.h"
 #include "third_party/eigen3/Eigen/Core"
 
@@ -24,18 +27,36 @@ namespace linear_filters {
 // FirFilter implements a one dimensional, linear finite impulse response filter
 // along the time dimension of a multi-channel signal. Having a different filter
 // for each channel is supported.
+//
+// Short filters are applied in direct form. Long filters are applied with
+// uniformly partitioned FFT convolution (see partitioned_fft_convolver.h),
+// which costs O(log(partition size) + filter size / partition size) per sample
+// rather than O(filter size) and adds no latency. By default, Init() chooses
+// between the two from the filter size.
 class FirFilter {
  public:
+  // Passed as partition_size to Init() to choose the method automatically.
+  static constexpr int kAutomaticPartitionSize = -1;
+  // Passed as partition_size to Init() to always use direct form.
+  static constexpr int kDirectForm = 0;
+
   FirFilter()
-    : num_channels_(0 /* uninitialized */) {}
+    : num_channels_(0 /* uninitialized */),
+      partition_size_(kDirectForm) {}
 
   // filter is a one-dimensional impulse response that will be applied to each
   // channel.
-  void Init(int num_channels, const Eigen::ArrayXf& filter);
+  //
+  // partition_size is kAutomaticPartitionSize, kDirectForm, or a power of two
+  // to use partitioned FFT convolution with partitions of that many samples.
+  // Processing blocks that are about the partition size is most efficient.
+  void Init(int num_channels, const Eigen::ArrayXf& filter,
+            int partition_size = kAutomaticPartitionSize);
   // The number of channels is inferred from the number of rows. This
   // initializer should be used if you want a filter whose impulse response is
   // channel-dependent.
-  void Init(const Eigen::ArrayXXf& filter);
+  void Init(const Eigen::ArrayXXf& filter,
+            int partition_size = kAutomaticPartitionSize);
 
   void Reset();
 
@@ -46,50 +67,58 @@ class FirFilter {
   // like ArrayXXf or MatrixXf (or a Map of either type), where the number of
   // rows equals the number of channels, as set by Init(...).
   // In-place processing is not supported.
+  //
+  // The filter state is allocated by Init(), so this does not allocate as long
+  // as output already has the right size. To process blocks of varying size on a
+  // realtime thread, pass a block of the columns of a preallocated array, e.g.
+  //   Eigen::ArrayXXf buffer(num_channels, max_block_size);
+  //   auto output = buffer.leftCols(input.cols());
+  //   filter.ProcessBlock(input, &output);
   template <typename InputType, typename OutputType>
   void ProcessBlock(const InputType& input, OutputType* output) {
     DCHECK_NE(num_channels_, 0) << "You must call Init() first!";
-    DCHECK_EQ(input.rows(), filter_.rows());
+    DCHECK_EQ(input.rows(), num_channels_);
     output->resize(num_channels_, input.cols());
-    output->setZero();
-    if (input.cols() == 0) { return; }  // Nothing to process!
-    // Move leftover state into output.
-    const int state_to_flush_frames = std::min<int>(input.cols(),
-                                                    state_.cols());
-    output->leftCols(state_to_flush_frames) =
-        state_.leftCols(state_to_flush_frames);
-
-    // TODO: The next block of code is nearly identical code to what
-    // we see in FixedDelayLine. Refactor into common function.
-
-    // Move remaining state to the left, if there is any.
-    int start_frame = 0;
-    while (true) {
-      const int sample_shift = state_to_flush_frames;
-      const int available_to_move = std::min<int>(
-          sample_shift, kernel_frames_ - (start_frame + sample_shift));
-      if (available_to_move <= 0) { break; }
-      state_.middleCols(start_frame, available_to_move) =
-          state_.middleCols(start_frame + sample_shift, available_to_move);
-      start_frame += sample_shift;
+    if (partition_size_ != kDirectForm) {
+      using StridedMap = Eigen::Map<Eigen::ArrayXXf, 0, Eigen::OuterStride<>>;
+      using ConstStridedMap =
+          Eigen::Map<const Eigen::ArrayXXf, 0, Eigen::OuterStride<>>;
+      convolver_.ProcessBlock(
+          ConstStridedMap(input.data(), input.rows(), input.cols(),
+                          Eigen::OuterStride<>(input.outerStride())),
+          StridedMap(output->data(), output->rows(), output->cols(),
+                     Eigen::OuterStride<>(output->outerStride())));
+      return;
     }
-    state_.rightCols(state_to_flush_frames).setZero();
-
-    for (int i = 0; i < input.cols(); ++i) {
-      auto this_frame = input.col(i);
-      workspace_ = filter_.colwise() * this_frame;
-      const int available_frames_in_output = input.cols() - i;
-
-      const int to_accum_frames = std::min<int>(available_frames_in_output,
-                                                kernel_frames_);
-      output->middleCols(i, to_accum_frames) +=
-          workspace_.leftCols(to_accum_frames);
-      // Copy spillover into the state buffer.
-      const int leftover_frames = kernel_frames_ - available_frames_in_output;
-      if (leftover_frames > 0) {
-        state_.leftCols(leftover_frames) +=
-            workspace_.rightCols(leftover_frames);
+    if (kernel_frames_ == 0) {
+      output->setZero();
+      return;
+    }
+    // Copy the input into the history buffer in chunks that are small enough
+    // not to overwrite the history needed for any output in the chunk, then
+    // compute each output as a dot product with a contiguous window of the
+    // history.
+    const int max_chunk_frames = history_size_ - kernel_frames_ + 1;
+    for (int start = 0; start < input.cols();) {
+      const int chunk_frames = std::min<int>(
+          std::min<int>(input.cols() - start, max_chunk_frames),
+          history_size_ - history_position_);
+      const auto chunk = input.middleCols(start, chunk_frames).transpose();
+      history_.middleRows(history_position_, chunk_frames) = chunk;
+      history_.middleRows(history_position_ + history_size_, chunk_frames) =
+          chunk;
+      for (int i = 0; i < chunk_frames; ++i) {
+        // The window ends at the second copy of the current frame.
+        const int window_start =
+            history_position_ + i + history_size_ - kernel_frames_ + 1;
+        for (int channel = 0; channel < num_channels_; ++channel) {
+          (*output)(channel, start + i) =
+              history_.col(channel).segment(window_start, kernel_frames_)
+              .matrix().dot(reversed_filter_.col(channel).matrix());
+        }
       }
+      history_position_ = (history_position_ + chunk_frames) % history_size_;
+      start += chunk_frames;
     }
   }
 
@@ -97,12 +126,29 @@ class FirFilter {
     return num_channels_;
   }
 
+  // The partition size in use, or kDirectForm.
+  int partition_size() const {
+    return partition_size_;
+  }
+
  private:
+  // The partition size chosen by kAutomaticPartitionSize.
+  static int AutomaticPartitionSize(int kernel_frames);
+
   int num_channels_;
+  int partition_size_;
+  PartitionedFftConvolver convolver_;
+  // Members for direct-form convolution.
   int kernel_frames_;
-  Eigen::ArrayXXf filter_;
-  Eigen::ArrayXXf state_;
-  Eigen::ArrayXXf workspace_;
+  // The filter, time reversed, with one column per channel.
+  Eigen::ArrayXXf reversed_filter_;
+  // Mirrored circular buffer of the last history_size_ input frames, with one
+  // column per channel. Each frame is written at history_position_ and
+  // history_position_ + history_size_, so that the most recent kernel_frames_
+  // frames are always contiguous.
+  Eigen::ArrayXXf history_;
+  int history_size_;
+  int history_position_;
 };
 
 }  // namespace linear_filters
@@ -16,9 +16,12 @@
 
 #include "audio/linear_filters/fir_filter.h"
 
+#include <algorithm>
 #include <random>
 
+#include "audio/dsp/heap_allocation_counter.h"
 #include "audio/dsp/testing_util.h"
+#include "benchmark/benchmark.h"
 #include "glog/logging.h"
 #include "gtest/gtest.h"
 #include "third_party/eigen3/Eigen/Core"
@@ -234,5 +237,139 @@ TEST(FirFilterTest, RandomBlockSizes) {
   EXPECT_THAT(actual, EigenArrayNear(expected, 1e-5));
 }
 
+TEST(FirFilterTest, PreallocatedOutputDoesNotAllocate) {
+  constexpr int kNumChannels = 2;
+  constexpr int kMaxBlockSize = 16;
+  const Eigen::ArrayXXf kernel = Eigen::ArrayXXf::Random(kNumChannels, 5);
+  FirFilter fir;
+  fir.Init(kernel);
+  FirFilter reference;
+  reference.Init(kernel);
+  Eigen::ArrayXXf buffer(kNumChannels, kMaxBlockSize);
+  for (int num_samples : {kMaxBlockSize, 3, 0, 1, 9}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    const Eigen::ArrayXXf input =
+        Eigen::ArrayXXf::Random(kNumChannels, num_samples);
+    Eigen::ArrayXXf expected;
+    reference.ProcessBlock(input, &expected);
+    auto output = buffer.leftCols(num_samples);
+    {
+      audio_dsp::ScopedHeapAllocationCounter counter;
+      fir.ProcessBlock(input, &output);
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+    EXPECT_THAT(output, EigenArrayNear(expected, 1e-6));
+  }
+}
+
+TEST(FirFilterTest, AutomaticPartitionSize) {
+  FirFilter fir;
+  fir.Init(Eigen::ArrayXXf::Random(2, 25));
+  EXPECT_EQ(fir.partition_size(), FirFilter::kDirectForm);
+  // The direct form is used up to the crossover found with BM_FirFilter.
+  fir.Init(Eigen::ArrayXXf::Random(2, 191));
+  EXPECT_EQ(fir.partition_size(), FirFilter::kDirectForm);
+  fir.Init(Eigen::ArrayXXf::Random(2, 192));
+  EXPECT_EQ(fir.partition_size(), 256);
+  fir.Init(Eigen::ArrayXXf::Random(2, 10000));
+  EXPECT_EQ(fir.partition_size(), 512);
+  fir.Init(Eigen::ArrayXXf::Random(2, 10000), FirFilter::kDirectForm);
+  EXPECT_EQ(fir.partition_size(), FirFilter::kDirectForm);
+  fir.Init(Eigen::ArrayXXf::Random(2, 10000), 64);
+  EXPECT_EQ(fir.partition_size(), 64);
+}
+
+// Partitioned FFT convolution matches direct form for streaming with random
+// block sizes, both shorter and longer than the partitions.
+TEST(FirFilterTest, PartitionedMatchesDirectForm) {
+  constexpr int kChannels = 3;
+  constexpr int kNumSamples = 1000;
+  const Eigen::ArrayXXf all_data =
+      Eigen::ArrayXXf::Random(kChannels, kNumSamples);
+  for (int partition_size : {1, 2, 16, 64}) {
+    for (int kernel_size : {1, 15, 64, 200}) {
+      SCOPED_TRACE(testing::Message() << "partition_size: " << partition_size
+                   << ", kernel_size: " << kernel_size);
+      const Eigen::ArrayXXf kernel =
+          Eigen::ArrayXXf::Random(kChannels, kernel_size);
+      FirFilter fir_expected;
+      fir_expected.Init(kernel, FirFilter::kDirectForm);
+      Eigen::ArrayXXf expected;
+      fir_expected.ProcessBlock(all_data, &expected);
+
+      FirFilter fir;
+      fir.Init(kernel, partition_size);
+      EXPECT_EQ(fir.partition_size(), partition_size);
+      Eigen::ArrayXXf actual(kChannels, kNumSamples);
+      std::mt19937 rng(0 /* seed */);
+      for (int i = 0; i < kNumSamples;) {
+        std::uniform_int_distribution<int> block_size_distribution(
+            0, std::min<int>(3 * partition_size, kNumSamples - i));
+        const int block_size = block_size_distribution(rng);
+        auto output = actual.middleCols(i, block_size);
+        fir.ProcessBlock(all_data.middleCols(i, block_size), &output);
+        i += block_size;
+      }
+      EXPECT_THAT(actual, EigenArrayNear(expected, 1e-4));
+
+      fir.Reset();
+      fir.ProcessBlock(all_data, &actual);
+      EXPECT_THAT(actual, EigenArrayNear(expected, 1e-4));
+    }
+  }
+}
+
+TEST(FirFilterTest, PartitionedDoesNotAllocate) {
+  constexpr int kNumChannels = 2;
+  constexpr int kMaxBlockSize = 100;
+  const Eigen::ArrayXXf kernel = Eigen::ArrayXXf::Random(kNumChannels, 300);
+  FirFilter fir;
+  fir.Init(kernel, 32);
+  Eigen::ArrayXXf buffer(kNumChannels, kMaxBlockSize);
+  for (int num_samples : {kMaxBlockSize, 3, 0, 32, 1, 64}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    const Eigen::ArrayXXf input =
+        Eigen::ArrayXXf::Random(kNumChannels, num_samples);
+    auto output = buffer.leftCols(num_samples);
+    {
+      audio_dsp::ScopedHeapAllocationCounter counter;
+      fir.ProcessBlock(input, &output);
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+  }
+}
+
+// Arguments are the kernel size and the partition size, where 0 is direct
+// form.
+void BM_FirFilter(benchmark::State& state) {
+  constexpr int kNumChannels = 2;
+  constexpr int kBlockSize = 256;
+  const int kernel_size = state.range(0);
+  const int partition_size = state.range(1);
+  srand(0 /* seed */);
+  const Eigen::ArrayXXf input =
+      Eigen::ArrayXXf::Random(kNumChannels, kBlockSize);
+  Eigen::ArrayXXf output(kNumChannels, kBlockSize);
+  FirFilter fir;
+  fir.Init(Eigen::ArrayXXf::Random(kNumChannels, kernel_size),
+           partition_size);
+  while (state.KeepRunning()) {
+    fir.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBlockSize * state.iterations());
+}
+BENCHMARK(BM_FirFilter)
+    ->ArgPair(16, 0)->ArgPair(16, 16)
+    ->ArgPair(32, 0)->ArgPair(32, 32)
+    ->ArgPair(64, 0)->ArgPair(64, 64)
+    ->ArgPair(96, 0)->ArgPair(96, 128)
+    ->ArgPair(128, 0)->ArgPair(128, 128)->ArgPair(128, 256)
+    ->ArgPair(160, 0)->ArgPair(160, 256)
+    ->ArgPair(192, 0)->ArgPair(192, 256)
+    ->ArgPair(256, 0)->ArgPair(256, 256)
+    ->ArgPair(4096, 0)->ArgPair(4096, 256)->ArgPair(4096, 512)
+    ->ArgPair(96000, 256)->ArgPair(96000, 512)->ArgPair(96000, 1024);
+
 }  // namespace
 }  // namespace linear_filters
@@ -0,0 +1,179 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/mimo_fft_convolver.h"
+
+#include <algorithm>
+
+#include "audio/dsp/number_util.h"
+#include "glog/logging.h"
+
+namespace linear_filters {
+
+namespace {
+
+// The largest automatically chosen partition size, as for FirFilter.
+constexpr int kMaxAutomaticPartitionSize = 512;
+
+}  // namespace
+
+constexpr int MimoFftConvolver::kAutomaticPartitionSize;
+
+void MimoFftConvolver::Init(
+    const std::vector<std::vector<Eigen::ArrayXf>>& kernels,
+    int partition_size) {
+  CHECK(!kernels.empty());
+  CHECK(!kernels[0].empty());
+  num_outputs_ = kernels.size();
+  num_inputs_ = kernels[0].size();
+  int max_kernel_size = 1;
+  for (const auto& row : kernels) {
+    CHECK_EQ(row.size(), num_inputs_);
+    for (const Eigen::ArrayXf& kernel : row) {
+      max_kernel_size = std::max<int>(max_kernel_size, kernel.size());
+    }
+  }
+  if (partition_size == kAutomaticPartitionSize) {
+    partition_size = std::min<int>(audio_dsp::NextPowerOfTwo(max_kernel_size),
+                                   kMaxAutomaticPartitionSize);
+  }
+  CHECK_GT(partition_size, 0);
+  CHECK(audio_dsp::IsPowerOfTwoOrZero(partition_size))
+      << "partition_size must be a power of two, got " << partition_size;
+  partition_size_ = partition_size;
+  num_partitions_ =
+      (max_kernel_size + partition_size_ - 1) / partition_size_;
+  const int fft_size = 2 * partition_size_;
+  fft_.Init(fft_size);
+  const int num_bins = fft_.num_bins();
+
+  // Find the nonzero partitions, undelayed ones first so that ProcessBlock()
+  // only visits those.
+  terms_.clear();
+  input_used_.assign(num_inputs_, false);
+  output_used_.assign(num_outputs_, false);
+  num_undelayed_terms_ = 0;
+  for (int p = 0; p < num_partitions_; ++p) {
+    for (int o = 0; o < num_outputs_; ++o) {
+      for (int i = 0; i < num_inputs_; ++i) {
+        const Eigen::ArrayXf& kernel = kernels[o][i];
+        const int start = p * partition_size_;
+        const int size =
+            std::min<int>(partition_size_, kernel.size() - start);
+        if (size > 0 && (kernel.segment(start, size) != 0.0f).any()) {
+          terms_.push_back({i, o, p});
+          num_undelayed_terms_ += (p == 0);
+          input_used_[i] = true;
+          output_used_[o] = true;
+        }
+      }
+    }
+  }
+  term_spectra_.resize(num_bins, terms_.size());
+  Eigen::ArrayXf padded_partition(fft_size);
+  for (int t = 0; t < terms_.size(); ++t) {
+    const Term& term = terms_[t];
+    const Eigen::ArrayXf& kernel = kernels[term.output][term.input];
+    const int start = term.partition * partition_size_;
+    const int size = std::min<int>(partition_size_, kernel.size() - start);
+    padded_partition.setZero();
+    padded_partition.head(size) = kernel.segment(start, size);
+    fft_.ForwardTransform(padded_partition, term_spectra_.col(t));
+  }
+  term_spectra_ *= 1.0f / fft_size;
+
+  frame_spectra_.resize(num_bins, num_partitions_ * num_inputs_);
+  delayed_sum_.resize(num_bins, num_outputs_);
+  history_.resize(fft_size, num_inputs_);
+  spectrum_workspace_.resize(num_bins, num_outputs_);
+  time_workspace_.resize(fft_size);
+  Reset();
+}
+
+void MimoFftConvolver::Reset() {
+  frame_spectra_.setZero();
+  current_slot_ = 0;
+  delayed_sum_.setZero();
+  history_.setZero();
+  num_filled_ = 0;
+}
+
+void MimoFftConvolver::ProcessBlock(
+    const Eigen::Ref<const Eigen::ArrayXXf>& input,
+    Eigen::Ref<Eigen::ArrayXXf> output) {
+  DCHECK_NE(num_inputs_, 0) << "You must call Init() first!";
+  DCHECK_EQ(input.rows(), num_inputs_);
+  DCHECK_EQ(output.rows(), num_outputs_);
+  DCHECK_EQ(output.cols(), input.cols());
+  for (int start = 0; start < input.cols();) {
+    const int num_samples =
+        std::min<int>(partition_size_ - num_filled_, input.cols() - start);
+    const int frame_offset = partition_size_ + num_filled_;
+    history_.middleRows(frame_offset, num_samples) =
+        input.middleCols(start, num_samples).transpose();
+    // Transform each input once. The current slot is overwritten until the
+    // frame is complete.
+    for (int i = 0; i < num_inputs_; ++i) {
+      if (input_used_[i]) {
+        fft_.ForwardTransform(history_.col(i),
+                              frame_spectra_.col(current_slot_ * num_inputs_ +
+                                                 i));
+      }
+    }
+    spectrum_workspace_ = delayed_sum_;
+    for (int t = 0; t < num_undelayed_terms_; ++t) {
+      const Term& term = terms_[t];
+      spectrum_workspace_.col(term.output) +=
+          frame_spectra_.col(current_slot_ * num_inputs_ + term.input) *
+          term_spectra_.col(t);
+    }
+    for (int o = 0; o < num_outputs_; ++o) {
+      if (output_used_[o]) {
+        fft_.InverseTransform(spectrum_workspace_.col(o), time_workspace_);
+        output.row(o).segment(start, num_samples) =
+            time_workspace_.segment(frame_offset, num_samples).transpose();
+      } else {
+        output.row(o).segment(start, num_samples).setZero();
+      }
+    }
+    num_filled_ += num_samples;
+    start += num_samples;
+    if (num_filled_ == partition_size_) {
+      FinishFrame();
+    }
+  }
+}
+
+void MimoFftConvolver::FinishFrame() {
+  history_.topRows(partition_size_) = history_.bottomRows(partition_size_);
+  history_.bottomRows(partition_size_).setZero();
+  num_filled_ = 0;
+
+  // The frame that was just completed is delayed by one partition relative to
+  // the next frame, and so on.
+  delayed_sum_.setZero();
+  for (int t = num_undelayed_terms_; t < terms_.size(); ++t) {
+    const Term& term = terms_[t];
+    const int slot = (current_slot_ + 1 - term.partition + num_partitions_) %
+        num_partitions_;
+    delayed_sum_.col(term.output) +=
+        frame_spectra_.col(slot * num_inputs_ + term.input) *
+        term_spectra_.col(t);
+  }
+  current_slot_ = (current_slot_ + 1) % num_partitions_;
+}
+
+}  // namespace linear_filters
@@ -0,0 +1,126 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Multiple-input, multiple-output (MIMO) FIR filtering, where each output
+// channel is the sum of the convolutions of every input channel with its own
+// kernel:
+//
+//   output[o] = sum_i kernels[o][i] * input[i],
+//
+// as needed for crossfeed, binaural rendering, crosstalk cancellation, and
+// room correction of speaker arrays. FirFilter is the special case of a
+// diagonal kernel matrix.
+//
+// This uses the uniformly partitioned, zero-latency FFT convolution described
+// in partitioned_fft_convolver.h. Each input is transformed once per call and
+// shared by all outputs, products are accumulated in the frequency domain, and
+// each output is inverse transformed once, so the FFT cost is proportional to
+// num_inputs + num_outputs rather than num_inputs * num_outputs. Kernel
+// partitions that are all zero, including empty kernels, are skipped, so
+// sparse matrices and kernels with long initial delays are cheap.
+
+#ifndef AUDIO_LINEAR_FILTERS_MIMO_FFT_CONVOLVER_H_
+#define AUDIO_LINEAR_FILTERS_MIMO_FFT_CONVOLVER_H_
+
+#include <vector>
+
+#include "audio/dsp/real_fft.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+
+class MimoFftConvolver {
+ public:
+  // Passed as partition_size to Init() to choose it from the kernel sizes.
+  static constexpr int kAutomaticPartitionSize = -1;
+
+  MimoFftConvolver()
+    : num_inputs_(0 /* uninitialized */),
+      num_outputs_(0) {}
+
+  // kernels[o][i] is the kernel from input i to output o. kernels must have
+  // num_outputs rows of num_inputs kernels each, which may have different
+  // sizes. partition_size is kAutomaticPartitionSize or a power of two; as
+  // with FirFilter, processing blocks of about the partition size is most
+  // efficient.
+  void Init(const std::vector<std::vector<Eigen::ArrayXf>>& kernels,
+            int partition_size = kAutomaticPartitionSize);
+
+  void Reset();
+
+  // Process a block of samples. input has num_inputs() rows and output has
+  // num_outputs() rows and the same number of columns. For streaming, pass
+  // successive nonoverlapping blocks of samples. Does not allocate.
+  void ProcessBlock(const Eigen::Ref<const Eigen::ArrayXXf>& input,
+                    Eigen::Ref<Eigen::ArrayXXf> output);
+
+  int num_inputs() const { return num_inputs_; }
+  int num_outputs() const { return num_outputs_; }
+  int partition_size() const { return partition_size_; }
+  // Number of kernel partitions that are not all zero, over all kernels. The
+  // cost of a frame is proportional to this.
+  int num_nonzero_partitions() const { return terms_.size(); }
+
+ private:
+  // A nonzero kernel partition.
+  struct Term {
+    int input;
+    int output;
+    int partition;
+  };
+
+  // Called when the current frame is complete. Shifts the time-domain history
+  // and accumulates the delayed terms for the next frame.
+  void FinishFrame();
+
+  int num_inputs_;
+  int num_outputs_;
+  int partition_size_;
+  int num_partitions_;
+  audio_dsp::RealFft fft_;
+
+  // Sorted by partition.
+  std::vector<Term> terms_;
+  // Number of terms with partition 0.
+  int num_undelayed_terms_;
+  // Spectra of the nonzero kernel partitions, scaled by 1 / fft_size, one
+  // column per term.
+  Eigen::ArrayXXcf term_spectra_;
+  // Whether any term uses the input or output.
+  std::vector<bool> input_used_;
+  std::vector<bool> output_used_;
+
+  // Frequency-domain delay line of the input frames, a circular buffer of
+  // num_partitions_ slots. Column slot * num_inputs_ + i is input i.
+  Eigen::ArrayXXcf frame_spectra_;
+  int current_slot_;
+  // The terms with partition >= 1 for the current frame, one column per
+  // output.
+  Eigen::ArrayXXcf delayed_sum_;
+  // The previous and current input frames, one column per input.
+  Eigen::ArrayXXf history_;
+  int num_filled_;
+
+  Eigen::ArrayXXcf spectrum_workspace_;
+  Eigen::ArrayXf time_workspace_;
+};
+
+}  // namespace linear_filters
+
+#endif  // AUDIO_LINEAR_FILTERS_MIMO_FFT_CONVOLVER_H_
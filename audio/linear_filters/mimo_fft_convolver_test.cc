@@ -0,0 +1,203 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/mimo_fft_convolver.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "audio/dsp/heap_allocation_counter.h"
+#include "audio/dsp/testing_util.h"
+#include "audio/linear_filters/fir_filter.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+namespace {
+
+using ::audio_dsp::EigenArrayNear;
+using ::Eigen::ArrayXf;
+using ::Eigen::ArrayXXf;
+using ::std::vector;
+
+using KernelMatrix = vector<vector<ArrayXf>>;
+
+KernelMatrix RandomKernels(int num_outputs, int num_inputs, int kernel_size) {
+  KernelMatrix kernels(num_outputs);
+  for (auto& row : kernels) {
+    for (int i = 0; i < num_inputs; ++i) {
+      row.push_back(ArrayXf::Random(kernel_size));
+    }
+  }
+  return kernels;
+}
+
+// Sums the outputs of a direct-form FirFilter per kernel.
+ArrayXXf ExpectedOutput(const KernelMatrix& kernels, const ArrayXXf& input) {
+  ArrayXXf output = ArrayXXf::Zero(kernels.size(), input.cols());
+  for (int o = 0; o < kernels.size(); ++o) {
+    for (int i = 0; i < input.rows(); ++i) {
+      if (kernels[o][i].size() == 0) { continue; }
+      FirFilter fir;
+      fir.Init(1, kernels[o][i], FirFilter::kDirectForm);
+      ArrayXXf filtered;
+      fir.ProcessBlock(input.row(i), &filtered);
+      output.row(o) += filtered;
+    }
+  }
+  return output;
+}
+
+TEST(MimoFftConvolverTest, MatchesSumOfFirFilters) {
+  constexpr int kNumInputs = 3;
+  constexpr int kNumOutputs = 2;
+  constexpr int kNumSamples = 1000;
+  const ArrayXXf input = ArrayXXf::Random(kNumInputs, kNumSamples);
+  for (int partition_size : {1, 8, 64}) {
+    for (int kernel_size : {1, 20, 150}) {
+      SCOPED_TRACE(testing::Message() << "partition_size: " << partition_size
+                   << ", kernel_size: " << kernel_size);
+      const KernelMatrix kernels =
+          RandomKernels(kNumOutputs, kNumInputs, kernel_size);
+      MimoFftConvolver convolver;
+      convolver.Init(kernels, partition_size);
+      EXPECT_EQ(convolver.num_inputs(), kNumInputs);
+      EXPECT_EQ(convolver.num_outputs(), kNumOutputs);
+      EXPECT_EQ(convolver.partition_size(), partition_size);
+
+      ArrayXXf output(kNumOutputs, kNumSamples);
+      std::mt19937 rng(0 /* seed */);
+      for (int i = 0; i < kNumSamples;) {
+        std::uniform_int_distribution<int> block_size_distribution(
+            0, std::min<int>(3 * partition_size, kNumSamples - i));
+        const int block_size = block_size_distribution(rng);
+        convolver.ProcessBlock(input.middleCols(i, block_size),
+                               output.middleCols(i, block_size));
+        i += block_size;
+      }
+      const ArrayXXf expected = ExpectedOutput(kernels, input);
+      EXPECT_THAT(output, EigenArrayNear(expected, 2e-4));
+
+      convolver.Reset();
+      convolver.ProcessBlock(input, output);
+      EXPECT_THAT(output, EigenArrayNear(expected, 2e-4));
+    }
+  }
+}
+
+// Zero kernels and zero partitions, e.g. from a pure delay, are skipped.
+TEST(MimoFftConvolverTest, Sparse) {
+  constexpr int kNumSamples = 500;
+  KernelMatrix kernels(3, vector<ArrayXf>(2));
+  // Output 0 is a delayed copy of input 1.
+  kernels[0][1] = ArrayXf::Zero(70);
+  kernels[0][1][69] = 1.0f;
+  // Output 1 is empty, and output 2 is a mix of both inputs.
+  kernels[2][0] = ArrayXf::Random(10);
+  kernels[2][1] = ArrayXf::Zero(40);
+  kernels[2][1].tail(5).setRandom();
+
+  MimoFftConvolver convolver;
+  convolver.Init(kernels, 16);
+  // Partition 4 of kernels[0][1], 0 of kernels[2][0], and 2 of kernels[2][1].
+  EXPECT_EQ(convolver.num_nonzero_partitions(), 3);
+
+  const ArrayXXf input = ArrayXXf::Random(2, kNumSamples);
+  ArrayXXf output(3, kNumSamples);
+  convolver.ProcessBlock(input, output);
+  const ArrayXXf expected = ExpectedOutput(kernels, input);
+  EXPECT_THAT(output, EigenArrayNear(expected, 1e-5));
+  EXPECT_TRUE((output.row(1) == 0.0f).all());
+}
+
+TEST(MimoFftConvolverTest, AutomaticPartitionSize) {
+  MimoFftConvolver convolver;
+  convolver.Init(RandomKernels(2, 2, 100));
+  EXPECT_EQ(convolver.partition_size(), 128);
+  convolver.Init(RandomKernels(2, 2, 10000));
+  EXPECT_EQ(convolver.partition_size(), 512);
+}
+
+TEST(MimoFftConvolverTest, DoesNotAllocate) {
+  constexpr int kMaxBlockSize = 100;
+  MimoFftConvolver convolver;
+  convolver.Init(RandomKernels(4, 3, 300), 32);
+  ArrayXXf buffer(4, kMaxBlockSize);
+  for (int num_samples : {kMaxBlockSize, 3, 0, 32, 1, 64}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    const ArrayXXf input = ArrayXXf::Random(3, num_samples);
+    {
+      audio_dsp::ScopedHeapAllocationCounter counter;
+      convolver.ProcessBlock(input, buffer.leftCols(num_samples));
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+  }
+}
+
+// Compares a 4 x 4 matrix of 4096-tap kernels to 16 FirFilters.
+constexpr int kBenchmarkChannels = 4;
+constexpr int kBenchmarkKernelSize = 4096;
+constexpr int kBenchmarkBlockSize = 256;
+
+void BM_MimoFftConvolver(benchmark::State& state) {
+  srand(0 /* seed */);
+  const ArrayXXf input =
+      ArrayXXf::Random(kBenchmarkChannels, kBenchmarkBlockSize);
+  ArrayXXf output(kBenchmarkChannels, kBenchmarkBlockSize);
+  MimoFftConvolver convolver;
+  convolver.Init(RandomKernels(kBenchmarkChannels, kBenchmarkChannels,
+                               kBenchmarkKernelSize),
+                 kBenchmarkBlockSize);
+  while (state.KeepRunning()) {
+    convolver.ProcessBlock(input, output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK(BM_MimoFftConvolver);
+
+void BM_FirFilterPerKernel(benchmark::State& state) {
+  srand(0 /* seed */);
+  const ArrayXXf input =
+      ArrayXXf::Random(kBenchmarkChannels, kBenchmarkBlockSize);
+  ArrayXXf output(kBenchmarkChannels, kBenchmarkBlockSize);
+  ArrayXXf filtered(1, kBenchmarkBlockSize);
+  vector<FirFilter> filters(kBenchmarkChannels * kBenchmarkChannels);
+  for (FirFilter& fir : filters) {
+    fir.Init(1, ArrayXf::Random(kBenchmarkKernelSize), kBenchmarkBlockSize);
+  }
+  while (state.KeepRunning()) {
+    output.setZero();
+    for (int o = 0; o < kBenchmarkChannels; ++o) {
+      for (int i = 0; i < kBenchmarkChannels; ++i) {
+        filters[o * kBenchmarkChannels + i].ProcessBlock(input.row(i),
+                                                         &filtered);
+        output.row(o) += filtered;
+      }
+    }
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK(BM_FirFilterPerKernel);
+
+}  // namespace
+}  // namespace linear_filters
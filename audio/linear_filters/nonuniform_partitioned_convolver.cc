@@ -0,0 +1,387 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/nonuniform_partitioned_convolver.h"
+
+#include <algorithm>
+#include <chrono>
+
+#include "audio/dsp/number_util.h"
+#include "glog/logging.h"
+
+namespace linear_filters {
+
+using ::Eigen::ArrayXXf;
+
+namespace {
+
+// How long ConvolverWorkerThread sleeps when there is no work.
+constexpr std::chrono::microseconds kWorkerPollInterval(100);
+
+// Copies num_rows rows of a circular buffer starting at row start.
+void CopyFromCircularBuffer(const ArrayXXf& buffer, int start, int num_rows,
+                            ArrayXXf* output) {
+  start = audio_dsp::Modulo(start, buffer.rows());
+  const int first_rows = std::min<int>(num_rows, buffer.rows() - start);
+  output->topRows(first_rows) = buffer.middleRows(start, first_rows);
+  output->middleRows(first_rows, num_rows - first_rows) =
+      buffer.topRows(num_rows - first_rows);
+}
+
+}  // namespace
+
+// A uniformly partitioned overlap-save convolution of taps
+// [offset, offset + num_partitions * partition_size) of the kernel, computed a
+// frame at a time. Unlike PartitionedFftConvolver, the output for a frame is
+// only computed once the frame is complete. offset must be at least the
+// partition size, so that the output is ready in time.
+class NonUniformPartitionedConvolver::Segment {
+ public:
+  Segment(const ArrayXXf& kernel, int offset, int partition_size,
+          int num_partitions, bool background)
+      : num_channels_(kernel.rows()),
+        offset_(offset),
+        partition_size_(partition_size),
+        num_partitions_(num_partitions),
+        background_(background),
+        state_(kIdle) {
+    CHECK_GE(offset_, partition_size_);
+    CHECK(!background_ || offset_ >= 2 * partition_size_);
+    const int fft_size = 2 * partition_size_;
+    fft_.Init(fft_size);
+    const int num_bins = fft_.num_bins();
+    partition_spectra_.resize(num_bins, num_partitions_ * num_channels_);
+    Eigen::ArrayXf padded_partition(fft_size);
+    for (int p = 0; p < num_partitions_; ++p) {
+      const int start = offset_ + p * partition_size_;
+      const int size = std::min<int>(partition_size_, kernel.cols() - start);
+      for (int c = 0; c < num_channels_; ++c) {
+        padded_partition.setZero();
+        padded_partition.head(size) =
+            kernel.row(c).segment(start, size).transpose();
+        fft_.ForwardTransform(padded_partition,
+                              partition_spectra_.col(p * num_channels_ + c));
+      }
+    }
+    partition_spectra_ *= 1.0f / fft_size;
+    frame_spectra_.resize(num_bins, num_partitions_ * num_channels_);
+    spectrum_workspace_.resize(num_bins, num_channels_);
+    time_workspace_.resize(fft_size);
+    frame_input_.resize(fft_size, num_channels_);
+    frame_output_.resize(partition_size_, num_channels_);
+    Reset();
+  }
+
+  int offset() const { return offset_; }
+  int partition_size() const { return partition_size_; }
+  bool background() const { return background_; }
+
+  // Must not be called while work is pending.
+  void Reset() {
+    DCHECK_EQ(state_.load(), kIdle);
+    frame_spectra_.setZero();
+    current_slot_ = 0;
+  }
+
+  // Called by the audio thread when a frame is complete, where position is
+  // the position in the circular buffers of the end of the frame. Adds the
+  // output of the frame (or, with background processing, of the previous
+  // frame) to pending_output. Returns whether a deadline was missed.
+  bool FinishFrame(int position, const ArrayXXf& input_history,
+                   ArrayXXf* pending_output) {
+    bool missed_deadline = false;
+    if (background_) {
+      missed_deadline = WaitForWork();
+      if (state_.load(std::memory_order_relaxed) == kDone) {
+        AddOutput(pending_output);
+      }
+    }
+    CopyFromCircularBuffer(input_history, position - 2 * partition_size_,
+                           2 * partition_size_, &frame_input_);
+    // The frame [position - partition_size, position) is delayed by offset.
+    output_position_ = audio_dsp::Modulo(
+        position - partition_size_ + offset_, pending_output->rows());
+    if (background_) {
+      state_.store(kPending, std::memory_order_release);
+    } else {
+      Compute();
+      AddOutput(pending_output);
+    }
+    return missed_deadline;
+  }
+
+  // Called by the worker thread. Returns whether there was work to do.
+  bool RunPendingWork() {
+    int expected = kPending;
+    if (!state_.compare_exchange_strong(expected, kRunning,
+                                        std::memory_order_acquire)) {
+      return false;
+    }
+    Compute();
+    state_.store(kDone, std::memory_order_release);
+    return true;
+  }
+
+  // Waits for posted work to be done, doing it on this thread if it has not
+  // started. Returns whether the work was not done already. Afterwards, the
+  // state is kIdle or kDone.
+  bool WaitForWork() {
+    int expected = kPending;
+    if (state_.compare_exchange_strong(expected, kRunning,
+                                       std::memory_order_acquire)) {
+      Compute();
+      state_.store(kDone, std::memory_order_relaxed);
+      return true;
+    }
+    if (expected != kRunning) {
+      return false;  // kIdle or kDone.
+    }
+    while (state_.load(std::memory_order_acquire) != kDone) {
+      std::this_thread::yield();
+    }
+    return true;
+  }
+
+  // Discards posted work, waiting for it if it is running.
+  void DiscardWork() {
+    int expected = kPending;
+    if (!state_.compare_exchange_strong(expected, kIdle,
+                                        std::memory_order_acquire)) {
+      while (state_.load(std::memory_order_acquire) == kRunning) {
+        std::this_thread::yield();
+      }
+    }
+    state_.store(kIdle, std::memory_order_relaxed);
+  }
+
+ private:
+  enum State { kIdle, kPending, kRunning, kDone };
+
+  void Compute() {
+    const int slot_column = current_slot_ * num_channels_;
+    for (int c = 0; c < num_channels_; ++c) {
+      fft_.ForwardTransform(frame_input_.col(c),
+                            frame_spectra_.col(slot_column + c));
+    }
+    spectrum_workspace_.setZero();
+    for (int k = 0; k < num_partitions_; ++k) {
+      const int slot = (current_slot_ - k + num_partitions_) % num_partitions_;
+      spectrum_workspace_ +=
+          frame_spectra_.middleCols(slot * num_channels_, num_channels_) *
+          partition_spectra_.middleCols(k * num_channels_, num_channels_);
+    }
+    for (int c = 0; c < num_channels_; ++c) {
+      fft_.InverseTransform(spectrum_workspace_.col(c), time_workspace_);
+      frame_output_.col(c) = time_workspace_.tail(partition_size_);
+    }
+    current_slot_ = (current_slot_ + 1) % num_partitions_;
+  }
+
+  void AddOutput(ArrayXXf* pending_output) {
+    // Partition sizes and offsets divide the buffer size, so this does not
+    // wrap around.
+    pending_output->middleRows(output_position_, partition_size_) +=
+        frame_output_;
+  }
+
+  const int num_channels_;
+  const int offset_;
+  const int partition_size_;
+  const int num_partitions_;
+  const bool background_;
+  audio_dsp::RealFft fft_;
+  // Laid out as in PartitionedFftConvolver.
+  Eigen::ArrayXXcf partition_spectra_;
+  Eigen::ArrayXXcf frame_spectra_;
+  int current_slot_;
+  Eigen::ArrayXXcf spectrum_workspace_;
+  Eigen::ArrayXf time_workspace_;
+
+  // Handoff between the audio thread and the worker. The audio thread owns
+  // frame_input_ and output_position_ in states kIdle and kDone, and whoever
+  // moved the state to kRunning owns the rest until it is kDone.
+  std::atomic<int> state_;
+  // The previous and current frame, one column per channel.
+  ArrayXXf frame_input_;
+  ArrayXXf frame_output_;
+  int output_position_;
+};
+
+NonUniformPartitionedConvolver::NonUniformPartitionedConvolver()
+    : num_channels_(0 /* uninitialized */) {}
+
+NonUniformPartitionedConvolver::~NonUniformPartitionedConvolver() {}
+
+void NonUniformPartitionedConvolver::Init(
+    int num_channels, const Eigen::ArrayXf& kernel,
+    const NonUniformPartitionedConvolverParams& params) {
+  CHECK_GT(num_channels, 0);
+  Init(kernel.transpose().replicate(num_channels, 1), params);
+}
+
+void NonUniformPartitionedConvolver::Init(
+    const ArrayXXf& kernel,
+    const NonUniformPartitionedConvolverParams& params) {
+  CHECK_GT(kernel.rows(), 0);
+  CHECK_GT(params.head_size, 0);
+  CHECK(audio_dsp::IsPowerOfTwoOrZero(params.head_size));
+  CHECK_GE(params.max_partition_size, params.head_size);
+  CHECK(audio_dsp::IsPowerOfTwoOrZero(params.max_partition_size));
+  std::lock_guard<std::mutex> lock(background_mutex_);
+  for (const auto& segment : segments_) {
+    segment->DiscardWork();
+  }
+  num_channels_ = kernel.rows();
+  head_size_ = params.head_size;
+  background_tail_ = params.background_tail;
+
+  reversed_head_ = ArrayXXf::Zero(num_channels_, head_size_);
+  const int num_head_taps = std::min<int>(head_size_, kernel.cols());
+  reversed_head_.rightCols(num_head_taps) =
+      kernel.leftCols(num_head_taps).rowwise().reverse();
+
+  // Each partition size is used until the offset is at least twice the next
+  // partition size, so that it could be computed in the background.
+  segments_.clear();
+  int largest_partition_size = head_size_;
+  int partition_size = head_size_;
+  for (int offset = head_size_; offset < kernel.cols();) {
+    const int remaining_partitions =
+        (kernel.cols() - offset + partition_size - 1) / partition_size;
+    const int num_partitions = partition_size == params.max_partition_size ?
+        remaining_partitions :
+        std::min((4 * partition_size - offset) / partition_size,
+                 remaining_partitions);
+    const bool background =
+        background_tail_ && partition_size > head_size_;
+    segments_.emplace_back(new Segment(kernel, offset, partition_size,
+                                       num_partitions, background));
+    largest_partition_size = partition_size;
+    offset += num_partitions * partition_size;
+    partition_size = std::min(2 * partition_size, params.max_partition_size);
+  }
+
+  head_history_.resize(num_channels_, 2 * head_size_);
+  input_history_.resize(2 * largest_partition_size, num_channels_);
+  pending_output_.resize(2 * largest_partition_size, num_channels_);
+  ResetLocked();
+}
+
+void NonUniformPartitionedConvolver::Reset() {
+  std::lock_guard<std::mutex> lock(background_mutex_);
+  ResetLocked();
+}
+
+void NonUniformPartitionedConvolver::ResetLocked() {
+  for (const auto& segment : segments_) {
+    segment->DiscardWork();
+    segment->Reset();
+  }
+  head_history_.setZero();
+  input_history_.setZero();
+  pending_output_.setZero();
+  position_ = 0;
+  num_missed_deadlines_ = 0;
+}
+
+void NonUniformPartitionedConvolver::ProcessBlockImpl(
+    const Eigen::Ref<const ArrayXXf>& input, Eigen::Ref<ArrayXXf> output) {
+  for (int start = 0; start < input.cols();) {
+    // Process up to the end of the current head frame. The circular buffer
+    // sizes are multiples of head_size_, so this does not wrap around.
+    const int frame_position = position_ % head_size_;
+    const int num_samples =
+        std::min<int>(head_size_ - frame_position, input.cols() - start);
+    const auto input_block = input.middleCols(start, num_samples);
+    head_history_.middleCols(head_size_ + frame_position, num_samples) =
+        input_block;
+    input_history_.middleRows(position_, num_samples) =
+        input_block.transpose();
+    for (int i = 0; i < num_samples; ++i) {
+      output.col(start + i) =
+          (reversed_head_ *
+           head_history_.middleCols(frame_position + i + 1, head_size_))
+          .rowwise().sum() +
+          pending_output_.row(position_ + i).transpose();
+    }
+    pending_output_.middleRows(position_, num_samples).setZero();
+    position_ = (position_ + num_samples) % input_history_.rows();
+    start += num_samples;
+    if (position_ % head_size_ == 0) {
+      FinishHeadFrame();
+    }
+  }
+}
+
+void NonUniformPartitionedConvolver::FinishHeadFrame() {
+  head_history_.leftCols(head_size_) = head_history_.rightCols(head_size_);
+  for (const auto& segment : segments_) {
+    if (position_ % segment->partition_size() == 0 &&
+        segment->FinishFrame(position_, input_history_, &pending_output_)) {
+      ++num_missed_deadlines_;
+    }
+  }
+}
+
+bool NonUniformPartitionedConvolver::ProcessBackgroundWork() {
+  std::unique_lock<std::mutex> lock(background_mutex_, std::try_to_lock);
+  if (!lock.owns_lock()) {
+    return false;  // Init() or Reset() is running.
+  }
+  bool did_work = false;
+  for (const auto& segment : segments_) {
+    if (segment->background() && segment->RunPendingWork()) {
+      did_work = true;
+    }
+  }
+  return did_work;
+}
+
+std::vector<int>
+NonUniformPartitionedConvolver::GetSegmentPartitionSizes() const {
+  std::vector<int> partition_sizes;
+  for (const auto& segment : segments_) {
+    partition_sizes.push_back(segment->partition_size());
+  }
+  return partition_sizes;
+}
+
+ConvolverWorkerThread::ConvolverWorkerThread(
+    const std::vector<NonUniformPartitionedConvolver*>& convolvers)
+    : convolvers_(convolvers),
+      stop_(false),
+      thread_(&ConvolverWorkerThread::Run, this) {}
+
+ConvolverWorkerThread::~ConvolverWorkerThread() {
+  stop_.store(true);
+  thread_.join();
+}
+
+void ConvolverWorkerThread::Run() {
+  while (!stop_.load()) {
+    bool did_work = false;
+    for (NonUniformPartitionedConvolver* convolver : convolvers_) {
+      if (convolver->ProcessBackgroundWork()) {
+        did_work = true;
+      }
+    }
+    if (!did_work) {
+      std::this_thread::sleep_for(kWorkerPollInterval);
+    }
+  }
+}
+
+}  // namespace linear_filters
@@ -0,0 +1,211 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Zero-latency convolution of a multichannel signal with a long per-channel
+// FIR kernel, e.g. a reverb impulse response of several seconds, using
+// non-uniformly partitioned FFT convolution [Gardner, "Efficient convolution
+// without input-output delay," JAES 1995].
+//
+// The kernel is split into a head of H = head_size taps that is applied in
+// direct form, followed by segments of uniformly partitioned overlap-save
+// convolution whose partition sizes double from H up to max_partition_size:
+//
+//   taps:       [0, H)   [H, 4H)   [4H, 8H)   [8H, 16H)   ...
+//   method:     direct   3 x H     2 x 2H     2 x 4H      ...
+//
+// A segment with partition size B transforms each B-sample input frame once,
+// when it is complete, and its first tap is at least B, so its output is
+// ready before it is needed and no latency is added. The cost per sample is
+// O(H) for the head plus O(log(B)) per segment, so O(log^2(kernel size))
+// overall, rather than the O(kernel size) of direct form or the
+// O(kernel size / B) of uniform partitions of size B.
+//
+// The segments with partitions larger than H start at least two partitions
+// into the kernel, which leaves a whole frame period for computing them. With
+// background_tail, ProcessBlock() only posts their work and the caller runs it
+// on another thread with ProcessBackgroundWork(), e.g. using
+// ConvolverWorkerThread. The deadline for the work posted when a frame of a
+// segment completes is the completion of the segment's next frame. If the work
+// has not started by then, ProcessBlock() does it on the calling thread; if it
+// is running, ProcessBlock() waits for it. Either way, the output is the same
+// as without background_tail, and num_missed_deadlines() is incremented.
+//
+// Example:
+//   NonUniformPartitionedConvolverParams params;
+//   params.background_tail = true;
+//   NonUniformPartitionedConvolver convolver;
+//   convolver.Init(impulse_response, params);
+//   ConvolverWorkerThread worker({&convolver});
+//   // On the audio thread, for each block:
+//   convolver.ProcessBlock(input, &output);
+
+#ifndef AUDIO_LINEAR_FILTERS_NONUNIFORM_PARTITIONED_CONVOLVER_H_
+#define AUDIO_LINEAR_FILTERS_NONUNIFORM_PARTITIONED_CONVOLVER_H_
+
+#include <atomic>
+#include <memory>
+#include <mutex>  // NOLINT
+#include <thread>
+#include <vector>
+
+#include "audio/dsp/real_fft.h"
+#include "glog/logging.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+
+struct NonUniformPartitionedConvolverParams {
+  NonUniformPartitionedConvolverParams()
+      : head_size(64),
+        max_partition_size(8192),
+        background_tail(false) {}
+
+  // Number of taps applied in direct form, which is also the smallest
+  // partition size. Must be a power of two. Cost grows linearly with the head
+  // size, but blocks much smaller than the head size are inefficient.
+  int head_size;
+  // Largest partition size, a power of two that is at least head_size.
+  int max_partition_size;
+  // Whether the segments with partitions larger than head_size are computed by
+  // calls to ProcessBackgroundWork() rather than by ProcessBlock().
+  bool background_tail;
+};
+
+class NonUniformPartitionedConvolver {
+ public:
+  NonUniformPartitionedConvolver();
+  ~NonUniformPartitionedConvolver();
+
+  // kernel is a one-dimensional impulse response that will be applied to each
+  // channel.
+  void Init(int num_channels, const Eigen::ArrayXf& kernel,
+            const NonUniformPartitionedConvolverParams& params =
+                NonUniformPartitionedConvolverParams());
+  // The number of channels is inferred from the number of rows, one impulse
+  // response per channel.
+  void Init(const Eigen::ArrayXXf& kernel,
+            const NonUniformPartitionedConvolverParams& params =
+                NonUniformPartitionedConvolverParams());
+
+  void Reset();
+
+  // Process a block of samples. For streaming, pass successive nonoverlapping
+  // blocks of samples to this function. Init() must be called before calling
+  // this function.
+  // input and output must be 2D Eigen types with contiguous column-major data
+  // like ArrayXXf or MatrixXf (or a Map or block of columns of either type),
+  // where the number of rows equals the number of channels, as set by Init().
+  // In-place processing is not supported.
+  //
+  // Does not allocate as long as output already has the right size.
+  template <typename InputType, typename OutputType>
+  void ProcessBlock(const InputType& input, OutputType* output) {
+    DCHECK_NE(num_channels_, 0) << "You must call Init() first!";
+    DCHECK_EQ(input.rows(), num_channels_);
+    output->resize(num_channels_, input.cols());
+    using StridedMap = Eigen::Map<Eigen::ArrayXXf, 0, Eigen::OuterStride<>>;
+    using ConstStridedMap =
+        Eigen::Map<const Eigen::ArrayXXf, 0, Eigen::OuterStride<>>;
+    ProcessBlockImpl(
+        ConstStridedMap(input.data(), input.rows(), input.cols(),
+                        Eigen::OuterStride<>(input.outerStride())),
+        StridedMap(output->data(), output->rows(), output->cols(),
+                   Eigen::OuterStride<>(output->outerStride())));
+  }
+
+  // Does the background work posted by ProcessBlock(), if any. Returns whether
+  // there was work to do. This is the only method that may be called from
+  // another thread, concurrently with any method but the destructor. While
+  // Init() or Reset() is running, it returns false without doing anything, and
+  // they wait for any call that is already running, so a ConvolverWorkerThread
+  // can stay attached while the convolver is reinitialized.
+  bool ProcessBackgroundWork();
+
+  int GetNumChannels() const {
+    return num_channels_;
+  }
+
+  // Number of times ProcessBlock() had to finish background work itself.
+  int num_missed_deadlines() const { return num_missed_deadlines_; }
+
+  // Partition sizes of the FFT segments, in order of increasing delay.
+  std::vector<int> GetSegmentPartitionSizes() const;
+
+ private:
+  class Segment;
+
+  void ProcessBlockImpl(const Eigen::Ref<const Eigen::ArrayXXf>& input,
+                        Eigen::Ref<Eigen::ArrayXXf> output);
+
+  // Clears the state. background_mutex_ must be held.
+  void ResetLocked();
+
+  // Called on each multiple of head_size_ samples.
+  void FinishHeadFrame();
+
+  int num_channels_;
+  int head_size_;
+  bool background_tail_;
+  std::vector<std::unique_ptr<Segment>> segments_;
+  // Held by ProcessBackgroundWork() while it uses segments_, and by Init() and
+  // Reset() while they change them. ProcessBlock() does not lock it.
+  std::mutex background_mutex_;
+
+  // The head of the kernel, time reversed, one row per channel.
+  Eigen::ArrayXXf reversed_head_;
+  // The previous and current head frames of input, one row per channel.
+  Eigen::ArrayXXf head_history_;
+  // Recent input, a circular buffer with one column per channel, from which
+  // the segments take their input frames.
+  Eigen::ArrayXXf input_history_;
+  // Circular buffer of the segment output, indexed like input_history_ and
+  // cleared as it is consumed.
+  Eigen::ArrayXXf pending_output_;
+  // Number of samples processed since Reset(), modulo the size of the
+  // circular buffers.
+  int position_;
+
+  int num_missed_deadlines_;
+};
+
+// Runs ProcessBackgroundWork() of a set of convolvers in a loop on a thread.
+// The thread polls rather than being notified, so that ProcessBlock() makes no
+// system calls.
+class ConvolverWorkerThread {
+ public:
+  // The convolvers must outlive this object.
+  explicit ConvolverWorkerThread(
+      const std::vector<NonUniformPartitionedConvolver*>& convolvers);
+  // Stops and joins the thread.
+  ~ConvolverWorkerThread();
+
+  ConvolverWorkerThread(const ConvolverWorkerThread&) = delete;
+  ConvolverWorkerThread& operator=(const ConvolverWorkerThread&) = delete;
+
+ private:
+  void Run();
+
+  const std::vector<NonUniformPartitionedConvolver*> convolvers_;
+  std::atomic<bool> stop_;
+  std::thread thread_;
+};
+
+}  // namespace linear_filters
+
+#endif  // AUDIO_LINEAR_FILTERS_NONUNIFORM_PARTITIONED_CONVOLVER_H_
@@ -0,0 +1,256 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/nonuniform_partitioned_convolver.h"
+
+#include <algorithm>
+#include <random>
+#include <vector>
+
+#include "audio/dsp/heap_allocation_counter.h"
+#include "audio/dsp/testing_util.h"
+#include "audio/linear_filters/fir_filter.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+namespace {
+
+using ::audio_dsp::EigenArrayNear;
+using ::Eigen::ArrayXXf;
+using ::std::vector;
+
+NonUniformPartitionedConvolverParams MakeParams(int head_size,
+                                                int max_partition_size,
+                                                bool background_tail) {
+  NonUniformPartitionedConvolverParams params;
+  params.head_size = head_size;
+  params.max_partition_size = max_partition_size;
+  params.background_tail = background_tail;
+  return params;
+}
+
+// Processes input in blocks of random size up to max_block_size.
+ArrayXXf ProcessInRandomBlocks(const ArrayXXf& input, int max_block_size,
+                               NonUniformPartitionedConvolver* convolver) {
+  ArrayXXf output(input.rows(), input.cols());
+  std::mt19937 rng(0 /* seed */);
+  for (int i = 0; i < input.cols();) {
+    std::uniform_int_distribution<int> block_size_distribution(
+        0, std::min<int>(max_block_size, input.cols() - i));
+    const int block_size = block_size_distribution(rng);
+    auto output_block = output.middleCols(i, block_size);
+    convolver->ProcessBlock(input.middleCols(i, block_size), &output_block);
+    i += block_size;
+  }
+  return output;
+}
+
+ArrayXXf DirectFormOutput(const ArrayXXf& kernel, const ArrayXXf& input) {
+  FirFilter fir;
+  fir.Init(kernel, FirFilter::kDirectForm);
+  ArrayXXf output;
+  fir.ProcessBlock(input, &output);
+  return output;
+}
+
+TEST(NonUniformPartitionedConvolverTest, SegmentPartitionSizes) {
+  NonUniformPartitionedConvolver convolver;
+  // The head covers [0, 4), and the segments [4, 16), [16, 32), [32, 64), and
+  // [64, 1000).
+  convolver.Init(ArrayXXf::Random(2, 1000), MakeParams(4, 32, false));
+  EXPECT_EQ(convolver.GetNumChannels(), 2);
+  EXPECT_EQ(convolver.GetSegmentPartitionSizes(),
+            vector<int>({4, 8, 16, 32}));
+
+  convolver.Init(ArrayXXf::Random(2, 4), MakeParams(4, 32, false));
+  EXPECT_TRUE(convolver.GetSegmentPartitionSizes().empty());
+
+  convolver.Init(ArrayXXf::Random(2, 100), MakeParams(16, 16, false));
+  EXPECT_EQ(convolver.GetSegmentPartitionSizes(), vector<int>({16}));
+}
+
+TEST(NonUniformPartitionedConvolverTest, MatchesDirectForm) {
+  constexpr int kChannels = 2;
+  constexpr int kNumSamples = 2000;
+  const ArrayXXf input = ArrayXXf::Random(kChannels, kNumSamples);
+  for (int kernel_size : {1, 8, 9, 50, 300, 1500}) {
+    for (int max_partition_size : {8, 64}) {
+      SCOPED_TRACE(testing::Message() << "kernel_size: " << kernel_size
+                   << ", max_partition_size: " << max_partition_size);
+      const ArrayXXf kernel = ArrayXXf::Random(kChannels, kernel_size);
+      const ArrayXXf expected = DirectFormOutput(kernel, input);
+      NonUniformPartitionedConvolver convolver;
+      convolver.Init(kernel, MakeParams(8, max_partition_size, false));
+      EXPECT_THAT(ProcessInRandomBlocks(input, 20, &convolver),
+                  EigenArrayNear(expected, 2e-4));
+
+      convolver.Reset();
+      ArrayXXf output;
+      convolver.ProcessBlock(input, &output);
+      EXPECT_THAT(output, EigenArrayNear(expected, 2e-4));
+      EXPECT_EQ(convolver.num_missed_deadlines(), 0);
+    }
+  }
+}
+
+// Without a worker, every background deadline is missed, and ProcessBlock()
+// does the work itself.
+TEST(NonUniformPartitionedConvolverTest, BackgroundWithoutWorker) {
+  const ArrayXXf kernel = ArrayXXf::Random(3, 500);
+  const ArrayXXf input = ArrayXXf::Random(3, 1000);
+  NonUniformPartitionedConvolver convolver;
+  convolver.Init(kernel, MakeParams(8, 32, true));
+  EXPECT_THAT(ProcessInRandomBlocks(input, 40, &convolver),
+              EigenArrayNear(DirectFormOutput(kernel, input), 2e-4));
+  EXPECT_GT(convolver.num_missed_deadlines(), 0);
+}
+
+// Posted work can be done at any time before the deadline, in which case no
+// deadline is missed.
+TEST(NonUniformPartitionedConvolverTest, BackgroundWorkBetweenBlocks) {
+  const ArrayXXf kernel = ArrayXXf::Random(2, 700);
+  const ArrayXXf input = ArrayXXf::Random(2, 1024);
+  NonUniformPartitionedConvolver convolver;
+  convolver.Init(kernel, MakeParams(16, 64, true));
+  ArrayXXf output(2, 1024);
+  for (int start = 0; start < 1024; start += 16) {
+    auto output_block = output.middleCols(start, 16);
+    convolver.ProcessBlock(input.middleCols(start, 16), &output_block);
+    convolver.ProcessBackgroundWork();
+  }
+  EXPECT_THAT(output, EigenArrayNear(DirectFormOutput(kernel, input), 2e-4));
+  EXPECT_EQ(convolver.num_missed_deadlines(), 0);
+  EXPECT_FALSE(convolver.ProcessBackgroundWork());
+}
+
+TEST(NonUniformPartitionedConvolverTest, WorkerThread) {
+  constexpr int kNumConvolvers = 4;
+  const ArrayXXf input = ArrayXXf::Random(2, 3000);
+  vector<ArrayXXf> kernels;
+  vector<NonUniformPartitionedConvolver> convolvers(kNumConvolvers);
+  vector<NonUniformPartitionedConvolver*> convolver_pointers;
+  for (int i = 0; i < kNumConvolvers; ++i) {
+    kernels.push_back(ArrayXXf::Random(2, 1200));
+    convolvers[i].Init(kernels[i], MakeParams(16, 128, true));
+    convolver_pointers.push_back(&convolvers[i]);
+  }
+  vector<ArrayXXf> outputs(kNumConvolvers, ArrayXXf(2, 3000));
+  {
+    ConvolverWorkerThread worker(convolver_pointers);
+    for (int start = 0; start < 3000; start += 30) {
+      for (int i = 0; i < kNumConvolvers; ++i) {
+        auto output_block = outputs[i].middleCols(start, 30);
+        convolvers[i].ProcessBlock(input.middleCols(start, 30),
+                                   &output_block);
+      }
+    }
+  }
+  for (int i = 0; i < kNumConvolvers; ++i) {
+    EXPECT_THAT(outputs[i],
+                EigenArrayNear(DirectFormOutput(kernels[i], input), 2e-4));
+  }
+}
+
+TEST(NonUniformPartitionedConvolverTest, SameKernelForEachChannel) {
+  const Eigen::ArrayXf kernel = Eigen::ArrayXf::Random(300);
+  const ArrayXXf input = ArrayXXf::Random(3, 500);
+  NonUniformPartitionedConvolver convolver;
+  convolver.Init(3, kernel, MakeParams(8, 64, false));
+  EXPECT_EQ(convolver.GetNumChannels(), 3);
+  EXPECT_THAT(
+      ProcessInRandomBlocks(input, 20, &convolver),
+      EigenArrayNear(
+          DirectFormOutput(kernel.transpose().replicate(3, 1), input), 2e-4));
+}
+
+// Init() and Reset() synchronize with the worker, so it can stay attached.
+TEST(NonUniformPartitionedConvolverTest, ReinitWithWorkerThread) {
+  const ArrayXXf input = ArrayXXf::Random(2, 2000);
+  NonUniformPartitionedConvolver convolver;
+  convolver.Init(ArrayXXf::Random(2, 1200), MakeParams(16, 128, true));
+  ConvolverWorkerThread worker({&convolver});
+  for (int kernel_size : {900, 1500, 300}) {
+    SCOPED_TRACE("kernel_size: " + testing::PrintToString(kernel_size));
+    const ArrayXXf kernel = ArrayXXf::Random(2, kernel_size);
+    convolver.Init(kernel, MakeParams(16, 128, true));
+    const ArrayXXf expected = DirectFormOutput(kernel, input);
+    for (int repeat = 0; repeat < 2; ++repeat) {
+      EXPECT_THAT(ProcessInRandomBlocks(input, 40, &convolver),
+                  EigenArrayNear(expected, 2e-4));
+      convolver.Reset();
+    }
+  }
+}
+
+TEST(NonUniformPartitionedConvolverTest, DoesNotAllocate) {
+  constexpr int kMaxBlockSize = 100;
+  NonUniformPartitionedConvolver convolver;
+  convolver.Init(ArrayXXf::Random(2, 2000), MakeParams(16, 256, true));
+  ArrayXXf buffer(2, kMaxBlockSize);
+  for (int num_samples : {kMaxBlockSize, 3, 0, 16, 1, 64, 100, 100, 100}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    const ArrayXXf input = ArrayXXf::Random(2, num_samples);
+    {
+      audio_dsp::ScopedHeapAllocationCounter counter;
+      auto output = buffer.leftCols(num_samples);
+      convolver.ProcessBlock(input, &output);
+      convolver.ProcessBackgroundWork();
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+  }
+}
+
+// Compares to FirFilter with a two-second kernel at 48kHz and 64-sample
+// blocks.
+constexpr int kBenchmarkKernelSize = 96000;
+constexpr int kBenchmarkBlockSize = 64;
+
+void BM_NonUniformPartitionedConvolver(benchmark::State& state) {
+  srand(0 /* seed */);
+  const ArrayXXf input = ArrayXXf::Random(2, kBenchmarkBlockSize);
+  ArrayXXf output(2, kBenchmarkBlockSize);
+  NonUniformPartitionedConvolver convolver;
+  convolver.Init(ArrayXXf::Random(2, kBenchmarkKernelSize),
+                 NonUniformPartitionedConvolverParams());
+  while (state.KeepRunning()) {
+    convolver.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK(BM_NonUniformPartitionedConvolver);
+
+void BM_UniformPartitionedFirFilter(benchmark::State& state) {
+  srand(0 /* seed */);
+  const ArrayXXf input = ArrayXXf::Random(2, kBenchmarkBlockSize);
+  ArrayXXf output(2, kBenchmarkBlockSize);
+  FirFilter fir;
+  fir.Init(ArrayXXf::Random(2, kBenchmarkKernelSize), kBenchmarkBlockSize);
+  while (state.KeepRunning()) {
+    fir.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kBenchmarkBlockSize * state.iterations());
+}
+BENCHMARK(BM_UniformPartitionedFirFilter);
+
+}  // namespace
+}  // namespace linear_filters
@@ -0,0 +1,117 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef AUDIO_LINEAR_FILTERS_PARALLEL_BIQUAD_FILTER_INL_H_
+#define AUDIO_LINEAR_FILTERS_PARALLEL_BIQUAD_FILTER_INL_H_
+
+#include "audio/linear_filters/parallel_biquad_filter.h"
+
+namespace linear_filters {
+
+template <typename _SampleType>
+void ParallelBiquadFilter<_SampleType>::Init(
+    int num_channels, const ParallelBiquadFilterCoefficients& coeffs) {
+  if (kNumChannelsAtCompileTime == Eigen::Dynamic) {
+    CHECK_GE(num_channels, 1);
+  } else {
+    CHECK_EQ(num_channels, kNumChannelsAtCompileTime);
+  }
+  CHECK(!coeffs.direct.empty()) << "The direct term must have a coefficient.";
+  num_channels_ = num_channels;
+  const int num_sections = coeffs.sections.size();
+  feedforward0_.resize(1, num_sections);
+  feedforward1_.resize(1, num_sections);
+  feedback1_.resize(1, num_sections);
+  feedback2_.resize(1, num_sections);
+  for (int k = 0; k < num_sections; ++k) {
+    const BiquadFilterCoefficients& section = coeffs.sections[k];
+    CHECK_NE(section.a[0], 0.0) << "Filter coefficient a0 cannot be zero.";
+    CHECK_EQ(section.b[2], 0.0) << "Parallel sections must have b2 = 0.";
+    // Scale the coefficients by 1 / a0.
+    const double scale = 1.0 / section.a[0];
+    feedforward0_[k] = static_cast<CoefficientType>(scale * section.b[0]);
+    feedforward1_[k] = static_cast<CoefficientType>(scale * section.b[1]);
+    feedback1_[k] = static_cast<CoefficientType>(scale * section.a[1]);
+    feedback2_[k] = static_cast<CoefficientType>(scale * section.a[2]);
+  }
+  direct_.assign(coeffs.direct.begin(), coeffs.direct.end());
+  Reset();
+}
+
+template <typename _SampleType>
+void ParallelBiquadFilter<_SampleType>::Reset() {
+  CHECK_GE(num_channels_, 1) << "Reset() called before Init().";
+  const int num_sections = feedforward0_.cols();
+  state1_ = SectionsArray::Zero(num_channels_, num_sections);
+  state2_ = SectionsArray::Zero(num_channels_, num_sections);
+  next_state_.resize(num_channels_, num_sections);
+  section_output_.resize(num_channels_, num_sections);
+  direct_state_ = SectionsArray::Zero(num_channels_, direct_.size() - 1);
+  input_.resize(num_channels_);
+  output_.resize(num_channels_);
+}
+
+template <typename _SampleType>
+template <typename InputType, typename OutputType>
+void ParallelBiquadFilter<_SampleType>::ProcessSample(const InputType& input,
+                                                      OutputType* output) {
+  // Each section k is a direct form 2 biquad with b2 = 0,
+  //   s_k[n] = x[n] - alpha1[k] * s_k[n - 1] - alpha2[k] * s_k[n - 2],
+  //   y_k[n] = beta0[k] * s_k[n] + beta1[k] * s_k[n - 1],
+  // and the output is
+  //   y[n] = sum_k y_k[n] + sum_m d[m] * x[n - m].
+  // The sections are the columns of the state arrays, so every line below
+  // updates all sections at once.
+  using OutputScalarType = typename Traits::template
+      GetScalarType<OutputType>::Type;
+  DCHECK_GE(num_channels_, 1) << "ProcessSample() called before Init().";
+  DCHECK(output != nullptr);
+  DCHECK_EQ(Traits::AsEigenArray(input).rows(), num_channels_);
+  // Copy the input to a workspace, so that the broadcast below does not
+  // evaluate the cast into a temporary. The input is read in full before
+  // output is written, so in-place processing works.
+  input_ = Traits::AsEigenArray(input).array().template cast<AccumType>();
+
+  next_state_ = -(state1_.rowwise() * feedback1_) -
+                state2_.rowwise() * feedback2_;
+  next_state_.colwise() += input_;
+  section_output_ = next_state_.rowwise() * feedforward0_ +
+                    state1_.rowwise() * feedforward1_;
+  output_ = section_output_.rowwise().sum();
+  state2_.swap(state1_);
+  state1_.swap(next_state_);
+
+  // Add the FIR direct term.
+  output_ += direct_[0] * input_;
+  const int num_delays = direct_state_.cols();
+  for (int m = 0; m < num_delays; ++m) {
+    output_ += direct_[m + 1] * direct_state_.col(m);
+  }
+  for (int m = num_delays - 1; m > 0; --m) {
+    direct_state_.col(m) = direct_state_.col(m - 1);
+  }
+  if (num_delays > 0) {
+    direct_state_.col(0) = input_;
+  }
+
+  Traits::AsMutableEigenArray(output)->resize(num_channels_);
+  Traits::AsMutableEigenArray(output)->matrix() =
+      output_.matrix().template cast<OutputScalarType>();
+}
+
+}  // namespace linear_filters
+
+#endif  // AUDIO_LINEAR_FILTERS_PARALLEL_BIQUAD_FILTER_INL_H_
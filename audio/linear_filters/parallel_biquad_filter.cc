@@ -0,0 +1,205 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/parallel_biquad_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+
+#include "audio/linear_filters/biquad_filter.h"
+
+namespace linear_filters {
+
+using ::std::complex;
+using ::std::vector;
+
+namespace {
+
+// Bounds on the number of impulse response samples compared for the error.
+constexpr int kMinErrorSamples = 64;
+constexpr int kMaxErrorSamples = 65536;
+
+// Computes the first num_samples samples of the impulse response of filter.
+template <typename ScalarType, typename FilterType>
+vector<ScalarType> ImpulseResponse(FilterType* filter, int num_samples) {
+  vector<ScalarType> impulse(num_samples, 0.0);
+  impulse[0] = 1.0;
+  vector<ScalarType> response;
+  filter->ProcessBlock(impulse, &response);
+  return response;
+}
+
+// Computes the maximum absolute difference between the impulse response of a
+// ParallelBiquadFilter<ScalarType> and serial_response, relative to the peak
+// magnitude of serial_response.
+template <typename ScalarType>
+double RelativeImpulseResponseError(
+    const ParallelBiquadFilterCoefficients& parallel,
+    const vector<double>& serial_response) {
+  const int num_samples = serial_response.size();
+  ParallelBiquadFilter<ScalarType> parallel_filter;
+  parallel_filter.Init(1, parallel);
+  const vector<ScalarType> parallel_response =
+      ImpulseResponse<ScalarType>(&parallel_filter, num_samples);
+  double max_error = 0.0;
+  double max_response = 0.0;
+  for (int n = 0; n < num_samples; ++n) {
+    const double error = std::abs(parallel_response[n] - serial_response[n]);
+    if (!std::isfinite(error)) {
+      // Residues overflow when poles are repeated or nearly so.
+      return std::numeric_limits<double>::infinity();
+    }
+    max_error = std::max(max_error, error);
+    max_response = std::max(max_response, std::abs(serial_response[n]));
+  }
+  const double relative_error = max_error / max_response;
+  return std::isfinite(relative_error)
+      ? relative_error : std::numeric_limits<double>::infinity();
+}
+
+}  // namespace
+
+complex<double> ParallelBiquadFilterCoefficients::EvalTransferFunction(
+    const complex<double>& z) const {
+  const complex<double> z_inv = 1.0 / z;
+  complex<double> result = 0.0;
+  // Evaluate the direct term with Horner's method.
+  for (int m = direct.size() - 1; m >= 0; --m) {
+    result = result * z_inv + direct[m];
+  }
+  for (const BiquadFilterCoefficients& section : sections) {
+    result += section.EvalTransferFunction(z);
+  }
+  return result;
+}
+
+ParallelBiquadFilterCoefficients MakeParallelBiquadFilterCoefficients(
+    const BiquadFilterCascadeCoefficients& cascade) {
+  const int num_stages = cascade.size();
+  // Gather the poles of each stage, where poles at the origin are only
+  // counted. They are poles of H(z) but not of H as a function of z^-1, and
+  // they raise the degree of the direct term instead.
+  vector<vector<complex<double>>> stage_poles(num_stages);
+  vector<complex<double>> poles;
+  int num_poles_at_origin = 0;
+  for (int i = 0; i < num_stages; ++i) {
+    const auto stage_pole_pair = cascade[i].GetPoles();
+    for (const complex<double>& pole :
+         {stage_pole_pair.first, stage_pole_pair.second}) {
+      if (pole == 0.0) {
+        ++num_poles_at_origin;
+      } else {
+        stage_poles[i].push_back(pole);
+        poles.push_back(pole);
+      }
+    }
+  }
+
+  // In terms of q = z^-1, the cascade is H(q) = B(q) / prod_p (1 - p q), where
+  // B(q) = prod_i (b0[i] + b1[i] q + b2[i] q^2) / a0[i]. For distinct poles,
+  // the residue of the term r_p / (1 - p q) is
+  //   r_p = B(1/p) / prod_{p' != p} (1 - p' / p).
+  // Both products are evaluated in factored form, since expanding the
+  // polynomials loses precision quickly as the order grows.
+  auto residue = [&cascade, &poles](int pole_index) {
+    const complex<double> p = poles[pole_index];
+    const complex<double> q = 1.0 / p;
+    complex<double> r = 1.0;
+    for (const BiquadFilterCoefficients& stage : cascade.coeffs) {
+      r *= (stage.b[0] + (stage.b[1] + stage.b[2] * q) * q) / stage.a[0];
+    }
+    for (int j = 0; j < poles.size(); ++j) {
+      if (j != pole_index) {
+        r /= 1.0 - poles[j] * q;
+      }
+    }
+    return r;
+  };
+
+  ParallelBiquadFilterCoefficients parallel;
+  parallel.sections.clear();
+  vector<complex<double>> residues(poles.size());
+  int pole_index = 0;
+  for (int i = 0; i < num_stages; ++i) {
+    if (stage_poles[i].empty()) { continue; }  // Stage is FIR.
+    const double a0 = cascade[i].a[0];
+    if (stage_poles[i].size() == 1) {
+      // First-order section r / (1 - p q).
+      const complex<double> r = residue(pole_index);
+      residues[pole_index++] = r;
+      parallel.sections.push_back(
+          {{r.real(), 0.0, 0.0}, {1.0, -stage_poles[i][0].real(), 0.0}});
+    } else {
+      // Combine the stage's two poles into one section,
+      //   r1 / (1 - p1 q) + r2 / (1 - p2 q)
+      //     = ((r1 + r2) - (r1 p2 + r2 p1) q) / ((1 - p1 q) (1 - p2 q)).
+      // The poles are real or a conjugate pair, and so are the residues since
+      // the coefficients are real, so the section coefficients are real.
+      const complex<double> p1 = stage_poles[i][0];
+      const complex<double> p2 = stage_poles[i][1];
+      const complex<double> r1 = residue(pole_index);
+      residues[pole_index++] = r1;
+      const complex<double> r2 = residue(pole_index);
+      residues[pole_index++] = r2;
+      parallel.sections.push_back(
+          {{(r1 + r2).real(), -(r1 * p2 + r2 * p1).real(), 0.0},
+           {1.0, cascade[i].a[1] / a0, cascade[i].a[2] / a0}});
+    }
+  }
+
+  // Estimate how long to compare the impulse responses.
+  double decay_time = num_poles_at_origin;
+  for (const BiquadFilterCoefficients& stage : cascade.coeffs) {
+    decay_time += stage.EstimateDecayTime(-120.0);
+  }
+  const int num_samples = std::isfinite(decay_time)
+      ? std::max(kMinErrorSamples,
+                 static_cast<int>(std::min<double>(std::ceil(decay_time),
+                                                   kMaxErrorSamples)))
+      : kMaxErrorSamples;
+
+  BiquadFilterCascade<double> serial_filter;
+  serial_filter.Init(1, cascade);
+  const vector<double> serial_response =
+      ImpulseResponse<double>(&serial_filter, num_samples);
+
+  // The direct term has degree num_poles_at_origin and makes up the
+  // difference between the impulse response and the sum of the partial
+  // fractions, d[m] = h[m] - sum_p r_p p^m.
+  parallel.direct.resize(num_poles_at_origin + 1);
+  for (int m = 0; m <= num_poles_at_origin; ++m) {
+    complex<double> partial_fractions = 0.0;
+    for (int j = 0; j < poles.size(); ++j) {
+      partial_fractions += residues[j] * std::pow(poles[j], m);
+    }
+    parallel.direct[m] = serial_response[m] - partial_fractions.real();
+  }
+
+  parallel.relative_error =
+      RelativeImpulseResponseError<double>(parallel, serial_response);
+  parallel.relative_error_float =
+      RelativeImpulseResponseError<float>(parallel, serial_response);
+  return parallel;
+}
+
+ParallelBiquadFilterCoefficients MakeParallelBiquadFilterCoefficients(
+    const FilterPolesAndZeros& poles_and_zeros) {
+  return MakeParallelBiquadFilterCoefficients(
+      poles_and_zeros.GetCoefficients());
+}
+
+}  // namespace linear_filters
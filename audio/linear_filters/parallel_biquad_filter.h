@@ -0,0 +1,199 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Parallel form of a biquad filter cascade.
+//
+// A cascade of biquads
+//
+//          N-1  b0[i] + b1[i] z^-1 + b2[i] z^-2
+//  H(z) = prod  ---------------------------------
+//          i=0  a0[i] + a1[i] z^-1 + a2[i] z^-2
+//
+// has a strict stage-to-stage dependency: stage i cannot run before stage
+// i - 1 has produced its output. If the poles are distinct, a partial fraction
+// expansion rewrites H(z) as a sum of sections plus an FIR direct term,
+//
+//            M         K-1      beta0[k] + beta1[k] z^-1
+//  H(z) =   sum d[m] z^-m + sum ---------------------------------,
+//           m=0             k=0 1 + alpha1[k] z^-1 + alpha2[k] z^-2
+//
+// where section k has the poles of one stage of the cascade and M is the number
+// of poles at the origin (M = 0 unless some stages have a2 = 0). The sections
+// are independent, so ParallelBiquadFilter updates all of them at once with
+// operations vectorized over the sections and sums their outputs. This has
+// much more instruction-level parallelism than the serial form, especially for
+// the high-order filters produced by PoleZeroFilterDesign.
+//
+// The expansion is ill-conditioned when poles are close together (the residues
+// grow large and cancel), so MakeParallelBiquadFilterCoefficients() reports
+// the error of the conversion. Only use the parallel form where that error is
+// acceptable.
+//
+// Example:
+//   BiquadFilterCascadeCoefficients cascade = ...
+//   ParallelBiquadFilterCoefficients parallel =
+//       MakeParallelBiquadFilterCoefficients(cascade);
+//   if (ParallelBiquadFilter<float>::RelativeError(parallel) < 1e-3) {
+//     ParallelBiquadFilter<float> filter;
+//     filter.Init(1, parallel);
+//     filter.ProcessBlock(input, &output);
+//   }
+
+#ifndef AUDIO_LINEAR_FILTERS_PARALLEL_BIQUAD_FILTER_H_
+#define AUDIO_LINEAR_FILTERS_PARALLEL_BIQUAD_FILTER_H_
+
+#include <complex>
+#include <type_traits>
+#include <vector>
+
+#include "audio/linear_filters/biquad_filter_coefficients.h"
+#include "audio/linear_filters/filter_poles_and_zeros.h"
+#include "audio/linear_filters/filter_traits.h"
+#include "glog/logging.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+
+struct ParallelBiquadFilterCoefficients {
+  // The default constructor makes coefficients for an identity filter.
+  ParallelBiquadFilterCoefficients()
+      : direct(1, 1.0), relative_error(0.0), relative_error_float(0.0) {}
+
+  // Evaluate the transfer function at complex value z.
+  std::complex<double> EvalTransferFunction(
+      const std::complex<double>& z) const;
+
+  // The parallel sections. Section k has feedforward coefficients
+  // b = {beta0[k], beta1[k], 0} and feedback coefficients
+  // a = {1, alpha1[k], alpha2[k]}.
+  std::vector<BiquadFilterCoefficients> sections;
+  // FIR direct term, d[m] is the coefficient of z^-m.
+  std::vector<double> direct;
+  // Maximum absolute difference between the impulse responses of the parallel
+  // and serial forms, relative to the peak magnitude of the serial impulse
+  // response, for a ParallelBiquadFilter computing in double precision.
+  // Infinity if the conversion failed, e.g. because the cascade has repeated
+  // poles.
+  double relative_error;
+  // Same as relative_error for a ParallelBiquadFilter computing in single
+  // precision, so it includes the float rounding of the coefficients and
+  // state. Use ParallelBiquadFilter::RelativeError() to get the one matching a
+  // filter's scalar type.
+  double relative_error_float;
+};
+
+// Converts a cascade to parallel form by partial fraction expansion, using the
+// poles of each stage from BiquadFilterCoefficients::GetPoles(). The impulse
+// responses for relative_error and relative_error_float are compared over the estimated decay time of
+// the cascade, between 64 and 65536 samples.
+ParallelBiquadFilterCoefficients MakeParallelBiquadFilterCoefficients(
+    const BiquadFilterCascadeCoefficients& cascade);
+
+// Same as above for a filter given by its discrete-time poles and zeros.
+ParallelBiquadFilterCoefficients MakeParallelBiquadFilterCoefficients(
+    const FilterPolesAndZeros& poles_and_zeros);
+
+// Runs a filter in parallel form. The interface is the same as BiquadFilter,
+// see biquad_filter.h for the meaning of SampleType.
+//
+// The state of all sections is held with sections along the columns, so for a
+// single-channel filter each update is vectorized over the sections, and for
+// a multichannel filter over the channels of each section.
+template <typename _SampleType>
+class ParallelBiquadFilter {
+  using Traits = typename internal::FilterTraits<
+     _SampleType, internal::IsEigenType<_SampleType>::Value>;
+
+ public:
+  using CoefficientType = typename Traits::CoefficientType;
+  using SampleType = typename Traits::SampleType;
+  using ScalarType = typename Traits::template GetScalarType<SampleType>::Type;
+  static constexpr int kNumChannelsAtCompileTime =
+      Traits::kNumChannelsAtCompileTime;
+  using AccumType = typename Traits::AccumType;
+
+  // Necessary to align fixed-sized Eigen members, see
+  // http://eigen.tuxfamily.org/dox/group__TopicStructHavingEigenMembers.html
+  EIGEN_MAKE_ALIGNED_OPERATOR_NEW
+
+  ParallelBiquadFilter(): num_channels_(0) {}
+
+  // Initialize the filter with zero state. The number of channels must be
+  // compatible with SampleType as for BiquadFilter::Init().
+  void Init(int num_channels, const ParallelBiquadFilterCoefficients& coeffs);
+
+  // Reset the filter to zero state.
+  void Reset();
+
+  int num_channels() const { return num_channels_; }
+
+  // The conversion error of coeffs for a filter with this CoefficientType,
+  // either coeffs.relative_error or coeffs.relative_error_float.
+  static double RelativeError(const ParallelBiquadFilterCoefficients& coeffs) {
+    return std::is_same<CoefficientType, float>::value
+        ? coeffs.relative_error_float : coeffs.relative_error;
+  }
+
+  // Process a block of samples, see BiquadFilter::ProcessBlock().
+  template <typename InputType, typename OutputType>
+  void ProcessBlock(const InputType& input, OutputType* output) {
+    CHECK_GE(num_channels_, 1) << "ProcessBlock() called before Init().";
+    Traits::ProcessBlock(this, input, output);
+  }
+
+  // Process one sample, see BiquadFilter::ProcessSample().
+  template <typename InputType, typename OutputType>
+  void ProcessSample(const InputType& input, OutputType* output);
+
+ private:
+  using SectionsArray =
+      Eigen::Array<AccumType, kNumChannelsAtCompileTime, Eigen::Dynamic>;
+  using SectionCoeffsArray = Eigen::Array<AccumType, 1, Eigen::Dynamic>;
+
+  int num_channels_;
+  // Row vectors over the sections of beta0, beta1, alpha1 and alpha2. They
+  // are stored as AccumType so that they combine directly with the state.
+  SectionCoeffsArray feedforward0_;
+  SectionCoeffsArray feedforward1_;
+  SectionCoeffsArray feedback1_;
+  SectionCoeffsArray feedback2_;
+  // FIR direct term d[0], d[1], ....
+  std::vector<CoefficientType> direct_;
+  // Arrays of size num_channels-by-num_sections holding the section states
+  // s[n - 1] and s[n - 2], and workspaces for s[n] and the section outputs.
+  // The workspaces are allocated in Reset() so that ProcessSample() does not
+  // allocate.
+  SectionsArray state1_;
+  SectionsArray state2_;
+  SectionsArray next_state_;
+  SectionsArray section_output_;
+  // Array of size num_channels-by-(direct_.size() - 1) holding the previous
+  // inputs x[n - 1], x[n - 2], ... for the direct term.
+  SectionsArray direct_state_;
+  // Workspaces for the input and output samples.
+  Eigen::Array<AccumType, kNumChannelsAtCompileTime, 1> input_;
+  Eigen::Array<AccumType, kNumChannelsAtCompileTime, 1> output_;
+};
+
+}  // namespace linear_filters
+
+// Hide implementation in another header.
+#include "audio/linear_filters/parallel_biquad_filter-inl.h"   // IWYU pragma: export
+
+#endif  // AUDIO_LINEAR_FILTERS_PARALLEL_BIQUAD_FILTER_H_
@@ -0,0 +1,294 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/parallel_biquad_filter.h"
+
+#include <cmath>
+#include <complex>
+#include <vector>
+
+#include "audio/dsp/heap_allocation_counter.h"
+#include "audio/dsp/testing_util.h"
+#include "audio/linear_filters/biquad_filter.h"
+#include "audio/linear_filters/biquad_filter_coefficients.h"
+#include "audio/linear_filters/biquad_filter_design.h"
+#include "audio/linear_filters/filter_poles_and_zeros.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+namespace {
+
+using ::audio_dsp::EigenArrayNear;
+using ::Eigen::ArrayXf;
+using ::Eigen::Dynamic;
+using ::std::complex;
+using ::std::vector;
+
+// Points at which transfer functions are compared.
+const vector<complex<double>> kTestPoints = {
+    {0.3, -0.5}, {1.0, 0.0}, {-1.0, 0.0}, {0.0, 1.0}, {1.5, 2.0}};
+
+void ExpectSameTransferFunction(
+    const BiquadFilterCascadeCoefficients& cascade,
+    const ParallelBiquadFilterCoefficients& parallel, double tolerance) {
+  for (const complex<double>& z : kTestPoints) {
+    SCOPED_TRACE("z: " + testing::PrintToString(z));
+    const complex<double> expected = cascade.EvalTransferFunction(z);
+    EXPECT_LE(std::abs(parallel.EvalTransferFunction(z) - expected),
+              tolerance * std::max(1.0, std::abs(expected)));
+  }
+}
+
+TEST(ParallelBiquadFilterTest, DefaultCoefficientsAreIdentity) {
+  ParallelBiquadFilterCoefficients parallel;
+  EXPECT_TRUE(parallel.sections.empty());
+  EXPECT_EQ(parallel.direct, vector<double>({1.0}));
+  EXPECT_NEAR(std::abs(parallel.EvalTransferFunction({0.3, 0.4}) - 1.0),
+              0.0, 1e-12);
+}
+
+TEST(ParallelBiquadFilterTest, TwoStageCascade) {
+  const BiquadFilterCascadeCoefficients cascade(
+      vector<BiquadFilterCoefficients>{
+          {{-0.2, 1.9, 0.4}, {0.5, -0.2, 0.1}},
+          {{0.3, 0.1, -0.2}, {1.0, 0.4, 0.3}}});
+  const ParallelBiquadFilterCoefficients parallel =
+      MakeParallelBiquadFilterCoefficients(cascade);
+
+  EXPECT_EQ(parallel.sections.size(), 2);
+  EXPECT_EQ(parallel.direct.size(), 1);
+  for (const BiquadFilterCoefficients& section : parallel.sections) {
+    EXPECT_EQ(section.b[2], 0.0);
+  }
+  EXPECT_LT(parallel.relative_error, 1e-12);
+  ExpectSameTransferFunction(cascade, parallel, 1e-10);
+}
+
+// Odd-order designs have a first-order stage with a pole at the origin, which
+// adds a tap to the direct term.
+TEST(ParallelBiquadFilterTest, OddOrderButterworth) {
+  const BiquadFilterCascadeCoefficients cascade =
+      ButterworthFilterDesign(7).LowpassCoefficients(48000.0, 3000.0);
+  const ParallelBiquadFilterCoefficients parallel =
+      MakeParallelBiquadFilterCoefficients(cascade);
+
+  EXPECT_EQ(parallel.sections.size(), 4);
+  EXPECT_EQ(parallel.direct.size(), 2);
+  EXPECT_LT(parallel.relative_error, 1e-9);
+  EXPECT_LT(parallel.relative_error_float, 1e-5);
+  ExpectSameTransferFunction(cascade, parallel, 1e-8);
+}
+
+// The error in single precision includes the float rounding, so it is much
+// larger than in double precision, and RelativeError() must pick the one
+// matching the filter.
+TEST(ParallelBiquadFilterTest, RelativeErrorMatchesScalarType) {
+  const BiquadFilterCascadeCoefficients cascade =
+      ButterworthFilterDesign(16).LowpassCoefficients(48000.0, 8000.0);
+  const ParallelBiquadFilterCoefficients parallel =
+      MakeParallelBiquadFilterCoefficients(cascade);
+
+  EXPECT_LT(parallel.relative_error, 1e-9);
+  EXPECT_GT(parallel.relative_error_float, 100 * parallel.relative_error);
+  EXPECT_LT(parallel.relative_error_float, 3e-4);
+  EXPECT_EQ(ParallelBiquadFilter<double>::RelativeError(parallel),
+            parallel.relative_error);
+  EXPECT_EQ(ParallelBiquadFilter<Eigen::ArrayXcd>::RelativeError(parallel),
+            parallel.relative_error);
+  EXPECT_EQ(ParallelBiquadFilter<float>::RelativeError(parallel),
+            parallel.relative_error_float);
+  EXPECT_EQ(ParallelBiquadFilter<Eigen::Array3f>::RelativeError(parallel),
+            parallel.relative_error_float);
+}
+
+TEST(ParallelBiquadFilterTest, FirStages) {
+  BiquadFilterCascadeCoefficients cascade(
+      BiquadFilterCoefficients({0.3, 0.1, -0.2}, {1.0, 0.4, 0.3}));
+  cascade.AppendNumerator({1.0, -0.5, 0.25});
+  const ParallelBiquadFilterCoefficients parallel =
+      MakeParallelBiquadFilterCoefficients(cascade);
+
+  EXPECT_EQ(parallel.sections.size(), 1);
+  EXPECT_EQ(parallel.direct.size(), 3);
+  EXPECT_LT(parallel.relative_error, 1e-12);
+  ExpectSameTransferFunction(cascade, parallel, 1e-10);
+}
+
+TEST(ParallelBiquadFilterTest, FromPolesAndZeros) {
+  FilterPolesAndZeros poles_and_zeros;
+  poles_and_zeros.AddPole(0.5);
+  poles_and_zeros.AddPole(-0.3);
+  poles_and_zeros.AddConjugatePolePair(std::polar(0.9, 0.3));
+  poles_and_zeros.AddConjugatePolePair(std::polar(0.8, 1.2));
+  // With as many zeros as poles, Eval(z) is the discrete-time transfer
+  // function.
+  poles_and_zeros.AddZero(-1.0);
+  poles_and_zeros.AddZero(0.2);
+  poles_and_zeros.AddConjugateZeroPair(std::polar(1.0, 2.0));
+  poles_and_zeros.AddConjugateZeroPair(std::polar(1.0, 2.5));
+  poles_and_zeros.SetGain(0.1);
+  const ParallelBiquadFilterCoefficients parallel =
+      MakeParallelBiquadFilterCoefficients(poles_and_zeros);
+
+  EXPECT_LT(parallel.relative_error, 1e-10);
+  for (const complex<double>& z : kTestPoints) {
+    SCOPED_TRACE("z: " + testing::PrintToString(z));
+    const complex<double> expected = poles_and_zeros.Eval(z);
+    EXPECT_LE(std::abs(parallel.EvalTransferFunction(z) - expected),
+              1e-8 * std::max(1.0, std::abs(expected)));
+  }
+}
+
+TEST(ParallelBiquadFilterTest, RepeatedPolesReportError) {
+  const BiquadFilterCoefficients stage = {{1.0, 0.0, 0.0}, {1.0, -1.2, 0.5}};
+  const BiquadFilterCascadeCoefficients cascade(
+      vector<BiquadFilterCoefficients>{stage, stage});
+  const ParallelBiquadFilterCoefficients parallel =
+      MakeParallelBiquadFilterCoefficients(cascade);
+  EXPECT_GT(parallel.relative_error, 1e-3);
+  EXPECT_GT(parallel.relative_error_float, 1e-3);
+}
+
+TEST(ParallelBiquadFilterTest, PreallocatedOutputDoesNotAllocate) {
+  constexpr int kNumChannels = 3;
+  constexpr int kNumSamples = 16;
+  const ParallelBiquadFilterCoefficients parallel =
+      MakeParallelBiquadFilterCoefficients(
+          ButterworthFilterDesign(7).LowpassCoefficients(48000.0, 3000.0));
+  ParallelBiquadFilter<Eigen::ArrayXf> filter;
+  filter.Init(kNumChannels, parallel);
+  const Eigen::ArrayXXf input =
+      Eigen::ArrayXXf::Random(kNumChannels, kNumSamples);
+  Eigen::ArrayXXf output(kNumChannels, kNumSamples);
+  {
+    audio_dsp::ScopedHeapAllocationCounter counter;
+    filter.ProcessBlock(input, &output);
+    EXPECT_EQ(counter.num_allocations(), 0);
+  }
+}
+
+template <typename TypeParam>
+class ParallelBiquadFilterTypedTest : public ::testing::Test {};
+
+typedef ::testing::Types<
+    float,
+    double,
+    complex<float>,
+    Eigen::ArrayXf,
+    Eigen::ArrayXcd,
+    Eigen::VectorXf,
+    Eigen::Array3f
+    > TestTypes;
+TYPED_TEST_SUITE(ParallelBiquadFilterTypedTest, TestTypes);
+
+// Test that ParallelBiquadFilter matches the serial BiquadFilterCascade.
+TYPED_TEST(ParallelBiquadFilterTypedTest, MatchesCascade) {
+  using SampleType = TypeParam;
+  constexpr int kNumSamples = 200;
+  const BiquadFilterCascadeCoefficients cascade =
+      ButterworthFilterDesign(5).LowpassCoefficients(48000.0, 5000.0);
+  const ParallelBiquadFilterCoefficients parallel =
+      MakeParallelBiquadFilterCoefficients(cascade);
+  srand(0 /* seed */);
+
+  using FilterType = ParallelBiquadFilter<SampleType>;
+  const int kNumChannelsAtCompileTime = FilterType::kNumChannelsAtCompileTime;
+  using ScalarType = typename FilterType::ScalarType;
+  using BlockOfSamples = typename Eigen::Array<
+      ScalarType, kNumChannelsAtCompileTime, Dynamic>;
+
+  for (int num_channels : {1, 3, 10}) {
+    if ((kNumChannelsAtCompileTime != Dynamic &&
+         kNumChannelsAtCompileTime != num_channels) ||
+        (!internal::IsEigenType<SampleType>::Value && num_channels != 1)) {
+      continue;  // Skip if SampleType is incompatible with num_channels.
+    }
+    SCOPED_TRACE("num_channels: " + testing::PrintToString(num_channels));
+    BiquadFilterCascade<SampleType> serial_filter;
+    serial_filter.Init(num_channels, cascade);
+    FilterType parallel_filter;
+    parallel_filter.Init(num_channels, parallel);
+    EXPECT_EQ(parallel_filter.num_channels(), num_channels);
+
+    const BlockOfSamples input =
+        BlockOfSamples::Random(num_channels, kNumSamples);
+    BlockOfSamples expected;
+    serial_filter.ProcessBlock(input, &expected);
+    // Process in two blocks, the second in place.
+    BlockOfSamples output(num_channels, kNumSamples);
+    BlockOfSamples block = input.leftCols(kNumSamples / 2);
+    BlockOfSamples block_output;
+    parallel_filter.ProcessBlock(block, &block_output);
+    output.leftCols(kNumSamples / 2) = block_output;
+    block = input.rightCols(kNumSamples / 2);
+    parallel_filter.ProcessBlock(block, &block);
+    output.rightCols(kNumSamples / 2) = block;
+
+    EXPECT_THAT(output, EigenArrayNear(expected, 1e-5));
+
+    parallel_filter.Reset();
+    parallel_filter.ProcessBlock(input, &output);
+    EXPECT_THAT(output, EigenArrayNear(expected, 1e-5));
+  }
+}
+
+// Compares the serial and parallel forms of a high-order lowpass filter.
+constexpr int kBenchmarkOrder = 16;
+constexpr int kSamplePerBlock = 1000;
+
+void BM_SerialCascadeScalarFloat(benchmark::State& state) {
+  const BiquadFilterCascadeCoefficients cascade =
+      ButterworthFilterDesign(kBenchmarkOrder)
+      .LowpassCoefficients(48000.0, 8000.0);
+  srand(0 /* seed */);
+  ArrayXf input = ArrayXf::Random(kSamplePerBlock);
+  ArrayXf output(kSamplePerBlock);
+  BiquadFilterCascade<float> filter;
+  filter.Init(1, cascade);
+
+  while (state.KeepRunning()) {
+    filter.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kSamplePerBlock * state.iterations());
+}
+BENCHMARK(BM_SerialCascadeScalarFloat);
+
+void BM_ParallelScalarFloat(benchmark::State& state) {
+  const BiquadFilterCascadeCoefficients cascade =
+      ButterworthFilterDesign(kBenchmarkOrder)
+      .LowpassCoefficients(48000.0, 8000.0);
+  srand(0 /* seed */);
+  ArrayXf input = ArrayXf::Random(kSamplePerBlock);
+  ArrayXf output(kSamplePerBlock);
+  ParallelBiquadFilter<float> filter;
+  filter.Init(1, MakeParallelBiquadFilterCoefficients(cascade));
+
+  while (state.KeepRunning()) {
+    filter.ProcessBlock(input, &output);
+    benchmark::DoNotOptimize(output);
+  }
+  state.SetItemsProcessed(kSamplePerBlock * state.iterations());
+}
+BENCHMARK(BM_ParallelScalarFloat);
+
+}  // namespace
+}  // namespace linear_filters
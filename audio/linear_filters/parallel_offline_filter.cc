@@ -0,0 +1,313 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/parallel_offline_filter.h"
+
+#include <algorithm>
+#include <cmath>
+#include <functional>
+#include <thread>  // NOLINT(build/c++11)
+
+#include "audio/linear_filters/biquad_filter.h"
+#include "audio/linear_filters/ladder_filter.h"
+#include "glog/logging.h"
+
+namespace linear_filters {
+
+using ::Eigen::ArrayXf;
+using ::Eigen::ArrayXXd;
+using ::Eigen::ArrayXXf;
+using ::Eigen::MatrixXd;
+using ::std::vector;
+
+namespace {
+
+// Chunks are at least this long, so that the serial pass over the chunk
+// boundaries and the thread startup are small compared to the filtering.
+constexpr int kMinChunkSize = 4096;
+
+// The zero-input response added to a chunk is dropped once it has decayed
+// below this fraction of its initial magnitude.
+constexpr double kNegligibleResponse = 1e-12;
+
+using ChunkMap = Eigen::Map<ArrayXXf>;
+
+// The difference equation
+//   y[n] = sum_k b[k] x[n - k] - sum_{k > 0} a[k] y[n - k],  k = 0, ..., order,
+// with a[0] = 1.
+struct Recursion {
+  Recursion(const vector<double>& coeffs_b, const vector<double>& coeffs_a)
+      : order(std::max(coeffs_b.size(), coeffs_a.size()) - 1),
+        b(order + 1, 0.0),
+        a(order + 1, 0.0) {
+    CHECK(!coeffs_a.empty());
+    CHECK_NE(coeffs_a[0], 0.0);
+    for (int k = 0; k < coeffs_b.size(); ++k) {
+      b[k] = coeffs_b[k] / coeffs_a[0];
+    }
+    for (int k = 0; k < coeffs_a.size(); ++k) {
+      a[k] = coeffs_a[k] / coeffs_a[0];
+    }
+  }
+
+  // Returns M^power, where M is the companion matrix advancing the state
+  // (y[n], y[n - 1], ..., y[n - order + 1]) of the homogeneous recursion by
+  // one sample.
+  MatrixXd CompanionMatrixPower(int power) const {
+    MatrixXd companion = MatrixXd::Zero(order, order);
+    for (int k = 0; k < order; ++k) {
+      companion(0, k) = -a[k + 1];
+    }
+    for (int k = 1; k < order; ++k) {
+      companion(k, k - 1) = 1.0;
+    }
+    MatrixXd result = MatrixXd::Identity(order, order);
+    for (; power > 0; power /= 2) {
+      if (power % 2 == 1) {
+        result = result * companion;
+      }
+      companion = companion * companion;
+    }
+    return result;
+  }
+
+  int order;
+  vector<double> b;
+  vector<double> a;
+};
+
+// Runs fn(chunk) for chunk = 0, ..., num_chunks - 1, each on its own thread.
+void RunInParallel(int num_chunks, const std::function<void(int)>& fn) {
+  vector<std::thread> threads;
+  threads.reserve(num_chunks - 1);
+  for (int chunk = 1; chunk < num_chunks; ++chunk) {
+    threads.emplace_back(fn, chunk);
+  }
+  fn(0);
+  for (std::thread& thread : threads) {
+    thread.join();
+  }
+}
+
+// Adds to each row of chunk the solution of the homogeneous recursion whose
+// first recursion.order samples are the corresponding row of initial.
+void AddZeroInputResponse(const Recursion& recursion, const ArrayXXd& initial,
+                          ChunkMap* chunk) {
+  const int order = recursion.order;
+  const int num_samples = chunk->cols();
+  vector<double> response(order);
+  for (int channel = 0; channel < chunk->rows(); ++channel) {
+    const double threshold =
+        kNegligibleResponse * initial.row(channel).abs().maxCoeff();
+    if (threshold == 0.0) {
+      continue;
+    }
+    // response[n % order] holds the response at sample n.
+    int num_negligible = 0;
+    for (int n = 0; n < num_samples && num_negligible < order; ++n) {
+      double value;
+      if (n < order) {
+        value = initial(channel, n);
+      } else {
+        value = 0.0;
+        for (int k = 1; k <= order; ++k) {
+          value -= recursion.a[k] * response[(n - k) % order];
+        }
+      }
+      response[n % order] = value;
+      (*chunk)(channel, n) += value;
+      num_negligible = std::abs(value) < threshold ? num_negligible + 1 : 0;
+    }
+  }
+}
+
+// Filters chunk in place in double precision, a block at a time, with
+// process_block, and keeps the last order outputs at that precision in
+// output_tail. The chunk must have at least order samples.
+void FilterInDoublePrecision(
+    const std::function<void(ArrayXXd*)>& process_block, int order,
+    ChunkMap* chunk, ArrayXXd* output_tail) {
+  constexpr int kBlockSize = 256;
+  // The last order samples are a block of their own.
+  const int body_size = chunk->cols() - order;
+  ArrayXXd block;
+  for (int start = 0; start < body_size; start += kBlockSize) {
+    const int block_size = std::min(kBlockSize, body_size - start);
+    block = chunk->middleCols(start, block_size).cast<double>();
+    process_block(&block);
+    chunk->middleCols(start, block_size) = block.cast<float>();
+  }
+  *output_tail = chunk->rightCols(order).cast<double>();
+  process_block(output_tail);
+  chunk->rightCols(order) = output_tail->cast<float>();
+}
+
+// Filters signal in place by the cascade of recursions, starting from zero
+// state. filter_chunk(stage, chunk, output_tail) must filter chunk in place by
+// stage starting from zero state, and set output_tail to the last stage.order
+// outputs. Chunks have at least stage.order samples.
+void FilterInChunks(
+    const vector<Recursion>& stages,
+    const std::function<void(int, ChunkMap*, ArrayXXd*)>& filter_chunk,
+    int num_threads, ArrayXXf* signal) {
+  CHECK_GE(num_threads, 1);
+  const int num_channels = signal->rows();
+  const int num_samples = signal->cols();
+  int max_order = 0;
+  for (const Recursion& stage : stages) {
+    max_order = std::max(max_order, stage.order);
+  }
+  if (num_samples < max_order) {
+    // Too short to chunk at all; pad with zeros so that the one chunk is long
+    // enough.
+    ArrayXXf padded = ArrayXXf::Zero(num_channels, max_order);
+    padded.leftCols(num_samples) = *signal;
+    FilterInChunks(stages, filter_chunk, 1, &padded);
+    *signal = padded.leftCols(num_samples);
+    return;
+  }
+  const int num_chunks = std::max(
+      1, std::min<int>(num_threads,
+                       num_samples / std::max(kMinChunkSize, max_order)));
+  // All chunks but the last have the same size.
+  const int chunk_size = num_samples / num_chunks;
+  auto chunk_start = [chunk_size](int chunk) { return chunk * chunk_size; };
+  auto chunk_end = [chunk_size, num_chunks, num_samples](int chunk) {
+    return chunk == num_chunks - 1 ? num_samples : (chunk + 1) * chunk_size;
+  };
+
+  // The first samples of the zero-input response to add to each chunk for the
+  // stage in progress, and the input and zero-state output of that stage at
+  // the end of each chunk.
+  vector<ArrayXXd> initial_response(num_chunks);
+  vector<ArrayXXd> input_tail(num_chunks);
+  vector<ArrayXXd> output_tail(num_chunks);
+
+  for (int stage = 0; stage <= stages.size(); ++stage) {
+    // Completes the previous stage on each chunk and, with its true output
+    // as input, filters the chunk by this stage from zero state.
+    RunInParallel(num_chunks, [&](int chunk) {
+      ChunkMap chunk_map(signal->data() + chunk_start(chunk) * num_channels,
+                         num_channels, chunk_end(chunk) - chunk_start(chunk));
+      if (stage > 0 && chunk > 0) {
+        AddZeroInputResponse(stages[stage - 1], initial_response[chunk],
+                             &chunk_map);
+      }
+      if (stage < stages.size()) {
+        input_tail[chunk] =
+            chunk_map.rightCols(stages[stage].order).cast<double>();
+        filter_chunk(stage, &chunk_map, &output_tail[chunk]);
+      }
+    });
+    if (stage == stages.size() || num_chunks == 1) {
+      continue;
+    }
+
+    // Serially, finds where each chunk ends and hence the zero-input response
+    // that the next chunk is missing.
+    const Recursion& recursion = stages[stage];
+    const int order = recursion.order;
+    const MatrixXd advance = recursion.CompanionMatrixPower(chunk_size - order);
+    initial_response[0] = ArrayXXd::Zero(num_channels, order);
+    for (int chunk = 1; chunk < num_chunks; ++chunk) {
+      // The true output at the end of the previous chunk, the zero-state
+      // output plus the response advanced to the end of the chunk.
+      ArrayXXd& y = output_tail[chunk - 1];
+      const ArrayXXd& previous_initial = initial_response[chunk - 1];
+      for (int channel = 0; channel < num_channels; ++channel) {
+        const Eigen::VectorXd end_state =
+            advance * previous_initial.row(channel).reverse().matrix()
+                          .transpose();
+        y.row(channel) += end_state.reverse().array().transpose();
+      }
+      const ArrayXXd& x = input_tail[chunk - 1];
+      ArrayXXd& response = initial_response[chunk];
+      response.resize(num_channels, order);
+      for (int channel = 0; channel < num_channels; ++channel) {
+        for (int n = 0; n < order; ++n) {
+          // Samples before the chunk are at column order + (n - k) of the
+          // tails.
+          double value = 0.0;
+          for (int k = n + 1; k <= order; ++k) {
+            value += recursion.b[k] * x(channel, order + n - k) -
+                     recursion.a[k] * y(channel, order + n - k);
+          }
+          for (int k = 1; k <= n; ++k) {
+            value -= recursion.a[k] * response(channel, n - k);
+          }
+          response(channel, n) = value;
+        }
+      }
+    }
+  }
+}
+
+}  // namespace
+
+void FilterLongSignalParallel(const BiquadFilterCascadeCoefficients& coeffs,
+                              int num_threads, ArrayXXf* signal) {
+  vector<Recursion> stages;
+  for (const BiquadFilterCoefficients& stage_coeffs : coeffs.coeffs) {
+    stages.emplace_back(stage_coeffs.b, stage_coeffs.a);
+  }
+  const int num_channels = signal->rows();
+  // A biquad is well enough conditioned that its zero-state output in single
+  // precision determines the state at the end of the chunk accurately.
+  FilterInChunks(stages, [&](int stage, ChunkMap* chunk,
+                             ArrayXXd* output_tail) {
+    if (num_channels == 1) {
+      BiquadFilter<float> filter;
+      filter.Init(1, coeffs[stage]);
+      Eigen::Map<ArrayXf> samples(chunk->data(), chunk->cols());
+      filter.ProcessBlock(samples, &samples);
+    } else {
+      BiquadFilter<ArrayXf> filter;
+      filter.Init(num_channels, coeffs[stage]);
+      filter.ProcessBlock(*chunk, chunk);
+    }
+    *output_tail = chunk->rightCols(stages[stage].order).cast<double>();
+  }, num_threads, signal);
+}
+
+void FilterLongSignalParallel(const vector<double>& coeffs_b,
+                              const vector<double>& coeffs_a,
+                              int num_threads, ArrayXXf* signal) {
+  const Recursion recursion(coeffs_b, coeffs_a);
+  const int num_channels = signal->rows();
+  // The state at the end of a chunk is found from the last outputs through a
+  // high-order direct form recursion, which amplifies their rounding errors
+  // when poles are close together, so the zero-state outputs are computed in
+  // double precision.
+  FilterInChunks({recursion}, [&](int, ChunkMap* chunk,
+                                  ArrayXXd* output_tail) {
+    if (num_channels == 1) {
+      LadderFilter<double> filter;
+      filter.InitFromTransferFunction(1, coeffs_b, coeffs_a);
+      FilterInDoublePrecision([&filter](ArrayXXd* block) {
+        Eigen::Map<Eigen::ArrayXd> samples(block->data(), block->size());
+        filter.ProcessBlock(samples, &samples);
+      }, recursion.order, chunk, output_tail);
+    } else {
+      LadderFilter<Eigen::ArrayXd> filter;
+      filter.InitFromTransferFunction(num_channels, coeffs_b, coeffs_a);
+      FilterInDoublePrecision([&filter](ArrayXXd* block) {
+        filter.ProcessBlock(*block, block);
+      }, recursion.order, chunk, output_tail);
+    }
+  }, num_threads, signal);
+}
+
+}  // namespace linear_filters
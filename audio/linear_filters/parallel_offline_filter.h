@@ -0,0 +1,72 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Offline IIR filtering of long signals on several threads.
+//
+// A recursive filter must normally run serially over time. Since the filter is
+// linear, the signal can instead be split into chunks that are filtered in
+// parallel from zero state. The output of a chunk then differs from the
+// serial output only by the zero-input response to the filter state at the
+// start of the chunk. That response is determined by the last few inputs and
+// outputs of the previous chunk, and where the previous chunk ends is found
+// without running over it by raising the companion matrix of the recursion to
+// the chunk length. So after the parallel pass, a short serial pass over the
+// chunk boundaries finds every chunk's initial state, and a second parallel
+// pass adds the responses, stopping early once they decay below rounding
+// error. Biquad cascades are processed a stage at a time this way, which is
+// numerically better than multiplying out a single high-order recursion.
+//
+// The result equals that of filtering serially from zero state, e.g. with
+// BiquadFilterCascade or LadderFilter, up to rounding error.
+//
+// Example use:
+//   BiquadFilterCascadeCoefficients coeffs = ...
+//   ArrayXXf signal = ...  // An hour of audio, one row per channel.
+//   FilterLongSignalParallel(coeffs, std::thread::hardware_concurrency(),
+//                            &signal);
+
+#ifndef AUDIO_LINEAR_FILTERS_PARALLEL_OFFLINE_FILTER_H_
+#define AUDIO_LINEAR_FILTERS_PARALLEL_OFFLINE_FILTER_H_
+
+#include <vector>
+
+#include "audio/linear_filters/biquad_filter_coefficients.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+
+// Filters each row of signal in place with the biquad cascade, starting from
+// zero state, using up to num_threads threads. Signals too short to benefit
+// are filtered serially.
+void FilterLongSignalParallel(const BiquadFilterCascadeCoefficients& coeffs,
+                              int num_threads, Eigen::ArrayXXf* signal);
+
+// Filters each row of signal in place with the rational transfer function
+//   H(z) = (b[0] + b[1] z^-1 + ...) / (a[0] + a[1] z^-1 + ...),
+// as LadderFilter::InitFromTransferFunction(), starting from zero state,
+// using up to num_threads threads. The zero-state chunks are filtered with
+// LadderFilter in double precision, since a single high-order recursion
+// needs it to find the chunk boundary states accurately.
+void FilterLongSignalParallel(const std::vector<double>& coeffs_b,
+                              const std::vector<double>& coeffs_a,
+                              int num_threads, Eigen::ArrayXXf* signal);
+
+}  // namespace linear_filters
+
+#endif  // AUDIO_LINEAR_FILTERS_PARALLEL_OFFLINE_FILTER_H_
@@ -0,0 +1,131 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/parallel_offline_filter.h"
+
+#include <vector>
+
+#include "audio/dsp/testing_util.h"
+#include "audio/linear_filters/biquad_filter.h"
+#include "audio/linear_filters/biquad_filter_coefficients.h"
+#include "audio/linear_filters/biquad_filter_design.h"
+#include "audio/linear_filters/ladder_filter.h"
+#include "benchmark/benchmark.h"
+#include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+namespace {
+
+using ::Eigen::ArrayXf;
+using ::Eigen::ArrayXXf;
+using ::std::vector;
+
+constexpr float kSampleRateHz = 48000.0f;
+
+BiquadFilterCascadeCoefficients MakeCascade() {
+  return BiquadFilterCascadeCoefficients(
+      {LowpassBiquadFilterCoefficients(kSampleRateHz, 4000, 0.707),
+       HighpassBiquadFilterCoefficients(kSampleRateHz, 200, 0.707),
+       // A narrow resonance, whose zero-input response lasts for thousands of
+       // samples.
+       BandpassBiquadFilterCoefficients(kSampleRateHz, 1000, 50.0)});
+}
+
+ArrayXXf FilterSerially(const BiquadFilterCascadeCoefficients& coeffs,
+                        const ArrayXXf& input) {
+  BiquadFilterCascade<ArrayXf> filter;
+  filter.Init(input.rows(), coeffs);
+  ArrayXXf output;
+  filter.ProcessBlock(input, &output);
+  return output;
+}
+
+TEST(ParallelOfflineFilterTest, BiquadCascadeMatchesSerialFilter) {
+  const BiquadFilterCascadeCoefficients coeffs = MakeCascade();
+  for (int num_channels : {1, 3}) {
+    const ArrayXXf input = ArrayXXf::Random(num_channels, 50000);
+    const ArrayXXf expected = FilterSerially(coeffs, input);
+    for (int num_threads : {1, 2, 3, 8}) {
+      SCOPED_TRACE(testing::Message() << "num_channels: " << num_channels
+                                      << ", num_threads: " << num_threads);
+      ArrayXXf signal = input;
+      FilterLongSignalParallel(coeffs, num_threads, &signal);
+      EXPECT_THAT(signal, audio_dsp::EigenArrayNear(expected, 1e-4));
+    }
+  }
+}
+
+TEST(ParallelOfflineFilterTest, TransferFunctionMatchesLadderFilter) {
+  vector<double> coeffs_b;
+  vector<double> coeffs_a;
+  MakeCascade().AsPolynomialRatio(&coeffs_b, &coeffs_a);
+  for (int num_channels : {1, 2}) {
+    const ArrayXXf input = ArrayXXf::Random(num_channels, 40000);
+    LadderFilter<ArrayXf> ladder;
+    ladder.InitFromTransferFunction(num_channels, coeffs_b, coeffs_a);
+    ArrayXXf expected;
+    ladder.ProcessBlock(input, &expected);
+    for (int num_threads : {1, 4, 9}) {
+      SCOPED_TRACE(testing::Message() << "num_channels: " << num_channels
+                                      << ", num_threads: " << num_threads);
+      ArrayXXf signal = input;
+      FilterLongSignalParallel(coeffs_b, coeffs_a, num_threads, &signal);
+      EXPECT_THAT(signal, audio_dsp::EigenArrayNear(expected, 1e-4));
+    }
+  }
+}
+
+TEST(ParallelOfflineFilterTest, ShortSignals) {
+  const BiquadFilterCascadeCoefficients coeffs = MakeCascade();
+  for (int num_samples : {0, 1, 2, 100, 8191, 8193}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    const ArrayXXf input = ArrayXXf::Random(2, num_samples);
+    ArrayXXf signal = input;
+    FilterLongSignalParallel(coeffs, 4, &signal);
+    EXPECT_THAT(signal,
+                audio_dsp::EigenArrayNear(FilterSerially(coeffs, input), 1e-4));
+  }
+}
+
+template <bool kParallel>
+void BM_FilterLongSignal(benchmark::State& state) {
+  const int num_channels = state.range(0);
+  constexpr int kNumSamples = 1 << 20;
+  const BiquadFilterCascadeCoefficients coeffs = MakeCascade();
+  const ArrayXXf input = ArrayXXf::Random(num_channels, kNumSamples);
+  ArrayXXf signal;
+  BiquadFilterCascade<ArrayXf> filter;
+  while (state.KeepRunning()) {
+    signal = input;
+    if (kParallel) {
+      FilterLongSignalParallel(coeffs, 4, &signal);
+    } else {
+      filter.Init(num_channels, coeffs);
+      filter.ProcessBlock(signal, &signal);
+    }
+    benchmark::DoNotOptimize(signal);
+  }
+  state.SetItemsProcessed(kNumSamples * state.iterations());
+}
+BENCHMARK_TEMPLATE(BM_FilterLongSignal, false)->Arg(1)->Arg(8);
+BENCHMARK_TEMPLATE(BM_FilterLongSignal, true)->Arg(1)->Arg(8)->UseRealTime();
+
+}  // namespace
+}  // namespace linear_filters
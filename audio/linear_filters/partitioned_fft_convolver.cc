@@ -0,0 +1,122 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/partitioned_fft_convolver.h"
+
+#include <algorithm>
+
+#include "audio/dsp/number_util.h"
+#include "glog/logging.h"
+
+namespace linear_filters {
+
+void PartitionedFftConvolver::Init(const Eigen::ArrayXXf& kernel,
+                                   int partition_size) {
+  CHECK_GT(kernel.rows(), 0);
+  CHECK_GT(kernel.cols(), 0);
+  CHECK_GT(partition_size, 0);
+  CHECK(audio_dsp::IsPowerOfTwoOrZero(partition_size))
+      << "partition_size must be a power of two, got " << partition_size;
+  num_channels_ = kernel.rows();
+  partition_size_ = partition_size;
+  num_partitions_ =
+      (kernel.cols() + partition_size_ - 1) / partition_size_;
+  const int fft_size = 2 * partition_size_;
+  fft_.Init(fft_size);
+  const int num_bins = fft_.num_bins();
+
+  partition_spectra_.resize(num_bins, num_partitions_ * num_channels_);
+  Eigen::ArrayXf padded_partition(fft_size);
+  for (int p = 0; p < num_partitions_; ++p) {
+    const int start = p * partition_size_;
+    const int size = std::min<int>(partition_size_, kernel.cols() - start);
+    for (int c = 0; c < num_channels_; ++c) {
+      padded_partition.setZero();
+      padded_partition.head(size) =
+          kernel.row(c).segment(start, size).transpose();
+      fft_.ForwardTransform(padded_partition,
+                            partition_spectra_.col(p * num_channels_ + c));
+    }
+  }
+  partition_spectra_ *= 1.0f / fft_size;
+
+  frame_spectra_.resize(num_bins, num_partitions_ * num_channels_);
+  delayed_sum_.resize(num_bins, num_channels_);
+  history_.resize(fft_size, num_channels_);
+  spectrum_workspace_.resize(num_bins);
+  time_workspace_.resize(fft_size);
+  Reset();
+}
+
+void PartitionedFftConvolver::Reset() {
+  frame_spectra_.setZero();
+  current_slot_ = 0;
+  delayed_sum_.setZero();
+  history_.setZero();
+  num_filled_ = 0;
+}
+
+void PartitionedFftConvolver::ProcessBlock(
+    const Eigen::Ref<const Eigen::ArrayXXf>& input,
+    Eigen::Ref<Eigen::ArrayXXf> output) {
+  DCHECK_NE(num_channels_, 0) << "You must call Init() first!";
+  DCHECK_EQ(input.rows(), num_channels_);
+  DCHECK_EQ(output.rows(), num_channels_);
+  DCHECK_EQ(output.cols(), input.cols());
+  for (int start = 0; start < input.cols();) {
+    const int num_samples =
+        std::min<int>(partition_size_ - num_filled_, input.cols() - start);
+    const int frame_offset = partition_size_ + num_filled_;
+    history_.middleRows(frame_offset, num_samples) =
+        input.middleCols(start, num_samples).transpose();
+    for (int c = 0; c < num_channels_; ++c) {
+      // The current slot is overwritten until the frame is complete.
+      auto frame_spectrum =
+          frame_spectra_.col(current_slot_ * num_channels_ + c);
+      fft_.ForwardTransform(history_.col(c), frame_spectrum);
+      spectrum_workspace_ =
+          frame_spectrum * partition_spectra_.col(c) + delayed_sum_.col(c);
+      fft_.InverseTransform(spectrum_workspace_, time_workspace_);
+      output.row(c).segment(start, num_samples) =
+          time_workspace_.segment(frame_offset, num_samples).transpose();
+    }
+    num_filled_ += num_samples;
+    start += num_samples;
+    if (num_filled_ == partition_size_) {
+      FinishFrame();
+    }
+  }
+}
+
+void PartitionedFftConvolver::FinishFrame() {
+  history_.topRows(partition_size_) = history_.bottomRows(partition_size_);
+  history_.bottomRows(partition_size_).setZero();
+  num_filled_ = 0;
+
+  // The frame that was just completed is delayed by one partition relative to
+  // the next frame, and so on.
+  delayed_sum_.setZero();
+  for (int k = 1; k < num_partitions_; ++k) {
+    const int slot = (current_slot_ + 1 - k + num_partitions_) %
+        num_partitions_;
+    delayed_sum_ +=
+        frame_spectra_.middleCols(slot * num_channels_, num_channels_) *
+        partition_spectra_.middleCols(k * num_channels_, num_channels_);
+  }
+  current_slot_ = (current_slot_ + 1) % num_partitions_;
+}
+
+}  // namespace linear_filters
@@ -0,0 +1,100 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+// Uniformly partitioned overlap-save FFT convolution of a multichannel signal
+// with a per-channel FIR kernel. This is the engine behind FirFilter for long
+// kernels; most users should use FirFilter rather than this class directly.
+//
+// The kernel is split into partitions of B = partition_size taps and the input
+// into frames of B samples. Each frame is transformed once with a 2B-point
+// real FFT and kept in a frequency-domain delay line, so that the output is
+//   IFFT(sum_k frame_spectrum[m - k] * partition_spectrum[k]),
+// keeping the last B samples (overlap-save). The cost per sample is
+// O(log(B) + num_partitions) instead of the O(kernel size) of direct form.
+//
+// Unlike textbook overlap-save, no latency is added: the terms with k >= 1 are
+// accumulated once when a frame is complete, and every call to ProcessBlock()
+// transforms the partially filled current frame, zero padded, for the k = 0
+// term. Since the convolution is causal, the output samples for the filled part
+// of the frame are exact. Blocks of B samples aligned to frame boundaries cost
+// one forward and one inverse FFT per channel; smaller blocks cost that per
+// call, so B should not be much larger than the typical block size.
+
+#ifndef AUDIO_LINEAR_FILTERS_PARTITIONED_FFT_CONVOLVER_H_
+#define AUDIO_LINEAR_FILTERS_PARTITIONED_FFT_CONVOLVER_H_
+
+#include "audio/dsp/real_fft.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+
+class PartitionedFftConvolver {
+ public:
+  PartitionedFftConvolver()
+    : num_channels_(0 /* uninitialized */) {}
+
+  // kernel has one row per channel and at least one column. partition_size
+  // must be a power of two.
+  void Init(const Eigen::ArrayXXf& kernel, int partition_size);
+
+  void Reset();
+
+  // Process a block of samples. input and output have num_channels() rows and
+  // the same number of columns. For streaming, pass successive nonoverlapping
+  // blocks of samples. Does not allocate.
+  void ProcessBlock(const Eigen::Ref<const Eigen::ArrayXXf>& input,
+                    Eigen::Ref<Eigen::ArrayXXf> output);
+
+  int num_channels() const { return num_channels_; }
+  int partition_size() const { return partition_size_; }
+  int num_partitions() const { return num_partitions_; }
+
+ private:
+  // Called when the current frame is complete. Shifts the time-domain history
+  // and accumulates the delayed terms for the next frame.
+  void FinishFrame();
+
+  int num_channels_;
+  int partition_size_;
+  int num_partitions_;
+  audio_dsp::RealFft fft_;
+
+  // Spectra of the kernel partitions, scaled by 1 / fft_size to normalize the
+  // inverse FFT. Column p * num_channels_ + c is partition p of channel c.
+  Eigen::ArrayXXcf partition_spectra_;
+  // Frequency-domain delay line, a circular buffer of the last num_partitions_
+  // frame spectra laid out like partition_spectra_. current_slot_ holds the
+  // spectrum of the current, possibly partial, frame.
+  Eigen::ArrayXXcf frame_spectra_;
+  int current_slot_;
+  // sum_{k >= 1} frame_spectrum[m - k] * partition_spectrum[k] for the current
+  // frame m, one column per channel.
+  Eigen::ArrayXXcf delayed_sum_;
+  // The previous and current input frames, one column per channel. The
+  // samples after num_filled_ in the current frame are zero.
+  Eigen::ArrayXXf history_;
+  int num_filled_;
+
+  Eigen::ArrayXcf spectrum_workspace_;
+  Eigen::ArrayXf time_workspace_;
+};
+
+}  // namespace linear_filters
+
+#endif  // AUDIO_LINEAR_FILTERS_PARTITIONED_FFT_CONVOLVER_H_
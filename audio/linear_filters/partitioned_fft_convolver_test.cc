@@ -0,0 +1,108 @@
+/*
+ * Copyright 2018 Google LLC
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     https://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "audio/linear_filters/partitioned_fft_convolver.h"
+
+#include <algorithm>
+
+#include "audio/dsp/testing_util.h"
+#include "gtest/gtest.h"
+#include "third_party/eigen3/Eigen/Core"
+
+#include "audio/dsp/porting.h"  // auto-added.
+
+
+namespace linear_filters {
+namespace {
+
+using ::audio_dsp::EigenArrayNear;
+using ::Eigen::ArrayXXf;
+
+// Direct evaluation of the convolution, truncated to the input size.
+ArrayXXf NaiveConvolution(const ArrayXXf& kernel, const ArrayXXf& input) {
+  ArrayXXf output = ArrayXXf::Zero(input.rows(), input.cols());
+  for (int n = 0; n < input.cols(); ++n) {
+    for (int k = 0; k < kernel.cols() && k <= n; ++k) {
+      output.col(n) += kernel.col(k) * input.col(n - k);
+    }
+  }
+  return output;
+}
+
+TEST(PartitionedFftConvolverTest, Partitions) {
+  PartitionedFftConvolver convolver;
+  convolver.Init(ArrayXXf::Random(3, 100), 32);
+  EXPECT_EQ(convolver.num_channels(), 3);
+  EXPECT_EQ(convolver.partition_size(), 32);
+  EXPECT_EQ(convolver.num_partitions(), 4);
+}
+
+TEST(PartitionedFftConvolverTest, DelayedImpulse) {
+  constexpr int kDelay = 37;
+  ArrayXXf kernel = ArrayXXf::Zero(2, kDelay + 1);
+  kernel(0, kDelay) = 1.0f;
+  kernel(1, kDelay) = -2.0f;
+  PartitionedFftConvolver convolver;
+  convolver.Init(kernel, 8);
+
+  const ArrayXXf input = ArrayXXf::Random(2, 100);
+  ArrayXXf output(2, 100);
+  convolver.ProcessBlock(input, output);
+
+  ArrayXXf expected = ArrayXXf::Zero(2, 100);
+  expected.row(0).tail(100 - kDelay) = input.row(0).head(100 - kDelay);
+  expected.row(1).tail(100 - kDelay) = -2.0f * input.row(1).head(100 - kDelay);
+  EXPECT_THAT(output, EigenArrayNear(expected, 1e-5));
+}
+
+// Each call with blocks smaller than the partition size produces output right
+// away, without latency.
+TEST(PartitionedFftConvolverTest, StreamingSmallBlocks) {
+  constexpr int kNumSamples = 300;
+  const ArrayXXf kernel = ArrayXXf::Random(2, 70);
+  const ArrayXXf input = ArrayXXf::Random(2, kNumSamples);
+  const ArrayXXf expected = NaiveConvolution(kernel, input);
+
+  for (int block_size : {1, 5, 16, 17, 40}) {
+    SCOPED_TRACE("block_size: " + testing::PrintToString(block_size));
+    PartitionedFftConvolver convolver;
+    convolver.Init(kernel, 16);
+    ArrayXXf output(2, kNumSamples);
+    for (int start = 0; start < kNumSamples; start += block_size) {
+      const int num_samples = std::min(block_size, kNumSamples - start);
+      convolver.ProcessBlock(input.middleCols(start, num_samples),
+                             output.middleCols(start, num_samples));
+    }
+    EXPECT_THAT(output, EigenArrayNear(expected, 1e-5));
+  }
+}
+
+TEST(PartitionedFftConvolverTest, Reset) {
+  const ArrayXXf kernel = ArrayXXf::Random(1, 50);
+  const ArrayXXf input = ArrayXXf::Random(1, 90);
+  PartitionedFftConvolver convolver;
+  convolver.Init(kernel, 16);
+  ArrayXXf expected(1, 90);
+  convolver.ProcessBlock(input, expected);
+  convolver.ProcessBlock(input, expected);
+  convolver.Reset();
+  ArrayXXf output(1, 90);
+  convolver.ProcessBlock(input, output);
+  EXPECT_THAT(output, EigenArrayNear(NaiveConvolution(kernel, input), 1e-5));
+}
+
+}  // namespace
+}  // namespace linear_filters
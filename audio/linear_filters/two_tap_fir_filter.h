@@ -42,6 +42,7 @@ class TwoTapFirFilter {
 
   void Init(int num_channels) {
     num_channels_ = num_channels;
+    workspace_block_.resize(num_channels_, 0);
     Reset();
   }
 
@@ -49,27 +50,39 @@ class TwoTapFirFilter {
     state_ = Eigen::ArrayXf::Zero(num_channels_);
   }
 
-  // Process a block of samples. input is a 2D Eigen array with contiguous
-  // column-major data, where the number of rows equals GetNumChannels().
-  // &input = output is supported.
-  void ProcessBlock(const Eigen::ArrayXXf& input, Eigen::ArrayXXf* output) {
+  // Allocates the workspace for blocks of up to max_block_size_samples
+  // samples, so that ProcessBlock() does not allocate for such blocks unless it
+  // needs to resize the output. Without this, the workspace grows as needed.
+  void Prepare(int max_block_size_samples) {
+    DCHECK_GE(max_block_size_samples, 0);
+    workspace_block_.resize(num_channels_, max_block_size_samples);
+  }
+
+  // Process a block of samples. input and output are 2D Eigen types with
+  // contiguous column-major data like ArrayXXf (or a block of its columns),
+  // where the number of rows equals GetNumChannels(). &input = output is
+  // supported.
+  template <typename InputType, typename OutputType>
+  void ProcessBlock(const InputType& input, OutputType* output) {
     DCHECK_EQ(input.rows(), num_channels_);
-    // Resize is a no-op if the shape doesn't change, but this probably
-    // should be improved if the number of input samples is expected to be
-    // changing.
-    workspace_block_.resize(input.rows(), input.cols());
+    const int num_samples = input.cols();
+    if (workspace_block_.cols() < num_samples) {
+      workspace_block_.resize(num_channels_, num_samples);
+    }
+    auto workspace = workspace_block_.leftCols(num_samples);
 
-    if (input.cols() > 0) {
-      const int cols_minus_one = input.cols() - 1;
+    if (num_samples > 0) {
+      const int cols_minus_one = num_samples - 1;
       if (cols_minus_one > 0) {
-          workspace_block_.rightCols(cols_minus_one) =
+          workspace.rightCols(cols_minus_one) =
             gain_now_ * input.rightCols(cols_minus_one) +
             gain_prev_ * input.leftCols(cols_minus_one);
       }
-      workspace_block_.col(0) = gain_now_ * input.col(0) + gain_prev_ * state_;
+      workspace.col(0) = gain_now_ * input.col(0) + gain_prev_ * state_;
       state_ = input.rightCols(1);
     }
-    workspace_block_.swap(*output);
+    output->resize(num_channels_, num_samples);
+    *output = workspace;
   }
 
  private:
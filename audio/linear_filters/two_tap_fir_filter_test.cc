@@ -16,6 +16,7 @@
 
 #include "audio/linear_filters/two_tap_fir_filter.h"
 
+#include "audio/dsp/heap_allocation_counter.h"
 #include "audio/dsp/testing_util.h"
 #include "benchmark/benchmark.h"
 #include "gtest/gtest.h"
@@ -162,6 +163,31 @@ TEST(TwoTapFirTest, NoSamplesTest) {
   EXPECT_EQ(data.cols(), 0);
 }
 
+TEST(TwoTapFirTest, PreparedDoesNotAllocate) {
+  constexpr int kMaxBlockSize = 32;
+  FirstDifferenceFilter filter;
+  filter.Init(3);
+  filter.Prepare(kMaxBlockSize);
+  ArrayXXf buffer = ArrayXXf::Random(3, kMaxBlockSize);
+  for (int num_samples : {kMaxBlockSize, 7, 1, 0, 20}) {
+    SCOPED_TRACE("num_samples: " + testing::PrintToString(num_samples));
+    auto block = buffer.leftCols(num_samples);
+    const ArrayXXf input = block;
+    FirstDifferenceFilter reference;
+    reference.Init(3);
+    ArrayXXf expected;
+    reference.ProcessBlock(input, &expected);
+
+    filter.Reset();
+    {
+      audio_dsp::ScopedHeapAllocationCounter counter;
+      filter.ProcessBlock(block, &block);
+      EXPECT_EQ(counter.num_allocations(), 0);
+    }
+    EXPECT_THAT(block, audio_dsp::EigenArrayNear(expected, 1e-10));
+  }
+}
+
 // Run on lpac14 (32 X 2600 MHz CPUs); 2017-03-06T17:07:58.242651049-08:00
 // CPU: Intel Sandybridge with HyperThreading (16 cores)
 // Benchmark             Time(ns)     CPU(ns)     Iterations